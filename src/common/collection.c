@@ -84,6 +84,7 @@ const dt_collection_t *dt_collection_new(const dt_collection_t *clone)
     collection->where_ext = g_strdupv(clone->where_ext);
     collection->query = g_strdup(clone->query);
     collection->query_no_group = g_strdup(clone->query_no_group);
+    collection->where_no_group = g_strdup(clone->where_no_group);
     collection->clone = 1;
     collection->count = clone->count;
     collection->count_no_group = clone->count_no_group;
@@ -110,6 +111,7 @@ void dt_collection_free(const dt_collection_t *collection)
 
   g_free(collection->query);
   g_free(collection->query_no_group);
+  g_free(collection->where_no_group);
   g_strfreev(collection->where_ext);
   g_free((dt_collection_t *)collection);
 }
@@ -141,15 +143,19 @@ static char * and_operator(int *term)
   assert(0); // Not reached.
 }
 
-void dt_collection_memory_update()
+// maximum number of changed images handled by updating the rows of
+// memory.collected_images instead of running the collection query again
+#define DT_COLLECTION_MAX_DELTA 256
+
+// the query memory.collected_images has been filled with
+static gchar *_memory_query = NULL;
+// incremented for each update of memory.collected_images
+static uint32_t _memory_generation = 0;
+
+static void _collection_memory_rebuild(const gchar *query)
 {
-  if(!darktable.collection || !darktable.db) return;
   sqlite3_stmt *stmt;
 
-  /* check if we can get a query from collection */
-  gchar *query = g_strdup(dt_collection_get_query(darktable.collection));
-  if(!query) return;
-
   // we have a new query for the collection of images to display. For
   // speed reason we collect all images into a temporary (in-memory)
   // table (collected_images).
@@ -176,8 +182,189 @@ void dt_collection_memory_update()
   sqlite3_step(stmt);
   sqlite3_finalize(stmt);
 
-  g_free(query);
   g_free(ins_query);
+
+  g_free(_memory_query);
+  _memory_query = g_strdup(query);
+}
+
+// update memory.collected_images after a change of the given images
+// without running the collection query again. This handles images
+// leaving the collection, FALSE is returned if a full rebuild is
+// needed as images entered the collection or the order might have
+// changed.
+static gboolean _collection_memory_delta(const dt_collection_t *collection,
+                                         const dt_collection_properties_t changed_property,
+                                         GList *list,
+                                         int *removed)
+{
+  const gboolean *sorts = collection->params.sorts;
+  const gboolean use_sort = collection->params.query_flags & COLLECTION_QUERY_USE_SORT;
+  gboolean sorted = FALSE;
+
+  if(changed_property == DT_COLLECTION_PROP_RATING
+     || changed_property == DT_COLLECTION_PROP_RATING_RANGE)
+    sorted = sorts[DT_COLLECTION_SORT_RATING];
+  else if(changed_property == DT_COLLECTION_PROP_COLORLABEL)
+    sorted = sorts[DT_COLLECTION_SORT_COLOR];
+  else if(changed_property == DT_COLLECTION_PROP_TAG)
+    sorted = sorts[DT_COLLECTION_SORT_CUSTOM_ORDER];
+  else if(changed_property >= DT_COLLECTION_PROP_METADATA
+          && changed_property < DT_COLLECTION_PROP_METADATA + DT_METADATA_NUMBER)
+    sorted = sorts[DT_COLLECTION_SORT_TITLE] || sorts[DT_COLLECTION_SORT_DESCRIPTION];
+  else if(changed_property != DT_COLLECTION_PROP_GEOTAGGING)
+    return FALSE;
+
+  if((use_sort && sorted)
+     || !collection->where_no_group
+     || g_list_length(list) > DT_COLLECTION_MAX_DELTA)
+    return FALSE;
+
+  gchar *ids = NULL;
+  for(GList *l = list; l; l = g_list_next(l))
+    dt_util_str_cat(&ids, "%s%d", ids ? "," : "", GPOINTER_TO_INT(l->data));
+
+  // the representative of a group may change with any of its images
+  // clang-format off
+  gchar *group_ids = g_strdup_printf
+    ("SELECT id FROM main.images"
+     " WHERE group_id IN (SELECT group_id FROM main.images WHERE id IN (%s))",
+     ids);
+
+  // same selection as dt_collection_update() but limited to these groups
+  gchar *where = NULL;
+  if(darktable.gui && darktable.gui->grouping)
+    where = g_strdup_printf
+      ("mi.id IN (%s)"
+       " AND (%s AND (group_id = %d OR "
+       "mi.id IN (SELECT id FROM "
+       "(SELECT id,"
+       "        MIN(ABS(id-group_id)*2 + CASE WHEN (id-group_id) < 0 THEN 1 ELSE 0 END)"
+       " FROM main.images AS mi WHERE %s"
+       "   AND group_id IN (SELECT group_id FROM main.images WHERE id IN (%s))"
+       " GROUP BY group_id))) OR (mi.id = %d))",
+       group_ids, collection->where_no_group, darktable.gui->expanded_group_id,
+       collection->where_no_group, ids, darktable.gui->expanded_group_id);
+  else
+    where = g_strdup_printf("mi.id IN (%s) AND (%s)", group_ids, collection->where_no_group);
+  // clang-format on
+
+  sqlite3_stmt *stmt;
+  gboolean entered = FALSE;
+
+  // 1. images entering the collection need a full rebuild to get their position
+  gchar *query = g_strdup_printf("SELECT 1 FROM main.images AS mi"
+                                 " WHERE %s"
+                                 "   AND mi.id NOT IN (SELECT imgid FROM memory.collected_images)"
+                                 " LIMIT 1",
+                                 where);
+  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db), query, -1, &stmt, NULL);
+  entered = sqlite3_step(stmt) == SQLITE_ROW;
+  sqlite3_finalize(stmt);
+  g_free(query);
+
+  // 2. rows of images leaving the collection
+  GArray *rows = g_array_new(FALSE, FALSE, sizeof(int));
+  if(!entered)
+  {
+    // clang-format off
+    query = g_strdup_printf("SELECT rowid FROM memory.collected_images"
+                            " WHERE imgid IN (%s)"
+                            "   AND imgid NOT IN (SELECT mi.id FROM main.images AS mi WHERE %s)"
+                            " ORDER BY rowid",
+                            group_ids, where);
+    // clang-format on
+    DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db), query, -1, &stmt, NULL);
+    while(sqlite3_step(stmt) == SQLITE_ROW)
+    {
+      const int rowid = sqlite3_column_int(stmt, 0);
+      g_array_append_val(rows, rowid);
+    }
+    sqlite3_finalize(stmt);
+    g_free(query);
+  }
+  *removed = rows->len;
+
+  // 3. remove them and close the gaps, rowid is used as the position
+  //    of the images by the views. each range between two removed rows
+  //    is moved down in increasing order so the new rowid is always free.
+  if(rows->len)
+  {
+    gchar *rowids = NULL;
+    for(guint k = 0; k < rows->len; k++)
+      dt_util_str_cat(&rowids, "%s%d", rowids ? "," : "", g_array_index(rows, int, k));
+    query = g_strdup_printf("DELETE FROM memory.collected_images WHERE rowid IN (%s)", rowids);
+    DT_DEBUG_SQLITE3_EXEC(dt_database_get(darktable.db), query, NULL, NULL, NULL);
+    g_free(query);
+    g_free(rowids);
+
+    // clang-format off
+    DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db),
+                                "UPDATE memory.collected_images SET rowid = rowid - ?1"
+                                " WHERE rowid > ?2 AND rowid < ?3",
+                                -1, &stmt, NULL);
+    // clang-format on
+    for(guint k = 0; k < rows->len; k++)
+    {
+      DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, k + 1);
+      DT_DEBUG_SQLITE3_BIND_INT(stmt, 2, g_array_index(rows, int, k));
+      DT_DEBUG_SQLITE3_BIND_INT(stmt, 3, k + 1 < rows->len ? g_array_index(rows, int, k + 1) : INT_MAX);
+      sqlite3_step(stmt);
+      sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+  }
+
+  g_array_free(rows, TRUE);
+  g_free(where);
+  g_free(group_ids);
+  g_free(ids);
+
+  return !entered;
+}
+
+static void _collection_memory_update(const dt_collection_t *collection,
+                                      const dt_collection_change_t query_change,
+                                      const dt_collection_properties_t changed_property,
+                                      GList *list)
+{
+  if(!collection || !darktable.db) return;
+
+  /* check if we can get a query from collection */
+  const gchar *query = dt_collection_get_query(collection);
+  if(!query) return;
+
+  const double start = dt_get_debug_wtime();
+  _memory_generation++;
+
+  int removed = 0;
+  if(query_change == DT_COLLECTION_CHANGE_RELOAD
+     && list
+     && !g_strcmp0(query, _memory_query)
+     && _collection_memory_delta(collection, changed_property, list, &removed))
+  {
+    dt_print(DT_DEBUG_SQL,
+             "[collection_memory_update] %d changed images, %d removed in %.4f secs",
+             g_list_length(list), removed, dt_get_debug_wtime() - start);
+    return;
+  }
+
+  _collection_memory_rebuild(query);
+
+  dt_print(DT_DEBUG_SQL,
+           "[collection_memory_update] full rebuild, %d images in %.4f secs",
+           sqlite3_changes(dt_database_get(darktable.db)), dt_get_debug_wtime() - start);
+}
+
+void dt_collection_memory_update()
+{
+  _collection_memory_update(darktable.collection,
+                            DT_COLLECTION_CHANGE_NEW_QUERY, DT_COLLECTION_PROP_UNDEF, NULL);
+}
+
+uint32_t dt_collection_memory_generation()
+{
+  return _memory_generation;
 }
 
 static void _dt_collection_set_selq_pre_sort(const dt_collection_t *collection,
@@ -365,6 +552,8 @@ int dt_collection_update(const dt_collection_t *collection)
                   (collection->params.query_flags & COLLECTION_QUERY_USE_LIMIT)
                   ? " " LIMIT_QUERY : "");
   result = _dt_collection_store(collection, query, query_no_group);
+  g_free(collection->where_no_group);
+  ((dt_collection_t *)collection)->where_no_group = g_strdup(wq_no_group);
 
   /* free memory used */
   g_free(sq);
@@ -2701,7 +2890,7 @@ void dt_collection_update_query(const dt_collection_t *collection,
   /* raise signal of collection change, only if this is an original */
   if(!collection->clone)
   {
-    dt_collection_memory_update();
+    _collection_memory_update(collection, query_change, changed_property, list);
     DT_CONTROL_SIGNAL_RAISE(DT_SIGNAL_COLLECTION_CHANGED,
                             query_change, changed_property,
                             list, next);
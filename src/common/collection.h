@@ -156,6 +156,7 @@ typedef struct dt_collection_t
 {
   int clone;
   gchar *query, *query_no_group;
+  gchar *where_no_group; // where part of query_no_group, used to update single images
   gchar **where_ext;
   uint32_t count, count_no_group;
   uint32_t tagid;
@@ -271,6 +272,9 @@ void dt_collection_move_before(const dt_imgid_t image_id, GList * selected_image
 
 /* initialize memory table */
 void dt_collection_memory_update();
+/* number of updates of the memory table so far, lets callers caching its content
+   detect that it is outdated */
+uint32_t dt_collection_memory_generation();
 
 /** save the current collection for recentcollect module and collect history */
 void dt_collection_history_save();
@@ -27,6 +27,25 @@
 
 typedef DT_ALIGNED_PIXEL uint32_t dt_aligned_weights_t[4];
 
+// side of the tiles of which the table keeps the min and max
+#define TABLE_TILE 16
+
+struct dt_color_picker_table_t
+{
+  int width, height;
+  // the picked pixels, either the caller's buffer or the denoised copy
+  const float *pixel;
+  float *denoised;
+  // (width + 1) x (height + 1) summed-area table, the first row and
+  // column being zero. double as a float sum loses the precision of
+  // small boxes far from the origin
+  double *sum;
+  // per-channel min and max of the TABLE_TILE x TABLE_TILE tiles
+  float *tile_low;
+  float *tile_high;
+  int tiles_x, tiles_y;
+};
+
 static inline size_t _box_size(const int *const box)
 {
   return (size_t)((box[3] - box[1]) * (box[2] - box[0]));
@@ -416,6 +435,30 @@ gboolean dt_color_picker_box(dt_iop_module_t *module,
   return (box[2] - box[0] < 1) || (box[3] - box[1] < 1);
 }
 
+static float *_denoise(const float *const pixel,
+                       const dt_iop_roi_t *const roi)
+{
+  float *const denoised = dt_alloc_align_float(4 * roi->width * roi->height);
+  if(denoised)
+  {
+    size_t padded_size;
+    float *const tempbuf =
+      dt_alloc_perthread_float(4 * roi->width, &padded_size); //TODO: alloc in caller
+
+    // blur without clipping negatives because Lab a and b channels can be
+    // legitimately negative
+    // FIXME: this blurs whole image even when just a bit is sampled in the
+    // case of CPU path
+    blur_2D_Bspline(pixel, denoised, tempbuf, padded_size,
+                    roi->width, roi->height, 1, FALSE);
+    dt_free_align(tempbuf);
+  }
+  else
+    dt_print(DT_DEBUG_ALWAYS,
+             "[color picker] unable to alloc working memory, denoising skipped");
+  return denoised;
+}
+
 void dt_color_picker_helper(const dt_iop_buffer_dsc_t *dsc,
                             const float *const pixel,
                             const dt_iop_roi_t *roi,
@@ -438,31 +481,8 @@ void dt_color_picker_helper(const dt_iop_buffer_dsc_t *dsc,
 
   if(dsc->channels == 4u)
   {
-    float *restrict denoised = NULL;
-    const float *source = pixel;
-    if(denoise)
-    {
-      // Denoise the image
-      size_t padded_size;
-      denoised = dt_alloc_align_float(4 * roi->width * roi->height);
-      if(denoised)
-      {
-        float *const tempbuf =
-          dt_alloc_perthread_float(4 * roi->width, &padded_size); //TODO: alloc in caller
-
-        // blur without clipping negatives because Lab a and b channels can be
-        // legitimately negative
-        // FIXME: this blurs whole image even when just a bit is sampled in the
-        // case of CPU path
-        blur_2D_Bspline(pixel, denoised, tempbuf, padded_size,
-                        roi->width, roi->height, 1, FALSE);
-        dt_free_align(tempbuf);
-        source = denoised;
-      }
-      else
-        dt_print(DT_DEBUG_ALWAYS,
-                 "[color picker] unable to alloc working memory, denoising skipped");
-    }
+    float *restrict denoised = denoise ? _denoise(pixel, roi) : NULL;
+    const float *source = denoised ? denoised : pixel;
 
     // 4-channel raw images are monochrome, can be read as RGB
     const dt_iop_colorspace_type_t effective_cst =
@@ -524,6 +544,182 @@ void dt_color_picker_helper(const dt_iop_buffer_dsc_t *dsc,
            dt_get_lap_time(&start_time.clock), dt_get_lap_utime(&start_time.user));
 }
 
+dt_color_picker_table_t *dt_color_picker_table_new(const float *const pixel,
+                                                   const dt_iop_roi_t *const roi,
+                                                   const gboolean denoise)
+{
+  dt_times_t start_time = { 0 };
+  dt_get_perf_times(&start_time);
+
+  const int width = roi->width;
+  const int height = roi->height;
+  const size_t stride = 4 * ((size_t)width + 1);
+
+  dt_color_picker_table_t *table = calloc(1, sizeof(dt_color_picker_table_t));
+  if(!table) return NULL;
+
+  table->width = width;
+  table->height = height;
+  table->tiles_x = (width + TABLE_TILE - 1) / TABLE_TILE;
+  table->tiles_y = (height + TABLE_TILE - 1) / TABLE_TILE;
+  table->denoised = denoise ? _denoise(pixel, roi) : NULL;
+  table->pixel = table->denoised ? table->denoised : pixel;
+  table->sum = dt_alloc_aligned(sizeof(double) * stride * (height + 1));
+  table->tile_low = dt_alloc_align_float(4 * (size_t)table->tiles_x * table->tiles_y);
+  table->tile_high = dt_alloc_align_float(4 * (size_t)table->tiles_x * table->tiles_y);
+  if(!table->sum || !table->tile_low || !table->tile_high)
+  {
+    dt_color_picker_table_free(table);
+    return NULL;
+  }
+
+  const float *const restrict in = table->pixel;
+  double *const restrict sum = table->sum;
+
+  // running sums along the rows
+  memset(sum, 0, sizeof(double) * stride);
+  DT_OMP_FOR()
+  for(int j = 0; j < height; j++)
+  {
+    const float *const restrict row = in + (size_t)4 * width * j;
+    double *const restrict out = sum + stride * (j + 1);
+    double DT_ALIGNED_PIXEL acc[4] = { 0.0, 0.0, 0.0, 0.0 };
+    for_four_channels(c) out[c] = 0.0;
+    for(int i = 0; i < width; i++)
+      for_four_channels(c)
+      {
+        acc[c] += row[4 * i + c];
+        out[4 * (i + 1) + c] = acc[c];
+      }
+  }
+
+  // then down the columns, in strips of a cache line so that all
+  // threads walk their own memory
+  const size_t strip = DT_CACHELINE_BYTES / sizeof(double);
+  DT_OMP_FOR()
+  for(size_t x0 = 0; x0 < stride; x0 += strip)
+  {
+    const size_t x1 = MIN(stride, x0 + strip);
+    for(int j = 1; j < height; j++)
+    {
+      double *const restrict out = sum + stride * (j + 1);
+      const double *const restrict above = sum + stride * j;
+      for(size_t x = x0; x < x1; x++)
+        out[x] += above[x];
+    }
+  }
+
+  // min and max of the tiles
+  DT_OMP_FOR()
+  for(int ty = 0; ty < table->tiles_y; ty++)
+  {
+    float *const restrict low = table->tile_low + (size_t)4 * table->tiles_x * ty;
+    float *const restrict high = table->tile_high + (size_t)4 * table->tiles_x * ty;
+    for(int tx = 0; tx < table->tiles_x; tx++)
+      for_four_channels(c)
+      {
+        low[4 * tx + c] = FLT_MAX;
+        high[4 * tx + c] = -FLT_MAX;
+      }
+    for(int j = ty * TABLE_TILE; j < MIN(height, (ty + 1) * TABLE_TILE); j++)
+      for(int i = 0; i < width; i++)
+      {
+        const float *const restrict px = in + (size_t)4 * (width * j + i);
+        const int tx = i / TABLE_TILE;
+        for_four_channels(c)
+        {
+          low[4 * tx + c] = MIN(low[4 * tx + c], px[c]);
+          high[4 * tx + c] = MAX(high[4 * tx + c], px[c]);
+        }
+      }
+  }
+
+  dt_print(DT_DEBUG_PERF,
+           "dt_color_picker_table_new %dx%d denoised %d took %.3f secs (%.3f CPU)",
+           width, height, table->denoised != NULL,
+           dt_get_lap_time(&start_time.clock), dt_get_lap_utime(&start_time.user));
+
+  return table;
+}
+
+void dt_color_picker_table_free(dt_color_picker_table_t *table)
+{
+  if(!table) return;
+  dt_free_align(table->denoised);
+  dt_free_align(table->sum);
+  dt_free_align(table->tile_low);
+  dt_free_align(table->tile_high);
+  free(table);
+}
+
+static inline void _table_scan(const dt_color_picker_table_t *const table,
+                               const int x0,
+                               const int y0,
+                               const int x1,
+                               const int y1,
+                               dt_aligned_pixel_t low,
+                               dt_aligned_pixel_t high)
+{
+  for(int j = y0; j < y1; j++)
+    for(int i = x0; i < x1; i++)
+    {
+      const float *const px = table->pixel + (size_t)4 * (table->width * j + i);
+      for_four_channels(c, aligned(low,high:16))
+      {
+        low[c] = MIN(low[c], px[c]);
+        high[c] = MAX(high[c], px[c]);
+      }
+    }
+}
+
+void dt_color_picker_table_stats(const dt_color_picker_table_t *const table,
+                                 const int *const box,
+                                 lib_colorpicker_stats pick)
+{
+  const size_t stride = 4 * ((size_t)table->width + 1);
+  const double *const s00 = table->sum + stride * box[1] + 4 * box[0];
+  const double *const s01 = table->sum + stride * box[1] + 4 * box[2];
+  const double *const s10 = table->sum + stride * box[3] + 4 * box[0];
+  const double *const s11 = table->sum + stride * box[3] + 4 * box[2];
+  const double size = _box_size(box);
+
+  dt_aligned_pixel_t low = { FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX };
+  dt_aligned_pixel_t high = { -FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+  // the tiles completely inside the box, the pixels around them are
+  // looked at one by one
+  const int tx0 = (box[0] + TABLE_TILE - 1) / TABLE_TILE;
+  const int ty0 = (box[1] + TABLE_TILE - 1) / TABLE_TILE;
+  const int tx1 = box[2] / TABLE_TILE;
+  const int ty1 = box[3] / TABLE_TILE;
+  if(tx0 < tx1 && ty0 < ty1)
+  {
+    for(int ty = ty0; ty < ty1; ty++)
+      for(int tx = tx0; tx < tx1; tx++)
+      {
+        const size_t k = (size_t)4 * (table->tiles_x * ty + tx);
+        for_four_channels(c, aligned(low,high:16))
+        {
+          low[c] = MIN(low[c], table->tile_low[k + c]);
+          high[c] = MAX(high[c], table->tile_high[k + c]);
+        }
+      }
+    _table_scan(table, box[0], box[1], box[2], ty0 * TABLE_TILE, low, high);
+    _table_scan(table, box[0], ty1 * TABLE_TILE, box[2], box[3], low, high);
+    _table_scan(table, box[0], ty0 * TABLE_TILE, tx0 * TABLE_TILE, ty1 * TABLE_TILE, low, high);
+    _table_scan(table, tx1 * TABLE_TILE, ty0 * TABLE_TILE, box[2], ty1 * TABLE_TILE, low, high);
+  }
+  else
+    _table_scan(table, box[0], box[1], box[2], box[3], low, high);
+
+  for_four_channels(c)
+  {
+    pick[DT_PICK_MEAN][c] = (s11[c] - s01[c] - s10[c] + s00[c]) / size;
+    pick[DT_PICK_MIN][c] = low[c];
+    pick[DT_PICK_MAX][c] = high[c];
+  }
+}
+
 // clang-format off
 // modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
 // vim: shiftwidth=2 expandtab tabstop=2 cindent
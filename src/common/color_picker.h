@@ -53,6 +53,21 @@ void dt_color_picker_helper(const struct dt_iop_buffer_dsc_t *dsc, const float *
                             const enum dt_iop_colorspace_type_t picker_cst,
                             const dt_iop_order_iccprofile_info_t *const profile);
 
+// summed-area table and tile min/max of a 4-channel buffer, optionally
+// denoised, from which the statistics of any box come without scanning
+// it. worth it when many boxes are picked from the same buffer, as are
+// the live samples. the buffer must outlive the table.
+typedef struct dt_color_picker_table_t dt_color_picker_table_t;
+
+dt_color_picker_table_t *dt_color_picker_table_new(const float *const pixel,
+                                                   const struct dt_iop_roi_t *roi,
+                                                   const gboolean denoise);
+void dt_color_picker_table_free(dt_color_picker_table_t *table);
+// same as dt_color_picker_helper() without colorspace conversion
+void dt_color_picker_table_stats(const dt_color_picker_table_t *const table,
+                                 const int *const box,
+                                 lib_colorpicker_stats pick);
+
 // clang-format off
 // modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
 // vim: shiftwidth=2 expandtab tabstop=2 cindent
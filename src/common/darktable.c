@@ -44,9 +44,11 @@
 #include "common/action.h"
 #include "common/file_location.h"
 #include "common/film.h"
+#include "common/focus_peaking.h"
 #include "common/grealpath.h"
 #include "common/image.h"
 #include "common/image_cache.h"
+#include "common/interpolation.h"
 #include "common/iop_order.h"
 #include "common/l10n.h"
 #include "common/mipmap_cache.h"
@@ -1537,6 +1539,9 @@ int dt_init(int argc, char *argv[], const gboolean init_gui, const gboolean load
   // detect cpu features and decide which codepaths to enable
   dt_codepaths_init();
 
+  // resampling plan cache
+  dt_interpolation_init();
+
   // get the list of color profiles
   darktable.color_profiles = dt_colorspaces_init();
 
@@ -1757,6 +1762,8 @@ int dt_init(int argc, char *argv[], const gboolean init_gui, const gboolean load
   darktable.mipmap_cache = (dt_mipmap_cache_t *)calloc(1, sizeof(dt_mipmap_cache_t));
   dt_mipmap_cache_init(darktable.mipmap_cache);
 
+  dt_focuspeaking_init();
+
   // set up the list of exiv2 metadata
   dt_exif_set_exiv2_taglist();
 
@@ -2048,6 +2055,7 @@ void dt_cleanup()
 
     dt_ctl_switch_mode_to("");
     dt_dbus_destroy(darktable.dbus);
+    dt_control_crawler_cleanup();
 
     dt_lib_cleanup(darktable.lib);
     free(darktable.lib);
@@ -2081,6 +2089,8 @@ void dt_cleanup()
     free(darktable.gui);
     darktable.gui = NULL;
   }
+  // after the control, so that its job is no longer running
+  dt_focuspeaking_cleanup();
 
   dt_colorspaces_cleanup(darktable.color_profiles);
   dt_conf_cleanup(darktable.conf);
@@ -2119,6 +2129,7 @@ void dt_cleanup()
   {
     dt_database_cleanup_busy_statements(darktable.db);
     dt_database_perform_maintenance(darktable.db);
+    dt_exif_cache_prune();
   }
 
   dt_database_optimize(darktable.db);
@@ -2158,6 +2169,7 @@ void dt_cleanup()
   }
 
   dt_capabilities_cleanup();
+  dt_interpolation_cleanup();
 
   if(darktable.tmp_directory)
     g_free(darktable.tmp_directory);
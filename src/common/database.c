@@ -52,7 +52,7 @@
 #define LAST_FULL_DATABASE_VERSION_LIBRARY 55
 #define LAST_FULL_DATABASE_VERSION_DATA    10
 // You HAVE TO bump THESE versions whenever you add an update branches to _upgrade_*_schema_step()!
-#define CURRENT_DATABASE_VERSION_LIBRARY 56
+#define CURRENT_DATABASE_VERSION_LIBRARY 58
 #define CURRENT_DATABASE_VERSION_DATA    12
 
 #define USE_NESTED_TRANSACTIONS
@@ -75,8 +75,17 @@ typedef struct dt_database_t
 
   gchar *error_message, *error_dbfilename;
   int error_other_pid;
+
+  /* idle prepared statements, sql -> link in stmt_lru, most recently used first */
+  dt_pthread_mutex_t stmt_lock;
+  GHashTable *stmt_cache;
+  GQueue stmt_lru;
+  uint64_t stmt_prepared, stmt_reused;
 } dt_database_t;
 
+/* maximum number of idle statements kept by dt_database_prepare_cached() */
+#define DT_DATABASE_STMT_CACHE_SIZE 128
+
 
 /* migrates database from old place to new */
 static void _database_migrate_to_xdg_structure();
@@ -2946,6 +2955,29 @@ static int _upgrade_library_schema_step(dt_database_t *db, int version)
     sqlite3_exec(db->handle, "PRAGMA foreign_keys = ON", NULL, NULL, NULL);
     new_version = 56;
   }
+  else if(version == 56)
+  {
+    // used by the collect module camera and lens lists and by the
+    // remove_cameras and remove_lens triggers which would otherwise
+    // scan the whole images table for every deleted image.
+    TRY_EXEC("CREATE INDEX main.images_camera_id_index ON images (camera_id)",
+             "can't create index images_camera_id_index");
+    TRY_EXEC("CREATE INDEX main.images_lens_id_index ON images (lens_id)",
+             "can't create index images_lens_id_index");
+
+    new_version = 57;
+  }
+  else if(version == 57)
+  {
+    // folder state recorded by the crawler to skip the folders which
+    // did not change since the last startup.
+    TRY_EXEC("CREATE TABLE main.film_rolls_journal"
+             " (film_id INTEGER PRIMARY KEY, folder VARCHAR(1024), mtime INTEGER, dirty INTEGER,"
+             "  FOREIGN KEY(film_id) REFERENCES film_rolls(id) ON DELETE CASCADE ON UPDATE CASCADE)",
+             "can't create table film_rolls_journal");
+
+    new_version = 58;
+  }
   else
     new_version = version; // should be the fallback so that calling code sees that we are in an infinite loop
 
@@ -3669,9 +3701,150 @@ static void _create_memory_schema(dt_database_t *db)
   sqlite3_exec(db->handle,
       "CREATE TABLE memory.film_folder (id INTEGER PRIMARY KEY, status INTEGER)",
       NULL, NULL, NULL);
+  // per value image counts for the collect module views
+  sqlite3_exec(db->handle,
+      "CREATE TABLE memory.collect_film_count (film_id INTEGER PRIMARY KEY, count INTEGER)",
+      NULL, NULL, NULL);
+  sqlite3_exec(db->handle,
+      "CREATE TABLE memory.collect_tag_count (tagid INTEGER PRIMARY KEY, count INTEGER)",
+      NULL, NULL, NULL);
+  sqlite3_exec(db->handle,
+      "CREATE TABLE memory.collect_day_count (day INTEGER PRIMARY KEY, count INTEGER)",
+      NULL, NULL, NULL);
+  sqlite3_exec(db->handle,
+      "CREATE TABLE memory.collect_camera_count (camera_id INTEGER PRIMARY KEY, count INTEGER)",
+      NULL, NULL, NULL);
+  sqlite3_exec(db->handle,
+      "CREATE TABLE memory.collect_lens_count (lens_id INTEGER PRIMARY KEY, count INTEGER)",
+      NULL, NULL, NULL);
+  // clang-format on
+}
+
+// keep the memory.collect_*_count tables in sync with the library.
+// TEMP triggers are the only ones allowed to write into another
+// database, the unqualified table names resolve to the memory tables.
+#define _COUNT_INC(table, key, value, column)                                    \
+  " INSERT INTO " table " SELECT " value ", 1"                                  \
+  "  WHERE " column " IS NOT NULL"                                              \
+  "  ON CONFLICT(" key ") DO UPDATE SET count = count + 1;"
+#define _COUNT_DEC(table, key, value)                                            \
+  " UPDATE " table " SET count = count - 1 WHERE " key " = " value ";"          \
+  " DELETE FROM " table " WHERE " key " = " value " AND count <= 0;"
+#define _DAY(dt) "(" dt " / 86400000000) * 86400000000"
+
+static void _create_memory_counts(dt_database_t *db)
+{
+  const double start = dt_get_debug_wtime();
+
+  // clang-format off
+  sqlite3_exec(db->handle,
+     "CREATE TEMP TRIGGER collect_count_insert AFTER INSERT ON main.images"
+     " BEGIN"
+     _COUNT_INC("collect_film_count", "film_id", "NEW.film_id", "NEW.film_id")
+     _COUNT_INC("collect_camera_count", "camera_id", "NEW.camera_id", "NEW.camera_id")
+     _COUNT_INC("collect_lens_count", "lens_id", "NEW.lens_id", "NEW.lens_id")
+     _COUNT_INC("collect_day_count", "day", _DAY("NEW.datetime_taken"),
+                "NULLIF(NEW.datetime_taken, 0)")
+     " END",
+     NULL, NULL, NULL);
+  sqlite3_exec(db->handle,
+     "CREATE TEMP TRIGGER collect_count_delete AFTER DELETE ON main.images"
+     " BEGIN"
+     _COUNT_DEC("collect_film_count", "film_id", "OLD.film_id")
+     _COUNT_DEC("collect_camera_count", "camera_id", "OLD.camera_id")
+     _COUNT_DEC("collect_lens_count", "lens_id", "OLD.lens_id")
+     _COUNT_DEC("collect_day_count", "day", _DAY("OLD.datetime_taken"))
+     " END",
+     NULL, NULL, NULL);
+  sqlite3_exec(db->handle,
+     "CREATE TEMP TRIGGER collect_film_count_update AFTER UPDATE OF film_id ON main.images"
+     " WHEN OLD.film_id IS NOT NEW.film_id"
+     " BEGIN"
+     _COUNT_DEC("collect_film_count", "film_id", "OLD.film_id")
+     _COUNT_INC("collect_film_count", "film_id", "NEW.film_id", "NEW.film_id")
+     " END",
+     NULL, NULL, NULL);
+  sqlite3_exec(db->handle,
+     "CREATE TEMP TRIGGER collect_camera_count_update AFTER UPDATE OF camera_id ON main.images"
+     " WHEN OLD.camera_id IS NOT NEW.camera_id"
+     " BEGIN"
+     _COUNT_DEC("collect_camera_count", "camera_id", "OLD.camera_id")
+     _COUNT_INC("collect_camera_count", "camera_id", "NEW.camera_id", "NEW.camera_id")
+     " END",
+     NULL, NULL, NULL);
+  sqlite3_exec(db->handle,
+     "CREATE TEMP TRIGGER collect_lens_count_update AFTER UPDATE OF lens_id ON main.images"
+     " WHEN OLD.lens_id IS NOT NEW.lens_id"
+     " BEGIN"
+     _COUNT_DEC("collect_lens_count", "lens_id", "OLD.lens_id")
+     _COUNT_INC("collect_lens_count", "lens_id", "NEW.lens_id", "NEW.lens_id")
+     " END",
+     NULL, NULL, NULL);
+  sqlite3_exec(db->handle,
+     "CREATE TEMP TRIGGER collect_day_count_update AFTER UPDATE OF datetime_taken ON main.images"
+     " WHEN OLD.datetime_taken IS NOT NEW.datetime_taken"
+     " BEGIN"
+     _COUNT_DEC("collect_day_count", "day", _DAY("OLD.datetime_taken"))
+     _COUNT_INC("collect_day_count", "day", _DAY("NEW.datetime_taken"),
+                "NULLIF(NEW.datetime_taken, 0)")
+     " END",
+     NULL, NULL, NULL);
+  sqlite3_exec(db->handle,
+     "CREATE TEMP TRIGGER collect_tag_count_insert AFTER INSERT ON main.tagged_images"
+     " BEGIN"
+     _COUNT_INC("collect_tag_count", "tagid", "NEW.tagid", "NEW.tagid")
+     " END",
+     NULL, NULL, NULL);
+  sqlite3_exec(db->handle,
+     "CREATE TEMP TRIGGER collect_tag_count_delete AFTER DELETE ON main.tagged_images"
+     " BEGIN"
+     _COUNT_DEC("collect_tag_count", "tagid", "OLD.tagid")
+     " END",
+     NULL, NULL, NULL);
+  sqlite3_exec(db->handle,
+     "CREATE TEMP TRIGGER collect_tag_count_update AFTER UPDATE OF tagid ON main.tagged_images"
+     " WHEN OLD.tagid IS NOT NEW.tagid"
+     " BEGIN"
+     _COUNT_DEC("collect_tag_count", "tagid", "OLD.tagid")
+     _COUNT_INC("collect_tag_count", "tagid", "NEW.tagid", "NEW.tagid")
+     " END",
+     NULL, NULL, NULL);
+
+  // initial counts, all of them are served by an index
+  sqlite3_exec(db->handle,
+     "INSERT INTO memory.collect_film_count"
+     " SELECT film_id, COUNT(*) FROM main.images"
+     " WHERE film_id IS NOT NULL GROUP BY film_id",
+     NULL, NULL, NULL);
+  sqlite3_exec(db->handle,
+     "INSERT INTO memory.collect_camera_count"
+     " SELECT camera_id, COUNT(*) FROM main.images"
+     " WHERE camera_id IS NOT NULL GROUP BY camera_id",
+     NULL, NULL, NULL);
+  sqlite3_exec(db->handle,
+     "INSERT INTO memory.collect_lens_count"
+     " SELECT lens_id, COUNT(*) FROM main.images"
+     " WHERE lens_id IS NOT NULL GROUP BY lens_id",
+     NULL, NULL, NULL);
+  sqlite3_exec(db->handle,
+     "INSERT INTO memory.collect_day_count"
+     " SELECT " _DAY("datetime_taken") " AS day, COUNT(*) FROM main.images"
+     " WHERE datetime_taken IS NOT NULL AND datetime_taken <> 0 GROUP BY day",
+     NULL, NULL, NULL);
+  sqlite3_exec(db->handle,
+     "INSERT INTO memory.collect_tag_count"
+     " SELECT tagid, COUNT(*) FROM main.tagged_images GROUP BY tagid",
+     NULL, NULL, NULL);
   // clang-format on
+
+  dt_print(DT_DEBUG_SQL, "[init] collect counts created in %.3f secs",
+           dt_get_debug_wtime() - start);
 }
 
+#undef _COUNT_INC
+#undef _COUNT_DEC
+#undef _DAY
+
 static void _sanitize_db(dt_database_t *db)
 {
   sqlite3_stmt *stmt, *innerstmt;
@@ -4074,6 +4247,18 @@ static void _ask_for_upgrade(const gchar *dbname, const gboolean has_gui)
   }
 }
 
+// remove the write-ahead log of a deleted database, it must not be
+// applied to a database restored in its place
+static void _unlink_wal(const char *filename)
+{
+  gchar *wal = g_strdup_printf("%s-wal", filename);
+  gchar *shm = g_strdup_printf("%s-shm", filename);
+  g_unlink(wal);
+  g_unlink(shm);
+  g_free(wal);
+  g_free(shm);
+}
+
 void dt_database_backup(const char *filename)
 {
   char *version = g_strdup(darktable_package_version);
@@ -4100,6 +4285,20 @@ void dt_database_backup(const char *filename)
     if(g_file_test(filename, G_FILE_TEST_EXISTS))
     {
       copy_status = g_file_copy(src, dest, G_FILE_COPY_NONE, NULL, NULL, NULL, &gerror);
+
+      // the changes of a session which didn't end properly may still be in the write-ahead log
+      gchar *wal = g_strdup_printf("%s-wal", filename);
+      if(copy_status && g_file_test(wal, G_FILE_TEST_EXISTS))
+      {
+        gchar *backup_wal = g_strdup_printf("%s-wal", backup);
+        GFile *src_wal = g_file_new_for_path(wal);
+        GFile *dest_wal = g_file_new_for_path(backup_wal);
+        copy_status = g_file_copy(src_wal, dest_wal, G_FILE_COPY_NONE, NULL, NULL, NULL, &gerror);
+        g_object_unref(src_wal);
+        g_object_unref(dest_wal);
+        g_free(backup_wal);
+      }
+      g_free(wal);
     }
     else
     {
@@ -4324,8 +4523,24 @@ start:
 
   // some sqlite3 config
   sqlite3_exec(db->handle, "PRAGMA synchronous = OFF", NULL, NULL, NULL);
-  sqlite3_exec(db->handle, "PRAGMA journal_mode = MEMORY", NULL, NULL, NULL);
+  // the page size must be set before switching a new database to WAL
   sqlite3_exec(db->handle, "PRAGMA page_size = 32768", NULL, NULL, NULL);
+  // with a write-ahead log a crash can't leave the databases corrupted
+  // and a commit only appends the changed pages to the log.
+  if(dt_conf_get_bool("database/write_ahead_log")
+     && g_strcmp0(dbfilename_library, ":memory:"))
+  {
+    sqlite3_exec(db->handle, "PRAGMA journal_mode = WAL", NULL, NULL, NULL);
+    sqlite3_exec(db->handle, "PRAGMA journal_size_limit = 67108864", NULL, NULL, NULL);
+  }
+  else
+    sqlite3_exec(db->handle, "PRAGMA journal_mode = MEMORY", NULL, NULL, NULL);
+  // read pages through memory mapped I/O instead of copying them
+  sqlite3_exec(db->handle, "PRAGMA mmap_size = 268435456", NULL, NULL, NULL);
+
+  dt_pthread_mutex_init(&db->stmt_lock, NULL);
+  db->stmt_cache = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+  g_queue_init(&db->stmt_lru);
 
   // WARNING: the foreign_keys pragma must not be used, the integrity of the
   // database rely on it.
@@ -4480,6 +4695,7 @@ start:
       dt_print(DT_DEBUG_ALWAYS, "[init] deleting `%s' on user request: %s",
                dbfilename_data,
                g_unlink(dbfilename_data) == 0 ? "ok" : "failed" );
+      _unlink_wal(dbfilename_data);
 
       if(resp == GTK_RESPONSE_ACCEPT && data_snap)
       {
@@ -4653,6 +4869,7 @@ start:
 
     dt_print(DT_DEBUG_ALWAYS, "[init] deleting `%s' on user request ...%s",
       dbfilename_library, g_unlink(dbfilename_library) == 0 ? "OK" : "failed");
+    _unlink_wal(dbfilename_library);
 
     if(resp == GTK_RESPONSE_ACCEPT && data_snap)
     {
@@ -4725,6 +4942,7 @@ start:
 
   // create the in-memory tables
   _create_memory_schema(db);
+  _create_memory_counts(db);
 
   // drop table settings -- we don't want old versions of dt to drop our tables
   sqlite3_exec(db->handle, "DROP TABLE main.settings", NULL, NULL, NULL);
@@ -4792,8 +5010,92 @@ void dt_upgrade_maker_model(const dt_database_t *db)
   sqlite3_finalize(stmt);
 }
 
+static void _stmt_cache_clear(const dt_database_t *db)
+{
+  if(!db->stmt_cache) return;
+
+  dt_database_t *d = (dt_database_t *)db;
+  dt_pthread_mutex_lock(&d->stmt_lock);
+  g_hash_table_remove_all(d->stmt_cache);
+  sqlite3_stmt *stmt;
+  while((stmt = g_queue_pop_head(&d->stmt_lru)))
+    sqlite3_finalize(stmt);
+  dt_pthread_mutex_unlock(&d->stmt_lock);
+}
+
+sqlite3_stmt *dt_database_prepare_cached(const dt_database_t *db, const char *sql)
+{
+  dt_database_t *d = (dt_database_t *)db;
+  sqlite3_stmt *stmt = NULL;
+
+  dt_pthread_mutex_lock(&d->stmt_lock);
+  GList *link = g_hash_table_lookup(d->stmt_cache, sql);
+  if(link)
+  {
+    stmt = link->data;
+    g_hash_table_remove(d->stmt_cache, sql);
+    g_queue_delete_link(&d->stmt_lru, link);
+    d->stmt_reused++;
+  }
+  else
+    d->stmt_prepared++;
+  dt_pthread_mutex_unlock(&d->stmt_lock);
+
+  if(!stmt)
+  {
+    dt_print(DT_DEBUG_SQL, "[sql] prepare cached \"%s\"", sql);
+    if(sqlite3_prepare_v2(db->handle, sql, -1, &stmt, NULL) != SQLITE_OK)
+    {
+      dt_print(DT_DEBUG_ALWAYS, "[sql] can't prepare \"%s\": %s", sql, sqlite3_errmsg(db->handle));
+      sqlite3_finalize(stmt);
+      stmt = NULL;
+    }
+  }
+  return stmt;
+}
+
+void dt_database_release_cached(const dt_database_t *db, sqlite3_stmt *stmt)
+{
+  if(!stmt) return;
+
+  dt_database_t *d = (dt_database_t *)db;
+  sqlite3_reset(stmt);
+  sqlite3_clear_bindings(stmt);
+
+  const char *sql = sqlite3_sql(stmt);
+  sqlite3_stmt *evicted = NULL;
+
+  dt_pthread_mutex_lock(&d->stmt_lock);
+  if(g_hash_table_contains(d->stmt_cache, sql))
+  {
+    // another copy was used concurrently and is already back
+    evicted = stmt;
+  }
+  else
+  {
+    g_queue_push_head(&d->stmt_lru, stmt);
+    g_hash_table_insert(d->stmt_cache, g_strdup(sql), d->stmt_lru.head);
+    if(d->stmt_lru.length > DT_DATABASE_STMT_CACHE_SIZE)
+    {
+      evicted = g_queue_pop_tail(&d->stmt_lru);
+      g_hash_table_remove(d->stmt_cache, sqlite3_sql(evicted));
+    }
+  }
+  dt_pthread_mutex_unlock(&d->stmt_lock);
+
+  if(evicted) sqlite3_finalize(evicted);
+}
+
 void dt_database_destroy(const dt_database_t *db)
 {
+  if(db->stmt_cache)
+  {
+    dt_print(DT_DEBUG_SQL, "[sql] statement cache: %" PRIu64 " prepared, %" PRIu64 " reused",
+             db->stmt_prepared, db->stmt_reused);
+    _stmt_cache_clear(db);
+    g_hash_table_destroy(db->stmt_cache);
+    dt_pthread_mutex_destroy(&((dt_database_t *)db)->stmt_lock);
+  }
   sqlite3_close(db->handle);
   if(db->lockfile_data)
   {
@@ -4879,6 +5181,8 @@ gboolean dt_database_get_lock_acquired(const dt_database_t *db)
 
 void dt_database_cleanup_busy_statements(const struct dt_database_t *db)
 {
+  _stmt_cache_clear(db);
+
   sqlite3_stmt *stmt = NULL;
   while( (stmt = sqlite3_next_stmt(db->handle, NULL)) != NULL)
   {
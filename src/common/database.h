@@ -57,6 +57,13 @@ char **dt_database_snaps_to_remove(const struct dt_database_t *db);
 gchar *dt_database_get_most_recent_snap(const char* db_filename);
 
 int32_t dt_database_last_insert_rowid(const struct dt_database_t *);
+
+/** get a prepared statement for sql from the statement cache, preparing it if
+ * needed. it's reserved to the caller until given back with
+ * dt_database_release_cached() which resets it; never finalize it. */
+struct sqlite3_stmt *dt_database_prepare_cached(const struct dt_database_t *db, const char *sql);
+void dt_database_release_cached(const struct dt_database_t *db, struct sqlite3_stmt *stmt);
+
 // nested transactions support
 
 void dt_database_start_transaction(const struct dt_database_t *db);
@@ -23,7 +23,9 @@
 #endif
 
 #include <errno.h>
+#include <fcntl.h>
 #include <glib.h>
+#include <glib/gstdio.h>
 #include <sqlite3.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -37,8 +39,11 @@
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include <exiv2/exiv2.hpp>
 
@@ -61,6 +66,7 @@ using namespace std;
 #include "common/dng_opcode.h"
 #include "common/image_cache.h"
 #include "common/exif.h"
+#include "common/file_location.h"
 #include "common/metadata.h"
 #include "common/ratings.h"
 #include "common/tags.h"
@@ -388,6 +394,504 @@ public:
   image->readMetadata();                                      \
 }
 
+// The XMP toolkit used by Exiv2 is not thread safe, it gets this lock at
+// initialization so images can be read in parallel otherwise.
+static std::mutex _xmp_toolkit_lock;
+
+static void _exif_xmp_lock(void *data,
+                           bool lock_unlock)
+{
+  std::mutex *m = (std::mutex *)data;
+  if(lock_unlock)
+    m->lock();
+  else
+    m->unlock();
+}
+
+// Images read ahead by dt_exif_prefetch(), handed over to the next
+// dt_exif_read() or dt_exif_xmp_read() of the same path.
+static std::mutex _prefetch_lock;
+static std::unordered_map<std::string, std::unique_ptr<Exiv2::Image>> _prefetched;
+
+static std::unique_ptr<Exiv2::Image> _exif_open_read(const char *path)
+{
+  {
+    std::lock_guard<std::mutex> lock(_prefetch_lock);
+    auto it = _prefetched.find(path);
+    if(it != _prefetched.end())
+    {
+      std::unique_ptr<Exiv2::Image> image = std::move(it->second);
+      _prefetched.erase(it);
+      return image;
+    }
+  }
+
+  std::unique_ptr<Exiv2::Image> image(Exiv2::ImageFactory::open(WIDEN(path)));
+  assert(image.get() != 0);
+  read_metadata_threadsafe(image);
+  return image;
+}
+
+// the metadata of most files is in their first bytes
+#define DT_EXIF_PREFETCH_HEAD (256 * 1024)
+
+static void _exif_prefetch_file(const char *path)
+{
+  // read the head of the file without the lock so the disk reads of
+  // several files still overlap, Exiv2 then finds it in the page cache
+  FILE *f = g_fopen(path, "rb");
+  if(!f) return;
+  char *head = (char *)g_malloc(DT_EXIF_PREFETCH_HEAD);
+  const size_t rd = fread(head, 1, DT_EXIF_PREFETCH_HEAD, f);
+  g_free(head);
+  fclose(f);
+  // the error is reported by the regular read
+  if(rd == 0) return;
+
+  try
+  {
+    std::unique_ptr<Exiv2::Image> image(Exiv2::ImageFactory::open(WIDEN(path)));
+    assert(image.get() != 0);
+    read_metadata_threadsafe(image);
+    std::lock_guard<std::mutex> lock(_prefetch_lock);
+    _prefetched[path] = std::move(image);
+  }
+  catch(Exiv2::AnyError &e)
+  {
+    // the error is reported by the regular read
+  }
+}
+
+// On-disk cache of the metadata read from image files, keyed by the
+// file identity (path, size, mtime, inode). The Exif data is stored as
+// the list of its (key, type, value) entries as decoded by Exiv2 and
+// the IPTC and XMP data as their encoded packets, so that a hit runs
+// the very same decoding into dt_image_t without touching the file.
+// The monochrome preview check of ui/detect_mono_exif is stored along
+// with it (-1 while not known yet) as it would have to read the file.
+#define DT_EXIF_CACHE_VERSION 2
+// values larger than this (embedded previews, raw makernote blobs) are
+// not needed by darktable and are not cached, except the DNG opcodes.
+#define DT_EXIF_CACHE_MAX_VALUE 65536
+// the entries checked by one run of the pruning, the next run continues
+// after the last one checked so a large cache is covered over a few runs.
+#define DT_EXIF_CACHE_PRUNE_ROWS 2000
+
+static std::mutex _cache_lock;
+static sqlite3 *_cache_db = NULL;
+static gboolean _cache_opened = FALSE;
+
+static sqlite3 *_exif_cache_db()
+{
+  std::lock_guard<std::mutex> lock(_cache_lock);
+  if(_cache_opened) return _cache_db;
+  _cache_opened = TRUE;
+
+  if(!dt_conf_get_bool("cache_disk_backend_exif")) return NULL;
+
+  char cachedir[PATH_MAX] = { 0 };
+  dt_loc_get_user_cache_dir(cachedir, sizeof(cachedir));
+  gchar *filename = g_build_filename(cachedir, "exif-cache.db", NULL);
+  if(sqlite3_open_v2(filename, &_cache_db,
+                     SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_FULLMUTEX,
+                     NULL) != SQLITE_OK)
+  {
+    dt_print(DT_DEBUG_ALWAYS, "[exif_cache] can't open `%s': %s",
+             filename, sqlite3_errmsg(_cache_db));
+    sqlite3_close(_cache_db);
+    _cache_db = NULL;
+    g_free(filename);
+    return NULL;
+  }
+  g_free(filename);
+
+  // it's a cache, losing the last writes on a crash doesn't matter
+  sqlite3_busy_timeout(_cache_db, 100);
+  sqlite3_exec(_cache_db, "PRAGMA synchronous = OFF", NULL, NULL, NULL);
+  sqlite3_exec(_cache_db, "PRAGMA journal_mode = WAL", NULL, NULL, NULL);
+
+  // drop the cache when its format or the Exiv2 version changed
+  const int version = (DT_EXIF_CACHE_VERSION << 24) | (Exiv2::versionNumber() & 0xffffff);
+  int current = 0;
+  sqlite3_stmt *stmt;
+  if(sqlite3_prepare_v2(_cache_db, "PRAGMA user_version", -1, &stmt, NULL) == SQLITE_OK)
+  {
+    if(sqlite3_step(stmt) == SQLITE_ROW) current = sqlite3_column_int(stmt, 0);
+    sqlite3_finalize(stmt);
+  }
+  if(current != version)
+  {
+    sqlite3_exec(_cache_db, "DROP TABLE IF EXISTS metadata", NULL, NULL, NULL);
+    gchar *query = g_strdup_printf("PRAGMA user_version = %d", version);
+    sqlite3_exec(_cache_db, query, NULL, NULL, NULL);
+    g_free(query);
+  }
+  sqlite3_exec(_cache_db,
+               "CREATE TABLE IF NOT EXISTS metadata"
+               " (path VARCHAR PRIMARY KEY, size INTEGER, mtime INTEGER, inode INTEGER,"
+               "  width INTEGER, height INTEGER, mono INTEGER, length INTEGER, data BLOB)",
+               NULL, NULL, NULL);
+  sqlite3_exec(_cache_db,
+               "CREATE TABLE IF NOT EXISTS prune (id INTEGER PRIMARY KEY, last_rowid INTEGER)",
+               NULL, NULL, NULL);
+  return _cache_db;
+}
+
+static void _cache_append(std::string &buf, const void *data, const size_t size)
+{
+  buf.append((const char *)data, size);
+}
+
+static void _cache_append_u32(std::string &buf, const uint32_t value)
+{
+  _cache_append(buf, &value, sizeof(value));
+}
+
+static gboolean _cache_take(const uint8_t **pos,
+                            const uint8_t *end,
+                            void *data,
+                            const size_t size)
+{
+  if((size_t)(end - *pos) < size) return FALSE;
+  memcpy(data, *pos, size);
+  *pos += size;
+  return TRUE;
+}
+
+static void _exif_cache_put(const char *path,
+                            const struct stat *statbuf,
+                            const Exiv2::ExifData &exifData,
+                            const Exiv2::IptcData &iptcData,
+                            const Exiv2::XmpData &xmpData,
+                            const int width,
+                            const int height)
+{
+  sqlite3 *db = _exif_cache_db();
+  if(!db) return;
+
+  std::string buf;
+  std::vector<Exiv2::byte> value;
+
+  try
+  {
+    uint32_t count = 0;
+    std::string entries;
+    for(Exiv2::ExifData::const_iterator it = exifData.begin(); it != exifData.end(); ++it)
+    {
+      const size_t size = it->size();
+      const std::string key = it->key();
+      if(size > DT_EXIF_CACHE_MAX_VALUE && key.find("OpcodeList") == std::string::npos)
+        continue;
+      value.resize(size);
+      it->copy(value.data(), Exiv2::bigEndian);
+      _cache_append_u32(entries, key.size());
+      _cache_append(entries, key.data(), key.size());
+      _cache_append_u32(entries, (uint32_t)it->typeId());
+      _cache_append_u32(entries, size);
+      _cache_append(entries, value.data(), size);
+      count++;
+    }
+    _cache_append_u32(buf, count);
+    buf.append(entries);
+
+    Exiv2::DataBuf iptc = Exiv2::IptcParser::encode(iptcData);
+#if EXIV2_TEST_VERSION(0,28,0)
+    _cache_append_u32(buf, iptc.size());
+    _cache_append(buf, iptc.c_data(), iptc.size());
+#else
+    _cache_append_u32(buf, iptc.size_);
+    _cache_append(buf, iptc.pData_, iptc.size_);
+#endif
+
+    std::string xmpPacket;
+    if(!xmpData.empty()
+       && Exiv2::XmpParser::encode(xmpPacket, xmpData,
+                                   Exiv2::XmpParser::useCompactFormat
+                                   | Exiv2::XmpParser::omitPacketWrapper) != 0)
+      return;
+    _cache_append_u32(buf, xmpPacket.size());
+    buf.append(xmpPacket);
+  }
+  catch(Exiv2::AnyError &e)
+  {
+    return;
+  }
+
+  uLongf length = compressBound(buf.size());
+  std::vector<Bytef> data(length);
+  if(compress2(data.data(), &length, (const Bytef *)buf.data(), buf.size(), 1) != Z_OK)
+    return;
+
+  sqlite3_stmt *stmt;
+  if(sqlite3_prepare_v2(db,
+                        "INSERT OR REPLACE INTO metadata"
+                        " (path, size, mtime, inode, width, height, mono, length, data)"
+                        " VALUES (?1, ?2, ?3, ?4, ?5, ?6, -1, ?7, ?8)",
+                        -1, &stmt, NULL) != SQLITE_OK)
+    return;
+  sqlite3_bind_text(stmt, 1, path, -1, SQLITE_STATIC);
+  sqlite3_bind_int64(stmt, 2, statbuf->st_size);
+  sqlite3_bind_int64(stmt, 3, statbuf->st_mtime);
+  sqlite3_bind_int64(stmt, 4, statbuf->st_ino);
+  sqlite3_bind_int(stmt, 5, width);
+  sqlite3_bind_int(stmt, 6, height);
+  sqlite3_bind_int64(stmt, 7, buf.size());
+  sqlite3_bind_blob(stmt, 8, data.data(), length, SQLITE_STATIC);
+  sqlite3_step(stmt);
+  sqlite3_finalize(stmt);
+}
+
+static sqlite3_stmt *_exif_cache_lookup(sqlite3 *db,
+                                        const char *path,
+                                        const struct stat *statbuf,
+                                        const char *columns)
+{
+  sqlite3_stmt *stmt;
+  gchar *query = g_strdup_printf("SELECT %s FROM metadata"
+                                 " WHERE path = ?1 AND size = ?2 AND mtime = ?3 AND inode = ?4",
+                                 columns);
+  const int rc = sqlite3_prepare_v2(db, query, -1, &stmt, NULL);
+  g_free(query);
+  if(rc != SQLITE_OK) return NULL;
+
+  sqlite3_bind_text(stmt, 1, path, -1, SQLITE_STATIC);
+  sqlite3_bind_int64(stmt, 2, statbuf->st_size);
+  sqlite3_bind_int64(stmt, 3, statbuf->st_mtime);
+  sqlite3_bind_int64(stmt, 4, statbuf->st_ino);
+  if(sqlite3_step(stmt) != SQLITE_ROW)
+  {
+    sqlite3_finalize(stmt);
+    return NULL;
+  }
+  return stmt;
+}
+
+static gboolean _exif_cache_get(const char *path,
+                                const struct stat *statbuf,
+                                Exiv2::ExifData &exifData,
+                                Exiv2::IptcData &iptcData,
+                                Exiv2::XmpData &xmpData,
+                                int *width,
+                                int *height,
+                                int *mono)
+{
+  sqlite3 *db = _exif_cache_db();
+  if(!db) return FALSE;
+
+  sqlite3_stmt *stmt = _exif_cache_lookup(db, path, statbuf, "width, height, mono, length, data");
+  if(!stmt) return FALSE;
+
+  *width = sqlite3_column_int(stmt, 0);
+  *height = sqlite3_column_int(stmt, 1);
+  *mono = sqlite3_column_int(stmt, 2);
+  uLongf length = sqlite3_column_int64(stmt, 3);
+  std::vector<uint8_t> buf(length);
+  const int ok = uncompress(buf.data(), &length,
+                            (const Bytef *)sqlite3_column_blob(stmt, 4),
+                            sqlite3_column_bytes(stmt, 4)) == Z_OK
+                 && length == buf.size();
+  sqlite3_finalize(stmt);
+  if(!ok) return FALSE;
+
+  const uint8_t *pos = buf.data();
+  const uint8_t *end = pos + buf.size();
+  uint32_t count = 0;
+  if(!_cache_take(&pos, end, &count, sizeof(count))) return FALSE;
+
+  try
+  {
+    for(uint32_t k = 0; k < count; k++)
+    {
+      uint32_t key_size, type, size;
+      if(!_cache_take(&pos, end, &key_size, sizeof(key_size))
+         || (size_t)(end - pos) < key_size)
+        return FALSE;
+      const std::string key((const char *)pos, key_size);
+      pos += key_size;
+      if(!_cache_take(&pos, end, &type, sizeof(type))
+         || !_cache_take(&pos, end, &size, sizeof(size))
+         || (size_t)(end - pos) < size)
+        return FALSE;
+      auto value = Exiv2::Value::create((Exiv2::TypeId)type);
+      value->read(pos, size, Exiv2::bigEndian);
+      pos += size;
+      exifData.add(Exiv2::ExifKey(key), value.get());
+    }
+  }
+  catch(Exiv2::AnyError &e)
+  {
+    // an entry this Exiv2 doesn't know, read the file instead
+    return FALSE;
+  }
+
+  uint32_t size;
+  if(!_cache_take(&pos, end, &size, sizeof(size)) || (size_t)(end - pos) < size)
+    return FALSE;
+  if(size && Exiv2::IptcParser::decode(iptcData, pos, size) != 0)
+    return FALSE;
+  pos += size;
+
+  if(!_cache_take(&pos, end, &size, sizeof(size)) || (size_t)(end - pos) < size)
+    return FALSE;
+  if(size && Exiv2::XmpParser::decode(xmpData, std::string((const char *)pos, size)) != 0)
+    return FALSE;
+
+  return TRUE;
+}
+
+static void _exif_cache_set_mono(const char *path,
+                                 const struct stat *statbuf,
+                                 const gboolean mono)
+{
+  sqlite3 *db = _exif_cache_db();
+  if(!db) return;
+
+  sqlite3_stmt *stmt;
+  if(sqlite3_prepare_v2(db,
+                        "UPDATE metadata SET mono = ?5"
+                        " WHERE path = ?1 AND size = ?2 AND mtime = ?3 AND inode = ?4",
+                        -1, &stmt, NULL) != SQLITE_OK)
+    return;
+  sqlite3_bind_text(stmt, 1, path, -1, SQLITE_STATIC);
+  sqlite3_bind_int64(stmt, 2, statbuf->st_size);
+  sqlite3_bind_int64(stmt, 3, statbuf->st_mtime);
+  sqlite3_bind_int64(stmt, 4, statbuf->st_ino);
+  sqlite3_bind_int(stmt, 5, mono ? 1 : 0);
+  sqlite3_step(stmt);
+  sqlite3_finalize(stmt);
+}
+
+static int _exif_cache_pragma(sqlite3 *db, const char *pragma)
+{
+  gchar *query = g_strdup_printf("PRAGMA %s", pragma);
+  int val = -1;
+  sqlite3_stmt *stmt;
+  if(sqlite3_prepare_v2(db, query, -1, &stmt, NULL) == SQLITE_OK)
+  {
+    if(sqlite3_step(stmt) == SQLITE_ROW) val = sqlite3_column_int(stmt, 0);
+    sqlite3_finalize(stmt);
+  }
+  g_free(query);
+  return val;
+}
+
+void dt_exif_cache_prune()
+{
+  // called on shutdown after the configuration is gone, a cache which
+  // hasn't been used in this session is left for the next one
+  {
+    std::lock_guard<std::mutex> lock(_cache_lock);
+    if(!_cache_opened) return;
+  }
+  sqlite3 *db = _exif_cache_db();
+  if(!db) return;
+
+  // drop the entries of files which are gone or have been replaced. the
+  // files of a folder which isn't there at all are most likely on an
+  // unmounted drive, keep them.
+  sqlite3_int64 start = 0;
+  sqlite3_stmt *stmt;
+  if(sqlite3_prepare_v2(db, "SELECT last_rowid FROM prune WHERE id = 0", -1, &stmt, NULL) == SQLITE_OK)
+  {
+    if(sqlite3_step(stmt) == SQLITE_ROW) start = sqlite3_column_int64(stmt, 0);
+    sqlite3_finalize(stmt);
+  }
+
+  sqlite3_int64 last = start;
+  int checked = 0;
+  std::vector<sqlite3_int64> stale;
+  if(sqlite3_prepare_v2(db,
+                        "SELECT rowid, path, size, mtime, inode FROM metadata"
+                        " WHERE rowid > ?1 ORDER BY rowid LIMIT ?2",
+                        -1, &stmt, NULL) != SQLITE_OK)
+    return;
+  sqlite3_bind_int64(stmt, 1, start);
+  sqlite3_bind_int(stmt, 2, DT_EXIF_CACHE_PRUNE_ROWS);
+  while(sqlite3_step(stmt) == SQLITE_ROW)
+  {
+    last = sqlite3_column_int64(stmt, 0);
+    checked++;
+    const char *path = (const char *)sqlite3_column_text(stmt, 1);
+    if(!path) continue;
+    struct stat statbuf;
+    if(stat(path, &statbuf))
+    {
+      gchar *folder = g_path_get_dirname(path);
+      if(g_file_test(folder, G_FILE_TEST_IS_DIR)) stale.push_back(last);
+      g_free(folder);
+    }
+    else if(statbuf.st_size != sqlite3_column_int64(stmt, 2)
+            || statbuf.st_mtime != sqlite3_column_int64(stmt, 3)
+            || (sqlite3_int64)statbuf.st_ino != sqlite3_column_int64(stmt, 4))
+      stale.push_back(last);
+  }
+  sqlite3_finalize(stmt);
+
+  sqlite3_exec(db, "BEGIN", NULL, NULL, NULL);
+  // start over from the first entry once the end has been reached
+  if(sqlite3_prepare_v2(db, "INSERT OR REPLACE INTO prune (id, last_rowid) VALUES (0, ?1)",
+                        -1, &stmt, NULL) == SQLITE_OK)
+  {
+    sqlite3_bind_int64(stmt, 1, checked < DT_EXIF_CACHE_PRUNE_ROWS ? 0 : last);
+    sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+  }
+  if(!stale.empty()
+     && sqlite3_prepare_v2(db, "DELETE FROM metadata WHERE rowid = ?1", -1, &stmt, NULL) == SQLITE_OK)
+  {
+    for(const sqlite3_int64 rowid : stale)
+    {
+      sqlite3_bind_int64(stmt, 1, rowid);
+      sqlite3_step(stmt);
+      sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+  }
+  sqlite3_exec(db, "COMMIT", NULL, NULL, NULL);
+
+  // only worth rewriting the whole file when a good part of it is unused
+  const int free_pages = _exif_cache_pragma(db, "freelist_count");
+  const int pages = _exif_cache_pragma(db, "page_count");
+  const gboolean vacuum = pages > 0 && free_pages * 4 >= pages;
+  if(vacuum) sqlite3_exec(db, "VACUUM", NULL, NULL, NULL);
+
+  dt_print(DT_DEBUG_CACHE, "[exif_cache] checked %d entries, pruned %zu, %d/%d pages free%s",
+           checked, stale.size(), free_pages, pages, vacuum ? ", vacuumed" : "");
+}
+
+static gboolean _exif_cache_contains(const char *path)
+{
+  struct stat statbuf;
+  sqlite3 *db = _exif_cache_db();
+  if(!db || stat(path, &statbuf)) return FALSE;
+
+  sqlite3_stmt *stmt = _exif_cache_lookup(db, path, &statbuf, "1");
+  if(!stmt) return FALSE;
+  sqlite3_finalize(stmt);
+  return TRUE;
+}
+
+void dt_exif_prefetch(const char *path)
+{
+  // a cached image is not read at all
+  if(!_exif_cache_contains(path))
+    _exif_prefetch_file(path);
+
+  gchar *xmp = g_strconcat(path, ".xmp", NULL);
+  if(g_file_test(xmp, G_FILE_TEST_EXISTS))
+    _exif_prefetch_file(xmp);
+  g_free(xmp);
+}
+
+void dt_exif_prefetch_release(const char *path)
+{
+  gchar *xmp = g_strconcat(path, ".xmp", NULL);
+  std::lock_guard<std::mutex> lock(_prefetch_lock);
+  _prefetched.erase(path);
+  _prefetched.erase(xmp);
+  g_free(xmp);
+}
+
 static void _exif_import_tags(dt_image_t *img, Exiv2::XmpData::iterator &pos);
 
 static void _read_xmp_timestamps(Exiv2::XmpData &xmpData,
@@ -2324,21 +2828,36 @@ gboolean dt_exif_read(dt_image_t *img,
   // At least set 'datetime taken' to something useful in case there is
   // no Exif data in this file (pfm, png, ...)
   struct stat statbuf;
+  const gboolean have_stat = !stat(path, &statbuf);
 
-  if(!stat(path, &statbuf))
+  if(have_stat)
   {
     dt_datetime_unix_to_img(img, &statbuf.st_mtime);
   }
 
   try
   {
-    std::unique_ptr<Exiv2::Image> image(Exiv2::ImageFactory::open(WIDEN(path)));
-    assert(image.get() != 0);
-    read_metadata_threadsafe(image);
+    std::unique_ptr<Exiv2::Image> image;
+    Exiv2::ExifData cachedExifData;
+    Exiv2::IptcData cachedIptcData;
+    Exiv2::XmpData cachedXmpData;
+    int width = 0, height = 0, mono = -1;
+    const gboolean cached =
+      have_stat && _exif_cache_get(path, &statbuf, cachedExifData, cachedIptcData,
+                                   cachedXmpData, &width, &height, &mono);
+    if(!cached)
+    {
+      image = _exif_open_read(path);
+      width = image->pixelWidth();
+      height = image->pixelHeight();
+      if(have_stat)
+        _exif_cache_put(path, &statbuf, image->exifData(), image->iptcData(),
+                        image->xmpData(), width, height);
+    }
     bool res = true;
 
     // EXIF metadata
-    Exiv2::ExifData &exifData = image->exifData();
+    Exiv2::ExifData &exifData = cached ? cachedExifData : image->exifData();
     if(!exifData.empty())
     {
       res = _exif_decode_exif_data(img, exifData);
@@ -2347,7 +2866,12 @@ gboolean dt_exif_read(dt_image_t *img,
         const int oldflags =
           dt_image_monochrome_flags(img)
           | (img->flags & DT_IMAGE_MONOCHROME_WORKFLOW);
-        if(dt_imageio_has_mono_preview(path))
+        if(mono < 0)
+        {
+          mono = dt_imageio_has_mono_preview(path) ? 1 : 0;
+          if(have_stat) _exif_cache_set_mono(path, &statbuf, mono);
+        }
+        if(mono)
           img->flags |= (DT_IMAGE_MONOCHROME_PREVIEW
                          | DT_IMAGE_MONOCHROME_WORKFLOW);
         else
@@ -2367,19 +2891,19 @@ gboolean dt_exif_read(dt_image_t *img,
     dt_exif_apply_default_metadata(img);
 
     // IPTC metadata.
-    Exiv2::IptcData &iptcData = image->iptcData();
+    Exiv2::IptcData &iptcData = cached ? cachedIptcData : image->iptcData();
     if(!iptcData.empty()) res = _exif_decode_iptc_data(img, iptcData) && res;
 
     // XMP metadata.
-    Exiv2::XmpData &xmpData = image->xmpData();
+    Exiv2::XmpData &xmpData = cached ? cachedXmpData : image->xmpData();
     if(!xmpData.empty())
       res = _exif_decode_xmp_data(img, xmpData, -1, true) && res;
 
     // Initialize size - don't wait for full raw to be loaded to get this
     // information. If use_embedded_thumbnail is set, it will take a
     // change in development history to have this information.
-    img->height = image->pixelHeight();
-    img->width = image->pixelWidth();
+    img->height = height;
+    img->width = width;
 
     return res ? FALSE : TRUE;
   }
@@ -3807,9 +4331,7 @@ gboolean dt_exif_xmp_read(dt_image_t *img,
   try
   {
     // Read XMP sidecar
-    std::unique_ptr<Exiv2::Image> image(Exiv2::ImageFactory::open(WIDEN(filename)));
-    assert(image.get() != 0);
-    read_metadata_threadsafe(image);
+    std::unique_ptr<Exiv2::Image> image = _exif_open_read(filename);
     Exiv2::XmpData &xmpData = image->xmpData();
 
     sqlite3_stmt *stmt;
@@ -5746,10 +6268,10 @@ gboolean dt_exif_xmp_write(const dt_imgid_t imgid,
 
   try
   {
-    Exiv2::XmpData xmpData;
     std::string xmpPacket;
     char *checksum_old = NULL;
-    if(!force_write && g_file_test(filename, G_FILE_TEST_EXISTS))
+    const gboolean merge = !force_write && g_file_test(filename, G_FILE_TEST_EXISTS);
+    if(merge)
     {
       // we want to avoid writing the sidecar file if it didn't change
       // to avoid issues when using the same images from different
@@ -5770,28 +6292,37 @@ gboolean dt_exif_xmp_write(const dt_imgid_t imgid,
                  "cannot read XMP file '%s': '%s'", filename, strerror(errno));
         dt_control_log(_("cannot read XMP file '%s': '%s'"), filename, strerror(errno));
       }
+    }
 
-      Exiv2::DataBuf buf = Exiv2::readFile(WIDEN(filename));
+    {
+      // the background job writes several sidecars in parallel, Exiv2
+      // isn't thread safe for this
+      Lock lock;
+      Exiv2::XmpData xmpData;
+      if(merge)
+      {
+        Exiv2::DataBuf buf = Exiv2::readFile(WIDEN(filename));
 #if EXIV2_TEST_VERSION(0,28,0)
-      xmpPacket.assign(buf.c_str(), buf.size());
+        xmpPacket.assign(buf.c_str(), buf.size());
 #else
-      xmpPacket.assign(reinterpret_cast<char *>(buf.pData_), buf.size_);
+        xmpPacket.assign(reinterpret_cast<char *>(buf.pData_), buf.size_);
 #endif
-      Exiv2::XmpParser::decode(xmpData, xmpPacket);
+        Exiv2::XmpParser::decode(xmpData, xmpPacket);
 
-      // Because XmpSeq or XmpBag are added to the list, we first have to
-      // remove these so that we don't end up with a string of duplicates.
-      _remove_known_keys(xmpData);
-    }
+        // Because XmpSeq or XmpBag are added to the list, we first have to
+        // remove these so that we don't end up with a string of duplicates.
+        _remove_known_keys(xmpData);
+      }
 
-    // Initialize xmp data:
-    _exif_xmp_read_data(xmpData, imgid, "dt_exif_xmp_write");
+      // Initialize xmp data:
+      _exif_xmp_read_data(xmpData, imgid, "dt_exif_xmp_write");
 
-    // Serialize the xmp data and output the xmp packet.
-    if(Exiv2::XmpParser::encode(xmpPacket, xmpData,
-       Exiv2::XmpParser::useCompactFormat | Exiv2::XmpParser::omitPacketWrapper) != 0)
-    {
-      throw Exiv2::Error(Exiv2::ErrorCode::kerErrorMessage, "[xmp_write] failed to serialize xmp data");
+      // Serialize the xmp data and output the xmp packet.
+      if(Exiv2::XmpParser::encode(xmpPacket, xmpData,
+         Exiv2::XmpParser::useCompactFormat | Exiv2::XmpParser::omitPacketWrapper) != 0)
+      {
+        throw Exiv2::Error(Exiv2::ErrorCode::kerErrorMessage, "[xmp_write] failed to serialize xmp data");
+      }
     }
 
     // Hash the new data and compare it to the old hash (if applicable).
@@ -5815,15 +6346,42 @@ gboolean dt_exif_xmp_write(const dt_imgid_t imgid,
     {
       // Using std::ofstream isn't possible here -- on Windows it
       // doesn't support Unicode filenames with mingw.
+      // The packet goes to a temporary file next to the sidecar which
+      // then replaces it, so that readers (and a crash) never see a
+      // partially written sidecar. A symlinked sidecar is replaced
+      // at its target, keeping the link, and the mode of the old
+      // sidecar is kept.
       errno = 0;
-      FILE *fout = g_fopen(filename, "wb");
+      char *target = NULL;
+#ifndef _WIN32
+      if(g_file_test(filename, G_FILE_TEST_IS_SYMLINK))
+        target = realpath(filename, NULL);
+#endif
+      const char *path = target ? target : filename;
+      gchar *tmpname = g_strconcat(path, ".XXXXXX", NULL);
+      const int fd = g_mkstemp_full(tmpname, O_WRONLY | O_BINARY, 0666);
+      GStatBuf statbuf;
+      if(fd != -1 && !g_stat(path, &statbuf))
+        g_chmod(tmpname, statbuf.st_mode & 0777);
+      FILE *fout = fd != -1 ? fdopen(fd, "wb") : NULL;
+      gboolean written = FALSE;
       if(fout)
       {
-        fprintf(fout, "%s", xml_header);
-        fprintf(fout, "%s", xmpPacket.c_str());
-        fclose(fout);
+        written = fprintf(fout, "%s", xml_header) >= 0
+                  && fprintf(fout, "%s", xmpPacket.c_str()) >= 0;
+        written = (fclose(fout) == 0) && written;
+        written = written && g_rename(tmpname, path) == 0;
+        if(!written) g_unlink(tmpname);
       }
-      else
+      else if(fd != -1)
+      {
+        close(fd);
+        g_unlink(tmpname);
+      }
+      g_free(tmpname);
+      free(target);
+
+      if(!written)
       {
         dt_print(DT_DEBUG_ALWAYS,
                  "cannot write XMP file '%s': '%s'", filename, strerror(errno));
@@ -5935,7 +6493,7 @@ void dt_exif_init()
   Exiv2::enableBMFF();
   #endif
 
-  Exiv2::XmpParser::initialize();
+  Exiv2::XmpParser::initialize(_exif_xmp_lock, &_xmp_toolkit_lock);
 
   // This has to stay with the old url (namespace already propagated outside dt).
   Exiv2::XmpProperties::registerNs("http://darktable.sf.net/", "darktable");
@@ -5963,6 +6521,15 @@ void dt_exif_init()
 
 void dt_exif_cleanup()
 {
+  {
+    std::lock_guard<std::mutex> lock(_prefetch_lock);
+    _prefetched.clear();
+  }
+  {
+    std::lock_guard<std::mutex> lock(_cache_lock);
+    if(_cache_db) sqlite3_close(_cache_db);
+    _cache_db = NULL;
+  }
   Exiv2::XmpParser::terminate();
 }
 
@@ -82,6 +82,17 @@ void dt_exif_sanitize_datetime(char *datetime);
  * struct. returns TRUE if no success. */
 gboolean dt_exif_read(dt_image_t *img, const char *path);
 
+/** drop the cached metadata of image files which are gone or have changed, done with the database
+    maintenance. */
+void dt_exif_cache_prune();
+
+/** read the metadata of an image and its xmp sidecar ahead of time so that the next dt_exif_read() and
+    dt_exif_xmp_read() of these files don't have to. can be called from several threads in parallel. */
+void dt_exif_prefetch(const char *path);
+
+/** drop data prefetched for the image at path and its xmp sidecar which hasn't been used. */
+void dt_exif_prefetch_release(const char *path);
+
 /** read exif data to image struct from given data blob, wherever you got it from.
     returns TRUE in case of an error */
 gboolean dt_exif_read_from_blob(dt_image_t *img, uint8_t *blob, const int size);
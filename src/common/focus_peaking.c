@@ -0,0 +1,340 @@
+/*
+    This file is part of darktable,
+    Copyright (C) 2025 darktable developers.
+
+    darktable is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    darktable is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with darktable.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "common/extra_optimizations.h"
+
+#include "common/darktable.h"
+#include "common/focus_peaking.h"
+#include "control/control.h"
+#include "control/jobs.h"
+#include "gui/gtk.h"
+
+// the overlays are kept, least recently used dropped first, as long
+// as they take less memory than this
+#define DT_FOCUSPEAKING_CACHE_BYTES ((size_t)128 << 20)
+// requests not started yet when more come in are dropped, oldest
+// first, the views have moved on since
+#define DT_FOCUSPEAKING_MAX_PENDING 32
+
+typedef struct dt_focuspeaking_entry_t
+{
+  dt_imgid_t imgid;
+  dt_mipmap_size_t mip;
+  dt_hash_t hash;
+  int width, height;
+  uint8_t *image;           // copy of the image until the overlay is computed
+  cairo_surface_t *overlay; // NULL until then
+} dt_focuspeaking_entry_t;
+
+static struct
+{
+  dt_pthread_mutex_t lock;
+  gboolean initialized;
+  GList *done;                      // computed, most recently used first
+  GList *pending;                   // waiting, most recently requested first
+  dt_focuspeaking_entry_t *running; // being computed by the job
+  gboolean running_removed;         // and no longer wanted
+  size_t bytes;
+  gboolean job_queued;
+} _fp;
+
+static void _entry_free(gpointer data)
+{
+  dt_focuspeaking_entry_t *e = data;
+  if(e->overlay) cairo_surface_destroy(e->overlay);
+  dt_free_align(e->image);
+  free(e);
+}
+
+static inline size_t _entry_bytes(const dt_focuspeaking_entry_t *e)
+{
+  return (size_t)4 * e->width * e->height;
+}
+
+// same image at the same size, possibly with other content
+static inline gboolean _entry_same_view(const dt_focuspeaking_entry_t *e,
+                                        const dt_imgid_t imgid,
+                                        const dt_mipmap_size_t mip,
+                                        const int width,
+                                        const int height)
+{
+  return e->imgid == imgid && e->mip == mip
+    && e->width == width && e->height == height;
+}
+
+static inline gboolean _entry_is(const dt_focuspeaking_entry_t *e,
+                                 const dt_imgid_t imgid,
+                                 const dt_mipmap_size_t mip,
+                                 const dt_hash_t hash,
+                                 const int width,
+                                 const int height)
+{
+  return _entry_same_view(e, imgid, mip, width, height) && e->hash == hash;
+}
+
+// drops the entries of the same view with other content, to be called
+// with the lock held
+static GList *_remove_outdated(GList *list,
+                               const dt_focuspeaking_entry_t *e,
+                               const gboolean computed)
+{
+  for(GList *l = list; l; )
+  {
+    GList *next = g_list_next(l);
+    dt_focuspeaking_entry_t *o = l->data;
+    if(o != e
+       && _entry_same_view(o, e->imgid, e->mip, e->width, e->height)
+       && o->hash != e->hash)
+    {
+      if(computed) _fp.bytes -= _entry_bytes(o);
+      _entry_free(o);
+      list = g_list_delete_link(list, l);
+    }
+    l = next;
+  }
+  return list;
+}
+
+static void _queue_job(void);
+
+// computes the most recently requested overlay, and queues itself
+// again if more are waiting so that other jobs get a chance to run
+static int32_t _job_run(dt_job_t *job)
+{
+  dt_pthread_mutex_lock(&_fp.lock);
+  dt_focuspeaking_entry_t *e = _fp.pending ? _fp.pending->data : NULL;
+  if(e)
+  {
+    _fp.pending = g_list_delete_link(_fp.pending, _fp.pending);
+    _fp.running = e;
+    _fp.running_removed = FALSE;
+  }
+  else
+    _fp.job_queued = FALSE;
+  dt_pthread_mutex_unlock(&_fp.lock);
+
+  if(!e) return 0;
+
+  const double start = dt_get_debug_wtime();
+
+  e->overlay = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, e->width, e->height);
+  if(cairo_surface_status(e->overlay) == CAIRO_STATUS_SUCCESS)
+  {
+    cairo_surface_flush(e->overlay);
+    // cairo's ARGB32 rows are 4 * width bytes, as expected by the computation
+    dt_focuspeaking_compute(e->width, e->height, e->image,
+                            cairo_image_surface_get_data(e->overlay));
+    cairo_surface_mark_dirty(e->overlay);
+  }
+  dt_free_align(e->image);
+  e->image = NULL;
+
+  dt_print(DT_DEBUG_LIGHTTABLE | DT_DEBUG_PERF,
+           "[focus peaking] image %d %dx%d overlay computed in %0.04f sec",
+           e->imgid, e->width, e->height, dt_get_debug_wtime() - start);
+
+  dt_pthread_mutex_lock(&_fp.lock);
+  const gboolean keep = !_fp.running_removed
+    && cairo_surface_status(e->overlay) == CAIRO_STATUS_SUCCESS;
+  _fp.running = NULL;
+  if(keep)
+  {
+    // the overlay shown meanwhile is replaced now
+    _fp.done = _remove_outdated(_fp.done, e, TRUE);
+    _fp.done = g_list_prepend(_fp.done, e);
+    _fp.bytes += _entry_bytes(e);
+    // always keep the one just computed
+    while(_fp.bytes > DT_FOCUSPEAKING_CACHE_BYTES && _fp.done->next)
+    {
+      GList *last = g_list_last(_fp.done);
+      _fp.bytes -= _entry_bytes(last->data);
+      _entry_free(last->data);
+      _fp.done = g_list_delete_link(_fp.done, last);
+    }
+  }
+  dt_pthread_mutex_unlock(&_fp.lock);
+
+  if(keep)
+    // the darkroom draws the overlay as it is there, the thumbnails
+    // poll until their surface is complete
+    dt_control_queue_redraw_center();
+  else
+    _entry_free(e);
+
+  _queue_job();
+  return 0;
+}
+
+static void _queue_job(void)
+{
+  dt_job_t *job = dt_control_job_create(&_job_run, "focus peaking");
+  if(job)
+    dt_control_add_job(darktable.control, DT_JOB_QUEUE_SYSTEM_BG, job);
+  else
+  {
+    dt_pthread_mutex_lock(&_fp.lock);
+    _fp.job_queued = FALSE;
+    dt_pthread_mutex_unlock(&_fp.lock);
+  }
+}
+
+void dt_focuspeaking_init(void)
+{
+  dt_pthread_mutex_init(&_fp.lock, NULL);
+  _fp.initialized = TRUE;
+}
+
+void dt_focuspeaking_cleanup(void)
+{
+  if(!_fp.initialized) return;
+
+  // the job has been stopped with the control, it may have left its entry
+  g_list_free_full(_fp.done, _entry_free);
+  g_list_free_full(_fp.pending, _entry_free);
+  if(_fp.running) _entry_free(_fp.running);
+  dt_pthread_mutex_destroy(&_fp.lock);
+  memset(&_fp, 0, sizeof(_fp));
+}
+
+cairo_surface_t *dt_focuspeaking_get_overlay(const dt_imgid_t imgid,
+                                             const dt_mipmap_size_t mip,
+                                             const dt_hash_t hash,
+                                             const int width,
+                                             const int height,
+                                             const uint8_t *const image,
+                                             gboolean *ready)
+{
+  *ready = FALSE;
+
+  // the filters need a few pixels
+  if(!_fp.initialized || width < 8 || height < 8) return NULL;
+
+  dt_pthread_mutex_lock(&_fp.lock);
+
+  // the overlay of this content, or else the one of the previous
+  // content of this view until the new one is computed
+  dt_focuspeaking_entry_t *found = NULL;
+  for(GList *l = _fp.done; l; l = g_list_next(l))
+  {
+    dt_focuspeaking_entry_t *e = l->data;
+    if(_entry_is(e, imgid, mip, hash, width, height))
+    {
+      // most recently used first
+      _fp.done = g_list_remove_link(_fp.done, l);
+      _fp.done = g_list_concat(l, _fp.done);
+      cairo_surface_t *overlay = cairo_surface_reference(e->overlay);
+      dt_pthread_mutex_unlock(&_fp.lock);
+      *ready = TRUE;
+      return overlay;
+    }
+    if(!found && _entry_same_view(e, imgid, mip, width, height))
+      found = e;
+  }
+  cairo_surface_t *previous = found ? cairo_surface_reference(found->overlay) : NULL;
+
+  gboolean requested =
+    _fp.running && _entry_is(_fp.running, imgid, mip, hash, width, height);
+  for(GList *l = _fp.pending; l && !requested; l = g_list_next(l))
+    requested = _entry_is(l->data, imgid, mip, hash, width, height);
+
+  if(!requested)
+  {
+    dt_focuspeaking_entry_t *e = calloc(1, sizeof(dt_focuspeaking_entry_t));
+    if(e) e->image = dt_alloc_align_uint8((size_t)4 * width * height);
+    if(e && e->image)
+    {
+      e->imgid = imgid;
+      e->mip = mip;
+      e->hash = hash;
+      e->width = width;
+      e->height = height;
+      memcpy(e->image, image, _entry_bytes(e));
+      // requests for earlier content of this view are of no use anymore
+      _fp.pending = _remove_outdated(_fp.pending, e, FALSE);
+      _fp.pending = g_list_prepend(_fp.pending, e);
+
+      if(g_list_length(_fp.pending) > DT_FOCUSPEAKING_MAX_PENDING)
+      {
+        GList *last = g_list_last(_fp.pending);
+        _entry_free(last->data);
+        _fp.pending = g_list_delete_link(_fp.pending, last);
+      }
+    }
+    else if(e)
+      _entry_free(e);
+  }
+
+  const gboolean start = _fp.pending && !_fp.job_queued;
+  if(start) _fp.job_queued = TRUE;
+  dt_pthread_mutex_unlock(&_fp.lock);
+
+  if(start) _queue_job();
+
+  return previous;
+}
+
+static GList *_remove_image(GList *list,
+                            const dt_imgid_t imgid,
+                            const gboolean computed)
+{
+  for(GList *l = list; l; )
+  {
+    GList *next = g_list_next(l);
+    dt_focuspeaking_entry_t *e = l->data;
+    if(!dt_is_valid_imgid(imgid) || e->imgid == imgid)
+    {
+      if(computed) _fp.bytes -= _entry_bytes(e);
+      _entry_free(e);
+      list = g_list_delete_link(list, l);
+    }
+    l = next;
+  }
+  return list;
+}
+
+void dt_focuspeaking_remove(const dt_imgid_t imgid)
+{
+  if(!_fp.initialized) return;
+
+  dt_pthread_mutex_lock(&_fp.lock);
+  _fp.done = _remove_image(_fp.done, imgid, TRUE);
+  _fp.pending = _remove_image(_fp.pending, imgid, FALSE);
+  if(_fp.running && (!dt_is_valid_imgid(imgid) || _fp.running->imgid == imgid))
+    _fp.running_removed = TRUE;
+  dt_pthread_mutex_unlock(&_fp.lock);
+}
+
+void dt_focuspeaking_paint(cairo_t *cr,
+                           cairo_surface_t *overlay)
+{
+  cairo_save(cr);
+  cairo_rectangle(cr, 0, 0,
+                  cairo_image_surface_get_width(overlay),
+                  cairo_image_surface_get_height(overlay));
+  cairo_set_operator(cr, CAIRO_OPERATOR_OVER);
+  cairo_set_source_surface(cr, overlay, 0.0, 0.0);
+  cairo_pattern_set_filter(cairo_get_source (cr), darktable.gui->filter_image);
+  cairo_fill(cr);
+  cairo_restore(cr);
+}
+
+// clang-format off
+// modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
+// vim: shiftwidth=2 expandtab tabstop=2 cindent
+// kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
+// clang-format on
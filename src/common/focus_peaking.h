@@ -18,8 +18,11 @@
 
 #pragma once
 
+#include <cairo.h>
+
 #include "common/box_filters.h"
 #include "common/fast_guided_filter.h"
+#include "common/mipmap_cache.h"
 #include "develop/openmp_maths.h"
 
 /* NOTE: this code complies with the optimizations in "common/extra_optimizations.h".
@@ -73,13 +76,14 @@ static inline void _get_indices(const size_t i,
   index[7] = lower_line + right_row;      // south east
 }
 
-static inline void dt_focuspeaking(cairo_t *cr,
-                                   const int buf_width,
-                                   const int buf_height,
-                                   uint8_t *const restrict image)
+// computes the focus peaking overlay of image, both buf_width x
+// buf_height with 4 bytes per pixel, the overlay as cairo ARGB32
+static inline void dt_focuspeaking_compute(const int buf_width,
+                                           const int buf_height,
+                                           const uint8_t *const restrict image,
+                                           uint8_t *const restrict focus_peaking)
 {
   float *const restrict luma = dt_alloc_align_float((size_t)buf_width * buf_height);
-  uint8_t *const restrict focus_peaking = dt_alloc_align_uint8(buf_width * buf_height * 4);
 
   const size_t npixels = (size_t)buf_height * buf_width;
   // Create a luma buffer as the euclidian norm of RGB channels
@@ -193,26 +197,38 @@ static inline void dt_focuspeaking(cairo_t *cr,
       }
     }
 
-  // draw the focus peaking overlay
-  cairo_save(cr);
-  cairo_rectangle(cr, 0, 0, buf_width, buf_height);
-  cairo_surface_t *surface = cairo_image_surface_create_for_data((unsigned char *)focus_peaking,
-                                                                 CAIRO_FORMAT_ARGB32,
-                                                                 buf_width, buf_height,
-                                                                 cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, buf_width));
-  cairo_set_operator(cr, CAIRO_OPERATOR_OVER);
-  cairo_set_source_surface(cr, surface, 0.0, 0.0);
-  cairo_pattern_set_filter(cairo_get_source (cr), darktable.gui->filter_image);
-  cairo_fill(cr);
-  cairo_restore(cr);
-
   // cleanup
-  cairo_surface_destroy(surface);
   dt_free_align(luma);
   dt_free_align(luma_ds);
-  dt_free_align(focus_peaking);
 }
 
+/* The overlays shown in the thumbnails, culling and darkroom are
+ * computed by a background job, as they are too slow for the draw
+ * callbacks with many images visible.
+ *
+ * dt_focuspeaking_get_overlay() returns a new reference to the overlay
+ * of a width x height image and sets ready. While it is being computed
+ * ready is FALSE and the caller has to draw again later, meanwhile the
+ * overlay of the previous content of this image and size is returned if
+ * there is one, NULL otherwise. The overlays are cached per image,
+ * mipmap size (DT_MIPMAP_NONE for a pipe output), hash of the content
+ * and size.
+ **/
+void dt_focuspeaking_init(void);
+void dt_focuspeaking_cleanup(void);
+cairo_surface_t *dt_focuspeaking_get_overlay(const dt_imgid_t imgid,
+                                             const dt_mipmap_size_t mip,
+                                             const dt_hash_t hash,
+                                             const int width,
+                                             const int height,
+                                             const uint8_t *const image,
+                                             gboolean *ready);
+// forget the overlays of an image, or of all images for NO_IMGID
+void dt_focuspeaking_remove(const dt_imgid_t imgid);
+// draws the overlay at the origin of cr
+void dt_focuspeaking_paint(cairo_t *cr,
+                           cairo_surface_t *overlay);
+
 // clang-format off
 // modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
 // vim: shiftwidth=2 expandtab tabstop=2 cindent
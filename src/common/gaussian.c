@@ -196,309 +196,260 @@ error:
 }
 
 
-void dt_gaussian_blur(dt_gaussian_t *g, const float *const in, float *const out)
-{
-
-  const int width = g->width;
-  const int height = g->height;
-  const int ch = MIN(4, g->channels); // just to appease zealous compiler warnings about stack usage
+// number of floats filtered together by the recursive filter, for 4 channel images
+// this is 16 columns or rows per pass
+#define GAUSS_LANES 64
+// number of pixels per row tile transposed for the horizontal pass
+#define GAUSS_TILE 32
 
+typedef struct dt_gauss_coeffs_t
+{
   float a0, a1, a2, a3, b1, b2, coefp, coefn;
+} dt_gauss_coeffs_t;
 
-  _compute_gauss_params(g->sigma, g->order, &a0, &a1, &a2, &a3, &b1, &b2, &coefp, &coefn);
-
-  float *temp = g->buf;
-
-  float *Labmax = g->max;
-  float *Labmin = g->min;
-
-// vertical blur column by column
-  DT_OMP_FOR()
-  for(int i = 0; i < width; i++)
+/* The recursive filter runs over len samples of n interleaved and independent lanes,
+   samples are stride floats apart. As all lanes are contiguous in memory the recursion
+   is vectorised over the lanes, the state is kept by the caller so a line can be
+   processed in consecutive chunks.
+*/
+static inline void _forward_lanes(const float *const restrict in,
+                                  float *const restrict out,
+                                  const size_t n,
+                                  const size_t len,
+                                  const size_t stride,
+                                  const dt_gauss_coeffs_t *const c,
+                                  const float *const restrict lo,
+                                  const float *const restrict hi,
+                                  float *const restrict xp,
+                                  float *const restrict yp,
+                                  float *const restrict yb)
+{
+  const float a0 = c->a0, a1 = c->a1, b1 = c->b1, b2 = c->b2;
+  for(size_t j = 0; j < len; j++)
   {
-    dt_aligned_pixel_t xp = {0.0f};
-    dt_aligned_pixel_t yb = {0.0f};
-    dt_aligned_pixel_t yp = {0.0f};
-
-    // forward filter
-    for(int k = 0; k < ch; k++)
+    const float *const restrict src = in + j * stride;
+    float *const restrict dst = out + j * stride;
+    DT_OMP_SIMD()
+    for(size_t i = 0; i < n; i++)
     {
-      xp[k] = CLAMPF(in[(size_t)i * ch + k], Labmin[k], Labmax[k]);
-      yb[k] = xp[k] * coefp;
-      yp[k] = yb[k];
-    }
-
-    dt_aligned_pixel_t xc = {0.0f};
-    dt_aligned_pixel_t yc = {0.0f};
-    dt_aligned_pixel_t xn = {0.0f};
-    dt_aligned_pixel_t xa = {0.0f};
-    dt_aligned_pixel_t yn = {0.0f};
-    dt_aligned_pixel_t ya = {0.0f};
-    for(int j = 0; j < height; j++)
-    {
-      size_t offset = ((size_t)j * width + i) * ch;
-
-      for(int k = 0; k < ch; k++)
-      {
-        xc[k] = CLAMPF(in[offset + k], Labmin[k], Labmax[k]);
-        yc[k] = (a0 * xc[k]) + (a1 * xp[k]) - (b1 * yp[k]) - (b2 * yb[k]);
-
-        temp[offset + k] = yc[k];
-
-        xp[k] = xc[k];
-        yb[k] = yp[k];
-        yp[k] = yc[k];
-      }
-    }
-
-    // backward filter
-    for(int k = 0; k < ch; k++)
-    {
-      xn[k] = CLAMPF(in[((size_t)(height - 1) * width + i) * ch + k], Labmin[k], Labmax[k]);
-      xa[k] = xn[k];
-      yn[k] = xn[k] * coefn;
-      ya[k] = yn[k];
-    }
-
-    for(int j = height - 1; j > -1; j--)
-    {
-      size_t offset = ((size_t)j * width + i) * ch;
-
-      for(int k = 0; k < ch; k++)
-      {
-        xc[k] = CLAMPF(in[offset + k], Labmin[k], Labmax[k]);
-
-        yc[k] = (a2 * xn[k]) + (a3 * xa[k]) - (b1 * yn[k]) - (b2 * ya[k]);
-
-        xa[k] = xn[k];
-        xn[k] = xc[k];
-        ya[k] = yn[k];
-        yn[k] = yc[k];
-
-        temp[offset + k] += yc[k];
-      }
+      const float xc = CLAMPF(src[i], lo[i], hi[i]);
+      const float yc = (a0 * xc) + (a1 * xp[i]) - (b1 * yp[i]) - (b2 * yb[i]);
+      dst[i] = yc;
+      xp[i] = xc;
+      yb[i] = yp[i];
+      yp[i] = yc;
     }
   }
+}
 
-// horizontal blur line by line
-  DT_OMP_FOR()
-  for(int j = 0; j < height; j++)
+static inline void _backward_lanes(const float *const restrict in,
+                                   float *const restrict out,
+                                   const gboolean accumulate,
+                                   const size_t n,
+                                   const size_t len,
+                                   const size_t stride,
+                                   const dt_gauss_coeffs_t *const c,
+                                   const float *const restrict lo,
+                                   const float *const restrict hi,
+                                   float *const restrict xn,
+                                   float *const restrict xa,
+                                   float *const restrict yn,
+                                   float *const restrict ya)
+{
+  const float a2 = c->a2, a3 = c->a3, b1 = c->b1, b2 = c->b2;
+  for(size_t j = len; j > 0; j--)
   {
-    dt_aligned_pixel_t xp = {0.0f};
-    dt_aligned_pixel_t yb = {0.0f};
-    dt_aligned_pixel_t yp = {0.0f};
-
-    // forward filter
-    for(int k = 0; k < ch; k++)
+    const float *const restrict src = in + (j - 1) * stride;
+    float *const restrict dst = out + (j - 1) * stride;
+    DT_OMP_SIMD()
+    for(size_t i = 0; i < n; i++)
     {
-      xp[k] = CLAMPF(temp[(size_t)j * width * ch + k], Labmin[k], Labmax[k]);
-      yb[k] = xp[k] * coefp;
-      yp[k] = yb[k];
+      const float xc = CLAMPF(src[i], lo[i], hi[i]);
+      const float yc = (a2 * xn[i]) + (a3 * xa[i]) - (b1 * yn[i]) - (b2 * ya[i]);
+      xa[i] = xn[i];
+      xn[i] = xc;
+      ya[i] = yn[i];
+      yn[i] = yc;
+      dst[i] = accumulate ? dst[i] + yc : yc;
     }
+  }
+}
 
-    dt_aligned_pixel_t xc = {0.0f};
-    dt_aligned_pixel_t yc = {0.0f};
-    dt_aligned_pixel_t xn = {0.0f};
-    dt_aligned_pixel_t xa = {0.0f};
-    dt_aligned_pixel_t yn = {0.0f};
-    dt_aligned_pixel_t ya = {0.0f};
-
-    for(int i = 0; i < width; i++)
-    {
-      size_t offset = ((size_t)j * width + i) * ch;
-
-      for(int k = 0; k < ch; k++)
-      {
-        xc[k] = CLAMPF(temp[offset + k], Labmin[k], Labmax[k]);
-        yc[k] = (a0 * xc[k]) + (a1 * xp[k]) - (b1 * yp[k]) - (b2 * yb[k]);
-
-        out[offset + k] = yc[k];
-
-        xp[k] = xc[k];
-        yb[k] = yp[k];
-        yp[k] = yc[k];
-      }
-    }
+// boundary conditions assume the edge value is repeated infinitely
+static inline void _init_forward(const float *const restrict first,
+                                 const size_t n,
+                                 const dt_gauss_coeffs_t *const c,
+                                 const float *const restrict lo,
+                                 const float *const restrict hi,
+                                 float *const restrict xp,
+                                 float *const restrict yp,
+                                 float *const restrict yb)
+{
+  for(size_t i = 0; i < n; i++)
+  {
+    xp[i] = CLAMPF(first[i], lo[i], hi[i]);
+    yb[i] = xp[i] * c->coefp;
+    yp[i] = yb[i];
+  }
+}
 
-    // backward filter
-    for(int k = 0; k < ch; k++)
-    {
-      xn[k] = CLAMPF(temp[((size_t)(j + 1) * width - 1) * ch + k], Labmin[k], Labmax[k]);
-      xa[k] = xn[k];
-      yn[k] = xn[k] * coefn;
-      ya[k] = yn[k];
-    }
+static inline void _init_backward(const float *const restrict last,
+                                  const size_t n,
+                                  const dt_gauss_coeffs_t *const c,
+                                  const float *const restrict lo,
+                                  const float *const restrict hi,
+                                  float *const restrict xn,
+                                  float *const restrict xa,
+                                  float *const restrict yn,
+                                  float *const restrict ya)
+{
+  for(size_t i = 0; i < n; i++)
+  {
+    xn[i] = CLAMPF(last[i], lo[i], hi[i]);
+    xa[i] = xn[i];
+    yn[i] = xn[i] * c->coefn;
+    ya[i] = yn[i];
+  }
+}
 
-    for(int i = width - 1; i > -1; i--)
+// copy nr rows of np pixels into a tile holding one pixel of every row per sample, or back
+static inline void _transpose_tile(float *const restrict img,
+                                   float *const restrict tile,
+                                   const size_t width,
+                                   const size_t ch,
+                                   const size_t nr,
+                                   const size_t np,
+                                   const int mode) // 0: img to tile, 1: tile to img, 2: add tile to img
+{
+  for(size_t r = 0; r < nr; r++)
+  {
+    float *const restrict row = img + r * width * ch;
+    for(size_t p = 0; p < np; p++)
     {
-      size_t offset = ((size_t)j * width + i) * ch;
-
-      for(int k = 0; k < ch; k++)
+      float *const restrict t = tile + (p * nr + r) * ch;
+      for(size_t k = 0; k < ch; k++)
       {
-        xc[k] = CLAMPF(temp[offset + k], Labmin[k], Labmax[k]);
-
-        yc[k] = (a2 * xn[k]) + (a3 * xa[k]) - (b1 * yn[k]) - (b2 * ya[k]);
-
-        xa[k] = xn[k];
-        xn[k] = xc[k];
-        ya[k] = yn[k];
-        yn[k] = yc[k];
-
-        out[offset + k] += yc[k];
+        if(mode == 0)      t[k] = row[p * ch + k];
+        else if(mode == 1) row[p * ch + k] = t[k];
+        else               row[p * ch + k] += t[k];
       }
     }
   }
 }
 
-void dt_gaussian_blur_4c(dt_gaussian_t *g, const float *const in, float *const out)
+static void _gaussian_blur(dt_gaussian_t *g,
+                           const float *const in,
+                           float *const out,
+                           const int ch)
 {
-  assert(g->channels == 4);
+  const double start = dt_get_debug_wtime();
   const size_t width = g->width;
   const size_t height = g->height;
+  const size_t rowsize = width * ch;
 
-  float a0, a1, a2, a3, b1, b2, coefp, coefn;
-
-  _compute_gauss_params(g->sigma, g->order, &a0, &a1, &a2, &a3, &b1, &b2, &coefp, &coefn);
+  dt_gauss_coeffs_t c;
+  _compute_gauss_params(g->sigma, g->order, &c.a0, &c.a1, &c.a2, &c.a3, &c.b1, &c.b2, &c.coefp, &c.coefn);
 
   float *const temp = g->buf;
 
-  dt_aligned_pixel_t Labmin, Labmax;
-  copy_pixel(Labmin, g->min);
-  copy_pixel(Labmax, g->max);
+  // a block always holds whole pixels so the clamping limits are the same for every block
+  const size_t block = (GAUSS_LANES / ch) * ch;
+  float DT_ALIGNED_ARRAY lo[GAUSS_LANES];
+  float DT_ALIGNED_ARRAY hi[GAUSS_LANES];
+  for(size_t i = 0; i < block; i++)
+  {
+    lo[i] = g->min[i % ch];
+    hi[i] = g->max[i % ch];
+  }
 
-// vertical blur column by column
+  // vertical blur, a block of neighbouring columns per pass
   DT_OMP_FOR()
-  for(size_t i = 0; i < width; i++)
+  for(size_t col = 0; col < rowsize; col += block)
   {
-    // forward filter
-    dt_aligned_pixel_t xp;
-    dt_aligned_pixel_t yb;
-    dt_aligned_pixel_t yp;
-    for_four_channels(k)
-    {
-      xp[k] = CLAMPF(in[4*i + k], Labmin[k], Labmax[k]);
-      yb[k] = xp[k] * coefp;
-      yp[k] = yb[k];
-    }
-
-    dt_aligned_pixel_t xc;
-    dt_aligned_pixel_t xn;
-    dt_aligned_pixel_t xa;
-    for(size_t j = 0; j < height; j++)
-    {
-      size_t offset = 4 * (j * width + i);
-
-      dt_aligned_pixel_t yc;
-      for_four_channels(k)
-      {
-        xc[k] = CLAMPF(in[offset + k], Labmin[k], Labmax[k]);
-        yc[k] = (a0 * xc[k]) + (a1 * xp[k]) - (b1 * yp[k]) - (b2 * yb[k]);
-
-        xp[k] = xc[k];
-        yb[k] = yp[k];
-        yp[k] = yc[k];
-      }
-      copy_pixel(temp + offset, yc);
-    }
+    const size_t n = MIN(block, rowsize - col);
+    float DT_ALIGNED_ARRAY s1[GAUSS_LANES];
+    float DT_ALIGNED_ARRAY s2[GAUSS_LANES];
+    float DT_ALIGNED_ARRAY s3[GAUSS_LANES];
+    float DT_ALIGNED_ARRAY s4[GAUSS_LANES];
 
-    // backward filter
-    dt_aligned_pixel_t yn;
-    dt_aligned_pixel_t ya;
-    for_four_channels(k)
-    {
-      xn[k] = CLAMPF(in[4*((height - 1) * width + i) + k], Labmin[k], Labmax[k]);
-      xa[k] = xn[k];
-      yn[k] = xn[k] * coefn;
-      ya[k] = yn[k];
-    }
+    _init_forward(in + col, n, &c, lo, hi, s1, s2, s3);
+    _forward_lanes(in + col, temp + col, n, height, rowsize, &c, lo, hi, s1, s2, s3);
 
-    for(size_t j = height; j > 0; j--)
-    {
-      size_t offset = 4 * ((j-1) * width + i);
-
-      dt_aligned_pixel_t yc;
-      for_four_channels(k)
-      {
-        xc[k] = CLAMPF(in[offset + k], Labmin[k], Labmax[k]);
-
-        yc[k] = (a2 * xn[k]) + (a3 * xa[k]) - (b1 * yn[k]) - (b2 * ya[k]);
-
-        xa[k] = xn[k];
-        xn[k] = xc[k];
-        ya[k] = yn[k];
-        yn[k] = yc[k];
-        temp[offset + k] += yc[k];
-      }
-    }
+    _init_backward(in + (height - 1) * rowsize + col, n, &c, lo, hi, s1, s2, s3, s4);
+    _backward_lanes(in + col, temp + col, TRUE, n, height, rowsize, &c, lo, hi, s1, s2, s3, s4);
   }
 
-// horizontal blur line by line
+  /* horizontal blur, a block of rows is transposed tile by tile so the filter runs on
+     neighbouring rows as independent lanes without strided memory access.
+     Without the tile buffers we do it line by line.
+  */
+  const size_t rows = block / ch;
+  size_t padded = 0;
+  float *const tiles = dt_alloc_perthread_float(2 * GAUSS_TILE * GAUSS_LANES, &padded);
+  const size_t rowstep = tiles ? rows : 1;
   DT_OMP_FOR()
-  for(size_t j = 0; j < height; j++)
+  for(size_t row = 0; row < height; row += rowstep)
   {
-    // forward filter
-    dt_aligned_pixel_t xp;
-    dt_aligned_pixel_t yb;
-    dt_aligned_pixel_t yp;
-    dt_aligned_pixel_t xc;
-    for_four_channels(k)
+    float DT_ALIGNED_ARRAY s1[GAUSS_LANES];
+    float DT_ALIGNED_ARRAY s2[GAUSS_LANES];
+    float DT_ALIGNED_ARRAY s3[GAUSS_LANES];
+    float DT_ALIGNED_ARRAY s4[GAUSS_LANES];
+    float *const img = temp + row * rowsize;
+    float *const res = out + row * rowsize;
+
+    if(!tiles)
     {
-      xp[k] = CLAMPF(temp[4*(j * width) + k], Labmin[k], Labmax[k]);
-      yb[k] = xp[k] * coefp;
-      yp[k] = yb[k];
+      _init_forward(img, ch, &c, lo, hi, s1, s2, s3);
+      _forward_lanes(img, res, ch, width, ch, &c, lo, hi, s1, s2, s3);
+      _init_backward(img + rowsize - ch, ch, &c, lo, hi, s1, s2, s3, s4);
+      _backward_lanes(img, res, TRUE, ch, width, ch, &c, lo, hi, s1, s2, s3, s4);
+      continue;
     }
 
-    for(size_t i = 0; i < width; i++)
-    {
-      size_t offset = 4 * (j * width + i);
-      dt_aligned_pixel_t yc;
-
-      for_four_channels(k)
-      {
-        xc[k] = CLAMPF(temp[offset + k], Labmin[k], Labmax[k]);
-        yc[k] = (a0 * xc[k]) + (a1 * xp[k]) - (b1 * yp[k]) - (b2 * yb[k]);
-
-        out[offset + k] = yc[k];
+    float *const src = dt_get_perthread(tiles, padded);
+    float *const dst = src + GAUSS_TILE * GAUSS_LANES;
+    const size_t nr = MIN(rows, height - row);
+    const size_t n = nr * ch;
 
-        xp[k] = xc[k];
-        yb[k] = yp[k];
-        yp[k] = yc[k];
-      }
-    }
-
-    // backward filter
-    dt_aligned_pixel_t xn;
-    dt_aligned_pixel_t xa;
-    dt_aligned_pixel_t ya;
-    dt_aligned_pixel_t yn;
-    for_four_channels(k)
+    for(size_t p = 0; p < width; p += GAUSS_TILE)
     {
-      xn[k] = CLAMPF(temp[4*((j + 1) * width - 1) + k], Labmin[k], Labmax[k]);
-      xa[k] = xn[k];
-      yn[k] = xn[k] * coefn;
-      ya[k] = yn[k];
+      const size_t np = MIN(GAUSS_TILE, width - p);
+      _transpose_tile(img + p * ch, src, width, ch, nr, np, 0);
+      if(p == 0) _init_forward(src, n, &c, lo, hi, s1, s2, s3);
+      _forward_lanes(src, dst, n, np, n, &c, lo, hi, s1, s2, s3);
+      _transpose_tile(res + p * ch, dst, width, ch, nr, np, 1);
     }
 
-    for(int i = width - 1; i > -1; i--)
+    const size_t last = ((width - 1) / GAUSS_TILE) * GAUSS_TILE;
+    for(size_t p = last + GAUSS_TILE; p > 0; p -= GAUSS_TILE)
     {
-      size_t offset = 4 * (j * width + i);
-
-      dt_aligned_pixel_t yc;
-      for_four_channels(k)
-      {
-        xc[k] = CLAMPF(temp[offset + k], Labmin[k], Labmax[k]);
+      const size_t first = p - GAUSS_TILE;
+      const size_t np = MIN(GAUSS_TILE, width - first);
+      _transpose_tile(img + first * ch, src, width, ch, nr, np, 0);
+      if(first == last) _init_backward(src + (np - 1) * n, n, &c, lo, hi, s1, s2, s3, s4);
+      _backward_lanes(src, dst, FALSE, n, np, n, &c, lo, hi, s1, s2, s3, s4);
+      _transpose_tile(res + first * ch, dst, width, ch, nr, np, 2);
+    }
+  }
+  dt_free_align(tiles);
 
-        yc[k] = (a2 * xn[k]) + (a3 * xa[k]) - (b1 * yn[k]) - (b2 * ya[k]);
+  if(darktable.unmuted & DT_DEBUG_PERF)
+  {
+    const double spent = dt_get_debug_wtime() - start;
+    dt_print(DT_DEBUG_PERF, "[gaussian blur] %ix%i %i channels, sigma %.2f: %.4fs, %.1f Mpix/s",
+             g->width, g->height, ch, g->sigma, spent, (double)width * height / MAX(1e-6, spent) * 1e-6);
+  }
+}
 
-        xa[k] = xn[k];
-        xn[k] = xc[k];
-        ya[k] = yn[k];
-        yn[k] = yc[k];
+void dt_gaussian_blur(dt_gaussian_t *g, const float *const in, float *const out)
+{
+  _gaussian_blur(g, in, out, MIN(4, g->channels));
+}
 
-        out[offset + k] += yc[k];
-      }
-    }
-  }
+void dt_gaussian_blur_4c(dt_gaussian_t *g, const float *const in, float *const out)
+{
+  assert(g->channels == 4);
+  _gaussian_blur(g, in, out, 4);
 }
 
 void dt_gaussian_free(dt_gaussian_t *g)
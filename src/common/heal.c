@@ -16,6 +16,7 @@
     along with darktable.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include "common/math.h"
 #include "control/control.h"
 #include "develop/imageop.h"
 #include "develop/openmp_maths.h"
@@ -34,315 +35,302 @@
  * but subtract them I2 = I0 - I1, where I0 is the sample image to be
  * corrected, I1 is the reference pattern. Then we solve DeltaI=0
  * (Laplace) with I2 Dirichlet conditions at the borders of the
- * mask. The solver is a red/black checker Gauss-Seidel with over-relaxation.
- * It could benefit from a multi-grid evaluation of an initial solution
- * before the main iteration loop.
+ * mask. Image borders inside the mask have Neumann conditions (the
+ * missing neighbours are left out).
  *
- * I reduced the convergence criteria to 0.1% (0.001) as we are
- * dealing here with RGB integer components, more is overkill.
+ * The solver is a geometric multigrid: V-cycles of red/black Gauss-Seidel
+ * with the residual restricted to a half resolution grid down to a coarsest
+ * level of a few pixels, solved with over-relaxation. A coarse pixel is
+ * solved for if at least three of the four pixels it covers are. Each cycle
+ * reduces the error by a roughly constant factor whatever the size of the
+ * mask, where plain relaxation needed a number of iterations growing with
+ * the size (and for large masks never reached its convergence criteria).
+ *
+ * The error wanted is 0.1% (0.001) as we are dealing here with RGB integer
+ * components, more is overkill. The residual bounds the error only up to a
+ * factor growing with the size of the mask, cycles are run until the RMS
+ * residual is below 3e-7, which gives less than 0.02% on large masks.
  *
  * Jean-Yves Couleaud cjyves@free.fr
  */
 
+// levels are halved down to this size
+#define DT_HEAL_MIN_LEVEL 16
+// Gauss-Seidel sweeps before and after the coarse grid correction
+#define DT_HEAL_SMOOTH 2
 
-// Subtract bottom from top and store in result as a float; separate 'red' and 'black' pixels into
-// two contiguous regions
-static void _heal_sub(const float *const top_buffer, const float *const bottom_buffer,
-                      float *const restrict red_buffer, float *const restrict black_buffer,
-                      const size_t width, const size_t height)
+typedef struct dt_heal_level_t
+{
+  size_t width;
+  size_t height;
+  float *u;      // solution at the finest level, correction below, 4 channels
+  float *f;      // right hand side, 4 channels
+  uint8_t *mask; // pixels solved for
+  int *span;     // per row, first and past the last column solved for
+} dt_heal_level_t;
+
+// number of neighbours inside the image
+static inline float _heal_neighbours(const size_t row, const size_t col, const size_t width, const size_t height)
 {
-  // how many red or black pixels per line?  For consistency, we need the larger of the two, so round up
-  const size_t res_stride = 4 * ((width + 1) / 2);
+  return (row > 0) + (row + 1 < height) + (col > 0) + (col + 1 < width);
+}
 
-  DT_OMP_FOR()
-  for(size_t row = 0; row < height; row++)
+// sum of the neighbours inside the image
+static inline void _heal_neighbour_sum(const float *const restrict u, const size_t row, const size_t col,
+                                       const size_t width, const size_t height, dt_aligned_pixel_t sum)
+{
+  const size_t k = row * width + col;
+  for_each_channel(c) sum[c] = 0.0f;
+  if(row > 0)          for_each_channel(c) sum[c] += u[4 * (k - width) + c];
+  if(row + 1 < height) for_each_channel(c) sum[c] += u[4 * (k + width) + c];
+  if(col > 0)          for_each_channel(c) sum[c] += u[4 * (k - 1) + c];
+  if(col + 1 < width)  for_each_channel(c) sum[c] += u[4 * (k + 1) + c];
+}
+
+// One red/black Gauss-Seidel sweep of a * u - sum(neighbours) = f over the masked pixels, with over-relaxation
+// factor w.
+static void _heal_smooth(const dt_heal_level_t *const l, const float w)
+{
+  const size_t width = l->width;
+  const size_t height = l->height;
+  float *const restrict u = l->u;
+  const float *const restrict f = l->f;
+  const uint8_t *const restrict mask = l->mask;
+
+  for(int parity = 0; parity < 2; parity++)
   {
-    const int parity = row & 1;
-    const size_t row_start = (row+1) * res_stride;
-    float *const buf1 = parity ? red_buffer + row_start : black_buffer + row_start;
-    float *const buf2 = parity ? black_buffer + row_start : red_buffer + row_start;
-    // handle the pixels of the row pairwise, one red and one black at a time
-    for(size_t col = 0; col < width/2; col++)
+    DT_OMP_FOR()
+    for(size_t row = 0; row < height; row++)
     {
-      const size_t idx = 4 * (row * width + 2*col);
-      for_each_channel(c)
+      const size_t first = l->span[2 * row] + ((l->span[2 * row] + row + parity) & 1);
+      for(size_t col = first; col < l->span[2 * row + 1]; col += 2)
       {
-        buf1[4*col + c] = top_buffer[idx + c] - bottom_buffer[idx + c];
-        buf2[4*col + c] = top_buffer[idx+4 + c] - bottom_buffer[idx+4 + c];
-      }
-    }
-    if(width & 1)
-    {
-      // Handle the left-over pixel when the total width is odd.  Its color will always be the same as the
-      // left-most pixel, so it goes into buf1
-      const size_t res_idx = (width-1)/2;
-      const size_t idx = 4 * (row * width + (width-1));
-      for_each_channel(c)
-      {
-        buf1[4*res_idx + c] = top_buffer[idx + c] - bottom_buffer[idx + c];
-        buf2[4*res_idx + c] = 0.0f;
+        const size_t k = row * width + col;
+        if(!mask[k]) continue;
+        const float a = _heal_neighbours(row, col, width, height);
+        if(a == 0.0f) continue;
+        dt_aligned_pixel_t sum;
+        _heal_neighbour_sum(u, row, col, width, height, sum);
+        for_each_channel(c)
+          u[4 * k + c] += w * ((sum[c] + f[4 * k + c]) / a - u[4 * k + c]);
       }
     }
   }
-  // clear the top and bottom rows, used for padding
-  memset(red_buffer, 0, res_stride * sizeof(float));
-  memset(red_buffer + (height+1)*res_stride, 0, res_stride * sizeof(float));
-  memset(black_buffer, 0, res_stride * sizeof(float));
-  memset(black_buffer + (height+1)*res_stride, 0, res_stride * sizeof(float));
 }
 
-// Add first to second and store in result, re-interleaving the 'red' and 'black' pixels
-static void _heal_add(const float *const restrict red_buffer, const float *const black_buffer,
-                      const float *const restrict second_buffer, float *const restrict result_buffer,
-                      const size_t width, const size_t height)
+// Squared residual f - (a * u - sum(neighbours)) of the RGB channels over the masked pixels
+static float _heal_residual(const dt_heal_level_t *const l)
 {
-  // how many red or black pixels per line?  For consistency, we need the larger of the two, so round up, then
-  // add one to ensure a padding pixel on the right
-  const size_t res_stride = 4 * ((width + 1) / 2);
+  const size_t width = l->width;
+  const size_t height = l->height;
+  const float *const restrict u = l->u;
+  const float *const restrict f = l->f;
+  float err = 0.0f;
 
-  DT_OMP_FOR()
+  DT_OMP_FOR(reduction(+ : err))
   for(size_t row = 0; row < height; row++)
   {
-    const int parity = row & 1;
-    const size_t row_start = (row+1) * res_stride;
-    const float *const restrict buf1 = parity ? red_buffer + row_start : black_buffer + row_start;
-    const float *const restrict buf2 = parity ? black_buffer + row_start : red_buffer + row_start;
-    // handle the pixels of the row pairwise, one red and one black at a time
-    for(size_t col = 0; col < width/2; col++)
-    {
-      const size_t idx = 4 * (row * width + 2*col);
-      for_each_channel(c)
-      {
-        result_buffer[idx + c] = buf1[4*col + c] + second_buffer[idx + c];
-        result_buffer[idx + 4 + c] = buf2[4*col + c] + second_buffer[idx + 4 + c];
-      }
-    }
-    if(width & 1)
+    for(size_t col = l->span[2 * row]; col < l->span[2 * row + 1]; col++)
     {
-      // handle the left-over pixel when the total width is odd
-      const size_t res_idx = (width-1)/2;
-      const size_t idx = 4 * (row * width + (width-1));
-      for_each_channel(c)
-        result_buffer[idx + c] = buf1[4*res_idx + c] + second_buffer[idx + c];
+      const size_t k = row * width + col;
+      if(!l->mask[k]) continue;
+      const float a = _heal_neighbours(row, col, width, height);
+      dt_aligned_pixel_t sum;
+      _heal_neighbour_sum(u, row, col, width, height, sum);
+      for(int c = 0; c < 3; c++)
+        err += sqf(f[4 * k + c] + sum[c] - a * u[4 * k + c]);
     }
   }
+  return err;
 }
 
-// Perform one iteration of Gauss-Seidel, and return the sum squared residual.
-static float _heal_laplace_iteration(float *const restrict active_pixels,
-                                     const float *const restrict neighbor_pixels,
-                                     const size_t height, const size_t width, const unsigned *const restrict runs,
-                                     const size_t num_runs, const size_t start_parity, const float w)
+// Restrict the residual of the fine level to the right hand side of the coarse one. The coarse operator is
+// the same stencil at twice the spacing, so the coarse right hand side is four times the average residual,
+// the sum over the covered pixels.
+static void _heal_restrict(const dt_heal_level_t *const l, const dt_heal_level_t *const cl)
 {
-  dt_aligned_pixel_t err = { 0.f, 0.0f, 0.0f, 0.0f };
-
-  // on each iteration, we adjust each cell of the current color by a weighted fraction of the difference between
-  // it and the sum of the adjacenct cells of the opposite color.  Because we've split the cells by color, this
-  // leads to a somewhat different computation of neighbors.
-  // Rearranged, as provided to this function:
-  //   r00 r01 r02 ...           b00 b01 b02 ...
-  //   r10 r11 r12               b10 b11 b12
-  //   r20 r21 r22               b20 b21 b22
-  //   ...                       ...
-  // Original layout, from which we need to get the neighbors:
-  //     r00 b00 r01 b01 r02 b02 ...
-  //     b10 r10 b11 r11 b12 r12
-  //     r20 b20 r21 b21 r22 b22
-  //     b30 r30 b31 r31 b32 r32
-  //     ...
-  // As can be seen, the 'above' and 'below' neighbors of r(i)(j) are always b(i-1)(j) and b(i+1)(j).  The
-  // left and right neighbors depend on which color the row starts with: if red, they are b(i)(j-1) and b(i)(j);
-  // if black, they are b(i)(j) and b(i)(j+1).  All of the above holds when colors are swapped.
-#if !(defined(__apple_build_version__) && __apple_build_version__ < 11030000) //makes Xcode 11.3.1 compiler crash
-    DT_OMP_FOR(reduction(+ : err[0:4]))
-#endif
-    for(size_t i = 0; i < num_runs; i++)
+  const size_t width = l->width;
+  const size_t height = l->height;
+  const float *const restrict u = l->u;
+  const float *const restrict f = l->f;
+  const uint8_t *const restrict mask = l->mask;
+
+  DT_OMP_FOR()
+  for(size_t crow = 0; crow < cl->height; crow++)
+  {
+    // the coarse level span is within the fine one
+    const int *const span0 = l->span + 4 * crow;
+    const int *const span1 = 2 * crow + 1 < height ? span0 + 2 : span0;
+    const size_t first = MIN(span0[0], span1[0]) / 2;
+    const size_t last = (MAX(span0[1], span1[1]) + 1) / 2;
+    for(size_t ccol = 0; ccol < cl->width; ccol++)
     {
-      const size_t idx = runs[2*i];
-      const unsigned count = runs[2*i+1];
-      const size_t index = (size_t)4 * idx;
-      const size_t row = idx / width;
-      float a = 4.0f; // four neighboring pixels except at the edges
-      if(row == 1) a -= 1.0f;  // we added a padding row at top and bottom
-      if(row == height) a -= 1.0f;
-      const size_t vert_offset = 4 * width;
-      const size_t lroffset = 4 * (start_parity ^ (row & 1)); // how many floats to offset the left/right neighbors
-      if(count == 1)
+      const size_t ck = crow * cl->width + ccol;
+      if(ccol < first || ccol >= last)
       {
-        const size_t col = idx % width;
-        float aa = a;
-        dt_aligned_pixel_t left = { 0.0f };
-        dt_aligned_pixel_t right = { 0.0f };
-        if(col > 0 || lroffset) // first pixel in original stamp?
-          for_each_channel(c) left[c] = neighbor_pixels[index - 4 + lroffset + c];
-        else
-          aa -= 1.0f;
-        if(col + 1 < width || lroffset == 0) // last pixel in original stamp?
-          for_each_channel(c) right[c] = neighbor_pixels[index + lroffset + c];
-        else
-          aa -= 1.0f;
-
-        dt_aligned_pixel_t diff;
-        for_each_channel(c, aligned(active_pixels, neighbor_pixels))
-        {
-          diff[c] = w * ((aa * active_pixels[index+c])
-                             - (neighbor_pixels[index - vert_offset + c] + neighbor_pixels[index + vert_offset + c]
-                                + left[c] + right[c]));
-          active_pixels[index + c] -= diff[c];
-          err[c] += (diff[c] * diff[c]);
-        }
+        for_each_channel(c) cl->f[4 * ck + c] = cl->u[4 * ck + c] = 0.0f;
         continue;
       }
-      dt_aligned_pixel_t left;
-      copy_pixel(left, neighbor_pixels + index - 4 + lroffset);
-      for(size_t j = 0; j < count; j++)
-      {
-        const size_t pixidx = index + 4*j;
-        dt_aligned_pixel_t diff;
-        dt_aligned_pixel_t right;
-        for_each_channel(c, aligned(active_pixels,neighbor_pixels))
+      dt_aligned_pixel_t res = { 0.0f, 0.0f, 0.0f, 0.0f };
+      for(size_t row = 2 * crow; row < MIN(2 * crow + 2, height); row++)
+        for(size_t col = 2 * ccol; col < MIN(2 * ccol + 2, width); col++)
         {
-          right[c] = neighbor_pixels[pixidx + lroffset + c];
-          diff[c] = w * (a * active_pixels[pixidx+c]
-                         - (neighbor_pixels[pixidx - vert_offset + c] + neighbor_pixels[pixidx + vert_offset + c]
-                            + left[c] + right[c]));
-          active_pixels[pixidx + c] -= diff[c];
-          err[c] += (diff[c] * diff[c]);
-          left[c] = right[c];
+          const size_t k = row * width + col;
+          if(!mask[k]) continue;
+          const float a = _heal_neighbours(row, col, width, height);
+          dt_aligned_pixel_t sum;
+          _heal_neighbour_sum(u, row, col, width, height, sum);
+          for_each_channel(c)
+            res[c] += f[4 * k + c] + sum[c] - a * u[4 * k + c];
         }
+      for_each_channel(c)
+      {
+        cl->f[4 * ck + c] = cl->mask[ck] ? res[c] : 0.0f;
+        cl->u[4 * ck + c] = 0.0f;
       }
     }
-  return err[0] + err[1] + err[2];
+  }
 }
 
-// convert alternating pixels of one row of the opacity mask into a set of runs of opaque pixels of the
-// form (start_index, count), and return the updated number of runs
-static size_t _collect_color_runs(const float *const restrict mask, const size_t start_index,
-                                  size_t start, const size_t width,
-                                  unsigned *const restrict runs, size_t count, size_t *nmask)
+// Add the bilinearly interpolated coarse correction to the masked fine pixels
+static void _heal_prolong(const dt_heal_level_t *const cl, const dt_heal_level_t *const l)
 {
-  size_t masked = 0;
-  // handle the first and last pixels of the row specially so that we don't need checks on every pixel in the
-  // adaptation loop (which will be run hundreds of times for any stamp large enough that execution time is
-  // non-negligible)
-  if(start == 0 && mask[start])
-  {
-    runs[2*count] = start_index;
-    runs[2*count+1] = 1;
-    count++;
-    masked++;
-    start += 2; // we've processed the first pixel
-  }
-  gboolean in_run = FALSE;
-  unsigned run_start = 0;
-  size_t col;
-  for(col = start; col < width; col += 2)
-  {
-    if(mask[col])
-    {
-      masked++;
-      if(!in_run)
-      {
-        run_start = col;
-        in_run = TRUE;
-      }
-    }
-    else if(in_run)
-    {
-      runs[2*count] = start_index + run_start / 2;
-      runs[2*count + 1] = (col - run_start) / 2;
-      count++;
-      in_run = FALSE;
-    }
-  }
-  if(in_run)  // finish off a run that doesn't have a zero pixel to its right
+  const size_t cwidth = cl->width;
+  const size_t cheight = cl->height;
+  const float *const restrict cu = cl->u;
+  float *const restrict u = l->u;
+
+  DT_OMP_FOR()
+  for(size_t row = 0; row < l->height; row++)
   {
-    runs[2*count] = start_index + run_start / 2;
-    const unsigned runlen = (col - run_start) / 2;
-    runs[2*count + 1] = runlen;
-    if(runlen > 1 && col > width)
+    // center of the fine pixel in coarse pixel coordinates
+    const float fy = CLAMP(0.5f * row - 0.25f, 0.0f, cheight - 1.0f);
+    const size_t y0 = (size_t)fy;
+    const size_t y1 = MIN(y0 + 1, cheight - 1);
+    const float wy = fy - y0;
+    for(size_t col = l->span[2 * row]; col < l->span[2 * row + 1]; col++)
     {
-      // split off the final pixel into its own run
-      runs[2*count + 1]--;
-      runs[2*count + 2] = runs[2*count] + runs[2*count+1];
-      runs[2*count + 3] = 1;
-      count++;
+      const size_t k = row * l->width + col;
+      if(!l->mask[k]) continue;
+      const float fx = CLAMP(0.5f * col - 0.25f, 0.0f, cwidth - 1.0f);
+      const size_t x0 = (size_t)fx;
+      const size_t x1 = MIN(x0 + 1, cwidth - 1);
+      const float wx = fx - x0;
+      const float *const p00 = cu + 4 * (y0 * cwidth + x0);
+      const float *const p01 = cu + 4 * (y0 * cwidth + x1);
+      const float *const p10 = cu + 4 * (y1 * cwidth + x0);
+      const float *const p11 = cu + 4 * (y1 * cwidth + x1);
+      for_each_channel(c)
+        u[4 * k + c] += (1.0f - wy) * ((1.0f - wx) * p00[c] + wx * p01[c])
+                        + wy * ((1.0f - wx) * p10[c] + wx * p11[c]);
     }
-    count++;
   }
-  *nmask += masked;
-  return count;
 }
 
-// convert one row of the opacity mask into a set of runs of opaque pixels of the form (start_index, count)
-static void collect_runs(const int start, const float *const restrict mask, const size_t width, const size_t height,
-                         const size_t subwidth, unsigned *const restrict runs, size_t *count, size_t *nmask)
+static void _heal_vcycle(const dt_heal_level_t *const levels, const int level, const int num_levels)
 {
-  for(size_t row = 0; row < height; row++)
+  const dt_heal_level_t *const l = levels + level;
+  if(level == num_levels - 1)
   {
-    const int parity = start ^ (row & 1);
-    const size_t index = (row + 1) * subwidth;
-    const size_t mask_index = row * width;
-    *count = _collect_color_runs(mask + mask_index, index, parity, width, runs, *count, nmask);
+    // coarsest level, a few dozen sweeps with the optimal over-relaxation of a square this size
+    const size_t size = MAX(l->width, l->height);
+    const float w = 2.0f / (1.0f + sinf(M_PI_F / size));
+    for(size_t k = 0; k < size; k++)
+      _heal_smooth(l, w);
+    return;
   }
+
+  for(int k = 0; k < DT_HEAL_SMOOTH; k++) _heal_smooth(l, 1.0f);
+  _heal_restrict(l, l + 1);
+  _heal_vcycle(levels, level + 1, num_levels);
+  _heal_prolong(l + 1, l);
+  for(int k = 0; k < DT_HEAL_SMOOTH; k++) _heal_smooth(l, 1.0f);
 }
 
-// Solve the laplace equation for pixels and store the result in-place.
-static void _heal_laplace_loop(float *const restrict red_pixels, float *const restrict black_pixels,
-                               const size_t width, const size_t height,
-                               const float *const restrict mask, const int max_iter)
+// Set the first and past the last masked column of each row
+static void _heal_spans(const dt_heal_level_t *const l)
 {
-  // we start by converting the opacity mask into runs of nonzero positions, handling the 'red' and 'black'
-  // checkerboarded pixels separately
-  // the worst case is when consecutive red pixels alternate between being in the mask and out (same for black),
-  // in which case we will need exactly as many values in the run-length encoding as pixels; any other
-  // arrangement will yield fewer runs.  For any mask a user would have the patience to draw, there will only be
-  // a handful of runs in each row of pixels.
-  // Note that using `unsigned` instead of size_t, the stamp is limited to ~8 gigapixels (the main image can be larger)
-  const size_t subwidth = (width+1)/2;  // round up to be able to handle odd widths
-  unsigned *const restrict red_runs = dt_alloc_align_type(unsigned, subwidth * (height + 2));
-  unsigned *const restrict black_runs = dt_alloc_align_type(unsigned, subwidth * (height + 2));
-  if(!red_runs || !black_runs)
+  DT_OMP_FOR()
+  for(size_t row = 0; row < l->height; row++)
   {
-    dt_print(DT_DEBUG_ALWAYS, "_heal_laplace_loop: error allocating memory for healing");
-    goto cleanup;
+    const uint8_t *const mask = l->mask + row * l->width;
+    int first = 0;
+    int last = l->width;
+    while(first < last && !mask[first]) first++;
+    while(last > first && !mask[last - 1]) last--;
+    l->span[2 * row] = first;
+    l->span[2 * row + 1] = last;
   }
+}
 
-  size_t num_red = 0;
-  size_t num_black = 0;
-  size_t nmask_red = 0;
-  size_t nmask_black = 0;
-
-  DT_OMP_PRAGMA(parallel sections)
+// Solve for the masked pixels of the image in-place, return the number of V-cycles
+static int _heal_solve(float *const img, uint8_t *const mask, const size_t width, const size_t height,
+                       const size_t nmask, const int max_iter)
+{
+  dt_heal_level_t levels[32] = { { 0 } };
+  int num_levels = 1;
+  int cycles = 0;
+
+  levels[0] = (dt_heal_level_t){ width, height, img, dt_calloc_align_float((size_t)4 * width * height),
+                                 mask, dt_alloc_align_type(int, 2 * height) };
+  if(!levels[0].f || !levels[0].span) goto cleanup;
+  _heal_spans(levels);
+
+  while(num_levels < 32
+        && levels[num_levels - 1].width >= 2 * DT_HEAL_MIN_LEVEL
+        && levels[num_levels - 1].height >= 2 * DT_HEAL_MIN_LEVEL)
   {
-    collect_runs(1, mask, width, height, subwidth, red_runs, &num_red, &nmask_red);
-    DT_OMP_PRAGMA(section)
-    collect_runs(0, mask, width, height, subwidth, black_runs, &num_black, &nmask_black);
+    const dt_heal_level_t *const l = levels + num_levels - 1;
+    dt_heal_level_t *const cl = levels + num_levels;
+    cl->width = (l->width + 1) / 2;
+    cl->height = (l->height + 1) / 2;
+    cl->u = dt_alloc_align_float((size_t)4 * cl->width * cl->height);
+    cl->f = dt_alloc_align_float((size_t)4 * cl->width * cl->height);
+    cl->mask = dt_alloc_align_type(uint8_t, cl->width * cl->height);
+    cl->span = dt_alloc_align_type(int, 2 * cl->height);
+    num_levels++;
+    if(!cl->u || !cl->f || !cl->mask || !cl->span) goto cleanup;
+
+    DT_OMP_FOR()
+    for(size_t crow = 0; crow < cl->height; crow++)
+      for(size_t ccol = 0; ccol < cl->width; ccol++)
+      {
+        int masked = 0;
+        int covered = 0;
+        for(size_t row = 2 * crow; row < MIN(2 * crow + 2, l->height); row++)
+          for(size_t col = 2 * ccol; col < MIN(2 * ccol + 2, l->width); col++)
+          {
+            masked += l->mask[row * l->width + col];
+            covered++;
+          }
+        cl->mask[crow * cl->width + ccol] = 4 * masked >= 3 * covered;
+      }
+    _heal_spans(cl);
   }
-  const size_t nmask = nmask_red + nmask_black;
 
-  /* Empirically optimal over-relaxation factor. (Benchmarked on
-   * round brushes, at least. I don't know whether aspect ratio
-   * affects it.)
-   */
-  const float w = ((2.0f - 1.0f / (0.1575f * sqrtf(nmask) + 0.8f)) * .25f);
+  // the masked pixels start at zero
+  const float epsilon = 3e-7f;
+  const float err_exit = epsilon * epsilon * 3 * nmask;
 
-  const float epsilon = (0.1 / 255);
-  const float err_exit = epsilon * epsilon * w * w;
-
-  /* Gauss-Seidel with successive over-relaxation */
-  for(int iter = 0; iter < max_iter; iter++)
+  while(cycles < max_iter)
   {
-    // process red/black cells separately
-    float err = _heal_laplace_iteration(black_pixels, red_pixels, height, subwidth, black_runs, num_black, 1, w);
-    err += _heal_laplace_iteration(red_pixels, black_pixels, height, subwidth, red_runs, num_red, 0, w);
+    _heal_vcycle(levels, 0, num_levels);
+    cycles++;
 
-    if(err < err_exit) break;
+    if(_heal_residual(levels) < err_exit) break;
   }
 
 cleanup:
-  if(red_runs) dt_free_align(red_runs);
-  if(black_runs) dt_free_align(black_runs);
+  dt_free_align(levels[0].f);
+  dt_free_align(levels[0].span);
+  for(int k = 1; k < num_levels; k++)
+  {
+    dt_free_align(levels[k].u);
+    dt_free_align(levels[k].f);
+    dt_free_align(levels[k].mask);
+    dt_free_align(levels[k].span);
+  }
+  return cycles;
 }
 
 
@@ -359,26 +347,77 @@ void dt_heal(const float *const src_buffer, float *dest_buffer, const float *con
     dt_print(DT_DEBUG_ALWAYS, "dt_heal: full-color image required");
     return;
   }
-  const size_t subwidth = 4 * ((width+1)/2);  // round up to be able to handle odd widths
-  float *const restrict red_buffer = dt_alloc_align_float(subwidth * (height + 2));
-  float *const restrict black_buffer = dt_alloc_align_float(subwidth * (height + 2));
-  if(red_buffer == NULL || black_buffer == NULL)
+
+  dt_times_t start;
+  dt_get_perf_times(&start);
+
+  /* only the bounding box of the mask plus a border of fixed pixels is solved, this border gives the
+   * same boundary conditions as the full buffer */
+  int x0 = width, x1 = -1, y0 = height, y1 = -1;
+  DT_OMP_FOR(reduction(min : x0, y0) reduction(max : x1, y1))
+  for(int row = 0; row < height; row++)
+    for(int col = 0; col < width; col++)
+      if(mask_buffer[(size_t)row * width + col])
+      {
+        x0 = MIN(x0, col);
+        x1 = MAX(x1, col);
+        y0 = MIN(y0, row);
+        y1 = MAX(y1, row);
+      }
+  if(x1 < 0) return;
+
+  x0 = MAX(x0 - 1, 0);
+  y0 = MAX(y0 - 1, 0);
+  x1 = MIN(x1 + 1, width - 1);
+  y1 = MIN(y1 + 1, height - 1);
+  const size_t bwidth = x1 - x0 + 1;
+  const size_t bheight = y1 - y0 + 1;
+
+  float *const restrict diff = dt_alloc_align_float((size_t)4 * bwidth * bheight);
+  uint8_t *const restrict mask = dt_alloc_align_type(uint8_t, bwidth * bheight);
+  if(diff == NULL || mask == NULL)
   {
     dt_print(DT_DEBUG_ALWAYS, "dt_heal: error allocating memory for healing");
     goto cleanup;
   }
 
-  /* subtract pattern from image and store the result split by 'red' and 'black' positions  */
-  _heal_sub(dest_buffer, src_buffer, red_buffer, black_buffer, width, height);
+  /* subtract pattern from image */
+  size_t nmask = 0;
+  DT_OMP_FOR(reduction(+ : nmask))
+  for(size_t row = 0; row < bheight; row++)
+  {
+    const size_t k0 = (row + y0) * width + x0;
+    for(size_t col = 0; col < bwidth; col++)
+    {
+      const size_t k = row * bwidth + col;
+      mask[k] = mask_buffer[k0 + col] != 0.0f;
+      nmask += mask[k];
+      for_each_channel(c)
+        diff[4 * k + c] = mask[k] ? 0.0f : dest_buffer[4 * (k0 + col) + c] - src_buffer[4 * (k0 + col) + c];
+    }
+  }
 
-  _heal_laplace_loop(red_buffer, black_buffer, width, height, mask_buffer, max_iter);
+  const int cycles = _heal_solve(diff, mask, bwidth, bheight, nmask, max_iter);
 
   /* add solution to original image and store in dest */
-  _heal_add(red_buffer, black_buffer, src_buffer, dest_buffer, width, height);
+  DT_OMP_FOR()
+  for(size_t row = 0; row < bheight; row++)
+  {
+    const size_t k0 = (row + y0) * width + x0;
+    for(size_t col = 0; col < bwidth; col++)
+    {
+      const size_t k = row * bwidth + col;
+      if(!mask[k]) continue;
+      for_each_channel(c)
+        dest_buffer[4 * (k0 + col) + c] = diff[4 * k + c] + src_buffer[4 * (k0 + col) + c];
+    }
+  }
+
+  dt_show_times_f(&start, "[dt_heal]", "%zux%zu of %dx%d, %d cycles", bwidth, bheight, width, height, cycles);
 
 cleanup:
-  if(red_buffer) dt_free_align(red_buffer);
-  if(black_buffer) dt_free_align(black_buffer);
+  dt_free_align(diff);
+  dt_free_align(mask);
 }
 
 #ifdef HAVE_OPENCL
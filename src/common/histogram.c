@@ -36,11 +36,13 @@ static inline void _clamp_bin(const dt_aligned_pixel_t vals,
                               uint32_t *const restrict histogram,
                               const float max_bin)
 {
-  DT_ALIGNED_PIXEL size_t bin[4];
+  // 32-bit indices, the four float -> int conversions then go in a
+  // single vector instruction
+  DT_ALIGNED_PIXEL int32_t bin[4];
   for_each_channel(k,aligned(vals,bin:16))
   {
     // must be signed before clamping as value may be negative
-    bin[k] = CLAMP(vals[k], 0.0f, max_bin);
+    bin[k] = CLAMPF(vals[k], 0.0f, max_bin);
   }
 
   histogram[bin[0]*4]++;
@@ -160,12 +162,12 @@ static inline void _bin_Lab_LCh(const dt_dev_histogram_collection_params_t *cons
 
 //==============================================================================
 
-void _hist_worker(dt_dev_histogram_collection_params_t *const histogram_params,
-                  dt_dev_histogram_stats_t *histogram_stats,
-                  const void *const pixel,
-                  uint32_t **histogram,
-                  const _histogram_worker Worker,
-                  const dt_iop_order_iccprofile_info_t *const profile_info)
+static void _hist_worker(dt_dev_histogram_collection_params_t *const histogram_params,
+                         dt_dev_histogram_stats_t *histogram_stats,
+                         const void *const pixel,
+                         uint32_t **histogram,
+                         const _histogram_worker Worker,
+                         const dt_iop_order_iccprofile_info_t *const profile_info)
 {
   const size_t bins_total = (size_t)(histogram_stats->ch == 1 ? 1 : 4)
     * histogram_params->bins_count;
@@ -180,18 +182,54 @@ void _hist_worker(dt_dev_histogram_collection_params_t *const histogram_params,
     if(!*histogram) return;
     histogram_stats->buf_size = buf_size;
   }
-  // hack to make reduction clause work
   uint32_t DT_ALIGNED_PIXEL *working_hist = *histogram;
-  memset(working_hist, 0, buf_size);
 
   const dt_histogram_roi_t *const roi = histogram_params->roi;
 
-  DT_OMP_FOR(reduction(+:working_hist[:bins_total]))
-  for(int j = roi->crop_y; j < roi->height - roi->crop_bottom; j++)
+  // every thread bins into its own histogram, they are summed up
+  // afterwards: no contention on the bins and the merge, which
+  // matters for the 65536 raw bins, runs in parallel too
+  size_t padded_bins;
+  uint32_t *const restrict partial_hist =
+    dt_alloc_perthread(bins_total, sizeof(uint32_t), &padded_bins);
+  if(!partial_hist)
+  {
+    memset(working_hist, 0, buf_size);
+    return;
+  }
+  const size_t nthreads = dt_get_num_threads();
+
+  DT_OMP_PRAGMA(parallel default(firstprivate))
   {
-    Worker(histogram_params, pixel, working_hist, j, profile_info);
+    // clear all the slots, also those of threads not in this team
+    DT_OMP_PRAGMA(for schedule(static))
+    for(size_t n = 0; n < nthreads; n++)
+      memset(dt_get_bythread(partial_hist, padded_bins, n), 0, buf_size);
+
+    uint32_t *const restrict thread_hist = dt_get_perthread(partial_hist, padded_bins);
+
+    DT_OMP_PRAGMA(for schedule(static))
+    for(int j = roi->crop_y; j < roi->height - roi->crop_bottom; j++)
+    {
+      Worker(histogram_params, pixel, thread_hist, j, profile_info);
+    }
+
+    DT_OMP_PRAGMA(for simd schedule(simd:static) aligned(working_hist:16))
+    for(size_t k = 0; k < bins_total; k++)
+    {
+      uint32_t sum = 0;
+      for(size_t n = 0; n < nthreads; n++)
+      {
+        const uint32_t *const restrict thread_hist =
+          dt_get_bythread(partial_hist, padded_bins, n);
+        sum += thread_hist[k];
+      }
+      working_hist[k] = sum;
+    }
   }
 
+  dt_free_align(partial_hist);
+
   histogram_stats->bins_count = histogram_params->bins_count;
   histogram_stats->pixels = (roi->width - roi->crop_right - roi->crop_x)
                             * (roi->height - roi->crop_bottom - roi->crop_y);
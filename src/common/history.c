@@ -1439,7 +1439,7 @@ gboolean dt_history_compress(const dt_imgid_t imgid)
     // update history end
     dt_image_set_history_end(imgid, done);
 
-    dt_image_write_sidecar_file(imgid);
+    dt_image_synch_xmp(imgid);
   }
   dt_unlock_image(imgid);
   dt_history_hash_write_from_history(imgid, DT_HISTORY_HASH_CURRENT);
@@ -2843,7 +2843,7 @@ static gboolean _any_altered_data(const dt_imgid_t imgid)
     || (dt_tag_count_attached(imgid, TRUE) > 0);
 }
 
-gboolean dt_image_write_sidecar_file(const dt_imgid_t imgid)
+gboolean dt_image_write_sidecar_file_only(const dt_imgid_t imgid)
 {
   if(!dt_is_valid_imgid(imgid))
     return TRUE;
@@ -2887,21 +2887,32 @@ gboolean dt_image_write_sidecar_file(const dt_imgid_t imgid)
     g_object_unref(xmp);
   }
 
+  return error;
+}
+
+void dt_image_set_write_timestamp(const dt_imgid_t imgid)
+{
+  sqlite3_stmt *stmt;
+  DT_DEBUG_SQLITE3_PREPARE_V2
+    (dt_database_get(darktable.db),
+     "UPDATE main.images SET write_timestamp = STRFTIME('%s', 'now') WHERE id = ?1",
+     -1, &stmt, NULL);
+  DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, imgid);
+  sqlite3_step(stmt);
+  sqlite3_finalize(stmt);
+}
+
+gboolean dt_image_write_sidecar_file(const dt_imgid_t imgid)
+{
+  const gboolean error = dt_image_write_sidecar_file_only(imgid);
+
   /* The timestamp must be put into db
      - in case of no reported error while writing the sidecar
      - or if no sidecar writing was required
   */
-  if(!error)
-  {
-    sqlite3_stmt *stmt;
-    DT_DEBUG_SQLITE3_PREPARE_V2
-      (dt_database_get(darktable.db),
-       "UPDATE main.images SET write_timestamp = STRFTIME('%s', 'now') WHERE id = ?1",
-       -1, &stmt, NULL);
-    DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, imgid);
-    sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
-  }
+  if(!error && dt_is_valid_imgid(imgid))
+    dt_image_set_write_timestamp(imgid);
+
   return error;
 }
 
@@ -591,6 +591,10 @@ gboolean dt_image_safe_remove(const dt_imgid_t imgid);
 void dt_image_local_copy_synch(void);
 // xmp functions:
 gboolean dt_image_write_sidecar_file(const dt_imgid_t imgid);
+/* write the sidecar without recording it in the database, returns TRUE on error */
+gboolean dt_image_write_sidecar_file_only(const dt_imgid_t imgid);
+/* record that the sidecar of imgid is up to date */
+void dt_image_set_write_timestamp(const dt_imgid_t imgid);
 void dt_image_synch_xmp(const int32_t selected);
 void dt_image_synch_xmps(const GList *img);
 void dt_image_synch_all_xmp(const gchar *pathname);
@@ -37,10 +37,9 @@ static void _image_cache_allocate(void *data,
   dt_image_init(img);
   entry->data = img;
   // load stuff from db and store in cache:
-  sqlite3_stmt *stmt;
   // clang-format off
-  DT_DEBUG_SQLITE3_PREPARE_V2(
-      dt_database_get(darktable.db),
+  sqlite3_stmt *stmt = dt_database_prepare_cached(
+      darktable.db,
       "SELECT mi.id, group_id, film_id, width, height, filename,"
       "       mk.name, md.name, ln.name,"
       "       exposure, aperture, iso, focal_length, datetime_taken, flags,"
@@ -59,8 +58,7 @@ static void _image_cache_allocate(void *data,
       "       LEFT JOIN main.flash AS fl ON fl.id = mi.flash_id"
       "       LEFT JOIN main.exposure_program AS ep ON ep.id = mi.exposure_program_id"
       "       LEFT JOIN main.metering_mode AS mm ON mm.id = mi.metering_mode_id"
-      "  WHERE mi.id = ?1",
-      -1, &stmt, NULL);
+      "  WHERE mi.id = ?1");
   // clang-format on
   DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, entry->key);
 
@@ -193,7 +191,7 @@ static void _image_cache_allocate(void *data,
              "[image_cache_allocate] failed to open image %" PRIu32 " from database: %s",
              entry->key, sqlite3_errmsg(dt_database_get(darktable.db)));
   }
-  sqlite3_finalize(stmt);
+  dt_database_release_cached(darktable.db, stmt);
   img->cache_entry = entry; // init backref
   // could downgrade lock write->read on entry->lock if we were using
   // concurrencykit..
@@ -321,10 +319,9 @@ void dt_image_cache_write_release_info(dt_image_cache_t *cache,
       img->aspect_ratio = (float )img->height / (float )(MAX(1, img->width));
   }
 
-  sqlite3_stmt *stmt;
   // clang-format off
-  DT_DEBUG_SQLITE3_PREPARE_V2
-    (dt_database_get(darktable.db),
+  sqlite3_stmt *stmt = dt_database_prepare_cached
+    (darktable.db,
      "UPDATE main.images"
      " SET width = ?1, height = ?2, filename = ?3,"
      "     maker_id = ?4, model_id = ?5, lens_id = ?6, camera_id = ?35,"
@@ -338,8 +335,7 @@ void dt_image_cache_write_release_info(dt_image_cache_t *cache,
      "     print_timestamp = ?31, output_width = ?32, output_height = ?33,"
      "     whitebalance_id = ?36, flash_id = ?37,"
      "     exposure_program_id = ?38, metering_mode_id = ?39"
-     " WHERE id = ?40",
-     -1, &stmt, NULL);
+     " WHERE id = ?40");
 
   const int32_t maker_id = dt_image_get_camera_maker_id(img->exif_maker);
   const int32_t model_id = dt_image_get_camera_model_id(img->exif_model);
@@ -412,7 +408,7 @@ void dt_image_cache_write_release_info(dt_image_cache_t *cache,
              rc,
              sqlite3_errmsg(dt_database_get(darktable.db)),
              img->id);
-  sqlite3_finalize(stmt);
+  dt_database_release_cached(darktable.db, stmt);
 
   if(mode == DT_IMAGE_CACHE_SAFE)
   {
@@ -1007,20 +1007,178 @@ static gboolean _prepare_resampling_plan(const struct dt_interpolation *itor,
   return FALSE;
 }
 
+/* --------------------------------------------------------------------------
+ * Resampling plan cache
+ * ------------------------------------------------------------------------*/
+
+// finalscale, demosaic and the thumbnail exports ask for the same few
+// plans over and over, keep the most recently used ones around
+#define DT_RESAMPLING_PLANS 16
+
+typedef struct dt_resampling_plan_t
+{
+  // key
+  enum dt_interpolation_type id;
+  int in;
+  int in_x0;
+  int out;
+  int out_x0;
+  float scale;
+
+  int refs;
+  int *length;
+  float *kernel;
+  int *index;
+  int *meta;
+  // range of input samples referenced by index
+  int index_min;
+  int index_max;
+} dt_resampling_plan_t;
+
+static dt_pthread_mutex_t _plans_lock;
+// most recently used first
+static GList *_plans = NULL;
+
+static void _free_resampling_plan(dt_resampling_plan_t *plan)
+{
+  // length is the start of the plan's single allocation
+  dt_free_align(plan->length);
+  free(plan);
+}
+
+static gboolean _plan_matches(const dt_resampling_plan_t *plan,
+                              const struct dt_interpolation *itor,
+                              const int in,
+                              const int in_x0,
+                              const int out,
+                              const int out_x0,
+                              const float scale)
+{
+  return plan->id == itor->id
+    && plan->in == in && plan->in_x0 == in_x0
+    && plan->out == out && plan->out_x0 == out_x0
+    && plan->scale == scale;
+}
+
+/** Returns a referenced resampling plan from the cache, building it if
+ * needed. NULL on allocation failure. */
+static dt_resampling_plan_t *_get_resampling_plan(const struct dt_interpolation *itor,
+                                                  const int in,
+                                                  const int in_x0,
+                                                  const int out,
+                                                  const int out_x0,
+                                                  const float scale)
+{
+  dt_pthread_mutex_lock(&_plans_lock);
+  for(GList *l = _plans; l; l = g_list_next(l))
+  {
+    dt_resampling_plan_t *plan = l->data;
+    if(_plan_matches(plan, itor, in, in_x0, out, out_x0, scale))
+    {
+      plan->refs++;
+      _plans = g_list_remove_link(_plans, l);
+      _plans = g_list_concat(l, _plans);
+      dt_pthread_mutex_unlock(&_plans_lock);
+      return plan;
+    }
+  }
+  dt_pthread_mutex_unlock(&_plans_lock);
+
+  // build outside of the lock, other pipes may be resampling meanwhile
+  dt_resampling_plan_t *plan = calloc(1, sizeof(dt_resampling_plan_t));
+  if(!plan) return NULL;
+
+  if(_prepare_resampling_plan(itor, in, in_x0, out, out_x0, scale,
+                              &plan->length, &plan->kernel, &plan->index, &plan->meta)
+     || !plan->length)
+  {
+    free(plan);
+    return NULL;
+  }
+
+  plan->id = itor->id;
+  plan->in = in;
+  plan->in_x0 = in_x0;
+  plan->out = out;
+  plan->out_x0 = out_x0;
+  plan->scale = scale;
+  plan->refs = 1;
+
+  const int nindex = out > 0 ? plan->meta[3 * (out - 1) + 2] + plan->length[out - 1] : 0;
+  plan->index_min = in - 1;
+  plan->index_max = 0;
+  for(int k = 0; k < nindex; k++)
+  {
+    plan->index_min = MIN(plan->index_min, plan->index[k]);
+    plan->index_max = MAX(plan->index_max, plan->index[k]);
+  }
+  if(plan->index_min > plan->index_max)
+    plan->index_min = plan->index_max = 0;
+
+  dt_pthread_mutex_lock(&_plans_lock);
+  // another thread might have been faster
+  for(GList *l = _plans; l; l = g_list_next(l))
+  {
+    dt_resampling_plan_t *other = l->data;
+    if(_plan_matches(other, itor, in, in_x0, out, out_x0, scale))
+    {
+      other->refs++;
+      dt_pthread_mutex_unlock(&_plans_lock);
+      _free_resampling_plan(plan);
+      return other;
+    }
+  }
+
+  _plans = g_list_prepend(_plans, plan);
+
+  // drop the least recently used plans not in use
+  GList *l = g_list_last(_plans);
+  guint count = g_list_length(_plans);
+  while(l && count > DT_RESAMPLING_PLANS)
+  {
+    GList *prev = g_list_previous(l);
+    dt_resampling_plan_t *old = l->data;
+    if(old->refs == 0)
+    {
+      _plans = g_list_delete_link(_plans, l);
+      _free_resampling_plan(old);
+      count--;
+    }
+    l = prev;
+  }
+  dt_pthread_mutex_unlock(&_plans_lock);
+
+  return plan;
+}
+
+static void _release_resampling_plan(dt_resampling_plan_t *plan)
+{
+  if(!plan) return;
+  dt_pthread_mutex_lock(&_plans_lock);
+  plan->refs--;
+  dt_pthread_mutex_unlock(&_plans_lock);
+}
+
+void dt_interpolation_init(void)
+{
+  dt_pthread_mutex_init(&_plans_lock, NULL);
+}
+
+void dt_interpolation_cleanup(void)
+{
+  dt_pthread_mutex_lock(&_plans_lock);
+  g_list_free_full(_plans, (GDestroyNotify)_free_resampling_plan);
+  _plans = NULL;
+  dt_pthread_mutex_unlock(&_plans_lock);
+  dt_pthread_mutex_destroy(&_plans_lock);
+}
+
 static void _interpolation_resample_plain(const struct dt_interpolation *itor,
                                           float *out,
                                           const dt_iop_roi_t *const roi_out,
                                           const float *const in,
                                           const dt_iop_roi_t *const roi_in)
 {
-  int *hindex = NULL;
-  int *hlength = NULL;
-  float *hkernel = NULL;
-  int *vindex = NULL;
-  int *vlength = NULL;
-  float *vkernel = NULL;
-  int *vmeta = NULL;
-
   const int32_t in_stride_floats = roi_in->width * 4;
   const int32_t out_stride_floats = roi_out->width * 4;
 
@@ -1050,99 +1208,90 @@ static void _interpolation_resample_plain(const struct dt_interpolation *itor,
 
   // Generic non 1:1 case... much more complicated :D
 
-  // Prepare resampling plans once and for all
-  if(_prepare_resampling_plan(itor, roi_in->width, roi_in->x,
-                              roi_out->width, roi_out->x, roi_out->scale,
-                              &hlength, &hkernel, &hindex, NULL))
-    goto exit;
-
-  if(_prepare_resampling_plan(itor, roi_in->height, roi_in->y,
-                              roi_out->height, roi_out->y, roi_out->scale,
-                              &vlength, &vkernel, &vindex, &vmeta))
-    goto exit;
+  // Get the resampling plans, usually from the cache
+  dt_resampling_plan_t *hplan = _get_resampling_plan(itor, roi_in->width, roi_in->x,
+                                                     roi_out->width, roi_out->x,
+                                                     roi_out->scale);
+  dt_resampling_plan_t *vplan = _get_resampling_plan(itor, roi_in->height, roi_in->y,
+                                                     roi_out->height, roi_out->y,
+                                                     roi_out->scale);
+  float *rows = NULL;
+  size_t padded_size = 0;
+  if(!hplan || !vplan) goto exit;
+
+  /* The filter is separable. For each output line the contributing input
+   * lines are first combined over the columns used by the horizontal plan,
+   * this runs over contiguous memory and is vectorised. The horizontal
+   * filter then works on that single line, which stays in cache. */
+  const int hfirst = hplan->index_min;
+  const size_t hcount = 4 * (size_t)(hplan->index_max - hfirst + 1);
+  rows = dt_alloc_perthread_float(hcount, &padded_size);
+  if(!rows) goto exit;
 
   dt_get_perf_times(&mid);
 
   const size_t height = roi_out->height;
   const size_t width = roi_out->width;
+  const int *const hlength = hplan->length;
+  const int *const hindex = hplan->index;
+  const float *const hkernel = hplan->kernel;
+  const int *const vlength = vplan->length;
+  const int *const vindex = vplan->index;
+  const float *const vkernel = vplan->kernel;
+  const int *const vmeta = vplan->meta;
 
   // Process each output line
   DT_OMP_FOR()
   for(size_t oy = 0; oy < height; oy++)
   {
-    // Initialize column resampling indexes
-    int vlidx = vmeta[3 * oy + 0]; // V(ertical) L(ength) I(n)d(e)x
-    int vkidx = vmeta[3 * oy + 1]; // V(ertical) K(ernel) I(n)d(e)x
-    int viidx = vmeta[3 * oy + 2]; // V(ertical) I(ndex) I(n)d(e)x
+    float *const restrict vrow = dt_get_perthread(rows, padded_size);
 
-    // Initialize row resampling indexes
-    int hlidx = 0; // H(orizontal) L(ength) I(n)d(e)x
-    int hkidx = 0; // H(orizontal) K(ernel) I(n)d(e)x
+    // Vertical pass
+    const int vl = vlength[vmeta[3 * oy + 0]]; // V(ertical) L(ength)
+    const int vkidx = vmeta[3 * oy + 1];        // V(ertical) K(ernel) I(n)d(e)x
+    const int viidx = vmeta[3 * oy + 2];        // V(ertical) I(ndex) I(n)d(e)x
 
-    // Number of lines contributing to the output line
-    int vl = vlength[vlidx++]; // V(ertical) L(ength)
+    memset(vrow, 0, sizeof(float) * hcount);
+    for(int iy = 0; iy < vl; iy++)
+    {
+      const float *const restrict line =
+        in + (size_t)vindex[viidx + iy] * in_stride_floats + (size_t)4 * hfirst;
+      const float vtap = vkernel[vkidx + iy];
+      DT_OMP_SIMD(aligned(vrow:64))
+      for(size_t k = 0; k < hcount; k++)
+        vrow[k] += line[k] * vtap;
+    }
 
-    // Process each output column
+    // Horizontal pass
+    int hkidx = 0; // H(orizontal) K(ernel) I(n)d(e)x
     for(size_t ox = 0; ox < width; ox++)
     {
-      // This will hold the resulting pixel
       dt_aligned_pixel_t vs = { 0.0f, 0.0f, 0.0f, 0.0f };
 
       // Number of horizontal samples contributing to the output
-      int hl = hlength[hlidx++]; // H(orizontal) L(ength)
-
-      for(size_t iy = 0; iy < vl; iy++)
+      const int hl = hlength[ox]; // H(orizontal) L(ength)
+      for(int ix = 0; ix < hl; ix++, hkidx++)
       {
-        // This is our input line
-        size_t baseidx_vindex = (size_t)vindex[viidx++] * in_stride_floats;
-
-        dt_aligned_pixel_t vhs = { 0.0f, 0.0f, 0.0f, 0.0f };
-
-        for(size_t ix = 0; ix < hl; ix++)
-        {
-          // Apply the precomputed filter kernel
-          const size_t baseidx = baseidx_vindex + (size_t)hindex[hkidx] * 4;
-          const float htap = hkernel[hkidx++];
-          dt_aligned_pixel_t tmp;
-          copy_pixel(tmp, in + baseidx);
-          for_each_channel(c, aligned(tmp,vhs:16))
-            vhs[c] += tmp[c] * htap;
-        }
-
-        // Accumulate contribution from this line
-        const float vtap = vkernel[vkidx++];
-        for_each_channel(c, aligned(vhs,vs:16)) vs[c] += vhs[c] * vtap;
-
-        // Reset horizontal resampling context
-        hkidx -= hl;
+        const float *const restrict px = vrow + (size_t)4 * (hindex[hkidx] - hfirst);
+        const float htap = hkernel[hkidx];
+        for_each_channel(c, aligned(vs:16))
+          vs[c] += px[c] * htap;
       }
 
-      // Output pixel is ready
-      const size_t baseidx = (size_t)oy * out_stride_floats + (size_t)ox * 4;
-
       // Clip negative RGB that may be produced by Lanczos undershooting
       // Negative RGB are invalid values no matter the RGB space (light is positive)
       dt_aligned_pixel_t pixel;
       for_each_channel(c, aligned(vs:16))
         pixel[c] = MAX(vs[c], 0.f);
-      copy_pixel_nontemporal(out + baseidx, pixel);
-
-      // Reset vertical resampling context
-      viidx -= vl;
-      vkidx -= vl;
-
-      // Progress in horizontal context
-      hkidx += hl;
+      copy_pixel_nontemporal(out + (size_t)oy * out_stride_floats + (size_t)ox * 4, pixel);
     }
   }
   dt_omploop_sfence();
 
 exit:
-  /* Free the resampling plans. It's nasty to optimize allocs like that, but
-   * it simplifies the code :-D. The length array is in fact the only memory
-   * allocated. */
-  dt_free_align(hlength);
-  dt_free_align(vlength);
+  dt_free_align(rows);
+  _release_resampling_plan(hplan);
+  _release_resampling_plan(vplan);
   _show_2_times(&start, &mid, "resample_plain");
 }
 
@@ -1427,14 +1576,6 @@ static void _interpolation_resample_1c_plain(const struct dt_interpolation *itor
                                              const float *const in,
                                              const dt_iop_roi_t *const roi_in)
 {
-  int *hindex = NULL;
-  int *hlength = NULL;
-  float *hkernel = NULL;
-  int *vindex = NULL;
-  int *vlength = NULL;
-  float *vkernel = NULL;
-  int *vmeta = NULL;
-
   dt_print_pipe(DT_DEBUG_PIPE | DT_DEBUG_VERBOSE,
       "resample_1c_plain", NULL, NULL, DT_DEVICE_CPU, roi_in, roi_out, "%s", itor->name);
   dt_times_t start = { 0 }, mid = { 0 };
@@ -1462,90 +1603,72 @@ static void _interpolation_resample_1c_plain(const struct dt_interpolation *itor
 
   // Generic non 1:1 case... much more complicated :D
 
-  // Prepare resampling plans once and for all
-  if(_prepare_resampling_plan(itor, roi_in->width, roi_in->x,
-                              roi_out->width, roi_out->x, roi_out->scale,
-                              &hlength, &hkernel, &hindex, NULL))
-    goto exit;
-
-  if(_prepare_resampling_plan(itor, roi_in->height, roi_in->y,
-                              roi_out->height, roi_out->y, roi_out->scale,
-                              &vlength, &vkernel, &vindex, &vmeta))
-    goto exit;
+  // Get the resampling plans, usually from the cache
+  dt_resampling_plan_t *hplan = _get_resampling_plan(itor, roi_in->width, roi_in->x,
+                                                     roi_out->width, roi_out->x,
+                                                     roi_out->scale);
+  dt_resampling_plan_t *vplan = _get_resampling_plan(itor, roi_in->height, roi_in->y,
+                                                     roi_out->height, roi_out->y,
+                                                     roi_out->scale);
+  float *rows = NULL;
+  size_t padded_size = 0;
+  if(!hplan || !vplan) goto exit;
+
+  // separable, same as the 4 channel version
+  const int hfirst = hplan->index_min;
+  const size_t hcount = hplan->index_max - hfirst + 1;
+  rows = dt_alloc_perthread_float(hcount, &padded_size);
+  if(!rows) goto exit;
 
   dt_get_perf_times(&mid);
 
+  const int *const hlength = hplan->length;
+  const int *const hindex = hplan->index;
+  const float *const hkernel = hplan->kernel;
+  const int *const vlength = vplan->length;
+  const int *const vindex = vplan->index;
+  const float *const vkernel = vplan->kernel;
+  const int *const vmeta = vplan->meta;
+
   // Process each output line
   DT_OMP_FOR()
   for(int oy = 0; oy < roi_out->height; oy++)
   {
-    // Initialize column resampling indexes
-    int vlidx = vmeta[3 * oy + 0]; // V(ertical) L(ength) I(n)d(e)x
-    int vkidx = vmeta[3 * oy + 1]; // V(ertical) K(ernel) I(n)d(e)x
-    int viidx = vmeta[3 * oy + 2]; // V(ertical) I(ndex) I(n)d(e)x
+    float *const restrict vrow = dt_get_perthread(rows, padded_size);
 
-    // Initialize row resampling indexes
-    int hlidx = 0; // H(orizontal) L(ength) I(n)d(e)x
-    int hkidx = 0; // H(orizontal) K(ernel) I(n)d(e)x
-    int hiidx = 0; // H(orizontal) I(ndex) I(n)d(e)x
+    // Vertical pass
+    const int vl = vlength[vmeta[3 * oy + 0]]; // V(ertical) L(ength)
+    const int vkidx = vmeta[3 * oy + 1];        // V(ertical) K(ernel) I(n)d(e)x
+    const int viidx = vmeta[3 * oy + 2];        // V(ertical) I(ndex) I(n)d(e)x
 
-    // Number of lines contributing to the output line
-    int vl = vlength[vlidx++]; // V(ertical) L(ength)
+    memset(vrow, 0, sizeof(float) * hcount);
+    for(int iy = 0; iy < vl; iy++)
+    {
+      const float *const restrict i =
+        (float *)((char *)in + in_stride * vindex[viidx + iy]) + hfirst;
+      const float vtap = vkernel[vkidx + iy];
+      DT_OMP_SIMD(aligned(vrow:64))
+      for(size_t k = 0; k < hcount; k++)
+        vrow[k] += i[k] * vtap;
+    }
 
-    // Process each output column
+    // Horizontal pass
+    float *const o = (float *)((char *)out + (size_t)oy * out_stride);
+    int hkidx = 0; // H(orizontal) K(ernel) I(n)d(e)x
     for(int ox = 0; ox < roi_out->width; ox++)
     {
-      // This will hold the resulting pixel
       float vs = 0.0f;
-
-      // Number of horizontal samples contributing to the output
-      const int hl = hlength[hlidx++]; // H(orizontal) L(ength)
-
-      for(int iy = 0; iy < vl; iy++)
-      {
-        // This is our input line
-        const float *i = (float *)((char *)in + in_stride * vindex[viidx++]);
-
-        float vhs = 0.0f;
-
-        for(int ix = 0; ix < hl; ix++)
-        {
-          // Apply the precomputed filter kernel
-          const size_t baseidx = (size_t)hindex[hiidx++];
-          const float htap = hkernel[hkidx++];
-          vhs += i[baseidx] * htap;
-        }
-
-        // Accumulate contribution from this line
-        const float vtap = vkernel[vkidx++];
-        vs += vhs * vtap;
-
-        // Reset horizontal resampling context
-        hkidx -= hl;
-        hiidx -= hl;
-      }
-
-      // Output pixel is ready
-      float *o = (float *)((char *)out + (size_t)oy * out_stride
-                           + (size_t)ox * sizeof(float));
-      *o = vs;
-
-      // Reset vertical resampling context
-      viidx -= vl;
-      vkidx -= vl;
-
-      // Progress in horizontal context
-      hiidx += hl;
-      hkidx += hl;
+      const int hl = hlength[ox]; // H(orizontal) L(ength)
+      for(int ix = 0; ix < hl; ix++, hkidx++)
+        vs += vrow[hindex[hkidx] - hfirst] * hkernel[hkidx];
+      o[ox] = vs;
     }
   }
 
-  exit:
-  /* Free the resampling plans. It's nasty to optimize allocs like that, but
-   * it simplifies the code :-D. The length array is in fact the only memory
-   * allocated. */
-  dt_free_align(hlength);
-  dt_free_align(vlength);
+exit:
+  dt_free_align(rows);
+  _release_resampling_plan(hplan);
+  _release_resampling_plan(vplan);
   _show_2_times(&start, &mid, "resample_1c_plain");
 }
 
@@ -101,6 +101,11 @@ void dt_interpolation_compute_pixel4c(const struct dt_interpolation *itor, const
                                       const float x, const float y, const int width, const int height,
                                       const int linestride);
 
+/** Set up and free the cache of resampling plans used by
+ * dt_interpolation_resample() and dt_interpolation_resample_1c() */
+void dt_interpolation_init(void);
+void dt_interpolation_cleanup(void);
+
 /** Get an interpolator from type
  * @param type Interpolator to search for
  * @return requested interpolator or default if not found (this function can't fail)
@@ -21,6 +21,7 @@
 #include "common/debug.h"
 #include "common/exif.h"
 #include "common/file_location.h"
+#include "common/focus_peaking.h"
 #include "common/grealpath.h"
 #include "common/image_cache.h"
 #include "control/conf.h"
@@ -338,6 +339,45 @@ static inline dt_mipmap_size_t _get_size(const uint32_t key)
   return (dt_mipmap_size_t)(key >> 28);
 }
 
+// number of views which can prefetch at the same time
+#define DT_MIPMAP_PREFETCH_CLIENTS 4
+// how many seconds of navigation at the current rate to prefetch ahead
+#define DT_MIPMAP_PREFETCH_TIME 0.5
+// a move later than this is not considered the same navigation
+#define DT_MIPMAP_PREFETCH_IDLE 1.0
+
+typedef struct dt_mipmap_prefetch_list_t
+{
+  const void *owner;
+  dt_mipmap_size_t mip;
+  int count, next;
+  dt_imgid_t imgs[DT_MIPMAP_PREFETCH_MAX];
+} dt_mipmap_prefetch_list_t;
+
+// the prefetcher outlives the cache: its jobs may still be running
+// when the cache is cleaned up.
+static struct
+{
+  dt_pthread_mutex_t lock;
+  dt_mipmap_prefetch_list_t lists[DT_MIPMAP_PREFETCH_CLIENTS];
+  int turn;           // list to serve next
+  gboolean job_queued;
+  GHashTable *loaded; // keys of the buffers prefetched and not requested yet
+
+  long int stats_queued;    // images handed to the prefetcher
+  long int stats_loaded;    // images loaded
+  long int stats_cached;    // images found in cache already
+  long int stats_cancelled; // images dropped before being loaded
+  long int stats_hits;      // prefetched images requested afterwards
+} _prefetch;
+
+// time to the first thumbnail generated after an import started, for -d perf
+static struct
+{
+  gint pending; // atomic
+  double start;
+} _first_thumbnail;
+
 static int _mipmap_cache_get_filename(gchar *mipmapfilename, size_t size)
 {
   int r = -1;
@@ -686,6 +726,11 @@ static uint32_t _nearest_power_of_two(const uint32_t value)
 void dt_mipmap_cache_init(dt_mipmap_cache_t *cache)
 {
   _mipmap_cache_get_filename(cache->cachedir, sizeof(cache->cachedir));
+  if(!_prefetch.loaded)
+  {
+    dt_pthread_mutex_init(&_prefetch.lock, NULL);
+    _prefetch.loaded = g_hash_table_new(g_direct_hash, g_direct_equal);
+  }
   // make sure static memory is initialized
   struct dt_mipmap_buffer_dsc *dsc = (struct dt_mipmap_buffer_dsc *)_mipmap_cache_static_dead_image;
   _dead_image_f((dt_mipmap_buffer_t *)(dsc + 1));
@@ -767,6 +812,13 @@ void dt_mipmap_cache_init(dt_mipmap_cache_t *cache)
 
 void dt_mipmap_cache_cleanup(dt_mipmap_cache_t *cache)
 {
+  // stop prefetching
+  dt_pthread_mutex_lock(&_prefetch.lock);
+  for(int k = 0; k < DT_MIPMAP_PREFETCH_CLIENTS; k++)
+    _prefetch.lists[k].count = _prefetch.lists[k].next = 0;
+  g_hash_table_remove_all(_prefetch.loaded);
+  dt_pthread_mutex_unlock(&_prefetch.lock);
+
   dt_cache_cleanup(&cache->mip_thumbs.cache);
   dt_cache_cleanup(&cache->mip_full.cache);
   dt_cache_cleanup(&cache->mip_f.cache);
@@ -810,12 +862,17 @@ void dt_mipmap_cache_print(dt_mipmap_cache_t *cache)
            100.0 * cache->mip_f.stats_standin / (float)sum_standins,
            100.0 * cache->mip_f.stats_fetches / (float)sum_fetches,
            100.0 * cache->mip_f.stats_requests / (float)sum);
-  dt_print(DT_DEBUG_ALWAYS,"[mipmap_cache] full  | %6.2f%% | %6.2f%% | %6.2f%%  | %6.2f%% | %6.2f%%\n\n",
+  dt_print(DT_DEBUG_ALWAYS,"[mipmap_cache] full  | %6.2f%% | %6.2f%% | %6.2f%%  | %6.2f%% | %6.2f%%",
            100.0 * cache->mip_full.stats_near_match / (float)cache->mip_full.stats_requests,
            100.0 * cache->mip_full.stats_misses / (float)cache->mip_full.stats_requests,
            100.0 * cache->mip_full.stats_standin / (float)sum_standins,
            100.0 * cache->mip_full.stats_fetches / (float)sum_fetches,
            100.0 * cache->mip_full.stats_requests / (float)sum);
+  dt_print(DT_DEBUG_ALWAYS,"[mipmap_cache] prefetch %ld queued, %ld loaded, %ld cached, %ld cancelled,"
+           " %6.2f%% hits\n\n",
+           _prefetch.stats_queued, _prefetch.stats_loaded, _prefetch.stats_cached,
+           _prefetch.stats_cancelled,
+           100.0 * _prefetch.stats_hits / (float)MAX(1, _prefetch.stats_loaded));
 }
 
 static gboolean _raise_signal_mipmap_updated(gpointer user_data)
@@ -1105,6 +1162,13 @@ void dt_mipmap_cache_get_with_caller(
       if(buf->buf && buf->width > 0 && buf->height > 0)
       {
         if(mip != k) __sync_fetch_and_add(&(_get_cache(cache, mip)->stats_standin), 1);
+        else
+        {
+          dt_pthread_mutex_lock(&_prefetch.lock);
+          if(g_hash_table_remove(_prefetch.loaded, GUINT_TO_POINTER(key)))
+            _prefetch.stats_hits++;
+          dt_pthread_mutex_unlock(&_prefetch.lock);
+        }
         return;
       }
       // didn't succeed the first time? prefetch for later!
@@ -1205,6 +1269,8 @@ void dt_mipmap_cache_remove_at_size(dt_mipmap_cache_t *cache,
                                     const dt_mipmap_size_t mip)
 {
   if(mip > DT_MIPMAP_8 || mip < DT_MIPMAP_0) return;
+  // the focus peaking overlays were computed from the old thumbnails
+  dt_focuspeaking_remove(imgid);
   // get rid of all ldr thumbnails:
   const uint32_t key = get_key(imgid, mip);
   dt_cache_entry_t *entry = dt_cache_testget(&_get_cache(cache, mip)->cache, key, 'w');
@@ -1411,6 +1477,13 @@ static int _write_image(dt_imageio_module_data_t *data,
   return 0;
 }
 
+void dt_mipmap_cache_time_first_thumbnail(void)
+{
+  if(!(darktable.unmuted & DT_DEBUG_PERF)) return;
+  _first_thumbnail.start = dt_get_wtime();
+  g_atomic_int_set(&_first_thumbnail.pending, TRUE);
+}
+
 static void _init_8(uint8_t *buf,
                     uint32_t *width,
                     uint32_t *height,
@@ -1458,19 +1531,27 @@ static void _init_8(uint8_t *buf,
 
     const char *c = filename + strlen(filename);
     while(*c != '.' && c > filename) c--;
-    if(!strcasecmp(c, ".jpg"))
+    if(!strcasecmp(c, ".jpg") || !strcasecmp(c, ".jpeg"))
     {
-      // try to load jpg
+      // try to load jpg, decoded by libjpeg at the lowest resolution
+      // still covering the thumbnail
+      const double start = dt_get_debug_wtime();
       dt_imageio_jpeg_t jpg;
       if(!dt_imageio_jpeg_read_header(filename, &jpg))
       {
+        const int full_width = jpg.width;
+        const int full_height = jpg.height;
+        const gboolean swap = orientation & ORIENTATION_SWAP_XY;
+        dt_imageio_jpeg_set_scale(&jpg, swap ? ht : wd, swap ? wd : ht);
         uint8_t *tmp = dt_alloc_align_uint8((size_t)jpg.width * jpg.height * 4);
         *color_space = dt_imageio_jpeg_read_color_space(&jpg);
         if(!dt_imageio_jpeg_read(&jpg, tmp))
         {
           // scale to fit
-          dt_print(DT_DEBUG_CACHE,
-                   "[mipmap_cache] generate mip %d for ID=%d from jpeg", size, imgid);
+          dt_print(DT_DEBUG_CACHE | DT_DEBUG_PERF,
+                   "[mipmap_cache] generate mip %d for ID=%d from %dx%d jpeg decoded at %dx%d in %0.04f sec",
+                   size, imgid, full_width, full_height, jpg.width, jpg.height,
+                   dt_get_debug_wtime() - start);
           dt_iop_flip_and_zoom_8(tmp, jpg.width, jpg.height, buf, wd, ht, orientation, width, height);
           res = FALSE;
         }
@@ -1481,7 +1562,12 @@ static void _init_8(uint8_t *buf,
     {
       uint8_t *tmp = 0;
       int32_t thumb_width, thumb_height;
-      res = dt_imageio_large_thumbnail(filename, &tmp, &thumb_width, &thumb_height, color_space);
+      // the box the preview is fitted into before it is turned
+      const gboolean swap = orientation & ORIENTATION_SWAP_XY;
+      const int32_t fit_width = swap ? ht : wd;
+      const int32_t fit_height = swap ? wd : ht;
+      res = dt_imageio_large_thumbnail(filename, fit_width, fit_height,
+                                       &tmp, &thumb_width, &thumb_height, color_space);
       if(!res)
       {
         // if the thumbnail is not large enough, we compute one
@@ -1489,8 +1575,8 @@ static void _init_8(uint8_t *buf,
         const int imgwd = img2->width;
         const int imght = img2->height;
         dt_image_cache_read_release(darktable.image_cache, img2);
-        if(thumb_width < wd
-           && thumb_height < ht
+        if(thumb_width < fit_width
+           && thumb_height < fit_height
            && thumb_width < imgwd - 4
            && thumb_height < imght - 4)
         {
@@ -1574,6 +1660,11 @@ static void _init_8(uint8_t *buf,
     return;
   }
 
+  if(g_atomic_int_compare_and_exchange(&_first_thumbnail.pending, TRUE, FALSE))
+    dt_print(DT_DEBUG_PERF,
+             "[mipmap_cache] first thumbnail after import (mip %d for ID=%d) in %0.04f sec",
+             size, imgid, dt_get_wtime() - _first_thumbnail.start);
+
   // TODO: various speed optimizations:
   // TODO: also init all smaller mips!
   // TODO: use mipf, but:
@@ -1615,6 +1706,153 @@ void dt_mipmap_cache_copy_thumbnails(const dt_mipmap_cache_t *cache,
   }
 }
 
+// take the next image to prefetch, round robin between the views.
+// to be called with _prefetch.lock held.
+static gboolean _prefetch_next(dt_imgid_t *imgid, dt_mipmap_size_t *mip)
+{
+  for(int i = 0; i < DT_MIPMAP_PREFETCH_CLIENTS; i++)
+  {
+    dt_mipmap_prefetch_list_t *l = &_prefetch.lists[(_prefetch.turn + i) % DT_MIPMAP_PREFETCH_CLIENTS];
+    if(l->next < l->count)
+    {
+      *imgid = l->imgs[l->next++];
+      *mip = l->mip;
+      _prefetch.turn = (_prefetch.turn + i + 1) % DT_MIPMAP_PREFETCH_CLIENTS;
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+static void _prefetch_queue_job(void);
+
+// loads a single image and queues itself again if more are waiting,
+// so that other jobs get a chance to run in between.
+static int32_t _prefetch_job_run(dt_job_t *job)
+{
+  dt_mipmap_cache_t *cache = darktable.mipmap_cache;
+  dt_imgid_t imgid = NO_IMGID;
+  dt_mipmap_size_t mip = DT_MIPMAP_NONE;
+
+  while(TRUE)
+  {
+    dt_pthread_mutex_lock(&_prefetch.lock);
+    const gboolean found = cache && _prefetch_next(&imgid, &mip);
+    if(!found) _prefetch.job_queued = FALSE;
+    dt_pthread_mutex_unlock(&_prefetch.lock);
+    if(!found) return 0;
+
+    dt_mipmap_buffer_t buf;
+    dt_mipmap_cache_get(cache, &buf, imgid, mip, DT_MIPMAP_TESTLOCK, 'r');
+    if(buf.buf)
+    {
+      // already there, no need to hold a worker for this one
+      dt_mipmap_cache_release(cache, &buf);
+      dt_pthread_mutex_lock(&_prefetch.lock);
+      _prefetch.stats_cached++;
+      dt_pthread_mutex_unlock(&_prefetch.lock);
+      continue;
+    }
+    break;
+  }
+
+  dt_mipmap_buffer_t buf;
+  dt_mipmap_cache_get(cache, &buf, imgid, mip, DT_MIPMAP_BLOCKING, 'r');
+  dt_mipmap_cache_release(cache, &buf);
+
+  dt_pthread_mutex_lock(&_prefetch.lock);
+  _prefetch.stats_loaded++;
+  // forget the oldest ones if the views never asked for them
+  if(g_hash_table_size(_prefetch.loaded) >= DT_MIPMAP_PREFETCH_CLIENTS * DT_MIPMAP_PREFETCH_MAX * 4)
+    g_hash_table_remove_all(_prefetch.loaded);
+  g_hash_table_add(_prefetch.loaded, GUINT_TO_POINTER(get_key(imgid, mip)));
+  dt_pthread_mutex_unlock(&_prefetch.lock);
+
+  _prefetch_queue_job();
+  return 0;
+}
+
+static void _prefetch_queue_job(void)
+{
+  dt_job_t *job = dt_control_job_create(&_prefetch_job_run, "prefetch images");
+  if(job)
+    dt_control_add_job(darktable.control, DT_JOB_QUEUE_SYSTEM_BG, job);
+  else
+  {
+    dt_pthread_mutex_lock(&_prefetch.lock);
+    _prefetch.job_queued = FALSE;
+    dt_pthread_mutex_unlock(&_prefetch.lock);
+  }
+}
+
+void dt_mipmap_cache_prefetch(dt_mipmap_cache_t *cache,
+                              const void *owner,
+                              const dt_imgid_t *imgs,
+                              const int count,
+                              const dt_mipmap_size_t mip)
+{
+  if(!_prefetch.loaded || mip > DT_MIPMAP_FULL || (int)mip < DT_MIPMAP_0) return;
+
+  dt_pthread_mutex_lock(&_prefetch.lock);
+
+  // the list of this view, or a free one, or the first one
+  dt_mipmap_prefetch_list_t *l = NULL;
+  for(int k = 0; k < DT_MIPMAP_PREFETCH_CLIENTS && !l; k++)
+    if(_prefetch.lists[k].owner == owner) l = &_prefetch.lists[k];
+  for(int k = 0; k < DT_MIPMAP_PREFETCH_CLIENTS && !l; k++)
+    if(!_prefetch.lists[k].owner) l = &_prefetch.lists[k];
+  if(!l) l = &_prefetch.lists[0];
+
+  // the images not loaded yet are no longer wanted
+  _prefetch.stats_cancelled += l->count - l->next;
+
+  l->owner = owner;
+  l->mip = mip;
+  l->next = 0;
+  l->count = 0;
+  for(int k = 0; k < count && l->count < DT_MIPMAP_PREFETCH_MAX; k++)
+    if(dt_is_valid_imgid(imgs[k])) l->imgs[l->count++] = imgs[k];
+  _prefetch.stats_queued += l->count;
+
+  const gboolean start = l->count > 0 && !_prefetch.job_queued;
+  if(start) _prefetch.job_queued = TRUE;
+  dt_pthread_mutex_unlock(&_prefetch.lock);
+
+  if(start) _prefetch_queue_job();
+}
+
+void dt_mipmap_prefetch_motion_update(dt_mipmap_prefetch_motion_t *motion,
+                                      const int step)
+{
+  if(step == 0) return;
+
+  const double now = dt_get_wtime();
+  const int direction = step > 0 ? 1 : -1;
+  const float moved = fabsf((float)step);
+  const double elapsed = now - motion->time;
+
+  if(direction != motion->direction || elapsed > DT_MIPMAP_PREFETCH_IDLE)
+    // a new navigation, assume one move per second
+    motion->rate = moved;
+  else
+    // smooth the rate over the recent moves
+    motion->rate = 0.5f * motion->rate + 0.5f * moved / MAX(elapsed, 0.01);
+
+  motion->direction = direction;
+  motion->time = now;
+}
+
+int dt_mipmap_prefetch_motion_ahead(const dt_mipmap_prefetch_motion_t *motion,
+                                    const int visible)
+{
+  if(!motion->direction || dt_get_wtime() - motion->time > DT_MIPMAP_PREFETCH_IDLE)
+    return 0;
+
+  // at least the next screen, more when moving fast
+  const int ahead = ceilf(motion->rate * DT_MIPMAP_PREFETCH_TIME);
+  return motion->direction * MIN(MAX(ahead, visible), DT_MIPMAP_PREFETCH_MAX);
+}
+
 // clang-format off
 // modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
 // vim: shiftwidth=2 expandtab tabstop=2 cindent
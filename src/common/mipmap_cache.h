@@ -88,6 +88,17 @@ typedef struct dt_mipmap_cache_one_t
   long int stats_standin;    // texture used as stand-in
 } dt_mipmap_cache_one_t;
 
+// maximum number of images prefetched for a view
+#define DT_MIPMAP_PREFETCH_MAX 64
+
+// recent navigation of a view, to estimate how far ahead to prefetch
+typedef struct dt_mipmap_prefetch_motion_t
+{
+  double time;   // of the last move
+  int direction; // 1 forward, -1 backward
+  float rate;    // images per second
+} dt_mipmap_prefetch_motion_t;
+
 typedef struct dt_mipmap_cache_t
 {
   // real width and height are stored per element
@@ -161,6 +172,25 @@ void dt_mipmap_cache_copy_thumbnails(const dt_mipmap_cache_t *cache, const dt_im
 // return the mipmap corresponding to text value saved in prefs
 dt_mipmap_size_t dt_mipmap_cache_get_min_mip_from_pref(const char *value);
 
+// load the given images at size mip in the background, in the given order
+// and with low priority. this replaces the images still waiting from the
+// previous call with the same owner (a view), other owners are not affected.
+void dt_mipmap_cache_prefetch(dt_mipmap_cache_t *cache,
+                              const void *owner,
+                              const dt_imgid_t *imgs,
+                              const int count,
+                              const dt_mipmap_size_t mip);
+
+// with -d perf, report the time until the next thumbnail is generated.
+// called when an import starts.
+void dt_mipmap_cache_time_first_thumbnail(void);
+
+// record a move of a view by step images, negative when moving backward.
+void dt_mipmap_prefetch_motion_update(dt_mipmap_prefetch_motion_t *motion, const int step);
+// number of images to prefetch ahead of a view showing visible images,
+// negative when moving backward and 0 if the view did not move lately.
+int dt_mipmap_prefetch_motion_ahead(const dt_mipmap_prefetch_motion_t *motion, const int visible);
+
 G_END_DECLS
 
 // clang-format off
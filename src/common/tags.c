@@ -323,14 +323,12 @@ gchar *dt_tag_get_name(const guint tagid)
 {
   int rt;
   char *name = NULL;
-  sqlite3_stmt *stmt;
-  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db),
-                              "SELECT name FROM data.tags WHERE id= ?1", -1, &stmt,
-                              NULL);
+  sqlite3_stmt *stmt = dt_database_prepare_cached
+    (darktable.db, "SELECT name FROM data.tags WHERE id= ?1");
   DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, tagid);
   rt = sqlite3_step(stmt);
   if(rt == SQLITE_ROW) name = g_strdup((const char *)sqlite3_column_text(stmt, 0));
-  sqlite3_finalize(stmt);
+  dt_database_release_cached(darktable.db, stmt);
 
   return name;
 }
@@ -355,10 +353,8 @@ void dt_tag_rename(const guint tagid, const gchar *new_tagname)
 gboolean dt_tag_exists(const char *name, guint *tagid)
 {
   int rt;
-  sqlite3_stmt *stmt;
-  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db),
-                              "SELECT id FROM data.tags WHERE name = ?1", -1, &stmt,
-                              NULL);
+  sqlite3_stmt *stmt = dt_database_prepare_cached
+    (darktable.db, "SELECT id FROM data.tags WHERE name = ?1");
   DT_DEBUG_SQLITE3_BIND_TEXT(stmt, 1, name, -1, SQLITE_TRANSIENT);
   rt = sqlite3_step(stmt);
 
@@ -366,13 +362,13 @@ gboolean dt_tag_exists(const char *name, guint *tagid)
   {
     if(tagid != NULL)
       *tagid = sqlite3_column_int64(stmt, 0);
-    sqlite3_finalize(stmt);
+    dt_database_release_cached(darktable.db, stmt);
     return TRUE;
   }
 
   if(tagid != NULL)
     *tagid = -1;
-  sqlite3_finalize(stmt);
+  dt_database_release_cached(darktable.db, stmt);
   return FALSE;
 }
 
@@ -704,25 +700,26 @@ uint32_t dt_tag_count_attached(const dt_imgid_t imgid,
   if(!dt_is_valid_imgid(imgid))
     return 0;
 
-  sqlite3_stmt *stmt;
-
-  gchar *query = g_strdup_printf
-    ("SELECT COUNT(tagid)"
-     " FROM main.tagged_images"
-     " WHERE imgid = %d"
-     "       %s",
-     imgid,
-     ignore_dt_tags ? " AND tagid NOT IN memory.darktable_tags" : "");
-
-  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db), query, -1, &stmt, NULL);
-  g_free(query);
+  // clang-format off
+  sqlite3_stmt *stmt = dt_database_prepare_cached
+    (darktable.db,
+     ignore_dt_tags
+     ? "SELECT COUNT(tagid)"
+       " FROM main.tagged_images"
+       " WHERE imgid = ?1"
+       "       AND tagid NOT IN memory.darktable_tags"
+     : "SELECT COUNT(tagid)"
+       " FROM main.tagged_images"
+       " WHERE imgid = ?1");
+  // clang-format on
+  DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, imgid);
 
   int32_t count = 0;
 
   if(sqlite3_step(stmt) == SQLITE_ROW)
     count = sqlite3_column_int(stmt, 0);
 
-  sqlite3_finalize(stmt);
+  dt_database_release_cached(darktable.db, stmt);
   return count;
 }
 
@@ -1580,11 +1577,8 @@ void dt_tag_set_synonyms(gint tagid,
 
 gint dt_tag_get_flags(const gint tagid)
 {
-  sqlite3_stmt *stmt;
-
-  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db),
-                              "SELECT flags FROM data.tags WHERE id = ?1 ",
-                              -1, &stmt, NULL);
+  sqlite3_stmt *stmt = dt_database_prepare_cached
+    (darktable.db, "SELECT flags FROM data.tags WHERE id = ?1 ");
   DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, tagid);
 
   gint flags = 0;
@@ -1592,7 +1586,7 @@ gint dt_tag_get_flags(const gint tagid)
   {
     flags = sqlite3_column_int(stmt, 0);
   }
-  sqlite3_finalize(stmt);
+  dt_database_release_cached(darktable.db, stmt);
   return flags;
 }
 
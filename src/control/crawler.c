@@ -110,6 +110,232 @@ static void _set_modification_time(char *filename,
 #define FAST_UPDATE 0.2
 #define SLOW_UPDATE 1.0
 
+// images are checked in batches, the files of each batch in parallel.
+// the stat calls are bound by the latency of the file system, mostly
+// on network shares, so we use more threads than cores here.
+#define DT_CRAWLER_BATCH 256
+#define DT_CRAWLER_THREADS 16
+// number of folders watched for changes while running
+#define DT_CRAWLER_MAX_WATCHES 2048
+
+typedef struct dt_control_crawler_entry_t
+{
+  dt_imgid_t id;
+  time_t timestamp;
+  int version;
+  int flags;
+  gchar *image_path;
+  // filled by _crawl_entry()
+  gboolean missing;
+  int new_flags;
+  time_t timestamp_xmp;
+  gchar *xmp_path; // only set if the xmp is newer than the db entry
+} dt_control_crawler_entry_t;
+
+// film id -> GFileMonitor of the folders whose journal entry can be
+// trusted as long as the monitor has not been cancelled
+static GHashTable *_journal_watches = NULL;
+
+static void _crawl_entry(dt_control_crawler_entry_t *entry,
+                         const gboolean look_for_xmp)
+{
+  const gchar *image_path = entry->image_path;
+  entry->new_flags = entry->flags;
+
+  // if the image is missing we ignore it.
+  if(!g_file_test(image_path, G_FILE_TEST_EXISTS))
+  {
+    entry->missing = TRUE;
+    return;
+  }
+
+  // no need to look for xmp files if none get written anyway.
+  if(look_for_xmp)
+  {
+    // construct the xmp filename for this image
+    gchar xmp_path[PATH_MAX] = { 0 };
+    g_strlcpy(xmp_path, image_path, sizeof(xmp_path));
+    dt_image_path_append_version_no_db(entry->version, xmp_path, sizeof(xmp_path));
+    size_t len = strlen(xmp_path);
+    if(len + 4 >= PATH_MAX) return;
+    xmp_path[len++] = '.';
+    xmp_path[len++] = 'x';
+    xmp_path[len++] = 'm';
+    xmp_path[len++] = 'p';
+    xmp_path[len] = '\0';
+
+    // on Windows the encoding might not be UTF8
+    gchar *xmp_path_locale = dt_util_normalize_path(xmp_path);
+    int stat_res = -1;
+#ifdef _WIN32
+    // UTF8 paths fail in this context, but converting to UTF16 works
+    struct _stati64 statbuf;
+    if(xmp_path_locale) // in Windows dt_util_normalize_path returns
+                        // NULL if file does not exist
+    {
+      wchar_t *wfilename = g_utf8_to_utf16(xmp_path_locale, -1, NULL, NULL, NULL);
+      stat_res = _wstati64(wfilename, &statbuf);
+      g_free(wfilename);
+    }
+ #else
+    struct stat statbuf;
+    stat_res = stat(xmp_path_locale, &statbuf);
+#endif
+    g_free(xmp_path_locale);
+    if(stat_res) return; // TODO: shall we report these?
+
+    // step 1: check if the xmp is newer than our db entry
+    if(entry->timestamp + MAX_TIME_SKEW < statbuf.st_mtime)
+    {
+      entry->timestamp_xmp = statbuf.st_mtime;
+      entry->xmp_path = g_strdup(xmp_path);
+    }
+    // older timestamps are the case for all images after the db
+    // upgrade. better not report these
+  }
+
+  // step 2: check if the image has associated files (.txt, .wav)
+  size_t len = strlen(image_path);
+  const char *c = image_path + len;
+  while((c > image_path) && (*c != '.')) c--;
+  len = c - image_path + 1;
+
+  char *extra_path = calloc(len + 3 + 1, sizeof(char));
+  if(extra_path)
+  {
+    g_strlcpy(extra_path, image_path, len + 1);
+
+    extra_path[len] = 't';
+    extra_path[len + 1] = 'x';
+    extra_path[len + 2] = 't';
+    gboolean has_txt = g_file_test(extra_path, G_FILE_TEST_EXISTS);
+
+    if(!has_txt)
+    {
+      extra_path[len] = 'T';
+      extra_path[len + 1] = 'X';
+      extra_path[len + 2] = 'T';
+      has_txt = g_file_test(extra_path, G_FILE_TEST_EXISTS);
+    }
+
+    extra_path[len] = 'w';
+    extra_path[len + 1] = 'a';
+    extra_path[len + 2] = 'v';
+    gboolean has_wav = g_file_test(extra_path, G_FILE_TEST_EXISTS);
+
+    if(!has_wav)
+    {
+      extra_path[len] = 'W';
+      extra_path[len + 1] = 'A';
+      extra_path[len + 2] = 'V';
+      has_wav = g_file_test(extra_path, G_FILE_TEST_EXISTS);
+    }
+
+    // TODO: decide if we want to remove the flag for images that lost
+    // their extra file. currently we do (the else cases)
+    if(has_txt)
+      entry->new_flags |= DT_IMAGE_HAS_TXT;
+    else
+      entry->new_flags &= ~DT_IMAGE_HAS_TXT;
+    if(has_wav)
+      entry->new_flags |= DT_IMAGE_HAS_WAV;
+    else
+      entry->new_flags &= ~DT_IMAGE_HAS_WAV;
+
+    free(extra_path);
+  }
+}
+
+static void _journal_folder_changed(GFileMonitor *monitor,
+                                    GFile *file,
+                                    GFile *other_file,
+                                    const GFileMonitorEvent event_type,
+                                    gpointer user_data)
+{
+  if(event_type == G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED) return;
+
+  gchar *name = g_file_get_basename(file);
+  const size_t len = name ? strlen(name) : 0;
+  const gboolean is_xmp = len > 4 && !g_ascii_strcasecmp(name + len - 4, ".xmp");
+  g_free(name);
+  if(!is_xmp) return;
+
+  // the folder has to be crawled again on next startup, no need to
+  // watch it any longer.
+  g_file_monitor_cancel(monitor);
+  dt_print(DT_DEBUG_CONTROL,
+           "[crawler] sidecar changed in folder of film roll %d",
+           GPOINTER_TO_INT(user_data));
+}
+
+// compare the folders of all film rolls with the journal written on
+// last startup. the film rolls whose folder did not change since and
+// has been watched while darktable was running are added to
+// unchanged. the journal gets updated with the current state, the
+// entries are only trusted again once the session ends cleanly,
+// see dt_control_crawler_cleanup().
+static void _journal_check(GHashTable *unchanged)
+{
+  sqlite3_stmt *stmt, *inner_stmt;
+  // clang-format off
+  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db),
+                              "SELECT f.id, f.folder, j.folder, j.mtime, j.dirty"
+                              " FROM main.film_rolls f"
+                              " LEFT JOIN main.film_rolls_journal j ON j.film_id = f.id",
+                              -1, &stmt, NULL);
+  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db),
+                              "INSERT OR REPLACE INTO main.film_rolls_journal"
+                              " (film_id, folder, mtime, dirty)"
+                              " VALUES (?1, ?2, ?3, 1)",
+                              -1, &inner_stmt, NULL);
+  // clang-format on
+
+  _journal_watches = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_object_unref);
+
+  while(sqlite3_step(stmt) == SQLITE_ROW)
+  {
+    const int film_id = sqlite3_column_int(stmt, 0);
+    const char *folder = (const char *)sqlite3_column_text(stmt, 1);
+    const char *journal_folder = (const char *)sqlite3_column_text(stmt, 2);
+    const gboolean known = sqlite3_column_type(stmt, 3) != SQLITE_NULL;
+    const gint64 journal_mtime = sqlite3_column_int64(stmt, 3);
+    const gboolean dirty = sqlite3_column_int(stmt, 4);
+
+    GStatBuf statbuf;
+    if(!folder || g_stat(folder, &statbuf))
+      continue; // not reachable, crawl as usual
+
+    // watch before recording the state so we don't miss any change
+    if(g_hash_table_size(_journal_watches) < DT_CRAWLER_MAX_WATCHES)
+    {
+      GFile *gfolder = g_file_new_for_path(folder);
+      GFileMonitor *monitor = g_file_monitor_directory(gfolder, G_FILE_MONITOR_NONE, NULL, NULL);
+      g_object_unref(gfolder);
+      if(monitor)
+      {
+        g_signal_connect(monitor, "changed",
+                         G_CALLBACK(_journal_folder_changed), GINT_TO_POINTER(film_id));
+        g_hash_table_insert(_journal_watches, GINT_TO_POINTER(film_id), monitor);
+      }
+    }
+
+    if(known && !dirty
+       && !g_strcmp0(folder, journal_folder)
+       && journal_mtime == (gint64)statbuf.st_mtime)
+      g_hash_table_add(unchanged, GINT_TO_POINTER(film_id));
+
+    DT_DEBUG_SQLITE3_BIND_INT(inner_stmt, 1, film_id);
+    DT_DEBUG_SQLITE3_BIND_TEXT(inner_stmt, 2, folder, -1, SQLITE_TRANSIENT);
+    DT_DEBUG_SQLITE3_BIND_INT64(inner_stmt, 3, statbuf.st_mtime);
+    sqlite3_step(inner_stmt);
+    sqlite3_reset(inner_stmt);
+    sqlite3_clear_bindings(inner_stmt);
+  }
+
+  sqlite3_finalize(stmt);
+  sqlite3_finalize(inner_stmt);
+}
+
 GList *dt_control_crawler_run(void)
 {
   sqlite3_stmt *stmt, *inner_stmt;
@@ -130,7 +356,7 @@ GList *dt_control_crawler_run(void)
   // clang-format off
   sqlite3_prepare_v2(dt_database_get(darktable.db),
                      "SELECT i.id, write_timestamp, version,"
-                     "       folder || '" G_DIR_SEPARATOR_S "' || filename, flags"
+                     "       folder || '" G_DIR_SEPARATOR_S "' || filename, flags, film_id"
                      " FROM main.images i, main.film_rolls f"
                      " ON i.film_id = f.id"
                      " ORDER BY f.id, filename",
@@ -143,162 +369,155 @@ GList *dt_control_crawler_run(void)
   // let's wrap this into a transaction, it might make it a little faster.
   dt_database_start_transaction(darktable.db);
 
+  // film rolls whose folder did not change since last startup
+  GHashTable *unchanged = g_hash_table_new(g_direct_hash, g_direct_equal);
+  if(dt_conf_get_bool("run_crawler_journal"))
+    _journal_check(unchanged);
+
+  dt_control_crawler_entry_t *entries = calloc(DT_CRAWLER_BATCH, sizeof(dt_control_crawler_entry_t));
+
   int image_count = 0;
+  int checked_count = 0;
   const double start_time = dt_get_wtime();
   // set the "previous update" time to 10ms after a notional previous
   // update to ensure visibility of the first update (which might not
   // appear when done with zero delay) while minimizing the delay
   double last_time = start_time - (FAST_UPDATE-0.01);
 
-  while(sqlite3_step(stmt) == SQLITE_ROW)
+  gboolean done = (entries == NULL);
+  while(!done)
   {
-    const dt_imgid_t id = sqlite3_column_int(stmt, 0);
-    const time_t timestamp = sqlite3_column_int64(stmt, 1);
-    const int version = sqlite3_column_int(stmt, 2);
-    const gchar *image_path = (char *)sqlite3_column_text(stmt, 3);
-    int flags = sqlite3_column_int(stmt, 4);
-    ++image_count;
-
-    // update the progress message - five times per second for first four seconds, then once per second
-    const double curr_time = dt_get_wtime();
-    if(curr_time >= last_time + ((curr_time - start_time > 4.0) ? SLOW_UPDATE : FAST_UPDATE))
-    {
-      const double fraction = image_count / (double)total_images;
-      darktable_splash_screen_set_progress_percent(_("checking for updated sidecar files (%d%%)"),
-                                                   fraction,
-                                                   curr_time - start_time);
-      last_time = curr_time;
-    }
-
-    // if the image is missing we ignore it.
-    if(!g_file_test(image_path, G_FILE_TEST_EXISTS))
+    // read the next batch from the db
+    int count = 0;
+    while(count < DT_CRAWLER_BATCH)
     {
-      dt_print(DT_DEBUG_CONTROL, "[crawler] `%s' (id: %d) is missing", image_path, id);
-      continue;
-    }
-
-    // no need to look for xmp files if none get written anyway.
-    if(look_for_xmp)
-    {
-      // construct the xmp filename for this image
-      gchar xmp_path[PATH_MAX] = { 0 };
-      g_strlcpy(xmp_path, image_path, sizeof(xmp_path));
-      dt_image_path_append_version_no_db(version, xmp_path, sizeof(xmp_path));
-      size_t len = strlen(xmp_path);
-      if(len + 4 >= PATH_MAX) continue;
-      xmp_path[len++] = '.';
-      xmp_path[len++] = 'x';
-      xmp_path[len++] = 'm';
-      xmp_path[len++] = 'p';
-      xmp_path[len] = '\0';
-
-      // on Windows the encoding might not be UTF8
-      gchar *xmp_path_locale = dt_util_normalize_path(xmp_path);
-      int stat_res = -1;
-#ifdef _WIN32
-      // UTF8 paths fail in this context, but converting to UTF16 works
-      struct _stati64 statbuf;
-      if(xmp_path_locale) // in Windows dt_util_normalize_path returns
-                          // NULL if file does not exist
-      {
-        wchar_t *wfilename = g_utf8_to_utf16(xmp_path_locale, -1, NULL, NULL, NULL);
-        stat_res = _wstati64(wfilename, &statbuf);
-        g_free(wfilename);
-      }
- #else
-      struct stat statbuf;
-      stat_res = stat(xmp_path_locale, &statbuf);
-#endif
-      g_free(xmp_path_locale);
-      if(stat_res) continue; // TODO: shall we report these?
-
-      // step 1: check if the xmp is newer than our db entry
-      if(timestamp + MAX_TIME_SKEW < statbuf.st_mtime)
+      if(sqlite3_step(stmt) != SQLITE_ROW)
       {
-        dt_control_crawler_result_t *item = malloc(sizeof(dt_control_crawler_result_t));
-        item->id = id;
-        item->timestamp_xmp = statbuf.st_mtime;
-        item->timestamp_db = timestamp;
-        item->image_path = g_strdup(image_path);
-        item->xmp_path = g_strdup(xmp_path);
-
-        result = g_list_prepend(result, item);
-        dt_print(DT_DEBUG_CONTROL,
-                 "[crawler] `%s' (id: %d) is a newer XMP file", xmp_path, id);
+        done = TRUE;
+        break;
       }
-      // older timestamps are the case for all images after the db
-      // upgrade. better not report these
+      ++image_count;
+      if(g_hash_table_contains(unchanged, GINT_TO_POINTER(sqlite3_column_int(stmt, 5))))
+        continue;
+
+      dt_control_crawler_entry_t *entry = &entries[count++];
+      memset(entry, 0, sizeof(dt_control_crawler_entry_t));
+      entry->id = sqlite3_column_int(stmt, 0);
+      entry->timestamp = sqlite3_column_int64(stmt, 1);
+      entry->version = sqlite3_column_int(stmt, 2);
+      entry->image_path = g_strdup((char *)sqlite3_column_text(stmt, 3));
+      entry->flags = sqlite3_column_int(stmt, 4);
     }
+    checked_count += count;
 
-    // step 2: check if the image has associated files (.txt, .wav)
-    size_t len = strlen(image_path);
-    const char *c = image_path + len;
-    while((c > image_path) && (*c != '.')) c--;
-    len = c - image_path + 1;
+    DT_OMP_PRAGMA(parallel for default(firstprivate) schedule(dynamic)
+                  num_threads(DT_CRAWLER_THREADS) if(count > 1))
+    for(int i = 0; i < count; i++)
+      _crawl_entry(&entries[i], look_for_xmp);
 
-    char *extra_path = calloc(len + 3 + 1, sizeof(char));
-    if(extra_path)
+    // report and update the db in the original order
+    for(int i = 0; i < count; i++)
     {
-      g_strlcpy(extra_path, image_path, len + 1);
+      dt_control_crawler_entry_t *entry = &entries[i];
 
-      extra_path[len] = 't';
-      extra_path[len + 1] = 'x';
-      extra_path[len + 2] = 't';
-      gboolean has_txt = g_file_test(extra_path, G_FILE_TEST_EXISTS);
+      if(entry->missing)
+        dt_print(DT_DEBUG_CONTROL, "[crawler] `%s' (id: %d) is missing",
+                 entry->image_path, entry->id);
 
-      if(!has_txt)
+      if(entry->xmp_path)
       {
-        extra_path[len] = 'T';
-        extra_path[len + 1] = 'X';
-        extra_path[len + 2] = 'T';
-        has_txt = g_file_test(extra_path, G_FILE_TEST_EXISTS);
-      }
-
-      extra_path[len] = 'w';
-      extra_path[len + 1] = 'a';
-      extra_path[len + 2] = 'v';
-      gboolean has_wav = g_file_test(extra_path, G_FILE_TEST_EXISTS);
+        dt_control_crawler_result_t *item = malloc(sizeof(dt_control_crawler_result_t));
+        item->id = entry->id;
+        item->timestamp_xmp = entry->timestamp_xmp;
+        item->timestamp_db = entry->timestamp;
+        item->image_path = entry->image_path;
+        item->xmp_path = entry->xmp_path;
+        entry->image_path = entry->xmp_path = NULL;
 
-      if(!has_wav)
-      {
-        extra_path[len] = 'W';
-        extra_path[len + 1] = 'A';
-        extra_path[len + 2] = 'V';
-        has_wav = g_file_test(extra_path, G_FILE_TEST_EXISTS);
+        result = g_list_prepend(result, item);
+        dt_print(DT_DEBUG_CONTROL,
+                 "[crawler] `%s' (id: %d) is a newer XMP file", item->xmp_path, item->id);
       }
 
-      // TODO: decide if we want to remove the flag for images that lost
-      // their extra file. currently we do (the else cases)
-      int new_flags = flags;
-      if(has_txt)
-        new_flags |= DT_IMAGE_HAS_TXT;
-      else
-        new_flags &= ~DT_IMAGE_HAS_TXT;
-      if(has_wav)
-        new_flags |= DT_IMAGE_HAS_WAV;
-      else
-        new_flags &= ~DT_IMAGE_HAS_WAV;
-      if(flags != new_flags)
+      if(entry->flags != entry->new_flags)
       {
-        sqlite3_bind_int(inner_stmt, 1, new_flags);
-        sqlite3_bind_int(inner_stmt, 2, id);
+        sqlite3_bind_int(inner_stmt, 1, entry->new_flags);
+        sqlite3_bind_int(inner_stmt, 2, entry->id);
         sqlite3_step(inner_stmt);
         sqlite3_reset(inner_stmt);
         sqlite3_clear_bindings(inner_stmt);
       }
 
-      free(extra_path);
+      g_free(entry->image_path);
+    }
+
+    // update the progress message - five times per second for first four seconds, then once per second
+    const double curr_time = dt_get_wtime();
+    if(curr_time >= last_time + ((curr_time - start_time > 4.0) ? SLOW_UPDATE : FAST_UPDATE))
+    {
+      const double fraction = image_count / (double)total_images;
+      darktable_splash_screen_set_progress_percent(_("checking for updated sidecar files (%d%%)"),
+                                                   fraction,
+                                                   curr_time - start_time);
+      last_time = curr_time;
     }
   }
 
   dt_database_release_transaction(darktable.db);
 
+  dt_print(DT_DEBUG_PERF,
+           "[crawler] checked %d of %d images in %.3f secs, %u unchanged folders skipped",
+           checked_count, image_count, dt_get_wtime() - start_time,
+           g_hash_table_size(unchanged));
+
+  free(entries);
+  g_hash_table_destroy(unchanged);
   sqlite3_finalize(stmt);
   sqlite3_finalize(inner_stmt);
 
   return g_list_reverse(result); // list was built in reverse order, so un-reverse it
 }
 
+void dt_control_crawler_cleanup(void)
+{
+  // only the folders watched during the whole session can be skipped
+  // on next startup, this also invalidates the journal if the crawler
+  // did not run at all.
+  dt_database_start_transaction(darktable.db);
+  // clang-format off
+  DT_DEBUG_SQLITE3_EXEC(dt_database_get(darktable.db),
+                        "UPDATE main.film_rolls_journal SET dirty = 1",
+                        NULL, NULL, NULL);
+  // clang-format on
+
+  if(_journal_watches)
+  {
+    sqlite3_stmt *stmt;
+    // clang-format off
+    DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db),
+                                "UPDATE main.film_rolls_journal SET dirty = 0"
+                                " WHERE film_id = ?1",
+                                -1, &stmt, NULL);
+    // clang-format on
+    GHashTableIter it;
+    gpointer key, value;
+    g_hash_table_iter_init(&it, _journal_watches);
+    while(g_hash_table_iter_next(&it, &key, &value))
+    {
+      if(g_file_monitor_is_cancelled(G_FILE_MONITOR(value))) continue;
+      DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, GPOINTER_TO_INT(key));
+      sqlite3_step(stmt);
+      sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+
+    g_hash_table_destroy(_journal_watches);
+    _journal_watches = NULL;
+  }
+
+  dt_database_release_transaction(darktable.db);
+}
+
 
 /********************* the gui stuff *********************/
 
@@ -31,8 +31,13 @@
 // - there is a .txt or .wav file associated with the image and mark so in the db
 //   or if such a file no longer exists
 // it returns the list of images with a (supposedly) updated xmp file to let the user decide
+// if run_crawler_journal is set, the images of film rolls whose folder is unchanged
+// since the last startup and was watched during the last session are skipped.
 GList *dt_control_crawler_run();
 
+// stop watching the film roll folders and record which of them can be skipped on next startup
+void dt_control_crawler_cleanup(void);
+
 // show a popup with the images, let the user decide what to do and free the list afterwards
 void dt_control_crawler_show_image_list(GList *images);
 
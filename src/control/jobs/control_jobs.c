@@ -37,6 +37,7 @@
 #include "common/datetime.h"
 #include "common/overlay.h"
 #include "control/conf.h"
+#include "control/jobs/sidecar_jobs.h"
 #include "develop/imageop_math.h"
 #include "imageio/imageio_common.h"
 #include "imageio/imageio_dng.h"
@@ -2657,6 +2658,8 @@ void dt_control_datetime(const GTimeSpan offset,
 
 void dt_control_write_sidecar_files()
 {
+  // also push out the pending background writes
+  dt_sidecar_synch_flush();
   dt_control_add_job
     (darktable.control, DT_JOB_QUEUE_USER_FG,
      dt_control_generic_images_job_create(&dt_control_write_sidecar_files_job_run,
@@ -2872,6 +2875,8 @@ static int32_t _control_import_job_run(dt_job_t *job)
   }
 #endif
 
+  dt_mipmap_cache_time_first_thumbnail();
+
   GList *t = params->index;
   const guint total = g_list_length(t);
   snprintf(message, sizeof(message), ngettext("importing %d image",
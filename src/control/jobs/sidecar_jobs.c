@@ -17,152 +17,233 @@
 */
 
 #include "control/jobs/sidecar_jobs.h"
+#include "common/database.h"
+#include "common/dtpthread.h"
 
-static GSList *pending_images = NULL;
-static gboolean background_running = FALSE;
+// a sidecar is written once its image has not been touched for
+// DT_SIDECAR_DELAY secs, so that a burst of edits on one image results
+// in a single write, but never later than DT_SIDECAR_MAX_DELAY secs
+// after the first request.
+#define DT_SIDECAR_DELAY 0.5
+#define DT_SIDECAR_MAX_DELAY 5.0
+// number of sidecars written per batch and in parallel
+#define DT_SIDECAR_BATCH 64
+#define DT_SIDECAR_THREADS 4
 
-#ifndef _OPENMP
-#include "common/dtpthread.h"
-static gboolean lock_initialized = FALSE;
-static dt_pthread_mutex_t pending_mutex;
+typedef struct dt_sidecar_request_t
+{
+  double first; // time of the first request since the last write
+  double last;  // time of the most recent request
+} dt_sidecar_request_t;
+
+static dt_pthread_mutex_t _pending_mutex;
+// imgid -> dt_sidecar_request_t, protected by _pending_mutex
+static GHashTable *_pending = NULL;
+static gboolean _background_running = FALSE;
+static gboolean _flush = FALSE;
+static dt_sidecar_synch_stats_t _stats = { 0 };
 
-static void _lock_pending_queue()
+// to be called with _pending_mutex held
+static void _enqueue(const dt_imgid_t imgid, const double now)
 {
-  if(!lock_initialized)
+  dt_sidecar_request_t *req = g_hash_table_lookup(_pending, GINT_TO_POINTER(imgid));
+  if(req)
+  {
+    req->last = now;
+    _stats.coalesced++;
+  }
+  else
   {
-    dt_pthread_mutex_init(&pending_mutex, NULL);
-    lock_initialized = TRUE;
+    req = g_malloc(sizeof(dt_sidecar_request_t));
+    req->first = req->last = now;
+    g_hash_table_insert(_pending, GINT_TO_POINTER(imgid), req);
   }
-  dt_pthread_mutex_lock(&pending_mutex);
+  _stats.requested++;
 }
 
-static void _unlock_pending_queue()
+// take the sidecars due for writing off the queue, returns the number
+// of images stored in imgs and their request time in first.
+static int _get_batch(dt_imgid_t *imgs,
+                      double *first,
+                      const double now,
+                      const gboolean all)
 {
-  if(lock_initialized)
+  int count = 0;
+  GHashTableIter it;
+  gpointer key, value;
+  g_hash_table_iter_init(&it, _pending);
+  while(count < DT_SIDECAR_BATCH && g_hash_table_iter_next(&it, &key, &value))
   {
-    dt_pthread_mutex_unlock(&pending_mutex);
+    const dt_sidecar_request_t *req = value;
+    if(all
+       || now - req->last >= DT_SIDECAR_DELAY
+       || now - req->first >= DT_SIDECAR_MAX_DELAY)
+    {
+      imgs[count] = GPOINTER_TO_INT(key);
+      first[count] = req->first;
+      count++;
+      g_hash_table_iter_remove(&it);
+    }
   }
+  return count;
+}
+
+static void _write_batch(const dt_imgid_t *imgs, const int count)
+{
+  gboolean error[DT_SIDECAR_BATCH];
+
+  DT_OMP_PRAGMA(parallel for default(firstprivate) schedule(dynamic)
+                num_threads(MIN(count, DT_SIDECAR_THREADS)))
+  for(int i = 0; i < count; i++)
+    error[i] = dt_image_write_sidecar_file_only(imgs[i]);
+
+  // the write timestamps of the whole batch in a single short transaction,
+  // done here as the transaction is not per thread
+  dt_database_start_transaction(darktable.db);
+  for(int i = 0; i < count; i++)
+  {
+    if(!error[i])
+      dt_image_set_write_timestamp(imgs[i]);
+  }
+  dt_database_release_transaction(darktable.db);
 }
-#endif /* !_OPENMP */
 
 static int32_t _control_write_sidecars_job_run(dt_job_t *job)
 {
-  GSList *imgs = NULL;
-  GHashTable *enqueued = g_hash_table_new(g_direct_hash, g_direct_equal);
+  dt_imgid_t imgs[DT_SIDECAR_BATCH];
+  double first[DT_SIDECAR_BATCH];
 
-  double prev_fetch = 0;
-  // keep going until explicitly cancelled or darktable shuts down AND all writes have finished
-  while(imgs || (dt_control_running() && dt_control_job_get_state(job) != DT_JOB_STATE_CANCELLED))
+  while(TRUE)
   {
-    GSList *new_imgs = NULL;
-    double curr_fetch = dt_get_wtime();
-    // grab any pending images and add them to the list of images to be synchronized
-    if(curr_fetch > prev_fetch + 0.25)
+    const gboolean stopping = !dt_control_running()
+                              || dt_control_job_get_state(job) == DT_JOB_STATE_CANCELLED;
+    const double now = dt_get_wtime();
+
+    dt_pthread_mutex_lock(&_pending_mutex);
+    // once stopping, new requests are written synchronously and we only
+    // drain what is already queued
+    if(stopping) _background_running = FALSE;
+    const int count = _get_batch(imgs, first, now, stopping || _flush);
+    const guint pending = g_hash_table_size(_pending);
+    if(pending == 0) _flush = FALSE;
+    dt_pthread_mutex_unlock(&_pending_mutex);
+
+    if(count == 0)
     {
-      prev_fetch = curr_fetch;
-#ifdef _OPENMP
-#pragma omp atomic capture
-      { new_imgs = pending_images; pending_images = NULL ; }
-#else
-      // don't have atomics, so use locks instead
-      _lock_pending_queue();
-      new_imgs = pending_images;
-      pending_images = NULL;
-      _unlock_pending_queue();
-#endif
-      if(new_imgs)
+      if(stopping)
       {
-        // add the new images to the queue being processed if they are not already on the queue
-        GSList *to_add = NULL;
-        for(GSList *imglist = new_imgs; imglist; imglist = g_slist_next(imglist))
+        if(darktable.unmuted & DT_DEBUG_PERF)
         {
-          if(!g_hash_table_contains(enqueued,GINT_TO_POINTER(imglist->data)))
-          {
-            to_add = g_slist_prepend(to_add, imglist->data);
-            g_hash_table_insert(enqueued, GINT_TO_POINTER(imglist->data), GINT_TO_POINTER(imglist->data));
-          }
+          dt_sidecar_synch_stats_t stats;
+          dt_sidecar_synch_get_stats(&stats);
+          dt_print(DT_DEBUG_PERF,
+                   "[sidecar_synch] %" PRIu64 " requests, %" PRIu64 " coalesced, %" PRIu64
+                   " sidecars written in %" PRIu64 " batches, latency avg %.3f max %.3f secs",
+                   stats.requested, stats.coalesced, stats.written, stats.batches,
+                   stats.written ? stats.latency_sum / stats.written : 0.0, stats.latency_max);
         }
-        imgs = g_slist_concat(imgs, to_add);
-        g_slist_free(new_imgs);
+        break;
       }
+      // nothing due yet, check again a bit later
+      g_usleep(100000);
+      continue;
     }
-    // synchronize the first few images on the queue
-    for(int i = 0; imgs && i < 3; i++)
-    {
-      dt_imgid_t imgid = GPOINTER_TO_INT(imgs->data);
-      dt_image_write_sidecar_file(imgid);
-      // remove the head of the image queue
-      g_hash_table_remove(enqueued, GINT_TO_POINTER(imgid));
-      imgs = g_slist_delete_link(imgs, imgs);
-    }
-    if(imgs) // do we have more images already queued?
-    {
-      // give others a chance to run by sleeping 10ms; avoids apparent
-      // hangs when trying to switch views
-      g_usleep(10000);
-    }
-    else
+
+    const double start = dt_get_wtime();
+    _write_batch(imgs, count);
+    const double end = dt_get_wtime();
+
+    dt_pthread_mutex_lock(&_pending_mutex);
+    for(int i = 0; i < count; i++)
     {
-      // we currently have nothing to do, so wait 1 second before checking for more work
-      g_usleep(1000000);
+      const double latency = end - first[i];
+      _stats.latency_sum += latency;
+      _stats.latency_max = MAX(_stats.latency_max, latency);
     }
+    _stats.written += count;
+    _stats.batches++;
+    dt_pthread_mutex_unlock(&_pending_mutex);
+
+    dt_print(DT_DEBUG_PERF,
+             "[sidecar_synch] %d sidecars written in %.3f secs, %u pending",
+             count, end - start, pending);
+
+    // give others a chance to run; avoids apparent hangs when trying
+    // to switch views
+    if(!stopping) g_usleep(10000);
   }
-  g_hash_table_destroy(enqueued);
   return 0;
 }
 
 void dt_sidecar_synch_enqueue(dt_imgid_t imgid)
 {
-  if(background_running)
-  {
-    GSList *img = g_slist_prepend(NULL,GINT_TO_POINTER(imgid));
-#ifdef _OPENMP
-#pragma omp atomic capture
-    { img->next = pending_images; pending_images = img; }
-#else
-    // don't have atomics, so use locks instead
-    _lock_pending_queue();
-    img->next = pending_images;
-    pending_images = img;
-    _unlock_pending_queue();
-#endif
-  }
-  else
+  if(!_pending)
   {
-    // synchronize the sidecar immediately instead of queueing it for background write
     dt_image_write_sidecar_file(imgid);
+    return;
   }
+
+  dt_pthread_mutex_lock(&_pending_mutex);
+  const gboolean background = _background_running;
+  if(background)
+    _enqueue(imgid, dt_get_wtime());
+  dt_pthread_mutex_unlock(&_pending_mutex);
+
+  // synchronize the sidecar immediately instead of queueing it for background write
+  if(!background)
+    dt_image_write_sidecar_file(imgid);
 }
 
 void dt_sidecar_synch_enqueue_list(const GList *imgs)
 {
   if(!imgs)
     return;
-  if(!background_running)
+
+  gboolean background = FALSE;
+  if(_pending)
+  {
+    dt_pthread_mutex_lock(&_pending_mutex);
+    background = _background_running;
+    if(background)
+    {
+      const double now = dt_get_wtime();
+      for(const GList *ilist = imgs; ilist; ilist = g_list_next(ilist))
+        _enqueue(GPOINTER_TO_INT(ilist->data), now);
+    }
+    dt_pthread_mutex_unlock(&_pending_mutex);
+  }
+
+  if(!background)
   {
     // synchronize the sidecars immediately instead of queueing them for background write
     for(const GList *ilist = imgs; ilist; ilist = g_list_next(ilist))
     {
       dt_image_write_sidecar_file(GPOINTER_TO_INT(ilist->data));
     }
-    return;
   }
-  GSList *new_imgs = NULL;
-  for(const GList *ilist = imgs; ilist; ilist = g_list_next(ilist))
+}
+
+void dt_sidecar_synch_flush()
+{
+  if(!_pending) return;
+
+  dt_pthread_mutex_lock(&_pending_mutex);
+  _flush = _background_running && g_hash_table_size(_pending) > 0;
+  dt_pthread_mutex_unlock(&_pending_mutex);
+}
+
+void dt_sidecar_synch_get_stats(dt_sidecar_synch_stats_t *stats)
+{
+  if(!_pending)
   {
-    new_imgs = g_slist_prepend(new_imgs,ilist->data);
+    memset(stats, 0, sizeof(dt_sidecar_synch_stats_t));
+    return;
   }
-  GSList *last = g_slist_last(new_imgs);
-#ifdef _OPENMP
-#pragma omp atomic capture
-  { last->next = pending_images; pending_images = new_imgs; }
-#else
-  // don't have atomics, so use locks instead
-  _lock_pending_queue();
-  last->next = pending_images;
-  pending_images = new_imgs;
-  _unlock_pending_queue();
-#endif
+
+  dt_pthread_mutex_lock(&_pending_mutex);
+  *stats = _stats;
+  stats->pending = g_hash_table_size(_pending);
+  dt_pthread_mutex_unlock(&_pending_mutex);
 }
 
 void dt_control_sidecar_synch_start()
@@ -172,8 +253,10 @@ void dt_control_sidecar_synch_start()
   {
     return;
   }
+  dt_pthread_mutex_init(&_pending_mutex, NULL);
+  _background_running = TRUE;
+  _pending = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
   dt_control_add_job(darktable.control, DT_JOB_QUEUE_SYSTEM_FG, job);
-  background_running = TRUE;
 }
 
 // clang-format off
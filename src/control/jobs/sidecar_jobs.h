@@ -21,8 +21,24 @@
 #include "control/control.h"
 #include "imageio/imageio_module.h"
 
+typedef struct dt_sidecar_synch_stats_t
+{
+  uint32_t pending;   // images waiting for their sidecar to be written
+  uint64_t requested; // write requests received
+  uint64_t coalesced; // requests merged into an already pending write
+  uint64_t written;   // sidecars written
+  uint64_t batches;
+  double latency_sum; // secs from the first request to the write, summed over all writes
+  double latency_max;
+} dt_sidecar_synch_stats_t;
+
+/** queue the sidecar of imgid for writing. repeated requests for the
+ * same image are merged into a single write. */
 void dt_sidecar_synch_enqueue(dt_imgid_t imgid);
 void dt_sidecar_synch_enqueue_list(const GList *imgs);
+/** write all queued sidecars now instead of waiting for more changes */
+void dt_sidecar_synch_flush();
+void dt_sidecar_synch_get_stats(dt_sidecar_synch_stats_t *stats);
 void dt_control_sidecar_synch_start();
 
 // clang-format off
@@ -218,6 +218,20 @@ void dt_develop_blendif_process_parameters(float *const restrict parameters,
   }
 }
 
+uint32_t dt_develop_blendif_full_span_channels(const float *const parameters)
+{
+  uint32_t full_span = 0;
+  for(size_t i = 0, j = 0;
+      i < DEVELOP_BLENDIF_SIZE;
+      i++, j += DEVELOP_BLENDIF_PARAMETER_ITEMS)
+  {
+    if(parameters[j + 0] == -FLT_MAX && parameters[j + 1] == -FLT_MAX
+       && parameters[j + 2] == FLT_MAX && parameters[j + 3] == FLT_MAX)
+      full_span |= 1u << i;
+  }
+  return full_span;
+}
+
 // See function definition in blend.h for important information
 gboolean dt_develop_blendif_init_masking_profile(dt_dev_pixelpipe_iop_t *piece,
                                                  dt_iop_order_iccprofile_info_t *blending_profile,
@@ -418,6 +418,10 @@ gboolean dt_develop_blend_legacy_params_from_so(dt_iop_module_so_t *module_so,
 void dt_develop_blendif_process_parameters(float *const parameters,
                                            const dt_develop_blend_params_t *const params);
 
+/** returns the channels whose processed parameters select the whole span, the
+ * factor of such a channel is one for every pixel (or zero if inverted) */
+uint32_t dt_develop_blendif_full_span_channels(const float *const parameters);
+
 /**
  * Set up a profile adapted to the blending.
  *
@@ -524,7 +528,40 @@ gboolean dt_develop_blend_process_cl(dt_iop_module_t *self,
                                      const dt_iop_roi_t *roi_out);
 #endif
 
-#define _BLEND_FUNC_PROTO(align, uni) DT_OMP_DECLARE_SIMD(aligned align uniform uni) static void
+#define _BLEND_FUNC_PROTO(align, uni) DT_OMP_DECLARE_SIMD(aligned align uniform uni) static inline void
+
+/* blend the rows of a, starting at (xoffs, yoffs), with the ones of tmp into b. tmp may be b for
+   operators allowing it. p is the blend parameter of the operators taking one. */
+typedef void(_blend_image_func)(const float *const a,
+                                const float *const tmp,
+                                float *const b,
+                                const float *const mask,
+                                const int iwidth,
+                                const int xoffs,
+                                const int yoffs,
+                                const int owidth,
+                                const int oheight,
+                                const gboolean reverse,
+                                const float p);
+
+// instantiate the loop over the rows for a blend operator, the operator gets inlined and specialised into it
+// instead of being called through a function pointer for every row. ch is the number of channels, further
+// arguments are passed on to the operator after the row width (e.g. a constant clipping range).
+#define _BLEND_IMAGE_FUNC(blend, ch, ...)                                                                    \
+  static void blend##_image(const float *const a, const float *const tmp, float *const b,                    \
+                            const float *const restrict mask, const int iwidth, const int xoffs,             \
+                            const int yoffs, const int owidth, const int oheight, const gboolean reverse,    \
+                            const float p)                                                                   \
+  {                                                                                                          \
+    DT_OMP_FOR()                                                                                             \
+    for(size_t y = 0; y < oheight; y++)                                                                      \
+    {                                                                                                        \
+      const float *const in = a + ((y + yoffs) * iwidth + xoffs) * (ch);                                     \
+      const size_t row = y * owidth;                                                                         \
+      blend(reverse ? tmp + row * (ch) : in, reverse ? in : tmp + row * (ch), b + row * (ch), mask + row,    \
+            owidth, ##__VA_ARGS__);                                                                          \
+    }                                                                                                        \
+  }
 
 G_END_DECLS
 
@@ -33,9 +33,8 @@
 #include <math.h>
 
 
-typedef void(_blend_row_func)(const float *const restrict a, const float *const restrict b,
-                              float *const restrict out, const float *const restrict mask, const size_t stride);
 #define _BLEND_FUNC _BLEND_FUNC_PROTO((a, b, out: 16), (stride))
+#define _BLEND_IMAGE(blend) _BLEND_IMAGE_FUNC(blend, 1)
 
 void dt_develop_blendif_raw_make_mask(dt_dev_pixelpipe_iop_t *piece,
                                       const float *const restrict a,
@@ -326,64 +325,81 @@ _BLEND_FUNC _blend_pinlight(const float *const restrict a,
 }
 
 
-static _blend_row_func *_choose_blend_func(const unsigned int blend_mode)
+_BLEND_IMAGE(_blend_normal_bounded)
+_BLEND_IMAGE(_blend_normal_unbounded)
+_BLEND_IMAGE(_blend_lighten)
+_BLEND_IMAGE(_blend_darken)
+_BLEND_IMAGE(_blend_multiply)
+_BLEND_IMAGE(_blend_average)
+_BLEND_IMAGE(_blend_add)
+_BLEND_IMAGE(_blend_subtract)
+_BLEND_IMAGE(_blend_difference)
+_BLEND_IMAGE(_blend_screen)
+_BLEND_IMAGE(_blend_overlay)
+_BLEND_IMAGE(_blend_softlight)
+_BLEND_IMAGE(_blend_hardlight)
+_BLEND_IMAGE(_blend_vividlight)
+_BLEND_IMAGE(_blend_linearlight)
+_BLEND_IMAGE(_blend_pinlight)
+
+static _blend_image_func *_choose_blend_func(const unsigned int blend_mode)
 {
-  _blend_row_func *blend = NULL;
+  _blend_image_func *blend = NULL;
 
   /* select the blend operator */
   switch(blend_mode & DEVELOP_BLEND_MODE_MASK)
   {
     case DEVELOP_BLEND_LIGHTEN:
-      blend = _blend_lighten;
+      blend = _blend_lighten_image;
       break;
     case DEVELOP_BLEND_DARKEN:
-      blend = _blend_darken;
+      blend = _blend_darken_image;
       break;
     case DEVELOP_BLEND_MULTIPLY:
-      blend = _blend_multiply;
+      blend = _blend_multiply_image;
       break;
     case DEVELOP_BLEND_AVERAGE:
-      blend = _blend_average;
+      blend = _blend_average_image;
       break;
     case DEVELOP_BLEND_ADD:
-      blend = _blend_add;
+      blend = _blend_add_image;
       break;
     case DEVELOP_BLEND_SUBTRACT:
-      blend = _blend_subtract;
+      blend = _blend_subtract_image;
       break;
     case DEVELOP_BLEND_DIFFERENCE:
     case DEVELOP_BLEND_DIFFERENCE2:
-      blend = _blend_difference;
+      blend = _blend_difference_image;
       break;
     case DEVELOP_BLEND_SCREEN:
-      blend = _blend_screen;
+      blend = _blend_screen_image;
       break;
     case DEVELOP_BLEND_OVERLAY:
-      blend = _blend_overlay;
+      blend = _blend_overlay_image;
       break;
     case DEVELOP_BLEND_SOFTLIGHT:
-      blend = _blend_softlight;
+      blend = _blend_softlight_image;
       break;
     case DEVELOP_BLEND_HARDLIGHT:
-      blend = _blend_hardlight;
+      blend = _blend_hardlight_image;
       break;
     case DEVELOP_BLEND_VIVIDLIGHT:
-      blend = _blend_vividlight;
+      blend = _blend_vividlight_image;
       break;
     case DEVELOP_BLEND_LINEARLIGHT:
-      blend = _blend_linearlight;
+      blend = _blend_linearlight_image;
       break;
     case DEVELOP_BLEND_PINLIGHT:
-      blend = _blend_pinlight;
+      blend = _blend_pinlight_image;
       break;
     case DEVELOP_BLEND_BOUNDED:
-      blend = _blend_normal_bounded;
+      blend = _blend_normal_bounded_image;
       break;
 
     /* fallback to normal blend */
     case DEVELOP_BLEND_NORMAL2:
     default:
-      blend = _blend_normal_unbounded;
+      blend = _blend_normal_unbounded_image;
       break;
   }
 
@@ -415,32 +431,14 @@ void dt_develop_blendif_raw_blend(dt_dev_pixelpipe_iop_t *piece,
   }
   else
   {
-    _blend_row_func *const blend = _choose_blend_func(d->blend_mode);
+    _blend_image_func *const blend = _choose_blend_func(d->blend_mode);
 
     float *tmp_buffer = dt_alloc_align_float((size_t)owidth * oheight);
     if(tmp_buffer != NULL)
     {
       dt_iop_image_copy(tmp_buffer, b, (size_t)owidth * oheight);
-      if((d->blend_mode & DEVELOP_BLEND_REVERSE) == DEVELOP_BLEND_REVERSE)
-      {
-        DT_OMP_FOR()
-        for(size_t y = 0; y < oheight; y++)
-        {
-          const size_t a_start = (y + yoffs) * iwidth + xoffs;
-          const size_t bm_start = y * owidth;
-          blend(tmp_buffer + bm_start, a + a_start, b + bm_start, mask + bm_start, owidth);
-        }
-      }
-      else
-      {
-        DT_OMP_FOR()
-        for(size_t y = 0; y < oheight; y++)
-        {
-          const size_t a_start = (y + yoffs) * iwidth + xoffs;
-          const size_t bm_start = y * owidth;
-          blend(a + a_start, tmp_buffer + bm_start, b + bm_start, mask + bm_start, owidth);
-        }
-      }
+      blend(a, tmp_buffer, b, mask, iwidth, xoffs, yoffs, owidth, oheight,
+            (d->blend_mode & DEVELOP_BLEND_REVERSE) == DEVELOP_BLEND_REVERSE, 0.0f);
       dt_free_align(tmp_buffer);
     }
   }
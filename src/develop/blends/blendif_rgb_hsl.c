@@ -37,12 +37,8 @@
 #define DT_BLENDIF_RGB_BCH 3
 
 
-typedef void(_blend_row_func)(const float *const a,
-                              const float *const b,
-                              float *const out,
-                              const float *const restrict mask,
-                              const size_t stride);
 #define _BLEND_FUNC _BLEND_FUNC_PROTO((a, b, out: 16), (stride))
+#define _BLEND_IMAGE(blend) _BLEND_IMAGE_FUNC(blend, DT_BLENDIF_RGB_CH)
 
 DT_OMP_DECLARE_SIMD(aligned(XYZ: 16))
 static inline void _CLAMP_XYZ(float *const restrict XYZ)
@@ -246,15 +242,23 @@ void dt_develop_blendif_rgb_hsl_make_mask(dt_dev_pixelpipe_iop_t *piece,
   const int owidth = roi_out->width;
   const int oheight = roi_out->height;
 
-  const unsigned int any_channel_active = d->blendif & DEVELOP_BLENDIF_RGB_MASK;
   const unsigned int mask_inclusive = d->mask_combine & DEVELOP_COMBINE_INCL;
   const unsigned int mask_inversed = d->mask_combine & DEVELOP_COMBINE_INV;
 
+  // parameters, for every channel the 4 limits + pre-computed increasing slope and decreasing slope
+  float parameters[DEVELOP_BLENDIF_PARAMETER_ITEMS * DEVELOP_BLENDIF_SIZE] DT_ALIGNED_ARRAY;
+  dt_develop_blendif_process_parameters(parameters, d);
+  const unsigned int full_span = dt_develop_blendif_full_span_channels(parameters);
+
   // invert the individual channels if the combine mode is inclusive
   const unsigned int blendif = d->blendif ^ (mask_inclusive ? DEVELOP_BLENDIF_RGB_MASK << 16 : 0);
 
   // a channel cancels the mask if the whole span is selected and the channel is inverted
-  const unsigned int canceling_channel = (blendif >> 16) & ~blendif & DEVELOP_BLENDIF_RGB_MASK;
+  const unsigned int canceling_channel = (blendif >> 16) & (~blendif | full_span) & DEVELOP_BLENDIF_RGB_MASK;
+
+  // a channel selecting the whole span without being inverted leaves the mask as it is, skip it
+  const unsigned int active = blendif & ~full_span;
+  const unsigned int any_channel_active = active & DEVELOP_BLENDIF_RGB_MASK;
 
   const size_t buffsize = (size_t)owidth * oheight;
 
@@ -287,10 +291,6 @@ void dt_develop_blendif_rgb_hsl_make_mask(dt_dev_pixelpipe_iop_t *piece,
   {
     // we need to process all conditional channels
 
-    // parameters, for every channel the 4 limits + pre-computed increasing slope and decreasing slope
-    float parameters[DEVELOP_BLENDIF_PARAMETER_ITEMS * DEVELOP_BLENDIF_SIZE] DT_ALIGNED_ARRAY;
-    dt_develop_blendif_process_parameters(parameters, d);
-
     dt_iop_order_iccprofile_info_t blend_profile;
     const gboolean use_profile = dt_develop_blendif_init_masking_profile(piece, &blend_profile,
                                                                     DEVELOP_BLEND_CS_RGB_DISPLAY);
@@ -305,7 +305,8 @@ void dt_develop_blendif_rgb_hsl_make_mask(dt_dev_pixelpipe_iop_t *piece,
 
     DT_OMP_PRAGMA(parallel default(none)
                   dt_omp_firstprivate(temp_mask, mask, a, b, oheight, owidth, iwidth, yoffs, xoffs, buffsize,
-                                      blendif, profile, parameters, mask_inclusive, mask_inversed, global_opacity))
+                                      active, any_channel_active, profile, parameters,
+                                      mask_inclusive, mask_inversed, global_opacity))
     {
       // flush denormals to zero to avoid performance penalty if there are a lot of zero values in the mask
       const int oldMode = dt_mm_enable_flush_zero();
@@ -315,19 +316,26 @@ void dt_develop_blendif_rgb_hsl_make_mask(dt_dev_pixelpipe_iop_t *piece,
       for(size_t x = 0; x < buffsize; x++) temp_mask[x] = 1.0f;
 
       // combine channels
-      DT_OMP_PRAGMA(for schedule(static))
-      for(size_t y = 0; y < oheight; y++)
+      if(any_channel_active & ~DEVELOP_BLENDIF_OUTPUT_MASK)
       {
-        const size_t start = ((y + yoffs) * iwidth + xoffs) * DT_BLENDIF_RGB_CH;
-        _blendif_combine_channels(a + start, temp_mask + (y * owidth), owidth, blendif, parameters, profile);
+        DT_OMP_PRAGMA(for schedule(static))
+        for(size_t y = 0; y < oheight; y++)
+        {
+          const size_t start = ((y + yoffs) * iwidth + xoffs) * DT_BLENDIF_RGB_CH;
+          _blendif_combine_channels(a + start, temp_mask + (y * owidth), owidth, active, parameters, profile);
+        }
       }
-      DT_OMP_PRAGMA(for schedule(static))
-      for(size_t y = 0; y < oheight; y++)
+      if(any_channel_active & DEVELOP_BLENDIF_OUTPUT_MASK)
       {
-        const size_t start = (y * owidth) * DT_BLENDIF_RGB_CH;
-        _blendif_combine_channels(b + start, temp_mask + (y * owidth), owidth, blendif >> DEVELOP_BLENDIF_GRAY_out,
-                                  parameters + DEVELOP_BLENDIF_PARAMETER_ITEMS * DEVELOP_BLENDIF_GRAY_out,
-                                  profile);
+        DT_OMP_PRAGMA(for schedule(static))
+        for(size_t y = 0; y < oheight; y++)
+        {
+          const size_t start = (y * owidth) * DT_BLENDIF_RGB_CH;
+          _blendif_combine_channels(b + start, temp_mask + (y * owidth), owidth,
+                                    active >> DEVELOP_BLENDIF_GRAY_out,
+                                    parameters + DEVELOP_BLENDIF_PARAMETER_ITEMS * DEVELOP_BLENDIF_GRAY_out,
+                                    profile);
+        }
       }
 
       // apply global opacity
@@ -986,94 +994,121 @@ _BLEND_FUNC _blend_RGB_B(const float *const a,
 }
 
 
-static _blend_row_func *_choose_blend_func(const unsigned int blend_mode)
+_BLEND_IMAGE(_blend_normal_bounded)
+_BLEND_IMAGE(_blend_normal_unbounded)
+_BLEND_IMAGE(_blend_lighten)
+_BLEND_IMAGE(_blend_darken)
+_BLEND_IMAGE(_blend_multiply)
+_BLEND_IMAGE(_blend_average)
+_BLEND_IMAGE(_blend_add)
+_BLEND_IMAGE(_blend_subtract)
+_BLEND_IMAGE(_blend_difference)
+_BLEND_IMAGE(_blend_screen)
+_BLEND_IMAGE(_blend_overlay)
+_BLEND_IMAGE(_blend_softlight)
+_BLEND_IMAGE(_blend_hardlight)
+_BLEND_IMAGE(_blend_vividlight)
+_BLEND_IMAGE(_blend_linearlight)
+_BLEND_IMAGE(_blend_pinlight)
+_BLEND_IMAGE(_blend_lightness)
+_BLEND_IMAGE(_blend_chromaticity)
+_BLEND_IMAGE(_blend_hue)
+_BLEND_IMAGE(_blend_color)
+_BLEND_IMAGE(_blend_coloradjust)
+_BLEND_IMAGE(_blend_HSV_value)
+_BLEND_IMAGE(_blend_HSV_color)
+_BLEND_IMAGE(_blend_RGB_R)
+_BLEND_IMAGE(_blend_RGB_G)
+_BLEND_IMAGE(_blend_RGB_B)
+
+static _blend_image_func *_choose_blend_func(const unsigned int blend_mode)
 {
-  _blend_row_func *blend = NULL;
+  _blend_image_func *blend = NULL;
 
   /* select the blend operator */
   switch(blend_mode & DEVELOP_BLEND_MODE_MASK)
   {
     case DEVELOP_BLEND_LIGHTEN:
-      blend = _blend_lighten;
+      blend = _blend_lighten_image;
       break;
     case DEVELOP_BLEND_DARKEN:
-      blend = _blend_darken;
+      blend = _blend_darken_image;
       break;
     case DEVELOP_BLEND_MULTIPLY:
-      blend = _blend_multiply;
+      blend = _blend_multiply_image;
       break;
     case DEVELOP_BLEND_AVERAGE:
-      blend = _blend_average;
+      blend = _blend_average_image;
       break;
     case DEVELOP_BLEND_ADD:
-      blend = _blend_add;
+      blend = _blend_add_image;
       break;
     case DEVELOP_BLEND_SUBTRACT:
-      blend = _blend_subtract;
+      blend = _blend_subtract_image;
       break;
     case DEVELOP_BLEND_DIFFERENCE:
     case DEVELOP_BLEND_DIFFERENCE2:
-      blend = _blend_difference;
+      blend = _blend_difference_image;
       break;
     case DEVELOP_BLEND_SCREEN:
-      blend = _blend_screen;
+      blend = _blend_screen_image;
       break;
     case DEVELOP_BLEND_OVERLAY:
-      blend = _blend_overlay;
+      blend = _blend_overlay_image;
       break;
     case DEVELOP_BLEND_SOFTLIGHT:
-      blend = _blend_softlight;
+      blend = _blend_softlight_image;
       break;
     case DEVELOP_BLEND_HARDLIGHT:
-      blend = _blend_hardlight;
+      blend = _blend_hardlight_image;
       break;
     case DEVELOP_BLEND_VIVIDLIGHT:
-      blend = _blend_vividlight;
+      blend = _blend_vividlight_image;
       break;
     case DEVELOP_BLEND_LINEARLIGHT:
-      blend = _blend_linearlight;
+      blend = _blend_linearlight_image;
       break;
     case DEVELOP_BLEND_PINLIGHT:
-      blend = _blend_pinlight;
+      blend = _blend_pinlight_image;
       break;
     case DEVELOP_BLEND_LIGHTNESS:
-      blend = _blend_lightness;
+      blend = _blend_lightness_image;
       break;
     case DEVELOP_BLEND_CHROMATICITY:
-      blend = _blend_chromaticity;
+      blend = _blend_chromaticity_image;
       break;
     case DEVELOP_BLEND_HUE:
-      blend = _blend_hue;
+      blend = _blend_hue_image;
       break;
     case DEVELOP_BLEND_COLOR:
-      blend = _blend_color;
+      blend = _blend_color_image;
       break;
     case DEVELOP_BLEND_BOUNDED:
-      blend = _blend_normal_bounded;
+      blend = _blend_normal_bounded_image;
       break;
     case DEVELOP_BLEND_COLORADJUST:
-      blend = _blend_coloradjust;
+      blend = _blend_coloradjust_image;
       break;
     case DEVELOP_BLEND_HSV_VALUE:
-      blend = _blend_HSV_value;
+      blend = _blend_HSV_value_image;
       break;
     case DEVELOP_BLEND_HSV_COLOR:
-      blend = _blend_HSV_color;
+      blend = _blend_HSV_color_image;
       break;
     case DEVELOP_BLEND_RGB_R:
-      blend = _blend_RGB_R;
+      blend = _blend_RGB_R_image;
       break;
     case DEVELOP_BLEND_RGB_G:
-      blend = _blend_RGB_G;
+      blend = _blend_RGB_G_image;
       break;
     case DEVELOP_BLEND_RGB_B:
-      blend = _blend_RGB_B;
+      blend = _blend_RGB_B_image;
       break;
 
     /* fallback to normal blend */
     case DEVELOP_BLEND_NORMAL2:
     default:
-      blend = _blend_normal_unbounded;
+      blend = _blend_normal_unbounded_image;
       break;
   }
 
@@ -1320,30 +1355,9 @@ void dt_develop_blendif_rgb_hsl_blend(dt_dev_pixelpipe_iop_t *piece,
   }
   else
   {
-    _blend_row_func *const blend = _choose_blend_func(d->blend_mode);
-
-    if((d->blend_mode & DEVELOP_BLEND_REVERSE) == DEVELOP_BLEND_REVERSE)
-    {
-      DT_OMP_FOR()
-      for(size_t y = 0; y < oheight; y++)
-      {
-        const size_t a_start = ((y + yoffs) * iwidth + xoffs) * DT_BLENDIF_RGB_CH;
-        const size_t b_start = y * owidth * DT_BLENDIF_RGB_CH;
-        const size_t m_start = y * owidth;
-        blend(b + b_start, a + a_start, b + b_start, mask + m_start, owidth);
-      }
-    }
-    else
-    {
-      DT_OMP_FOR()
-      for(size_t y = 0; y < oheight; y++)
-      {
-        const size_t a_start = ((y + yoffs) * iwidth + xoffs) * DT_BLENDIF_RGB_CH;
-        const size_t b_start = y * owidth * DT_BLENDIF_RGB_CH;
-        const size_t m_start = y * owidth;
-        blend(a + a_start, b + b_start, b + b_start, mask + m_start, owidth);
-      }
-    }
+    _blend_image_func *const blend = _choose_blend_func(d->blend_mode);
+    blend(a, b, b, mask, iwidth, xoffs, yoffs, owidth, oheight,
+          (d->blend_mode & DEVELOP_BLEND_REVERSE) == DEVELOP_BLEND_REVERSE, 0.0f);
   }
 
   if(mask_display & DT_DEV_PIXELPIPE_DISPLAY_MASK)
@@ -36,13 +36,8 @@
 #define DT_BLENDIF_RGB_BCH 3
 
 
-typedef void(_blend_row_func)(const float *const a,
-                              const float *const b,
-                              const float p,
-                              float *const out,
-                              const float *const restrict mask,
-                              const size_t stride);
 #define _BLEND_FUNC _BLEND_FUNC_PROTO((a, b, out: 16), (p, stride))
+#define _BLEND_IMAGE(blend) _BLEND_IMAGE_FUNC(blend, DT_BLENDIF_RGB_CH, p)
 
 DT_OMP_DECLARE_SIMD(uniform(parameters, invert_mask))
 static inline float _blendif_compute_factor(const float value,
@@ -229,15 +224,23 @@ void dt_develop_blendif_rgb_jzczhz_make_mask(dt_dev_pixelpipe_iop_t *piece,
   const int owidth = roi_out->width;
   const int oheight = roi_out->height;
 
-  const unsigned int any_channel_active = d->blendif & DEVELOP_BLENDIF_RGB_MASK;
   const unsigned int mask_inclusive = d->mask_combine & DEVELOP_COMBINE_INCL;
   const unsigned int mask_inversed = d->mask_combine & DEVELOP_COMBINE_INV;
 
+  // parameters, for every channel the 4 limits + pre-computed increasing slope and decreasing slope
+  float parameters[DEVELOP_BLENDIF_PARAMETER_ITEMS * DEVELOP_BLENDIF_SIZE] DT_ALIGNED_ARRAY;
+  dt_develop_blendif_process_parameters(parameters, d);
+  const unsigned int full_span = dt_develop_blendif_full_span_channels(parameters);
+
   // invert the individual channels if the combine mode is inclusive
   const unsigned int blendif = d->blendif ^ (mask_inclusive ? DEVELOP_BLENDIF_RGB_MASK << 16 : 0);
 
   // a channel cancels the mask if the whole span is selected and the channel is inverted
-  const unsigned int canceling_channel = (blendif >> 16) & ~blendif & DEVELOP_BLENDIF_RGB_MASK;
+  const unsigned int canceling_channel = (blendif >> 16) & (~blendif | full_span) & DEVELOP_BLENDIF_RGB_MASK;
+
+  // a channel selecting the whole span without being inverted leaves the mask as it is, skip it
+  const unsigned int active = blendif & ~full_span;
+  const unsigned int any_channel_active = active & DEVELOP_BLENDIF_RGB_MASK;
 
   const size_t buffsize = (size_t)owidth * oheight;
 
@@ -270,10 +273,6 @@ void dt_develop_blendif_rgb_jzczhz_make_mask(dt_dev_pixelpipe_iop_t *piece,
   {
     // we need to process all conditional channels
 
-    // parameters, for every channel the 4 limits + pre-computed increasing slope and decreasing slope
-    float parameters[DEVELOP_BLENDIF_PARAMETER_ITEMS * DEVELOP_BLENDIF_SIZE] DT_ALIGNED_ARRAY;
-    dt_develop_blendif_process_parameters(parameters, d);
-
     dt_iop_order_iccprofile_info_t blend_profile;
     if(!dt_develop_blendif_init_masking_profile(piece, &blend_profile, DEVELOP_BLEND_CS_RGB_SCENE))
     {
@@ -290,7 +289,8 @@ void dt_develop_blendif_rgb_jzczhz_make_mask(dt_dev_pixelpipe_iop_t *piece,
 
     DT_OMP_PRAGMA(parallel default(none)
                   dt_omp_firstprivate(temp_mask, mask, a, b, oheight, owidth, iwidth, yoffs, xoffs, buffsize,
-                                      blendif, profile, parameters, mask_inclusive, mask_inversed, global_opacity))
+                                      active, any_channel_active, profile, parameters,
+                                      mask_inclusive, mask_inversed, global_opacity))
     {
       // flush denormals to zero to avoid performance penalty if there are a lot of zero values in the mask
       const int oldMode = dt_mm_enable_flush_zero();
@@ -300,19 +300,26 @@ void dt_develop_blendif_rgb_jzczhz_make_mask(dt_dev_pixelpipe_iop_t *piece,
       for(size_t x = 0; x < buffsize; x++) temp_mask[x] = 1.0f;
 
       // combine channels
-      DT_OMP_PRAGMA(for schedule(static))
-      for(size_t y = 0; y < oheight; y++)
+      if(any_channel_active & ~DEVELOP_BLENDIF_OUTPUT_MASK)
       {
-        const size_t start = ((y + yoffs) * iwidth + xoffs) * DT_BLENDIF_RGB_CH;
-        _blendif_combine_channels(a + start, temp_mask + (y * owidth), owidth, blendif, parameters, profile);
+        DT_OMP_PRAGMA(for schedule(static))
+        for(size_t y = 0; y < oheight; y++)
+        {
+          const size_t start = ((y + yoffs) * iwidth + xoffs) * DT_BLENDIF_RGB_CH;
+          _blendif_combine_channels(a + start, temp_mask + (y * owidth), owidth, active, parameters, profile);
+        }
       }
-      DT_OMP_PRAGMA(for schedule(static))
-      for(size_t y = 0; y < oheight; y++)
+      if(any_channel_active & DEVELOP_BLENDIF_OUTPUT_MASK)
       {
-        const size_t start = (y * owidth) * DT_BLENDIF_RGB_CH;
-        _blendif_combine_channels(b + start, temp_mask + (y * owidth), owidth, blendif >> DEVELOP_BLENDIF_GRAY_out,
-                                  parameters + DEVELOP_BLENDIF_PARAMETER_ITEMS * DEVELOP_BLENDIF_GRAY_out,
-                                  profile);
+        DT_OMP_PRAGMA(for schedule(static))
+        for(size_t y = 0; y < oheight; y++)
+        {
+          const size_t start = (y * owidth) * DT_BLENDIF_RGB_CH;
+          _blendif_combine_channels(b + start, temp_mask + (y * owidth), owidth,
+                                    active >> DEVELOP_BLENDIF_GRAY_out,
+                                    parameters + DEVELOP_BLENDIF_PARAMETER_ITEMS * DEVELOP_BLENDIF_GRAY_out,
+                                    profile);
+        }
       }
 
       // apply global opacity
@@ -354,10 +361,10 @@ void dt_develop_blendif_rgb_jzczhz_make_mask(dt_dev_pixelpipe_iop_t *piece,
 /* normal blend without any clamping */
 _BLEND_FUNC _blend_normal(const float *const a,
                           const float *const b,
-                          const float p,
                           float *const out,
                           const float *const restrict mask,
-                          const size_t stride)
+                          const size_t stride,
+                          const float p)
 {
   for(size_t i = 0, j = 0; i < stride; i++, j += DT_BLENDIF_RGB_CH)
   {
@@ -373,10 +380,10 @@ _BLEND_FUNC _blend_normal(const float *const a,
 /* multiply */
 _BLEND_FUNC _blend_multiply(const float *const a,
                             const float *const b,
-                            const float p,
                             float *const out,
                             const float *const restrict mask,
-                            const size_t stride)
+                            const size_t stride,
+                            const float p)
 {
   for(size_t i = 0, j = 0; i < stride; i++, j += DT_BLENDIF_RGB_CH)
   {
@@ -392,10 +399,10 @@ _BLEND_FUNC _blend_multiply(const float *const a,
 /* add */
 _BLEND_FUNC _blend_add(const float *const a,
                        const float *const b,
-                       const float p,
                        float *const out,
                        const float *const restrict mask,
-                       const size_t stride)
+                       const size_t stride,
+                       const float p)
 {
   for(size_t i = 0, j = 0; i < stride; i++, j += DT_BLENDIF_RGB_CH)
   {
@@ -411,10 +418,10 @@ _BLEND_FUNC _blend_add(const float *const a,
 /* subtract */
 _BLEND_FUNC _blend_subtract(const float *const a,
                             const float *const b,
-                            const float p,
                             float *const out,
                             const float *const restrict mask,
-                            const size_t stride)
+                            const size_t stride,
+                            const float p)
 {
   for(size_t i = 0, j = 0; i < stride; i++, j += DT_BLENDIF_RGB_CH)
   {
@@ -430,10 +437,10 @@ _BLEND_FUNC _blend_subtract(const float *const a,
 /* subtract inverse */
 _BLEND_FUNC _blend_subtract_inverse(const float *const a,
                                     const float *const b,
-                                    const float p,
                                     float *const out,
                                     const float *const restrict mask,
-                                    const size_t stride)
+                                    const size_t stride,
+                                    const float p)
 {
   for(size_t i = 0, j = 0; i < stride; i++, j += DT_BLENDIF_RGB_CH)
   {
@@ -449,10 +456,10 @@ _BLEND_FUNC _blend_subtract_inverse(const float *const a,
 /* difference */
 _BLEND_FUNC _blend_difference(const float *const a,
                               const float *const b,
-                              const float p,
                               float *const out,
                               const float *const restrict mask,
-                              const size_t stride)
+                              const size_t stride,
+                              const float p)
 {
   for(size_t i = 0, j = 0; i < stride; i++, j += DT_BLENDIF_RGB_CH)
   {
@@ -468,10 +475,10 @@ _BLEND_FUNC _blend_difference(const float *const a,
 /* divide */
 _BLEND_FUNC _blend_divide(const float *const a,
                           const float *const b,
-                          const float p,
                           float *const out,
                           const float *const restrict mask,
-                          const size_t stride)
+                          const size_t stride,
+                          const float p)
 {
   for(size_t i = 0, j = 0; i < stride; i++, j += DT_BLENDIF_RGB_CH)
   {
@@ -487,10 +494,10 @@ _BLEND_FUNC _blend_divide(const float *const a,
 /* divide inverse */
 _BLEND_FUNC _blend_divide_inverse(const float *const a,
                                   const float *const b,
-                                  const float p,
                                   float *const out,
                                   const float *const restrict mask,
-                                  const size_t stride)
+                                  const size_t stride,
+                                  const float p)
 {
   for(size_t i = 0, j = 0; i < stride; i++, j += DT_BLENDIF_RGB_CH)
   {
@@ -506,10 +513,10 @@ _BLEND_FUNC _blend_divide_inverse(const float *const a,
 /* average */
 _BLEND_FUNC _blend_average(const float *const a,
                            const float *const b,
-                           const float p,
                            float *const out,
                            const float *const restrict mask,
-                           const size_t stride)
+                           const size_t stride,
+                           const float p)
 {
   for(size_t i = 0, j = 0; i < stride; i++, j += DT_BLENDIF_RGB_CH)
   {
@@ -525,10 +532,10 @@ _BLEND_FUNC _blend_average(const float *const a,
 /* geometric mean */
 _BLEND_FUNC _blend_geometric_mean(const float *const a,
                                   const float *const b,
-                                  const float p,
                                   float *const out,
                                   const float *const restrict mask,
-                                  const size_t stride)
+                                  const size_t stride,
+                                  const float p)
 {
   for(size_t i = 0, j = 0; i < stride; i++, j += DT_BLENDIF_RGB_CH)
   {
@@ -544,10 +551,10 @@ _BLEND_FUNC _blend_geometric_mean(const float *const a,
 /* harmonic mean */
 _BLEND_FUNC _blend_harmonic_mean(const float *const a,
                                  const float *const b,
-                                 const float p,
                                  float *const out,
                                  const float *const restrict mask,
-                                 const size_t stride)
+                                 const size_t stride,
+                                 const float p)
 {
   for(size_t i = 0, j = 0; i < stride; i++, j += DT_BLENDIF_RGB_CH)
   {
@@ -565,10 +572,10 @@ _BLEND_FUNC _blend_harmonic_mean(const float *const a,
 /* chromaticity */
 _BLEND_FUNC _blend_chromaticity(const float *const a,
                                 const float *const b,
-                                const float p,
                                 float *const out,
                                 const float *const restrict mask,
-                                const size_t stride)
+                                const size_t stride,
+                                const float p)
 {
   for(size_t i = 0, j = 0; i < stride; i++, j += DT_BLENDIF_RGB_CH)
   {
@@ -586,10 +593,10 @@ _BLEND_FUNC _blend_chromaticity(const float *const a,
 /* luminance */
 _BLEND_FUNC _blend_luminance(const float *const a,
                              const float *const b,
-                             const float p,
                              float *const out,
                              const float *const restrict mask,
-                             const size_t stride)
+                             const size_t stride,
+                             const float p)
 {
   for(size_t i = 0, j = 0; i < stride; i++, j += DT_BLENDIF_RGB_CH)
   {
@@ -607,10 +614,10 @@ _BLEND_FUNC _blend_luminance(const float *const a,
 /* blend only R-channel in RGB color space without any clamping */
 _BLEND_FUNC _blend_RGB_R(const float *const a,
                          const float *const b,
-                         const float p,
                          float *const out,
                          const float *const restrict mask,
-                         const size_t stride)
+                         const size_t stride,
+                         const float p)
 {
   for(size_t i = 0, j = 0; i < stride; i++, j += DT_BLENDIF_RGB_CH)
   {
@@ -625,10 +632,10 @@ _BLEND_FUNC _blend_RGB_R(const float *const a,
 /* blend only R-channel in RGB color space without any clamping */
 _BLEND_FUNC _blend_RGB_G(const float *const a,
                          const float *const b,
-                         const float p,
                          float *const out,
                          const float *const restrict mask,
-                         const size_t stride)
+                         const size_t stride,
+                         const float p)
 {
   for(size_t i = 0, j = 0; i < stride; i++, j += DT_BLENDIF_RGB_CH)
   {
@@ -643,10 +650,10 @@ _BLEND_FUNC _blend_RGB_G(const float *const a,
 /* blend only R-channel in RGB color space without any clamping */
 _BLEND_FUNC _blend_RGB_B(const float *const a,
                          const float *const b,
-                         const float p,
                          float *const out,
                          const float *const restrict mask,
-                         const size_t stride)
+                         const size_t stride,
+                         const float p)
 {
   for(size_t i = 0, j = 0; i < stride; i++, j += DT_BLENDIF_RGB_CH)
   {
@@ -659,63 +666,80 @@ _BLEND_FUNC _blend_RGB_B(const float *const a,
 }
 
 
-static _blend_row_func *_choose_blend_func(const unsigned int blend_mode)
+_BLEND_IMAGE(_blend_normal)
+_BLEND_IMAGE(_blend_multiply)
+_BLEND_IMAGE(_blend_add)
+_BLEND_IMAGE(_blend_subtract)
+_BLEND_IMAGE(_blend_subtract_inverse)
+_BLEND_IMAGE(_blend_difference)
+_BLEND_IMAGE(_blend_divide)
+_BLEND_IMAGE(_blend_divide_inverse)
+_BLEND_IMAGE(_blend_average)
+_BLEND_IMAGE(_blend_geometric_mean)
+_BLEND_IMAGE(_blend_harmonic_mean)
+_BLEND_IMAGE(_blend_chromaticity)
+_BLEND_IMAGE(_blend_luminance)
+_BLEND_IMAGE(_blend_RGB_R)
+_BLEND_IMAGE(_blend_RGB_G)
+_BLEND_IMAGE(_blend_RGB_B)
+
+static _blend_image_func *_choose_blend_func(const unsigned int blend_mode)
 {
-  _blend_row_func *blend = NULL;
+  _blend_image_func *blend = NULL;
 
   /* select the blend operator */
   switch(blend_mode & DEVELOP_BLEND_MODE_MASK)
   {
     case DEVELOP_BLEND_MULTIPLY:
-      blend = _blend_multiply;
+      blend = _blend_multiply_image;
       break;
     case DEVELOP_BLEND_AVERAGE:
-      blend = _blend_average;
+      blend = _blend_average_image;
       break;
     case DEVELOP_BLEND_ADD:
-      blend = _blend_add;
+      blend = _blend_add_image;
       break;
     case DEVELOP_BLEND_SUBTRACT:
-      blend = _blend_subtract;
+      blend = _blend_subtract_image;
       break;
     case DEVELOP_BLEND_SUBTRACT_INVERSE:
-      blend = _blend_subtract_inverse;
+      blend = _blend_subtract_inverse_image;
       break;
     case DEVELOP_BLEND_DIFFERENCE:
     case DEVELOP_BLEND_DIFFERENCE2:
-      blend = _blend_difference;
+      blend = _blend_difference_image;
       break;
     case DEVELOP_BLEND_DIVIDE:
-      blend = _blend_divide;
+      blend = _blend_divide_image;
       break;
     case DEVELOP_BLEND_DIVIDE_INVERSE:
-      blend = _blend_divide_inverse;
+      blend = _blend_divide_inverse_image;
       break;
     case DEVELOP_BLEND_LIGHTNESS:
-      blend = _blend_luminance;
+      blend = _blend_luminance_image;
       break;
     case DEVELOP_BLEND_CHROMATICITY:
-      blend = _blend_chromaticity;
+      blend = _blend_chromaticity_image;
       break;
     case DEVELOP_BLEND_RGB_R:
-      blend = _blend_RGB_R;
+      blend = _blend_RGB_R_image;
       break;
     case DEVELOP_BLEND_RGB_G:
-      blend = _blend_RGB_G;
+      blend = _blend_RGB_G_image;
       break;
     case DEVELOP_BLEND_RGB_B:
-      blend = _blend_RGB_B;
+      blend = _blend_RGB_B_image;
       break;
     case DEVELOP_BLEND_GEOMETRIC_MEAN:
-      blend = _blend_geometric_mean;
+      blend = _blend_geometric_mean_image;
       break;
     case DEVELOP_BLEND_HARMONIC_MEAN:
-      blend = _blend_harmonic_mean;
+      blend = _blend_harmonic_mean_image;
       break;
 
     /* fallback to normal blend */
     default:
-      blend = _blend_normal;
+      blend = _blend_normal_image;
       break;
   }
 
@@ -997,30 +1021,9 @@ void dt_develop_blendif_rgb_jzczhz_blend(dt_dev_pixelpipe_iop_t *piece,
   else
   {
     const float p = exp2f(d->blend_parameter);
-    _blend_row_func *const blend = _choose_blend_func(d->blend_mode);
-
-    if((d->blend_mode & DEVELOP_BLEND_REVERSE) == DEVELOP_BLEND_REVERSE)
-    {
-      DT_OMP_FOR()
-      for(size_t y = 0; y < oheight; y++)
-      {
-        const size_t a_start = ((y + yoffs) * iwidth + xoffs) * DT_BLENDIF_RGB_CH;
-        const size_t b_start = y * owidth * DT_BLENDIF_RGB_CH;
-        const size_t m_start = y * owidth;
-        blend(b + b_start, a + a_start, p, b + b_start, mask + m_start, owidth);
-      }
-    }
-    else
-    {
-      DT_OMP_FOR()
-      for(size_t y = 0; y < oheight; y++)
-      {
-        const size_t a_start = ((y + yoffs) * iwidth + xoffs) * DT_BLENDIF_RGB_CH;
-        const size_t b_start = y * owidth * DT_BLENDIF_RGB_CH;
-        const size_t m_start = y * owidth;
-        blend(a + a_start, b + b_start, p, b + b_start, mask + m_start, owidth);
-      }
-    }
+    _blend_image_func *const blend = _choose_blend_func(d->blend_mode);
+    blend(a, b, b, mask, iwidth, xoffs, yoffs, owidth, oheight,
+          (d->blend_mode & DEVELOP_BLEND_REVERSE) == DEVELOP_BLEND_REVERSE, p);
   }
 
   if(mask_display & DT_DEV_PIXELPIPE_DISPLAY_MASK)
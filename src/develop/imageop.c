@@ -2158,6 +2158,9 @@ void dt_iop_commit_params(dt_iop_module_t *module,
   if(module->flags() & IOP_FLAGS_ALLOW_TILING)
     piece->process_tiling_ready = TRUE;
 
+  // assume process_pointwise is ready, commit_params can overwrite this.
+  piece->process_pointwise_ready = module->process_pointwise != NULL;
+
   if((piece->enabled || module->enabled) // better to check for both
     && module->so->get_introspection()
     && darktable.unmuted & DT_DEBUG_PARAMS)
@@ -22,6 +22,7 @@
 #include "common/opencl.h"
 #include "common/iop_order.h"
 #include "common/imagebuf.h"
+#include "common/interpolation.h"
 #include "control/control.h"
 #include "control/signal.h"
 #include "develop/blend.h"
@@ -438,6 +439,7 @@ void dt_dev_pixelpipe_create_nodes(dt_dev_pixelpipe_t *pipe,
     piece->hash = 0;
     piece->process_cl_ready = FALSE;
     piece->process_tiling_ready = FALSE;
+    piece->process_pointwise_ready = FALSE;
     piece->raster_masks = g_hash_table_new_full(g_direct_hash,
                                                 g_direct_equal, NULL, dt_free_align_ptr);
     memset(&piece->processed_roi_in, 0, sizeof(piece->processed_roi_in));
@@ -1013,22 +1015,54 @@ static void _pixelpipe_pick_samples(dt_develop_t *dev,
     samples = &primary;
   }
 
-  while(samples)
+  // find the boxes first. with several of them, or with denoising
+  // which otherwise blurs the whole image once per sample, their
+  // statistics come cheaper from a table of the buffer
+  const int nsamples = g_slist_length(samples);
+  int *boxes = g_new(int, 4 * nsamples);
+  gboolean *valid = g_new(gboolean, nsamples);
+  size_t area[2] = { 0, 0 };
+  int count[2] = { 0, 0 };
+  int k = 0;
+  for(GSList *s = samples; s; s = g_slist_next(s), k++)
   {
-    int box[4];
-    dt_colorpicker_sample_t *sample = samples->data;
-    if(!sample->locked &&
-       !dt_color_picker_box(module, roi_in, sample, PIXELPIPE_PICKER_INPUT, box))
+    const dt_colorpicker_sample_t *sample = s->data;
+    valid[k] = !sample->locked
+      && !dt_color_picker_box(module, roi_in, sample, PIXELPIPE_PICKER_INPUT, boxes + 4 * k);
+    if(valid[k])
     {
+      const int *const box = boxes + 4 * k;
+      area[sample->denoise != 0] += (size_t)(box[2] - box[0]) * (box[3] - box[1]);
+      count[sample->denoise != 0]++;
+    }
+  }
+
+  const size_t npixels = (size_t)roi_in->width * roi_in->height;
+  dt_color_picker_table_t *table[2] = { NULL, NULL };
+  if(dsc->channels == 4u)
+    for(int denoise = 0; denoise < 2; denoise++)
+      if(count[denoise] > 1 && (denoise || area[denoise] > 2 * npixels))
+        table[denoise] = dt_color_picker_table_new(input, roi_in, denoise);
+
+  k = 0;
+  for(GSList *s = samples; s; s = g_slist_next(s), k++)
+  {
+    dt_colorpicker_sample_t *sample = s->data;
+    if(valid[k])
+    {
+      const int *const box = boxes + 4 * k;
       // pixel input is in display profile, hence the sample output will be as well
       dt_print_pipe(DT_DEBUG_PIPE | DT_DEBUG_PICKER, "pixelpipe pick samples",
-        NULL, module, DT_DEVICE_NONE, roi_in, NULL, " %sbox %i/%i -- %i/%i",
+        NULL, module, DT_DEVICE_NONE, roi_in, NULL, " %sbox %i/%i -- %i/%i%s",
         darktable.lib->proxy.colorpicker.primary_sample->denoise ? "denoised " : "",
-        box[0], box[1], box[2], box[3]);
+        box[0], box[1], box[2], box[3], table[sample->denoise != 0] ? " from table" : "");
 
-      dt_color_picker_helper(dsc, input, roi_in, box, sample->denoise,
-                             sample->display,
-                             IOP_CS_RGB, IOP_CS_RGB, display_profile);
+      if(table[sample->denoise != 0])
+        dt_color_picker_table_stats(table[sample->denoise != 0], box, sample->display);
+      else
+        dt_color_picker_helper(dsc, input, roi_in, box, sample->denoise,
+                               sample->display,
+                               IOP_CS_RGB, IOP_CS_RGB, display_profile);
 
       // NOTE: conversions assume that dt_aligned_pixel_t[x] has no
       // padding, e.g. is equivalent to float[x*4], and that on failure
@@ -1042,8 +1076,12 @@ static void _pixelpipe_pick_samples(dt_develop_t *dev,
           (sample->display[0], sample->scope[0], 3, 1,
            display_profile, histogram_profile, "primary picker");
     }
-    samples = g_slist_next(samples);
   }
+
+  dt_color_picker_table_free(table[0]);
+  dt_color_picker_table_free(table[1]);
+  g_free(boxes);
+  g_free(valid);
 }
 
 // returns TRUE if blend process need the module default colorspace
@@ -1437,6 +1475,613 @@ static inline gboolean _skip_piece_on_tags(const dt_dev_pixelpipe_iop_t *piece)
           && (piece->pipe->type & DT_DEV_PIXELPIPE_BASIC);
 }
 
+// number of pixels processed by all modules of a fused chain before moving on
+#define DT_PIPE_FUSED_CHUNK 1024
+// number of output rows mapped through all modules of a fused warp at once
+#define DT_PIPE_WARP_ROWS 32
+
+static gboolean _dev_pixelpipe_process_rec(dt_dev_pixelpipe_t *pipe,
+                                           dt_develop_t *dev,
+                                           void **output,
+                                           void **cl_mem_output,
+                                           dt_iop_buffer_dsc_t **out_format,
+                                           const dt_iop_roi_t *roi_out,
+                                           GList *modules,
+                                           GList *pieces,
+                                           const int pos);
+
+static gboolean _piece_pointwise(dt_dev_pixelpipe_t *pipe,
+                                 dt_develop_t *dev,
+                                 dt_dev_pixelpipe_iop_t *piece,
+                                 const dt_iop_roi_t *roi_out)
+{
+  dt_iop_module_t *module = piece->module;
+  const dt_develop_blend_params_t *const bp = piece->blendop_data;
+
+  if(!module->process_pointwise
+     || !piece->process_pointwise_ready
+     || (bp && bp->mask_mode != DEVELOP_MASK_DISABLED)
+     || _request_color_pick(pipe, dev, module)
+     || module->request_histogram != DT_REQUEST_OFF
+     || piece->request_histogram != DT_REQUEST_OFF
+     || piece->dsc_in.channels != 4
+     || piece->dsc_in.datatype != TYPE_FLOAT)
+    return FALSE;
+
+  dt_iop_roi_t roi_in = *roi_out;
+  module->modify_roi_in(module, piece, roi_out, &roi_in);
+  return !memcmp(&roi_in, roi_out, sizeof(dt_iop_roi_t));
+}
+
+// modules of a chain may differ in colorspace as long as we can convert per pixel in the chain,
+// this is done like dt_ioppr_transform_image_colorspace() for matrix profiles.
+static inline gboolean _pointwise_cst_convertible(const dt_iop_order_iccprofile_info_t *const profile,
+                                                  const dt_iop_colorspace_type_t cst_from,
+                                                  const dt_iop_colorspace_type_t cst_to)
+{
+  if(cst_from == cst_to)
+    return TRUE;
+
+  return profile
+         && profile->type != DT_COLORSPACE_NONE
+         && !profile->nonlinearlut
+         && dt_is_valid_colormatrix(profile->matrix_in[0][0])
+         && dt_is_valid_colormatrix(profile->matrix_out[0][0])
+         && ((cst_from == IOP_CS_RGB && cst_to == IOP_CS_LAB)
+             || (cst_from == IOP_CS_LAB && cst_to == IOP_CS_RGB));
+}
+
+static inline void _pointwise_cst_convert(float *const buf,
+                                          const size_t npixels,
+                                          const dt_iop_colorspace_type_t cst_from,
+                                          const dt_iop_order_iccprofile_info_t *const profile)
+{
+  if(cst_from == IOP_CS_RGB)
+  {
+    for(size_t k = 0; k < 4 * npixels; k += 4)
+    {
+      dt_aligned_pixel_t xyz;
+      dt_apply_transposed_color_matrix(buf + k, profile->matrix_in_transposed, xyz);
+      dt_XYZ_to_Lab(xyz, buf + k);
+    }
+  }
+  else
+  {
+    for(size_t k = 0; k < 4 * npixels; k += 4)
+    {
+      dt_aligned_pixel_t xyz;
+      const float alpha = buf[k + 3];
+      dt_Lab_to_XYZ(buf + k, xyz);
+      dt_apply_transposed_color_matrix(xyz, profile->matrix_out_transposed, buf + k);
+      buf[k + 3] = alpha;
+    }
+  }
+}
+
+/* Collect the chain of modules providing a pointwise kernel right before and including
+   the one at pos, going upwards the pipe. The chain stops at the focused module or the last
+   history module so their input is kept in the cache.
+   Returns the number of modules in the chain, the chain itself in pipe order and the list
+   elements of its first module.
+*/
+static int _pointwise_chain_collect(dt_dev_pixelpipe_t *pipe,
+                                    dt_develop_t *dev,
+                                    const dt_iop_roi_t *roi_out,
+                                    GList *modules,
+                                    GList *pieces,
+                                    const int pos,
+                                    const dt_iop_order_iccprofile_info_t *const work_profile,
+                                    GList **chain,
+                                    GList **first_module,
+                                    GList **first_piece,
+                                    int *first_pos)
+{
+  const dt_iop_module_t *gui_module = dt_dev_gui_module();
+  dt_iop_colorspace_type_t cst = IOP_CS_NONE;
+  int nmod = 0;
+
+  *chain = NULL;
+  GList *m = modules;
+  int mpos = pos;
+  for(GList *p = pieces; p; p = g_list_previous(p), m = g_list_previous(m), mpos--)
+  {
+    dt_dev_pixelpipe_iop_t *piece = p->data;
+    dt_iop_module_t *module = m->data;
+
+    if(_skip_piece_on_tags(piece))
+      continue;
+    if(!_piece_pointwise(pipe, dev, piece, roi_out))
+      break;
+    if(*chain
+       && !_pointwise_cst_convertible(work_profile, module->output_colorspace(module, pipe, piece), cst))
+      break;
+
+    cst = module->input_colorspace(module, pipe, piece);
+    *chain = g_list_prepend(*chain, piece);
+    *first_module = m;
+    *first_piece = p;
+    *first_pos = mpos;
+    nmod++;
+
+    if(module == gui_module || module == dev->history_last_module)
+      break;
+  }
+
+  return nmod;
+}
+
+/* Run all kernels of a chain on parts of the image while they are in the cpu cache.
+   Before each module the data is converted from cst_from[i] to its input colorspace cst_to[i],
+   for the first module this has already been done on the input.
+*/
+static void _pointwise_chain_run(dt_dev_pixelpipe_iop_t **members,
+                                 const int nmod,
+                                 const dt_iop_colorspace_type_t *const cst_from,
+                                 const dt_iop_colorspace_type_t *const cst_to,
+                                 const dt_iop_order_iccprofile_info_t *const work_profile,
+                                 const float *const in,
+                                 float *const out,
+                                 const size_t npixels)
+{
+  DT_OMP_FOR()
+  for(size_t p = 0; p < npixels; p += DT_PIPE_FUSED_CHUNK)
+  {
+    const size_t n = MIN(DT_PIPE_FUSED_CHUNK, npixels - p);
+    for(int i = 0; i < nmod; i++)
+    {
+      dt_iop_module_t *module = members[i]->module;
+      if(i && cst_from[i] != cst_to[i])
+        _pointwise_cst_convert(out + 4 * p, n, cst_from[i], work_profile);
+      module->process_pointwise(module, members[i], i ? out + 4 * p : in + 4 * p, out + 4 * p, n);
+    }
+  }
+}
+
+/* Modules providing a pointwise kernel right before and including the current one are
+   processed as one chain, all kernels run on a part of the image while it's in the cpu cache
+   and only the output of the chain is kept in the pixelpipe cache.
+   Returns TRUE in case of unfinished work or error like _dev_pixelpipe_process_rec(),
+   fused is set if the chain has been processed.
+*/
+static gboolean _dev_pixelpipe_process_fused(dt_dev_pixelpipe_t *pipe,
+                                             dt_develop_t *dev,
+                                             void **output,
+                                             dt_iop_buffer_dsc_t **out_format,
+                                             const dt_iop_roi_t *roi_out,
+                                             GList *modules,
+                                             GList *pieces,
+                                             const int pos,
+                                             const dt_hash_t hash,
+                                             const size_t bufsize,
+                                             gboolean *fused)
+{
+  *fused = FALSE;
+
+#ifdef HAVE_OPENCL
+  // with opencl the data is kept on the device anyway
+  if(_opencl_pipe_isok(pipe))
+    return FALSE;
+#endif
+
+  if(pipe->mask_display != DT_DEV_PIXELPIPE_DISPLAY_NONE
+     || darktable.dump_pfm_pipe
+     || darktable.bench_module
+     || (darktable.unmuted & DT_DEBUG_NAN))
+    return FALSE;
+
+  const dt_iop_order_iccprofile_info_t *const work_profile = dt_ioppr_get_pipe_work_profile_info(pipe);
+  const dt_iop_module_t *gui_module = dt_dev_gui_module();
+  GList *chain = NULL;
+  GList *first_module = NULL;
+  GList *first_piece = NULL;
+  int first_pos = pos;
+
+  const int nmod = _pointwise_chain_collect(pipe, dev, roi_out, modules, pieces, pos, work_profile,
+                                            &chain, &first_module, &first_piece, &first_pos);
+  if(nmod < 2)
+  {
+    g_list_free(chain);
+    return FALSE;
+  }
+
+  // recurse to get the input of the chain
+  *fused = TRUE;
+  void *input = NULL;
+  void *cl_mem_input = NULL;
+  dt_iop_buffer_dsc_t _input_format = { 0 };
+  dt_iop_buffer_dsc_t *input_format = &_input_format;
+
+  for(GList *c = chain; c; c = g_list_next(c))
+  {
+    dt_dev_pixelpipe_iop_t *piece = c->data;
+    piece->processed_roi_in = piece->processed_roi_out = *roi_out;
+  }
+
+  if(_dev_pixelpipe_process_rec(pipe, dev, &input, &cl_mem_input, &input_format, roi_out,
+                                g_list_previous(first_module),
+                                g_list_previous(first_piece), first_pos - 1))
+  {
+    g_list_free(chain);
+    return TRUE;
+  }
+
+  dt_dev_pixelpipe_iop_t *first = chain->data;
+  dt_dev_pixelpipe_iop_t *last = g_list_last(chain)->data;
+
+  if(input_format->channels != 4 || input_format->datatype != TYPE_FLOAT || !dt_check_aligned(input))
+  {
+    // the upstream format changed since the last run, leave it to the per-module path
+    // which finds the chain input in the cache.
+    dt_print_pipe(DT_DEBUG_PIPE, "fused chain skipped", pipe, first->module, DT_DEVICE_CPU, roi_out, NULL,
+                  "unexpected input format");
+    first->dsc_in = *input_format;
+    g_list_free(chain);
+    *fused = FALSE;
+    return FALSE;
+  }
+
+  dt_times_t start;
+  dt_get_perf_times(&start);
+
+  const gboolean important =
+         ((pipe->type & DT_DEV_PIXELPIPE_PREVIEW) && dt_iop_module_is(last->module->so, "colorout"))
+      || ((pipe->type & DT_DEV_PIXELPIPE_FULL)    && dt_iop_module_is(last->module->so, "gamma"));
+  dt_dev_pixelpipe_cache_get(pipe, hash, bufsize, output, out_format, last->module, important);
+
+  if(dt_atomic_get_int(&pipe->shutdown))
+  {
+    g_list_free(chain);
+    return TRUE;
+  }
+
+  dt_ioppr_transform_image_colorspace(first->module, input, input, roi_out->width, roi_out->height,
+                                      input_format->cst,
+                                      first->module->input_colorspace(first->module, pipe, first),
+                                      &input_format->cst,
+                                      input_format->cst != IOP_CS_RAW ? work_profile : NULL);
+
+  // formats, colorspaces and setup of all modules in pipe order
+  dt_dev_pixelpipe_iop_t **members = g_new(dt_dev_pixelpipe_iop_t *, nmod);
+  dt_iop_colorspace_type_t *cst_from = g_new(dt_iop_colorspace_type_t, nmod);
+  dt_iop_colorspace_type_t *cst_to = g_new(dt_iop_colorspace_type_t, nmod);
+  dt_iop_buffer_dsc_t dsc = *input_format;
+  int k = 0;
+  for(GList *c = chain; c; c = g_list_next(c))
+  {
+    dt_dev_pixelpipe_iop_t *piece = c->data;
+    dt_iop_module_t *module = piece->module;
+    cst_from[k] = dsc.cst;
+    cst_to[k] = dsc.cst = module->input_colorspace(module, pipe, piece);
+    piece->dsc_out = piece->dsc_in = dsc;
+    module->output_format(module, pipe, piece, &piece->dsc_out);
+    pipe->dsc = piece->dsc_out;
+    if(module->process_pointwise_setup)
+      module->process_pointwise_setup(module, piece);
+    pipe->dsc.cst = module->output_colorspace(module, pipe, piece);
+    dsc = piece->dsc_out = pipe->dsc;
+    members[k++] = piece;
+  }
+  g_list_free(chain);
+
+  dt_print_pipe(DT_DEBUG_PIPE,
+                "process fused", pipe, last->module, DT_DEVICE_CPU, roi_out, roi_out, "%d modules from `%s%s'",
+                nmod, first->module->op, dt_iop_get_instance_id(first->module));
+
+  _pointwise_chain_run(members, nmod, cst_from, cst_to, work_profile,
+                       (const float *)input, (float *)*output, (size_t)roi_out->width * roi_out->height);
+  g_free(members);
+  g_free(cst_from);
+  g_free(cst_to);
+
+  **out_format = pipe->dsc;
+
+  dt_show_times_f(&start, "[dev_pixelpipe]", "[%s] processed %d fused modules `%s%s' to `%s%s' on CPU",
+                  dt_dev_pixelpipe_type_to_str(pipe->type), nmod,
+                  first->module->op, dt_iop_get_instance_id(first->module),
+                  last->module->op, dt_iop_get_instance_id(last->module));
+
+  // keep the input of the chain if the first module is likely to be changed again
+  const gboolean has_focus = first->module == gui_module;
+  const gboolean last_history = first->module == darktable.develop->history_last_module;
+  if((pipe->type & DT_DEV_PIXELPIPE_BASIC) && (has_focus || last_history))
+  {
+    dt_print_pipe(DT_DEBUG_PIPE,
+      "importance hints", pipe, first->module, DT_DEVICE_CPU, roi_out, NULL, " %s%s",
+      last_history ? "input_hint " : "",
+      has_focus ? "focus " : "");
+    dt_dev_pixelpipe_important_cacheline(pipe, input, bufsize);
+    if((pipe->type & DT_DEV_PIXELPIPE_FULL) && last_history)
+      darktable.develop->history_last_module = NULL;
+  }
+
+  return dt_atomic_get_int(&pipe->shutdown) ? TRUE : FALSE;
+}
+
+static gboolean _piece_warp(dt_dev_pixelpipe_t *pipe,
+                            dt_develop_t *dev,
+                            dt_dev_pixelpipe_iop_t *piece,
+                            const dt_iop_roi_t *roi_in,
+                            const dt_iop_roi_t *roi_out)
+{
+  dt_iop_module_t *module = piece->module;
+  const dt_develop_blend_params_t *const bp = piece->blendop_data;
+
+  if(!module->distort_warp
+     || (bp && bp->mask_mode != DEVELOP_MASK_DISABLED)
+     || _request_color_pick(pipe, dev, module)
+     || module->request_histogram != DT_REQUEST_OFF
+     || piece->request_histogram != DT_REQUEST_OFF
+     || piece->dsc_in.channels != 4
+     || piece->dsc_in.datatype != TYPE_FLOAT
+     || module->input_colorspace(module, pipe, piece) != module->output_colorspace(module, pipe, piece))
+    return FALSE;
+
+  return module->distort_warp(module, piece, roi_in, roi_out, NULL, 0);
+}
+
+/* Map the output positions of a strip of rows through the warps of all modules of a chain,
+   last one first, and resample the input of the chain there. points and valid hold
+   DT_PIPE_WARP_ROWS rows of roi_out.
+*/
+static void _warp_chain_run(dt_dev_pixelpipe_iop_t **members,
+                            const int nmod,
+                            const struct dt_interpolation *const interpolation,
+                            const float *const in,
+                            const dt_iop_roi_t *const roi_chain_in,
+                            float *const out,
+                            const dt_iop_roi_t *const roi_out,
+                            float *const points,
+                            uint8_t *const valid)
+{
+  const int width = roi_out->width;
+
+  for(int y0 = 0; y0 < roi_out->height; y0 += DT_PIPE_WARP_ROWS)
+  {
+    const int rows = MIN(DT_PIPE_WARP_ROWS, roi_out->height - y0);
+    const size_t count = (size_t)rows * width;
+
+    DT_OMP_FOR()
+    for(size_t p = 0; p < count; p++)
+    {
+      points[2 * p] = p % width;
+      points[2 * p + 1] = y0 + p / width;
+      valid[p] = TRUE;
+    }
+
+    for(int i = nmod - 1; i >= 0; i--)
+    {
+      dt_iop_module_t *module = members[i]->module;
+      const dt_iop_roi_t *const roi_in = &members[i]->processed_roi_in;
+      module->distort_warp(module, members[i], roi_in, &members[i]->processed_roi_out,
+                           points, count);
+
+      // the module would have got black outside of its input, like the interpolation
+      // does for the first one below
+      if(i == 0) break;
+      DT_OMP_FOR()
+      for(size_t p = 0; p < count; p++)
+      {
+        const float x = points[2 * p];
+        const float y = points[2 * p + 1];
+        if(!(x > -1.0f && x < roi_in->width && y > -1.0f && y < roi_in->height))
+        {
+          valid[p] = FALSE;
+          points[2 * p] = points[2 * p + 1] = 0.0f;
+        }
+      }
+    }
+
+    DT_OMP_FOR()
+    for(size_t p = 0; p < count; p++)
+    {
+      float *const o = out + 4 * ((size_t)y0 * width + p);
+      if(valid[p] && dt_isfinite(points[2 * p]) && dt_isfinite(points[2 * p + 1]))
+        dt_interpolation_compute_pixel4c(interpolation, in, o, points[2 * p], points[2 * p + 1],
+                                         roi_chain_in->width, roi_chain_in->height,
+                                         4 * roi_chain_in->width);
+      else
+        memset(o, 0, 4 * sizeof(float));
+    }
+  }
+}
+
+/* Modules providing a warp right before and including the current one are composed,
+   the coordinates of every output pixel are mapped through all of them and the input
+   of the chain is resampled once. This saves the intermediate buffers and the blur
+   added by each interpolation.
+   Returns TRUE in case of unfinished work or error like _dev_pixelpipe_process_rec(),
+   fused is set if the chain has been processed.
+*/
+static gboolean _dev_pixelpipe_process_warp(dt_dev_pixelpipe_t *pipe,
+                                            dt_develop_t *dev,
+                                            void **output,
+                                            dt_iop_buffer_dsc_t **out_format,
+                                            const dt_iop_roi_t *roi_out,
+                                            GList *modules,
+                                            GList *pieces,
+                                            const int pos,
+                                            const dt_hash_t hash,
+                                            const size_t bufsize,
+                                            gboolean *fused)
+{
+  *fused = FALSE;
+
+#ifdef HAVE_OPENCL
+  // the modules' own kernels are preferred
+  if(_opencl_pipe_isok(pipe))
+    return FALSE;
+#endif
+
+  if(pipe->mask_display != DT_DEV_PIXELPIPE_DISPLAY_NONE
+     || darktable.dump_pfm_pipe
+     || darktable.bench_module
+     || (darktable.unmuted & DT_DEBUG_NAN))
+    return FALSE;
+
+  // collect the chain going upwards the pipe, the input of the focused module is kept in the cache.
+  // the roi of each module is kept in its piece like for a regular run.
+  const dt_iop_module_t *gui_module = dt_dev_gui_module();
+  GList *chain = NULL;
+  GList *first_module = NULL;
+  GList *first_piece = NULL;
+  int first_pos = pos;
+  dt_iop_colorspace_type_t cst = IOP_CS_NONE;
+  int nmod = 0;
+  dt_iop_roi_t roi = *roi_out;
+
+  GList *m = modules;
+  int mpos = pos;
+  for(GList *p = pieces; p; p = g_list_previous(p), m = g_list_previous(m), mpos--)
+  {
+    dt_dev_pixelpipe_iop_t *piece = p->data;
+    dt_iop_module_t *module = m->data;
+
+    if(_skip_piece_on_tags(piece))
+      continue;
+
+    dt_iop_roi_t roi_in = roi;
+    module->modify_roi_in(module, piece, &roi, &roi_in);
+    if(!_piece_warp(pipe, dev, piece, &roi_in, &roi))
+      break;
+    const dt_iop_colorspace_type_t mcst = module->input_colorspace(module, pipe, piece);
+    if(chain && mcst != cst)
+      break;
+
+    piece->processed_roi_in = roi_in;
+    piece->processed_roi_out = roi;
+    roi = roi_in;
+
+    cst = mcst;
+    chain = g_list_prepend(chain, piece);
+    first_module = m;
+    first_piece = p;
+    first_pos = mpos;
+    nmod++;
+
+    if(module == gui_module || module == dev->history_last_module)
+      break;
+  }
+
+  const size_t npoints = (size_t)roi_out->width * DT_PIPE_WARP_ROWS;
+  float *points = nmod < 2 ? NULL : dt_alloc_align_float(2 * npoints);
+  uint8_t *valid = points ? dt_alloc_aligned(npoints) : NULL;
+  if(!valid)
+  {
+    dt_free_align(points);
+    g_list_free(chain);
+    return FALSE;
+  }
+
+  // recurse to get the input of the chain
+  *fused = TRUE;
+  void *input = NULL;
+  void *cl_mem_input = NULL;
+  dt_iop_buffer_dsc_t _input_format = { 0 };
+  dt_iop_buffer_dsc_t *input_format = &_input_format;
+
+  dt_dev_pixelpipe_iop_t *first = chain->data;
+  dt_dev_pixelpipe_iop_t *last = g_list_last(chain)->data;
+  const dt_iop_roi_t roi_chain_in = first->processed_roi_in;
+
+  if(_dev_pixelpipe_process_rec(pipe, dev, &input, &cl_mem_input, &input_format, &roi_chain_in,
+                                g_list_previous(first_module),
+                                g_list_previous(first_piece), first_pos - 1))
+  {
+    dt_free_align(points);
+    dt_free_align(valid);
+    g_list_free(chain);
+    return TRUE;
+  }
+
+  if(input_format->channels != 4 || input_format->datatype != TYPE_FLOAT || !dt_check_aligned(input))
+  {
+    // the upstream format changed since the last run, leave it to the per-module path
+    // which finds the chain input in the cache.
+    dt_print_pipe(DT_DEBUG_PIPE, "fused warp skipped", pipe, first->module, DT_DEVICE_CPU,
+                  &roi_chain_in, NULL, "unexpected input format");
+    first->dsc_in = *input_format;
+    dt_free_align(points);
+    dt_free_align(valid);
+    g_list_free(chain);
+    *fused = FALSE;
+    return FALSE;
+  }
+
+  dt_times_t start;
+  dt_get_perf_times(&start);
+
+  dt_dev_pixelpipe_cache_get(pipe, hash, bufsize, output, out_format, last->module, FALSE);
+
+  if(dt_atomic_get_int(&pipe->shutdown))
+  {
+    dt_free_align(points);
+    dt_free_align(valid);
+    g_list_free(chain);
+    return TRUE;
+  }
+
+  const dt_iop_order_iccprofile_info_t *const work_profile =
+    (input_format->cst != IOP_CS_RAW)
+      ? dt_ioppr_get_pipe_work_profile_info(pipe)
+      : NULL;
+  dt_ioppr_transform_image_colorspace(first->module, input, input,
+                                      roi_chain_in.width, roi_chain_in.height,
+                                      input_format->cst, cst, &input_format->cst, work_profile);
+
+  // formats of all modules in pipe order
+  dt_dev_pixelpipe_iop_t **members = g_new(dt_dev_pixelpipe_iop_t *, nmod);
+  dt_iop_buffer_dsc_t dsc = *input_format;
+  int k = 0;
+  for(GList *c = chain; c; c = g_list_next(c))
+  {
+    dt_dev_pixelpipe_iop_t *piece = c->data;
+    dt_iop_module_t *module = piece->module;
+    piece->dsc_out = piece->dsc_in = dsc;
+    module->output_format(module, pipe, piece, &piece->dsc_out);
+    pipe->dsc = piece->dsc_out;
+    pipe->dsc.cst = module->output_colorspace(module, pipe, piece);
+    dsc = piece->dsc_out = pipe->dsc;
+    members[k++] = piece;
+  }
+  g_list_free(chain);
+
+  dt_print_pipe(DT_DEBUG_PIPE,
+                "process warp", pipe, last->module, DT_DEVICE_CPU, &roi_chain_in, roi_out,
+                "%d modules from `%s%s'",
+                nmod, first->module->op, dt_iop_get_instance_id(first->module));
+
+  _warp_chain_run(members, nmod, dt_interpolation_new(DT_INTERPOLATION_USERPREF_WARP),
+                  (const float *)input, &roi_chain_in, (float *)*output, roi_out, points, valid);
+  g_free(members);
+  dt_free_align(points);
+  dt_free_align(valid);
+
+  **out_format = pipe->dsc;
+
+  dt_show_times_f(&start, "[dev_pixelpipe]", "[%s] processed %d warped modules `%s%s' to `%s%s' on CPU",
+                  dt_dev_pixelpipe_type_to_str(pipe->type), nmod,
+                  first->module->op, dt_iop_get_instance_id(first->module),
+                  last->module->op, dt_iop_get_instance_id(last->module));
+
+  // keep the input of the chain if the first module is likely to be changed again
+  const gboolean has_focus = first->module == gui_module;
+  const gboolean last_history = first->module == darktable.develop->history_last_module;
+  if((pipe->type & DT_DEV_PIXELPIPE_BASIC) && (has_focus || last_history))
+  {
+    dt_print_pipe(DT_DEBUG_PIPE,
+      "importance hints", pipe, first->module, DT_DEVICE_CPU, &roi_chain_in, NULL, " %s%s",
+      last_history ? "input_hint " : "",
+      has_focus ? "focus " : "");
+    dt_dev_pixelpipe_important_cacheline(pipe, input,
+                                         dt_iop_buffer_dsc_to_bpp(input_format)
+                                         * roi_chain_in.width * roi_chain_in.height);
+    if((pipe->type & DT_DEV_PIXELPIPE_FULL) && last_history)
+      darktable.develop->history_last_module = NULL;
+  }
+
+  return dt_atomic_get_int(&pipe->shutdown) ? TRUE : FALSE;
+}
+
 // recursive helper for process, returns TRUE in case of unfinished work or error
 static gboolean _dev_pixelpipe_process_rec(dt_dev_pixelpipe_t *pipe,
                                            dt_develop_t *dev,
@@ -1629,7 +2274,22 @@ static gboolean _dev_pixelpipe_process_rec(dt_dev_pixelpipe_t *pipe,
     return dt_atomic_get_int(&pipe->shutdown) ? TRUE : FALSE;
   }
 
-  // 3b) recurse and obtain output array in &input
+  // 3b) process a chain of pointwise modules in one pass
+  gboolean fused = FALSE;
+  if(_dev_pixelpipe_process_fused(pipe, dev, output, out_format, roi_out,
+                                  modules, pieces, pos, hash, bufsize, &fused))
+    return TRUE;
+  if(fused)
+    return FALSE;
+
+  // 3c) compose a chain of warping modules and resample once
+  if(_dev_pixelpipe_process_warp(pipe, dev, output, out_format, roi_out,
+                                 modules, pieces, pos, hash, bufsize, &fused))
+    return TRUE;
+  if(fused)
+    return FALSE;
+
+  // 3d) recurse and obtain output array in &input
 
   // get region of interest which is needed in input
   if(dt_atomic_get_int(&pipe->shutdown))
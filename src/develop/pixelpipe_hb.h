@@ -66,6 +66,7 @@ typedef struct dt_dev_pixelpipe_iop_t
   dt_iop_roi_t processed_roi_out;
   gboolean process_cl_ready;      // set this to FALSE in commit_params to temporarily disable the use of process_cl
   gboolean process_tiling_ready;  // set this to FALSE in commit_params to temporarily disable tiling
+  gboolean process_pointwise_ready; // set this to FALSE in commit_params to temporarily disable process_pointwise
 
   // the following are used internally for caching:
   dt_iop_buffer_dsc_t dsc_in;
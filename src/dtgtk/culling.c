@@ -53,36 +53,34 @@ static void _list_remove_thumb(gpointer user_data)
 static dt_imgid_t _thumb_get_imgid(int rowid)
 {
   dt_imgid_t id = NO_IMGID;
-  sqlite3_stmt *stmt;
-  gchar *query = g_strdup_printf
-    ("SELECT imgid"
+  sqlite3_stmt *stmt = dt_database_prepare_cached
+    (darktable.db,
+     "SELECT imgid"
      " FROM memory.collected_images"
-     " WHERE rowid=%d", rowid);
-  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db), query, -1, &stmt, NULL);
+     " WHERE rowid = ?1");
+  DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, rowid);
   if(sqlite3_step(stmt) == SQLITE_ROW)
   {
     id = sqlite3_column_int(stmt, 0);
   }
-  g_free(query);
-  sqlite3_finalize(stmt);
+  dt_database_release_cached(darktable.db, stmt);
   return id;
 }
 // get rowid from imgid
 static int _thumb_get_rowid(dt_imgid_t imgid)
 {
   dt_imgid_t id = NO_IMGID;
-  sqlite3_stmt *stmt;
-  gchar *query = g_strdup_printf
-    ("SELECT rowid"
+  sqlite3_stmt *stmt = dt_database_prepare_cached
+    (darktable.db,
+     "SELECT rowid"
      " FROM memory.collected_images"
-     " WHERE imgid=%d", imgid);
-  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db), query, -1, &stmt, NULL);
+     " WHERE imgid = ?1");
+  DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, imgid);
   if(sqlite3_step(stmt) == SQLITE_ROW)
   {
     id = sqlite3_column_int(stmt, 0);
   }
-  g_free(query);
-  sqlite3_finalize(stmt);
+  dt_database_release_cached(darktable.db, stmt);
   return id;
 }
 
@@ -311,6 +309,7 @@ static void _thumbs_move(dt_culling_t *table, const int move)
 
   if(new_offset != table->offset)
   {
+    dt_mipmap_prefetch_motion_update(&table->prefetch, new_offset - table->offset);
     table->offset = new_offset;
     dt_culling_full_redraw(table, TRUE);
     _thumbs_refocus(table);
@@ -1117,26 +1116,15 @@ void dt_culling_init(dt_culling_t *table, const int fallback_offset)
   table->offset_imgid = first_id;
 }
 
-static void _thumbs_prefetch(dt_culling_t *table)
+// get up to |count| images after rowid, or before if count is negative,
+// nearest first
+static int _thumbs_get_neighbours(dt_culling_t *table,
+                                  const int rowid,
+                                  const int count,
+                                  dt_imgid_t *imgs)
 {
-  if(!table->list) return;
-
-  // get the mip level by using the max image size actually shown
-  int maxw = 0;
-  int maxh = 0;
-  for(GList *l = table->list; l; l = g_list_next(l))
-  {
-    dt_thumbnail_t *th = l->data;
-    maxw = MAX(maxw, th->width);
-    maxh = MAX(maxh, th->height);
-  }
-  dt_mipmap_size_t mip =
-    dt_mipmap_cache_get_matching_size(darktable.mipmap_cache, maxw, maxh);
-
-  // prefetch next image
   gchar *query;
   sqlite3_stmt *stmt;
-  dt_thumbnail_t *last = g_list_last(table->list)->data;
   if(table->navigate_inside_selection)
   {
     // clang-format off
@@ -1144,10 +1132,10 @@ static void _thumbs_prefetch(dt_culling_t *table)
       ("SELECT m.imgid"
        " FROM memory.collected_images AS m, main.selected_images AS s"
        " WHERE m.imgid = s.imgid"
-       "   AND m.rowid > %d"
-       " ORDER BY m.rowid "
-       " LIMIT 1",
-       last->rowid);
+       "   AND m.rowid %s %d"
+       " ORDER BY m.rowid %s"
+       " LIMIT %d",
+       count > 0 ? ">" : "<", rowid, count > 0 ? "" : "DESC", abs(count));
     // clang-format on
   }
   else
@@ -1155,58 +1143,56 @@ static void _thumbs_prefetch(dt_culling_t *table)
     // clang-format off
     query = g_strdup_printf
       ("SELECT m.imgid"
-       " FROM memory.collected_images AS m "
-       " WHERE m.rowid > %d"
-       " ORDER BY m.rowid "
-       " LIMIT 1",
-       last->rowid);
+       " FROM memory.collected_images AS m"
+       " WHERE m.rowid %s %d"
+       " ORDER BY m.rowid %s"
+       " LIMIT %d",
+       count > 0 ? ">" : "<", rowid, count > 0 ? "" : "DESC", abs(count));
     // clang-format on
   }
+  int nb = 0;
   DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db), query, -1, &stmt, NULL);
-  if(sqlite3_step(stmt) == SQLITE_ROW)
-  {
-    const dt_imgid_t id = sqlite3_column_int(stmt, 0);
-    if(dt_is_valid_imgid(id))
-      dt_mipmap_cache_get(darktable.mipmap_cache, NULL, id, mip, DT_MIPMAP_PREFETCH, 'r');
-  }
+  while(sqlite3_step(stmt) == SQLITE_ROW)
+    imgs[nb++] = sqlite3_column_int(stmt, 0);
   sqlite3_finalize(stmt);
   g_free(query);
+  return nb;
+}
 
-  // prefetch previous image
-  dt_thumbnail_t *prev = (table->list)->data;
-  if(table->navigate_inside_selection)
+static void _thumbs_prefetch(dt_culling_t *table)
+{
+  if(!table->list) return;
+
+  // get the mip level by using the max image size actually shown
+  int maxw = 0;
+  int maxh = 0;
+  for(GList *l = table->list; l; l = g_list_next(l))
   {
-    // clang-format off
-    query = g_strdup_printf
-      ("SELECT m.imgid"
-       " FROM memory.collected_images AS m, main.selected_images AS s"
-       " WHERE m.imgid = s.imgid"
-       "   AND m.rowid < %d"
-       " ORDER BY m.rowid DESC "
-       " LIMIT 1",
-       prev->rowid);
-    // clang-format on
+    dt_thumbnail_t *th = l->data;
+    maxw = MAX(maxw, th->width);
+    maxh = MAX(maxh, th->height);
   }
+  dt_mipmap_size_t mip =
+    dt_mipmap_cache_get_matching_size(darktable.mipmap_cache, maxw, maxh);
+
+  const dt_thumbnail_t *first = table->list->data;
+  const dt_thumbnail_t *last = g_list_last(table->list)->data;
+  const int ahead = dt_mipmap_prefetch_motion_ahead(&table->prefetch, table->thumbs_count);
+
+  dt_imgid_t imgs[DT_MIPMAP_PREFETCH_MAX];
+  int count = 0;
+  if(ahead > 0)
+    count = _thumbs_get_neighbours(table, last->rowid, ahead, imgs);
+  else if(ahead < 0)
+    count = _thumbs_get_neighbours(table, first->rowid, ahead, imgs);
   else
   {
-    // clang-format off
-    query = g_strdup_printf
-      ("SELECT m.imgid"
-       " FROM memory.collected_images AS m"
-       " WHERE m.rowid < %d"
-       " ORDER BY m.rowid DESC "
-       " LIMIT 1",
-       prev->rowid);
-    // clang-format on
-  }
-  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db), query, -1, &stmt, NULL);
-  if(sqlite3_step(stmt) == SQLITE_ROW)
-  {
-    const dt_imgid_t id = sqlite3_column_int(stmt, 0);
-    if(dt_is_valid_imgid(id))
-      dt_mipmap_cache_get(darktable.mipmap_cache, NULL, id, mip, DT_MIPMAP_PREFETCH, 'r');
+    // not navigating, next and previous image
+    count = _thumbs_get_neighbours(table, last->rowid, 1, imgs);
+    count += _thumbs_get_neighbours(table, first->rowid, -1, imgs + count);
   }
-  sqlite3_finalize(stmt);
+
+  dt_mipmap_cache_prefetch(darktable.mipmap_cache, table, imgs, count, mip);
 }
 
 static gboolean _thumbs_recreate_list_at(dt_culling_t *table,
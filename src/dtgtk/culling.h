@@ -16,6 +16,7 @@
     along with darktable.  If not, see <http://www.gnu.org/licenses/>.
 */
 /** a class to manage a collection of zoomable thumbnails for culling or full preview.  */
+#include "common/mipmap_cache.h"
 #include "dtgtk/thumbnail.h"
 #include <gtk/gtk.h>
 
@@ -60,6 +61,8 @@ typedef struct dt_culling_t
 
   gboolean select_desactivate;
 
+  dt_mipmap_prefetch_motion_t prefetch; // recent moves, to prefetch the next images
+
   // the global zoom level of all images in the culling view.
   // scales images from 0 "image to fit" to 1 "100% zoom".
   float zoom_ratio;
@@ -670,6 +670,7 @@ static gboolean _event_image_draw(GtkWidget *widget,
       // get new surface with preview image
       const int buf_width = dev->preview_pipe->backbuf_width;
       const int buf_height = dev->preview_pipe->backbuf_height;
+      const dt_hash_t buf_hash = dev->preview_pipe->backbuf_hash;
 
       const size_t bbufsize = sizeof(uint8_t) * 4 * buf_width * buf_height;
       uint8_t *rgbbuf = dt_alloc_align_uint8(bbufsize);
@@ -710,11 +711,23 @@ static gboolean _event_image_draw(GtkWidget *widget,
 
         if(darktable.gui->show_focus_peaking)
         {
-          cairo_save(cr2);
-          cairo_scale(cr2, 1.0f/scale, 1.0f/scale);
-          dt_focuspeaking(cr2, img_width, img_height,
-                          cairo_image_surface_get_data(thumb->img_surf));
-          cairo_restore(cr2);
+          // computed in the background, ask again until it is there
+          cairo_surface_flush(thumb->img_surf);
+          gboolean ready = FALSE;
+          cairo_surface_t *overlay =
+            dt_focuspeaking_get_overlay(thumb->imgid, DT_MIPMAP_NONE, buf_hash,
+                                        img_width, img_height,
+                                        cairo_image_surface_get_data(thumb->img_surf), &ready);
+          if(overlay)
+          {
+            cairo_save(cr2);
+            cairo_scale(cr2, 1.0f/scale, 1.0f/scale);
+            dt_focuspeaking_paint(cr2, overlay);
+            cairo_restore(cr2);
+            cairo_surface_destroy(overlay);
+          }
+          if(!ready)
+            res = DT_VIEW_SURFACE_SMALLER;
         }
         cairo_surface_destroy(tmp_surface);
         cairo_destroy(cr2);
@@ -798,6 +811,7 @@ static gboolean _event_image_draw(GtkWidget *widget,
     if(res != DT_VIEW_SURFACE_OK)
     {
       thumb->busy = TRUE;
+      thumb->img_surf_dirty = TRUE;
       if(!thumb->expose_again_timeout_id)
         thumb->expose_again_timeout_id = g_timeout_add(250, _thumb_expose_again, thumb);
     }
@@ -811,7 +825,7 @@ static gboolean _event_image_draw(GtkWidget *widget,
       char path[PATH_MAX] = { 0 };
       gboolean from_cache = TRUE;
       dt_image_full_path(thumb->imgid, path, sizeof(path), &from_cache);
-      if(!dt_imageio_large_thumbnail(path, &full_res_thumb,
+      if(!dt_imageio_large_thumbnail(path, 0, 0, &full_res_thumb,
                                      &full_res_thumb_wd, &full_res_thumb_ht,
                                      &color_space))
       {
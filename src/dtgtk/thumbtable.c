@@ -225,36 +225,146 @@ static dt_thumbnail_t *_thumb_get_under_mouse(dt_thumbtable_t *table)
   return _thumb_get_at_pos(table, x, y);
 }
 
-// get imgid from rowid
-static dt_imgid_t _thumb_get_imgid(int rowid)
+// the positions of the images of memory.collected_images (its rowid)
+// are looked up very often while scrolling, so the imgids are kept in
+// pages of consecutive rowids loaded on demand around the viewport.
+#define DT_THUMBTABLE_PAGE_SIZE 1024
+#define DT_THUMBTABLE_PAGES 16
+
+typedef struct dt_thumbtable_page_t
 {
-  dt_imgid_t id = NO_IMGID;
-  sqlite3_stmt *stmt;
-  gchar *query = g_strdup_printf
-    ("SELECT imgid FROM memory.collected_images WHERE rowid=%d", rowid);
-  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db), query, -1, &stmt, NULL);
-  if(sqlite3_step(stmt) == SQLITE_ROW)
+  int page;        // first rowid is page * DT_THUMBTABLE_PAGE_SIZE + 1, -1 if unused
+  int count;       // number of rowids loaded
+  uint32_t used;   // last access, for the lru eviction
+  dt_imgid_t imgid[DT_THUMBTABLE_PAGE_SIZE];
+} dt_thumbtable_page_t;
+
+static struct
+{
+  dt_thumbtable_page_t pages[DT_THUMBTABLE_PAGES];
+  uint32_t generation; // of memory.collected_images the pages are loaded from
+  uint32_t clock;
+  int last_page;       // to get the scrolling direction
+} _index = { .generation = UINT32_MAX };
+
+static void _index_invalidate(void)
+{
+  for(int k = 0; k < DT_THUMBTABLE_PAGES; k++)
+    _index.pages[k].page = -1;
+  _index.last_page = -1;
+  _index.generation = dt_collection_memory_generation();
+}
+
+// the collection may be updated without raising a signal
+static void _index_check(void)
+{
+  if(_index.generation != dt_collection_memory_generation())
+    _index_invalidate();
+}
+
+static dt_thumbtable_page_t *_index_find_page(const int page)
+{
+  _index_check();
+
+  for(int k = 0; k < DT_THUMBTABLE_PAGES; k++)
+    if(_index.pages[k].page == page) return &_index.pages[k];
+  return NULL;
+}
+
+static dt_thumbtable_page_t *_index_load_page(const int page)
+{
+  dt_thumbtable_page_t *p = _index_find_page(page);
+  if(p) return p;
+
+  // use a free page or the least recently used one
+  for(int k = 0; k < DT_THUMBTABLE_PAGES; k++)
   {
-    id = sqlite3_column_int(stmt, 0);
+    dt_thumbtable_page_t *c = &_index.pages[k];
+    if(c->page < 0)
+    {
+      p = c;
+      break;
+    }
+    if(!p || c->used < p->used) p = c;
   }
-  g_free(query);
-  sqlite3_finalize(stmt);
-  return id;
+
+  const int first = page * DT_THUMBTABLE_PAGE_SIZE + 1;
+  p->page = page;
+  p->count = 0;
+  p->used = _index.clock;
+  for(int k = 0; k < DT_THUMBTABLE_PAGE_SIZE; k++)
+    p->imgid[k] = NO_IMGID;
+
+  // clang-format off
+  sqlite3_stmt *stmt = dt_database_prepare_cached
+    (darktable.db,
+     "SELECT rowid, imgid FROM memory.collected_images"
+     " WHERE rowid BETWEEN ?1 AND ?2");
+  // clang-format on
+  DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, first);
+  DT_DEBUG_SQLITE3_BIND_INT(stmt, 2, first + DT_THUMBTABLE_PAGE_SIZE - 1);
+  while(sqlite3_step(stmt) == SQLITE_ROW)
+  {
+    const int k = sqlite3_column_int(stmt, 0) - first;
+    p->imgid[k] = sqlite3_column_int(stmt, 1);
+    p->count = MAX(p->count, k + 1);
+  }
+  dt_database_release_cached(darktable.db, stmt);
+
+  return p;
+}
+
+// get imgid from rowid
+static dt_imgid_t _thumb_get_imgid(const int rowid)
+{
+  if(rowid < 1) return NO_IMGID;
+
+  const int page = (rowid - 1) / DT_THUMBTABLE_PAGE_SIZE;
+  dt_thumbtable_page_t *p = _index_load_page(page);
+  p->used = ++_index.clock;
+
+  // entering a neighbour page, load the next one in the scrolling direction
+  const int dir = page - _index.last_page;
+  if(_index.last_page >= 0 && (dir == 1 || dir == -1)
+     && page + dir >= 0 && p->count == DT_THUMBTABLE_PAGE_SIZE)
+    _index_load_page(page + dir);
+  _index.last_page = page;
+
+  const int k = rowid - 1 - page * DT_THUMBTABLE_PAGE_SIZE;
+  return k < p->count ? p->imgid[k] : NO_IMGID;
 }
 // get rowid from imgid
 static int _thumb_get_rowid(dt_imgid_t imgid)
 {
+  if(!dt_is_valid_imgid(imgid)) return -1;
+
+  // the image is most likely in one of the pages around the viewport
+  _index_check();
+  for(int j = 0; j < DT_THUMBTABLE_PAGES; j++)
+  {
+    dt_thumbtable_page_t *p = &_index.pages[j];
+    if(p->page < 0) continue;
+    for(int k = 0; k < p->count; k++)
+      if(p->imgid[k] == imgid)
+      {
+        p->used = ++_index.clock;
+        return p->page * DT_THUMBTABLE_PAGE_SIZE + k + 1;
+      }
+  }
+
   int id = -1;
-  sqlite3_stmt *stmt;
-  gchar *query = g_strdup_printf
-    ("SELECT rowid FROM memory.collected_images WHERE imgid=%d", imgid);
-  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db), query, -1, &stmt, NULL);
+  sqlite3_stmt *stmt = dt_database_prepare_cached
+    (darktable.db, "SELECT rowid FROM memory.collected_images WHERE imgid = ?1");
+  DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, imgid);
   if(sqlite3_step(stmt) == SQLITE_ROW)
   {
     id = sqlite3_column_int(stmt, 0);
   }
-  g_free(query);
-  sqlite3_finalize(stmt);
+  dt_database_release_cached(darktable.db, stmt);
+
+  // its neighbours are likely to be looked up next
+  if(id > 0)
+    _index_load_page((id - 1) / DT_THUMBTABLE_PAGE_SIZE)->used = ++_index.clock;
   return id;
 }
 
@@ -690,6 +800,42 @@ static int _thumbs_load_needed(dt_thumbtable_t *table,
   return changed;
 }
 
+// load the thumbnails about to be shown while scrolling
+static void _thumbs_prefetch(dt_thumbtable_t *table)
+{
+  if(!table->list) return;
+
+  const int visible = table->thumbs_per_row * table->rows;
+  const int ahead = dt_mipmap_prefetch_motion_ahead(&table->prefetch, visible);
+  if(ahead == 0) return;
+
+  // same size as the thumbnails currently shown
+  const dt_thumbnail_t *first = table->list->data;
+  const dt_thumbnail_t *last = g_list_last(table->list)->data;
+  int image_w = 0;
+  int image_h = 0;
+  gtk_widget_get_size_request(first->w_image_box, &image_w, &image_h);
+  if(image_w <= 0 || image_h <= 0)
+    image_w = image_h = table->thumb_size;
+  const dt_mipmap_size_t mip =
+    dt_mipmap_cache_get_matching_size(darktable.mipmap_cache,
+                                      image_w * darktable.gui->ppd,
+                                      image_h * darktable.gui->ppd);
+
+  dt_imgid_t imgs[DT_MIPMAP_PREFETCH_MAX];
+  const int start = ahead > 0 ? last->rowid : first->rowid;
+  const int dir = ahead > 0 ? 1 : -1;
+  int count = 0;
+  for(int k = 1; k <= abs(ahead); k++)
+  {
+    const dt_imgid_t imgid = _thumb_get_imgid(start + dir * k);
+    if(!dt_is_valid_imgid(imgid)) break;
+    imgs[count++] = imgid;
+  }
+
+  dt_mipmap_cache_prefetch(darktable.mipmap_cache, table, imgs, count, mip);
+}
+
 // move all thumbs from the table.
 // if clamp, we verify that the move is allowed (collection bounds, etc...)
 static gboolean _move(dt_thumbtable_t *table,
@@ -801,6 +947,7 @@ static gboolean _move(dt_thumbtable_t *table,
     _pos_compute_area(table);
 
   // we update the offset
+  const int old_offset = table->offset;
   if(table->mode == DT_THUMBTABLE_MODE_FILEMANAGER)
   {
     // we need to take account of the previous area move if needed
@@ -821,6 +968,14 @@ static gboolean _move(dt_thumbtable_t *table,
     table->offset_imgid = nfirst->imgid;
   }
 
+  // the thumbs of the new offset are in the list now, load the next ones.
+  // the zoomable mode moves freely in both directions, nothing to predict
+  if(table->mode != DT_THUMBTABLE_MODE_ZOOM && table->offset != old_offset)
+  {
+    dt_mipmap_prefetch_motion_update(&table->prefetch, table->offset - old_offset);
+    _thumbs_prefetch(table);
+  }
+
   // and we store it
   dt_conf_set_int("plugins/lighttable/collect/history_pos0", table->offset);
   if(table->mode == DT_THUMBTABLE_MODE_ZOOM)
@@ -1947,6 +2102,9 @@ static void _dt_collection_changed_callback(gpointer instance,
   if(!table)
     return;
 
+  // the rowids of memory.collected_images have changed
+  _index_invalidate();
+
   dt_collection_history_save();
 
   if(query_change == DT_COLLECTION_CHANGE_RELOAD)
@@ -16,6 +16,7 @@
     along with darktable.  If not, see <http://www.gnu.org/licenses/>.
 */
 /** a class to manage a table of thumbnail for lighttable and filmstrip.  */
+#include "common/mipmap_cache.h"
 #include "dtgtk/thumbnail.h"
 #include <gtk/gtk.h>
 
@@ -106,6 +107,9 @@ typedef struct dt_thumbtable_t
   guint scroll_timeout_id;
   float scroll_value;
 
+  // recent scrolling, to prefetch the next thumbnails
+  dt_mipmap_prefetch_motion_t prefetch;
+
   // darkroom selection from filmstrip (support for single & double click)
   guint sel_single_cb;
   dt_imgid_t to_selid;
@@ -23,6 +23,7 @@
 #include "common/collection.h"
 #include "common/colorspaces.h"
 #include "common/file_location.h"
+#include "common/focus_peaking.h"
 #include "common/l10n.h"
 #include "common/image.h"
 #include "common/image_cache.h"
@@ -220,6 +221,9 @@ static void _focuspeaking_switch_button_callback(GtkWidget *button,
   darktable.gui->show_focus_peaking = state_new;
   dt_pthread_mutex_unlock(&darktable.gui->mutex);
 
+  // no need to keep the overlays around
+  if(!state_new) dt_focuspeaking_remove(NO_IMGID);
+
   gtk_widget_queue_draw(button);
 
   // make sure the second window if active is updated
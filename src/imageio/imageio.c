@@ -609,8 +609,286 @@ dt_image_flags_t dt_imageio_get_type_from_extension(const char *extension)
   return 0;
 }
 
+// the embedded JPEG previews of the common raw containers are found
+// by walking their structure, which is a lot cheaper than having
+// exiv2 parse all the metadata. anything else is left to exiv2.
+typedef struct _preview_t
+{
+  size_t offset, length;
+  int width, height;
+} _preview_t;
+
+#define MAX_PREVIEWS 16
+
+static inline uint32_t _get_u16(const uint8_t *p,
+                                const gboolean be)
+{
+  return be ? (p[0] << 8) | p[1] : p[0] | (p[1] << 8);
+}
+
+static inline uint32_t _get_u32(const uint8_t *p,
+                                const gboolean be)
+{
+  return be ? ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]
+            : p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static gboolean _read_at(FILE *f,
+                         const size_t offset,
+                         void *out,
+                         const size_t length)
+{
+  return fseek(f, (long)offset, SEEK_SET) || fread(out, 1, length, f) != length;
+}
+
+// looks at the frame header of the JPEG, returns TRUE if it is
+// nothing libjpeg decodes into 8 bit RGB, as the lossless JPEG of a
+// raw image
+static gboolean _frame_check(const uint8_t *head,
+                             const size_t length,
+                             _preview_t *p)
+{
+  if(head[0] != 0xff || head[1] != 0xd8) return TRUE;
+
+  size_t i = 2;
+  while(i + 4 <= length)
+  {
+    if(head[i] != 0xff) return TRUE;
+    const uint8_t marker = head[i + 1];
+    if(marker == 0xff)
+    {
+      i++;
+      continue;
+    }
+    // markers without a segment
+    if(marker == 0x01 || (marker >= 0xd0 && marker <= 0xd7))
+    {
+      i += 2;
+      continue;
+    }
+    // start of frame, the huffman and arithmetic coding ones
+    if(marker >= 0xc0 && marker <= 0xcf
+       && marker != 0xc4 && marker != 0xc8 && marker != 0xcc)
+    {
+      if(i + 10 > length) return TRUE;
+      p->height = _get_u16(head + i + 5, TRUE);
+      p->width = _get_u16(head + i + 7, TRUE);
+      // baseline, extended and progressive 8 bit only
+      return marker > 0xc2 || head[i + 4] != 8 || p->width == 0 || p->height == 0;
+    }
+    // start of scan or end of image before any frame
+    if(marker == 0xda || marker == 0xd9) return TRUE;
+    i += 2 + _get_u16(head + i + 2, TRUE);
+  }
+  return TRUE;
+}
+
+static gboolean _preview_check(FILE *f,
+                               _preview_t *p)
+{
+  // the frame header follows the exif and icc markers
+  const size_t length = MIN(p->length, 65536 + 4096);
+  uint8_t *head = length < 4 ? NULL : malloc(length);
+  const gboolean res = !head || _read_at(f, p->offset, head, length)
+    || _frame_check(head, length, p);
+  free(head);
+  return res;
+}
+
+static void _preview_add(_preview_t *previews,
+                         int *count,
+                         const size_t offset,
+                         const size_t length)
+{
+  if(*count < MAX_PREVIEWS && offset && length)
+    previews[(*count)++] = (_preview_t){ .offset = offset, .length = length };
+}
+
+static void _tiff_previews(FILE *f,
+                           const gboolean be,
+                           uint32_t ifd,
+                           const int depth,
+                           _preview_t *previews,
+                           int *count)
+{
+  // the chain of the main ifds, for the sub ifds their own chain
+  for(int n = 0; n < 8 && ifd; n++)
+  {
+    uint8_t head[2];
+    if(_read_at(f, ifd, head, 2)) return;
+    const uint32_t entries = _get_u16(head, be);
+    if(entries == 0 || entries > 1000) return;
+
+    uint8_t *dir = malloc((size_t)12 * entries + 4);
+    if(!dir || _read_at(f, ifd + 2, dir, (size_t)12 * entries + 4))
+    {
+      free(dir);
+      return;
+    }
+
+    uint32_t jpeg_offset = 0, jpeg_length = 0;
+    uint32_t strip_offset = 0, strip_length = 0;
+    uint32_t compression = 0, subfile_type = 0;
+    uint32_t subifds[8];
+    int nsubifds = 0;
+
+    for(uint32_t k = 0; k < entries; k++)
+    {
+      const uint8_t *e = dir + 12 * k;
+      const uint32_t tag = _get_u16(e, be);
+      const uint32_t type = _get_u16(e + 2, be);
+      const uint32_t cnt = _get_u32(e + 4, be);
+      // shorts are stored left justified in the value field
+      const uint32_t value = type == 3 ? _get_u16(e + 8, be) : _get_u32(e + 8, be);
+      switch(tag)
+      {
+        case 0x00fe: subfile_type = value; break;
+        case 0x0103: compression = value; break;
+        case 0x0111: if(cnt == 1) strip_offset = value; break;
+        case 0x0117: if(cnt == 1) strip_length = value; break;
+        case 0x0201: jpeg_offset = value; break;
+        case 0x0202: jpeg_length = value; break;
+        // JpgFromRaw of panasonic's rw2
+        case 0x002e: if(type == 7) _preview_add(previews, count, value, cnt); break;
+        case 0x014a:
+          if(cnt == 1 && nsubifds < 8)
+            subifds[nsubifds++] = value;
+          else if(cnt > 1 && nsubifds < 8)
+          {
+            uint8_t offsets[4 * 8];
+            nsubifds = MIN(cnt, 8);
+            if(_read_at(f, value, offsets, 4 * nsubifds))
+              nsubifds = 0;
+            for(int s = 0; s < nsubifds; s++)
+              subifds[s] = _get_u32(offsets + 4 * s, be);
+          }
+          break;
+        default: break;
+      }
+    }
+    const uint32_t next = _get_u32(dir + 12 * entries, be);
+    free(dir);
+
+    _preview_add(previews, count, jpeg_offset, jpeg_length);
+    // old style JPEG, or new style in a reduced resolution image as in
+    // DNG previews. the frame header check leaves out lossless raw data.
+    if(compression == 6 || (compression == 7 && (subfile_type & 1)))
+      _preview_add(previews, count, strip_offset, strip_length);
+
+    if(depth < 2)
+      for(int s = 0; s < nsubifds; s++)
+        _tiff_previews(f, be, subifds[s], depth + 1, previews, count);
+
+    ifd = next;
+  }
+}
+
+static void _cr3_previews(FILE *f,
+                          _preview_t *previews,
+                          int *count)
+{
+  static const uint8_t prvw_uuid[16] = { 0xea, 0xf4, 0x2b, 0x5e, 0x1c, 0x98, 0x4b, 0x88,
+                                         0xb9, 0xfb, 0xb7, 0xdc, 0x40, 0x6e, 0x4d, 0x16 };
+  size_t offset = 0;
+  for(int n = 0; n < 64; n++)
+  {
+    uint8_t box[24 + 8];
+    if(_read_at(f, offset, box, 16)) return;
+    uint64_t size = _get_u32(box, TRUE);
+    if(size == 1)
+      size = ((uint64_t)_get_u32(box + 8, TRUE) << 32) | _get_u32(box + 12, TRUE);
+    if(size < 8) return;
+
+    if(!memcmp(box + 4, "uuid", 4))
+    {
+      uint8_t uuid[16];
+      // PRVW is the box following 8 unknown bytes after the uuid
+      if(!_read_at(f, offset + 8, uuid, 16)
+         && !memcmp(uuid, prvw_uuid, 16)
+         && !_read_at(f, offset + 32, box, 24)
+         && !memcmp(box + 4, "PRVW", 4))
+        _preview_add(previews, count, offset + 32 + 24, _get_u32(box + 20, TRUE));
+    }
+    offset += size;
+  }
+}
+
+// reads the JPEG preview of a raw file, the smallest one still as
+// large as the image fitted into fit_width x fit_height, or the
+// largest one if none or no fit size is given. large tells whether it
+// covers the fit size. returns TRUE if none was found.
+static gboolean _raw_preview(const char *filename,
+                             const int32_t fit_width,
+                             const int32_t fit_height,
+                             uint8_t **buffer,
+                             size_t *size,
+                             gboolean *large)
+{
+  FILE *f = g_fopen(filename, "rb");
+  if(!f) return TRUE;
+
+  _preview_t previews[MAX_PREVIEWS];
+  int count = 0;
+
+  uint8_t head[96];
+  if(!_read_at(f, 0, head, sizeof(head)))
+  {
+    const gboolean be = head[0] == 'M' && head[1] == 'M';
+    const uint32_t magic = _get_u16(head + 2, be);
+    if(!memcmp(head, "FUJIFILMCCD-RAW ", 16))
+      _preview_add(previews, &count, _get_u32(head + 84, TRUE), _get_u32(head + 88, TRUE));
+    else if(!memcmp(head + 4, "ftypcrx ", 8))
+      _cr3_previews(f, previews, &count);
+    // tiff, olympus' orf and panasonic's rw2
+    else if((be || (head[0] == 'I' && head[1] == 'I'))
+            && (magic == 42 || magic == 0x4f52 || magic == 0x5352 || magic == 0x55))
+      _tiff_previews(f, be, _get_u32(head + 4, be), 0, previews, &count);
+  }
+
+  const _preview_t *best = NULL;
+  for(int k = 0; k < count; k++)
+  {
+    _preview_t *p = previews + k;
+    if(_preview_check(f, p)) continue;
+    const gboolean large = fit_width > 0 && fit_height > 0
+      && (p->width >= fit_width || p->height >= fit_height);
+    const gboolean best_large = best && fit_width > 0 && fit_height > 0
+      && (best->width >= fit_width || best->height >= fit_height);
+    const size_t pixels = (size_t)p->width * p->height;
+    const size_t best_pixels = best ? (size_t)best->width * best->height : 0;
+    if(!best
+       || (large && (!best_large || pixels < best_pixels))
+       || (!large && !best_large && pixels > best_pixels))
+      best = p;
+  }
+
+  gboolean res = TRUE;
+  if(best)
+  {
+    *large = fit_width > 0 && fit_height > 0
+      && (best->width >= fit_width || best->height >= fit_height);
+    *buffer = malloc(best->length);
+    if(*buffer && !_read_at(f, best->offset, *buffer, best->length))
+    {
+      *size = best->length;
+      res = FALSE;
+    }
+    else
+    {
+      free(*buffer);
+      *buffer = NULL;
+    }
+  }
+  fclose(f);
+  return res;
+}
+
+#undef MAX_PREVIEWS
+
 // load a full-res thumbnail:
 gboolean dt_imageio_large_thumbnail(const char *filename,
+                                    const int32_t fit_width,
+                                    const int32_t fit_height,
                                     uint8_t **buffer,
                                     int32_t *width,
                                     int32_t *height,
@@ -622,9 +900,41 @@ gboolean dt_imageio_large_thumbnail(const char *filename,
   char *mime_type = NULL;
   size_t bufsize;
 
-  // get the biggest thumb from exif
-  if(dt_exif_get_thumbnail(filename, &buf, &bufsize, &mime_type))
-    goto error;
+  const double start = dt_get_debug_wtime();
+
+  // get the preview from the raw container, or the biggest thumb from exif
+  gboolean large = FALSE;
+  gboolean from_container =
+    !_raw_preview(filename, fit_width, fit_height, &buf, &bufsize, &large);
+
+  // some formats keep the large preview in the makernote (e.g. olympus'
+  // orf) where only exiv2 finds it, the container may only have the
+  // small thumbnail
+  if(from_container && !large && fit_width > 0 && fit_height > 0)
+  {
+    uint8_t *exif_buf = NULL;
+    char *exif_mime_type = NULL;
+    size_t exif_size = 0;
+    if(!dt_exif_get_thumbnail(filename, &exif_buf, &exif_size, &exif_mime_type))
+    {
+      free(buf);
+      buf = exif_buf;
+      bufsize = exif_size;
+      mime_type = exif_mime_type;
+    }
+    else
+      free(exif_mime_type);
+  }
+
+  if(!mime_type)
+  {
+    if(from_container)
+      mime_type = strdup("image/jpeg");
+    else if(dt_exif_get_thumbnail(filename, &buf, &bufsize, &mime_type))
+      goto error;
+  }
+  else
+    from_container = FALSE;
 
   if(strcmp(mime_type, "image/jpeg") == 0)
   {
@@ -633,7 +943,12 @@ gboolean dt_imageio_large_thumbnail(const char *filename,
     if(dt_imageio_jpeg_decompress_header(buf, bufsize, &jpg))
       goto error;
 
-    *buffer = dt_alloc_align_uint8(4 * jpg.width * jpg.height);
+    // let libjpeg skip what the fitted image doesn't need
+    const int full_width = jpg.width;
+    const int full_height = jpg.height;
+    dt_imageio_jpeg_set_scale(&jpg, fit_width, fit_height);
+
+    *buffer = dt_alloc_align_uint8((size_t)4 * jpg.width * jpg.height);
     if(!*buffer) goto error;
 
     *width = jpg.width;
@@ -648,6 +963,11 @@ gboolean dt_imageio_large_thumbnail(const char *filename,
       goto error;
     }
 
+    dt_print(DT_DEBUG_IMAGEIO | DT_DEBUG_PERF,
+             "[dt_imageio_large_thumbnail] %dx%d preview from %s decoded at %dx%d in %0.04f sec",
+             full_width, full_height, from_container ? "container" : "exiv2",
+             jpg.width, jpg.height, dt_get_debug_wtime() - start);
+
     res = FALSE;
   }
   else
@@ -786,7 +1106,7 @@ gboolean dt_imageio_has_mono_preview(const char *filename)
   int32_t thumb_width = 0, thumb_height = 0;
   gboolean mono = FALSE;
 
-  if(dt_imageio_large_thumbnail(filename, &tmp, &thumb_width,
+  if(dt_imageio_large_thumbnail(filename, 0, 0, &tmp, &thumb_width,
                                 &thumb_height, &color_space))
     goto cleanup;
   if((thumb_width < 32) || (thumb_height < 32) || (tmp == NULL))
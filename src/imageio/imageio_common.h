@@ -158,7 +158,11 @@ void dt_imageio_flip_buffers_ui8_to_float(float *out,
                                           const dt_image_orientation_t orientation);
 
 // allocate buffer and return 0 on success along with largest jpg thumbnail from raw.
+// with fit_width and fit_height set the smallest thumbnail still covering the image
+// fitted into that box is taken and decoded at the lowest resolution doing so.
 gboolean dt_imageio_large_thumbnail(const char *filename,
+                               const int32_t fit_width,
+                               const int32_t fit_height,
                                uint8_t **buffer,
                                int32_t *width,
                                int32_t *height,
@@ -46,6 +46,10 @@ typedef struct dt_imageio_jpeg_t
 
 /** reads the header and fills width/height in jpg struct. */
 int dt_imageio_jpeg_decompress_header(const void *in, size_t length, dt_imageio_jpeg_t *jpg);
+/** lets libjpeg decode at 1/2, 1/4 or 1/8 of the size, the largest reduction still at least as large as the
+ * image fitted into fit_width x fit_height, and updates width/height in jpg struct. call after reading the
+ * header, no reduction if the fit size is 0. */
+void dt_imageio_jpeg_set_scale(dt_imageio_jpeg_t *jpg, const int fit_width, const int fit_height);
 /** reads the whole image to the out buffer, which has to be large enough. */
 int dt_imageio_jpeg_decompress(dt_imageio_jpeg_t *jpg, uint8_t *out);
 /** compresses in to out buffer with given quality (0..100). out buffer must be large enough. returns actual
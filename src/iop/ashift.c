@@ -1077,6 +1077,50 @@ gboolean distort_backtransform(dt_iop_module_t *self,
   return TRUE;
 }
 
+gboolean distort_warp(dt_iop_module_t *self,
+                      dt_dev_pixelpipe_iop_t *piece,
+                      const dt_iop_roi_t *const roi_in,
+                      const dt_iop_roi_t *const roi_out,
+                      float *const points,
+                      const size_t points_count)
+{
+  // the preview pipe keeps a copy of our input for the structure detection
+  if(self->gui_data && self->dev->gui_attached
+     && (piece->pipe->type & DT_DEV_PIXELPIPE_PREVIEW))
+    return FALSE;
+
+  const dt_iop_ashift_data_t *const data = piece->data;
+
+  // nothing to be done if parameters are set to neutral values
+  if(isneutral(data)) return TRUE;
+
+  float DT_ALIGNED_ARRAY ihomograph[3][3];
+  _homography((float *)ihomograph, data->rotation, data->lensshift_v, data->lensshift_h,
+              data->shear, data->f_length_kb,
+              data->orthocorr, data->aspect,
+              piece->buf_in.width, piece->buf_in.height, ASHIFT_HOMOGRAPH_INVERTED);
+
+  // clipping offset, as in process()
+  const float fullwidth = (float)piece->buf_out.width / (data->cr - data->cl);
+  const float fullheight = (float)piece->buf_out.height / (data->cb - data->ct);
+  const float cx = roi_out->scale * fullwidth * data->cl;
+  const float cy = roi_out->scale * fullheight * data->ct;
+
+  DT_OMP_FOR(if(points_count > 100) shared(ihomograph))
+  for(size_t i = 0; i < points_count * 2; i += 2)
+  {
+    float DT_ALIGNED_PIXEL pout[3] = { (roi_out->x + points[i] + cx) / roi_out->scale,
+                                       (roi_out->y + points[i + 1] + cy) / roi_out->scale,
+                                       1.0f };
+    float DT_ALIGNED_PIXEL pin[3];
+    mat3mulv(pin, (float *)ihomograph, pout);
+    points[i] = pin[0] / pin[2] * roi_in->scale - roi_in->x;
+    points[i + 1] = pin[1] / pin[2] * roi_in->scale - roi_in->y;
+  }
+
+  return TRUE;
+}
+
 void distort_mask(struct dt_iop_module_t *self,
                   struct dt_dev_pixelpipe_iop_t *piece,
                   const float *const in,
@@ -207,6 +207,11 @@ typedef struct dt_iop_channelmixer_rbg_data_t
   dt_adaptation_t adaptation;
   dt_illuminant_t illuminant_type;
   dt_iop_channelmixer_rgb_version_t version;
+  // conversions for the adaptation, set up for process_pointwise()
+  dt_colormatrix_t RGB_to_XYZ_trans;
+  dt_colormatrix_t RGB_to_LMS_trans;
+  dt_colormatrix_t MIX_to_XYZ_trans;
+  dt_colormatrix_t XYZ_to_RGB_trans;
 } dt_iop_channelmixer_rbg_data_t;
 
 typedef struct dt_iop_channelmixer_rgb_global_data_t
@@ -761,25 +766,14 @@ static inline void _luma_chroma(const dt_aligned_pixel_t input,
   }
 }
 
-DT_OMP_DECLARE_SIMD(aligned(in, out, XYZ_to_RGB, RGB_to_XYZ, MIX : 64) aligned(illuminant, saturation, lightness, grey:16))
-static inline void _loop_switch(const float *const restrict in,
-                                float *const restrict out,
-                                const size_t width,
-                                const size_t height,
-                                const size_t ch,
-                                const dt_colormatrix_t XYZ_to_RGB,
-                                const dt_colormatrix_t RGB_to_XYZ,
-                                const dt_colormatrix_t MIX,
-                                const dt_aligned_pixel_t illuminant,
-                                const dt_aligned_pixel_t saturation,
-                                const dt_aligned_pixel_t lightness,
-                                const dt_aligned_pixel_t grey,
-                                const float p,
-                                const float gamut,
-                                const gboolean clip,
-                                const gboolean apply_grey,
-                                const dt_adaptation_t kind,
-                                const dt_iop_channelmixer_rgb_version_t version)
+static inline void _prepare_matrices(const dt_colormatrix_t XYZ_to_RGB,
+                                     const dt_colormatrix_t RGB_to_XYZ,
+                                     const dt_colormatrix_t MIX,
+                                     const dt_adaptation_t kind,
+                                     dt_colormatrix_t RGB_to_XYZ_trans,
+                                     dt_colormatrix_t RGB_to_LMS_trans,
+                                     dt_colormatrix_t MIX_to_XYZ_trans,
+                                     dt_colormatrix_t XYZ_to_RGB_trans)
 {
   dt_colormatrix_t RGB_to_LMS = { { 0.0f, 0.0f, 0.0f, 0.0f } };
   dt_colormatrix_t MIX_to_XYZ = { { 0.0f, 0.0f, 0.0f, 0.0f } };
@@ -805,96 +799,149 @@ static inline void _loop_switch(const float *const restrict in,
       dt_colormatrix_mul(MIX_to_XYZ, RGB_to_XYZ, MIX);
       break;
   }
-  const float minval = clip ? 0.0f : -FLT_MAX;
-  const dt_aligned_pixel_t min_value = { minval, minval, minval, minval };
 
-  dt_colormatrix_t RGB_to_XYZ_trans;
   dt_colormatrix_transpose(RGB_to_XYZ_trans, RGB_to_XYZ);
-  dt_colormatrix_t RGB_to_LMS_trans;
   dt_colormatrix_transpose(RGB_to_LMS_trans, RGB_to_LMS);
-  dt_colormatrix_t MIX_to_XYZ_trans;
   dt_colormatrix_transpose(MIX_to_XYZ_trans, MIX_to_XYZ);
-  dt_colormatrix_t XYZ_to_RGB_trans;
   dt_colormatrix_transpose(XYZ_to_RGB_trans, XYZ_to_RGB);
+}
 
-  DT_OMP_FOR()
-  for(size_t k = 0; k < height * width * 4; k += 4)
+static inline void _pixel_switch(const float *const in,
+                                 dt_aligned_pixel_t temp_two,
+                                 const dt_colormatrix_t RGB_to_XYZ_trans,
+                                 const dt_colormatrix_t RGB_to_LMS_trans,
+                                 const dt_colormatrix_t MIX_to_XYZ_trans,
+                                 const dt_colormatrix_t XYZ_to_RGB_trans,
+                                 const dt_aligned_pixel_t illuminant,
+                                 const dt_aligned_pixel_t saturation,
+                                 const dt_aligned_pixel_t lightness,
+                                 const dt_aligned_pixel_t grey,
+                                 const dt_aligned_pixel_t min_value,
+                                 const float p,
+                                 const float gamut,
+                                 const gboolean clip,
+                                 const gboolean apply_grey,
+                                 const dt_adaptation_t kind,
+                                 const dt_iop_channelmixer_rgb_version_t version)
+{
+  // intermediate temp buffers
+  dt_aligned_pixel_t temp_one;
+
+  dt_vector_max_nan(temp_two, in, min_value);
+
+  /* WE START IN PIPELINE RGB */
+
+  switch(kind)
   {
-    // intermediate temp buffers
-    dt_aligned_pixel_t temp_one;
-    dt_aligned_pixel_t temp_two;
+    case DT_ADAPTATION_FULL_BRADFORD:
+    {
+      // Convert from RGB to XYZ
+      dt_apply_transposed_color_matrix(temp_two, RGB_to_XYZ_trans, temp_one);
+      const float Y = temp_one[1];
+
+      // Convert to LMS
+      convert_XYZ_to_bradford_LMS(temp_one, temp_two);
+      // Do white balance
+      downscale_vector(temp_two, Y);
+      bradford_adapt_D50(temp_two, illuminant, p, TRUE, temp_one);
+      upscale_vector(temp_one, Y);
+      copy_pixel(temp_two, temp_one);
+      break;
+    }
+    case DT_ADAPTATION_LINEAR_BRADFORD:
+    {
+      // Convert from RGB to XYZ to LMS
+      dt_apply_transposed_color_matrix(temp_two, RGB_to_LMS_trans, temp_one);
 
-    dt_vector_max_nan(temp_two, &in[k], min_value);
+      // Do white balance
+      bradford_adapt_D50(temp_one, illuminant, p, FALSE, temp_two);
+      break;
+    }
+    case DT_ADAPTATION_CAT16:
+    {
+      // Convert from RGB to XYZ
+      dt_apply_transposed_color_matrix(temp_two, RGB_to_LMS_trans, temp_one);
 
-    /* WE START IN PIPELINE RGB */
+      // Do white balance
+      // force full-adaptation
+      CAT16_adapt_D50(temp_one, illuminant, 1.0f, TRUE, temp_two);
+      break;
+    }
+    case DT_ADAPTATION_XYZ:
+    {
+      // Convert from RGB to XYZ
+      dt_apply_transposed_color_matrix(temp_two, RGB_to_XYZ_trans, temp_one);
 
-    switch(kind)
+      // Do white balance in XYZ
+      XYZ_adapt_D50(temp_one, illuminant, temp_two);
+      break;
+    }
+    case DT_ADAPTATION_RGB:
+    case DT_ADAPTATION_LAST:
+    default:
     {
-      case DT_ADAPTATION_FULL_BRADFORD:
-      {
-        // Convert from RGB to XYZ
-        dt_apply_transposed_color_matrix(temp_two, RGB_to_XYZ_trans, temp_one);
-        const float Y = temp_one[1];
-
-        // Convert to LMS
-        convert_XYZ_to_bradford_LMS(temp_one, temp_two);
-        // Do white balance
-        downscale_vector(temp_two, Y);
-        bradford_adapt_D50(temp_two, illuminant, p, TRUE, temp_one);
-        upscale_vector(temp_one, Y);
-        copy_pixel(temp_two, temp_one);
-        break;
-      }
-      case DT_ADAPTATION_LINEAR_BRADFORD:
-      {
-        // Convert from RGB to XYZ to LMS
-        dt_apply_transposed_color_matrix(temp_two, RGB_to_LMS_trans, temp_one);
+      // No white balance.
+      for_four_channels(c)
+        temp_one[c] = 0.0f; //keep compiler happy by ensuring that always initialized
+    }
+  }
 
-        // Do white balance
-        bradford_adapt_D50(temp_one, illuminant, p, FALSE, temp_two);
-        break;
-      }
-      case DT_ADAPTATION_CAT16:
-      {
-        // Convert from RGB to XYZ
-        dt_apply_transposed_color_matrix(temp_two, RGB_to_LMS_trans, temp_one);
+  // Compute the 3D mix - this is a rotation + homothety of the vector base
+  dt_apply_transposed_color_matrix(temp_two, MIX_to_XYZ_trans, temp_one);
 
-        // Do white balance
-        // force full-adaptation
-        CAT16_adapt_D50(temp_one, illuminant, 1.0f, TRUE, temp_two);
-        break;
-      }
-      case DT_ADAPTATION_XYZ:
-      {
-        // Convert from RGB to XYZ
-        dt_apply_transposed_color_matrix(temp_two, RGB_to_XYZ_trans, temp_one);
+  /* FROM HERE WE ARE MANDATORILY IN XYZ - DATA IS IN temp_one */
 
-        // Do white balance in XYZ
-        XYZ_adapt_D50(temp_one, illuminant, temp_two);
-        break;
-      }
-      case DT_ADAPTATION_RGB:
-      case DT_ADAPTATION_LAST:
-      default:
-      {
-        // No white balance.
-        for_four_channels(c)
-          temp_one[c] = 0.0f; //keep compiler happy by ensuring that always initialized
-      }
+  // Gamut mapping happens in XYZ space no matter what, only 0->1 values are defined
+  // for this
+  if(clip)
+    dt_vector_clipneg_nan(temp_one);
+  _gamut_mapping(temp_one, gamut, clip, temp_two);
+
+  // convert to LMS, XYZ or pipeline RGB
+  switch(kind)
+  {
+    case DT_ADAPTATION_FULL_BRADFORD:
+    case DT_ADAPTATION_LINEAR_BRADFORD:
+    case DT_ADAPTATION_CAT16:
+    case DT_ADAPTATION_XYZ:
+    {
+      convert_any_XYZ_to_LMS(temp_two, temp_one, kind);
+      break;
+    }
+    case DT_ADAPTATION_RGB:
+    case DT_ADAPTATION_LAST:
+    default:
+    {
+      // Convert from XYZ to RGB
+      dt_apply_transposed_color_matrix(temp_two, XYZ_to_RGB_trans, temp_one);
+      break;
     }
+  }
 
-    // Compute the 3D mix - this is a rotation + homothety of the vector base
-    dt_apply_transposed_color_matrix(temp_two, MIX_to_XYZ_trans, temp_one);
+  /* FROM HERE WE ARE IN LMS, XYZ OR PIPELINE RGB depending on user
+     param - DATA IS IN temp_one */
 
-    /* FROM HERE WE ARE MANDATORILY IN XYZ - DATA IS IN temp_one */
+  // Clip in LMS
+  if(clip)
+    dt_vector_clipneg_nan(temp_one);
 
-    // Gamut mapping happens in XYZ space no matter what, only 0->1 values are defined
-    // for this
-    if(clip)
-      dt_vector_clipneg_nan(temp_one);
-    _gamut_mapping(temp_one, gamut, clip, temp_two);
+  // Apply lightness / saturation adjustment
+  _luma_chroma(temp_one, saturation, lightness, temp_two, version);
 
-    // convert to LMS, XYZ or pipeline RGB
+  // Clip in LMS
+  if(clip)
+    dt_vector_clipneg_nan(temp_two);
+
+  // Save
+  if(apply_grey)
+  {
+    // Turn LMS, XYZ or pipeline RGB into monochrome
+    const float grey_mix = fmaxf(scalar_product(temp_two, grey), 0.0f);
+    temp_two[0] = temp_two[1] = temp_two[2] = grey_mix;
+  }
+  else
+  {
+    // Convert back to XYZ
     switch(kind)
     {
       case DT_ADAPTATION_FULL_BRADFORD:
@@ -902,77 +949,73 @@ static inline void _loop_switch(const float *const restrict in,
       case DT_ADAPTATION_CAT16:
       case DT_ADAPTATION_XYZ:
       {
-        convert_any_XYZ_to_LMS(temp_two, temp_one, kind);
+        convert_any_LMS_to_XYZ(temp_two, temp_one, kind);
         break;
       }
       case DT_ADAPTATION_RGB:
       case DT_ADAPTATION_LAST:
       default:
       {
-        // Convert from XYZ to RGB
-        dt_apply_transposed_color_matrix(temp_two, XYZ_to_RGB_trans, temp_one);
+        // Convert from RBG to XYZ
+        dt_apply_transposed_color_matrix(temp_two, RGB_to_XYZ_trans, temp_one);
         break;
       }
     }
 
-    /* FROM HERE WE ARE IN LMS, XYZ OR PIPELINE RGB depending on user
-       param - DATA IS IN temp_one */
+    /* FROM HERE WE ARE MANDATORILY IN XYZ - DATA IS IN temp_one */
 
-    // Clip in LMS
+    // Clip in XYZ
     if(clip)
       dt_vector_clipneg_nan(temp_one);
 
-    // Apply lightness / saturation adjustment
-    _luma_chroma(temp_one, saturation, lightness, temp_two, version);
+    // Convert back to RGB
+    dt_apply_transposed_color_matrix(temp_one, XYZ_to_RGB_trans, temp_two);
 
-    // Clip in LMS
     if(clip)
       dt_vector_clipneg_nan(temp_two);
+  }
 
-    // Save
-    if(apply_grey)
-    {
-      // Turn LMS, XYZ or pipeline RGB into monochrome
-      const float grey_mix = fmaxf(scalar_product(temp_two, grey), 0.0f);
-      temp_two[0] = temp_two[1] = temp_two[2] = grey_mix;
-    }
-    else
-    {
-      // Convert back to XYZ
-      switch(kind)
-      {
-        case DT_ADAPTATION_FULL_BRADFORD:
-        case DT_ADAPTATION_LINEAR_BRADFORD:
-        case DT_ADAPTATION_CAT16:
-        case DT_ADAPTATION_XYZ:
-        {
-          convert_any_LMS_to_XYZ(temp_two, temp_one, kind);
-          break;
-        }
-        case DT_ADAPTATION_RGB:
-        case DT_ADAPTATION_LAST:
-        default:
-        {
-          // Convert from RBG to XYZ
-          dt_apply_transposed_color_matrix(temp_two, RGB_to_XYZ_trans, temp_one);
-          break;
-        }
-      }
-
-      /* FROM HERE WE ARE MANDATORILY IN XYZ - DATA IS IN temp_one */
-
-      // Clip in XYZ
-      if(clip)
-        dt_vector_clipneg_nan(temp_one);
+  temp_two[3] = in[3]; // alpha mask
+}
 
-      // Convert back to RGB
-      dt_apply_transposed_color_matrix(temp_one, XYZ_to_RGB_trans, temp_two);
+DT_OMP_DECLARE_SIMD(aligned(in, out, XYZ_to_RGB, RGB_to_XYZ, MIX : 64) aligned(illuminant, saturation, lightness, grey:16))
+static inline void _loop_switch(const float *const restrict in,
+                                float *const restrict out,
+                                const size_t width,
+                                const size_t height,
+                                const size_t ch,
+                                const dt_colormatrix_t XYZ_to_RGB,
+                                const dt_colormatrix_t RGB_to_XYZ,
+                                const dt_colormatrix_t MIX,
+                                const dt_aligned_pixel_t illuminant,
+                                const dt_aligned_pixel_t saturation,
+                                const dt_aligned_pixel_t lightness,
+                                const dt_aligned_pixel_t grey,
+                                const float p,
+                                const float gamut,
+                                const gboolean clip,
+                                const gboolean apply_grey,
+                                const dt_adaptation_t kind,
+                                const dt_iop_channelmixer_rgb_version_t version)
+{
+  const float minval = clip ? 0.0f : -FLT_MAX;
+  const dt_aligned_pixel_t min_value = { minval, minval, minval, minval };
 
-      if(clip)
-        dt_vector_clipneg_nan(temp_two);
-    }
+  dt_colormatrix_t RGB_to_XYZ_trans;
+  dt_colormatrix_t RGB_to_LMS_trans;
+  dt_colormatrix_t MIX_to_XYZ_trans;
+  dt_colormatrix_t XYZ_to_RGB_trans;
+  _prepare_matrices(XYZ_to_RGB, RGB_to_XYZ, MIX, kind,
+                    RGB_to_XYZ_trans, RGB_to_LMS_trans, MIX_to_XYZ_trans, XYZ_to_RGB_trans);
 
-    temp_two[3] = in[k + 3]; // alpha mask
+  DT_OMP_FOR()
+  for(size_t k = 0; k < height * width * 4; k += 4)
+  {
+    dt_aligned_pixel_t temp_two;
+    _pixel_switch(&in[k], temp_two,
+                  RGB_to_XYZ_trans, RGB_to_LMS_trans, MIX_to_XYZ_trans, XYZ_to_RGB_trans,
+                  illuminant, saturation, lightness, grey, min_value,
+                  p, gamut, clip, apply_grey, kind, version);
     copy_pixel_nontemporal(&out[k], temp_two);
   }
 }
@@ -2110,6 +2153,40 @@ static void _set_trouble_messages(dt_iop_module_t *self)
   }
 }
 
+static void _update_camera_illuminant(dt_iop_module_t *self,
+                                      dt_iop_channelmixer_rbg_data_t *data)
+{
+  if(data->illuminant_type == DT_ILLUMINANT_CAMERA)
+  {
+    // The camera illuminant is a behaviour rather than a preset of
+    // values: it uses whatever is in the RAW EXIF. But it depends on
+    // what temperature.c is doing and needs to be updated
+    // accordingly, to give a consistent result.  We initialise the
+    // CAT defaults using the temperature coeffs at startup, but if
+    // temperature is changed later, we get no notification of the
+    // change here, so we can't update the defaults.  So we need to
+    // re-run the detection at runtime…
+    float x, y;
+    dt_aligned_pixel_t custom_wb;
+    _get_white_balance_coeff(self, custom_wb);
+
+    if(find_temperature_from_raw_coeffs(&(self->dev->image_storage), custom_wb, &(x), &(y)))
+    {
+      // Convert illuminant from xyY to XYZ
+      dt_aligned_pixel_t XYZ;
+      illuminant_xy_to_XYZ(x, y, XYZ);
+
+      // Convert illuminant from XYZ to Bradford modified LMS
+      convert_any_XYZ_to_LMS(XYZ, data->illuminant, data->adaptation);
+      data->illuminant[3] = 0.f;
+    }
+    else
+    {
+      // just use whatever was defined in commit_params hoping the defaults work…
+    }
+  }
+}
+
 void process(dt_iop_module_t *self,
              dt_dev_pixelpipe_iop_t *piece,
              const void *const restrict ivoid,
@@ -2196,35 +2273,7 @@ void process(dt_iop_module_t *self,
 #endif
   }
 
-  if(data->illuminant_type == DT_ILLUMINANT_CAMERA)
-  {
-    // The camera illuminant is a behaviour rather than a preset of
-    // values: it uses whatever is in the RAW EXIF. But it depends on
-    // what temperature.c is doing and needs to be updated
-    // accordingly, to give a consistent result.  We initialise the
-    // CAT defaults using the temperature coeffs at startup, but if
-    // temperature is changed later, we get no notification of the
-    // change here, so we can't update the defaults.  So we need to
-    // re-run the detection at runtime…
-    float x, y;
-    dt_aligned_pixel_t custom_wb;
-    _get_white_balance_coeff(self, custom_wb);
-
-    if(find_temperature_from_raw_coeffs(&(self->dev->image_storage), custom_wb, &(x), &(y)))
-    {
-      // Convert illuminant from xyY to XYZ
-      dt_aligned_pixel_t XYZ;
-      illuminant_xy_to_XYZ(x, y, XYZ);
-
-      // Convert illuminant from XYZ to Bradford modified LMS
-      convert_any_XYZ_to_LMS(XYZ, data->illuminant, data->adaptation);
-      data->illuminant[3] = 0.f;
-    }
-    else
-    {
-      // just use whatever was defined in commit_params hoping the defaults work…
-    }
-  }
+  _update_camera_illuminant(self, data);
 
   // force loop unswitching in a controlled way
   switch(data->adaptation)
@@ -2290,6 +2339,80 @@ void process(dt_iop_module_t *self,
     }
 }
 
+void process_pointwise_setup(dt_iop_module_t *self,
+                             dt_dev_pixelpipe_iop_t *piece)
+{
+  dt_iop_channelmixer_rbg_data_t *data = piece->data;
+  const dt_iop_order_iccprofile_info_t *const work_profile =
+    dt_ioppr_get_pipe_current_profile_info(self, piece->pipe);
+
+  if(piece->pipe->type & DT_DEV_PIXELPIPE_PREVIEW)
+    _declare_cat_on_pipe(self, FALSE);
+
+  dt_colormatrix_t RGB_to_XYZ;
+  dt_colormatrix_t XYZ_to_RGB;
+  if(work_profile)
+  {
+    memcpy(RGB_to_XYZ, work_profile->matrix_in, sizeof(RGB_to_XYZ));
+    memcpy(XYZ_to_RGB, work_profile->matrix_out, sizeof(XYZ_to_RGB));
+  }
+
+  _update_camera_illuminant(self, data);
+
+  _prepare_matrices(XYZ_to_RGB, RGB_to_XYZ, data->MIX, data->adaptation,
+                    data->RGB_to_XYZ_trans, data->RGB_to_LMS_trans,
+                    data->MIX_to_XYZ_trans, data->XYZ_to_RGB_trans);
+}
+
+void process_pointwise(dt_iop_module_t *self,
+                       dt_dev_pixelpipe_iop_t *piece,
+                       const float *const in,
+                       float *const out,
+                       const size_t npixels)
+{
+  const dt_iop_channelmixer_rbg_data_t *const data = piece->data;
+  const float minval = data->clip ? 0.0f : -FLT_MAX;
+  const dt_aligned_pixel_t min_value = { minval, minval, minval, minval };
+
+#define PIXEL_LOOP(kind)                                                                    \
+  for(size_t k = 0; k < 4 * npixels; k += 4)                                                \
+  {                                                                                         \
+    dt_aligned_pixel_t res;                                                                 \
+    _pixel_switch(&in[k], res, data->RGB_to_XYZ_trans, data->RGB_to_LMS_trans,              \
+                  data->MIX_to_XYZ_trans, data->XYZ_to_RGB_trans,                           \
+                  data->illuminant, data->saturation, data->lightness, data->grey,          \
+                  min_value, data->p, data->gamut, data->clip, data->apply_grey,            \
+                  kind, data->version);                                                     \
+    copy_pixel(&out[k], res);                                                               \
+  }
+
+  // force loop unswitching like process()
+  switch(data->adaptation)
+  {
+    case DT_ADAPTATION_FULL_BRADFORD:
+      PIXEL_LOOP(DT_ADAPTATION_FULL_BRADFORD);
+      break;
+    case DT_ADAPTATION_LINEAR_BRADFORD:
+      PIXEL_LOOP(DT_ADAPTATION_LINEAR_BRADFORD);
+      break;
+    case DT_ADAPTATION_CAT16:
+      PIXEL_LOOP(DT_ADAPTATION_CAT16);
+      break;
+    case DT_ADAPTATION_XYZ:
+      PIXEL_LOOP(DT_ADAPTATION_XYZ);
+      break;
+    case DT_ADAPTATION_RGB:
+      PIXEL_LOOP(DT_ADAPTATION_RGB);
+      break;
+    case DT_ADAPTATION_LAST:
+    default:
+      if(in != out)
+        memcpy(out, in, sizeof(float) * 4 * npixels);
+      break;
+  }
+#undef PIXEL_LOOP
+}
+
 #if HAVE_OPENCL
 int process_cl(dt_iop_module_t *self,
                dt_dev_pixelpipe_iop_t *piece,
@@ -2307,31 +2430,7 @@ int process_cl(dt_iop_module_t *self,
   if(piece->pipe->type & DT_DEV_PIXELPIPE_PREVIEW)
     _declare_cat_on_pipe(self, FALSE);
 
-  if(d->illuminant_type == DT_ILLUMINANT_CAMERA)
-  {
-    // The camera illuminant is a behaviour rather than a preset of
-    // values: it uses whatever is in the RAW EXIF. But it depends on
-    // what temperature.c is doing and needs to be updated
-    // accordingly, to give a consistent result.  We initialise the
-    // CAT defaults using the temperature coeffs at startup, but if
-    // temperature is changed later, we get no notification of the
-    // change here, so we can't update the defaults.  So we need to
-    // re-run the detection at runtime…
-    float x, y;
-    dt_aligned_pixel_t custom_wb;
-    _get_white_balance_coeff(self, custom_wb);
-
-    if(find_temperature_from_raw_coeffs(&(self->dev->image_storage), custom_wb, &(x), &(y)))
-    {
-      // Convert illuminant from xyY to XYZ
-      dt_aligned_pixel_t XYZ;
-      illuminant_xy_to_XYZ(x, y, XYZ);
-
-      // Convert illuminant from XYZ to Bradford modified LMS
-      convert_any_XYZ_to_LMS(XYZ, d->illuminant, d->adaptation);
-      d->illuminant[3] = 0.f;
-    }
-  }
+  _update_camera_illuminant(self, d);
 
   cl_int err = CL_MEM_OBJECT_ALLOCATION_FAILURE;
 
@@ -3133,6 +3232,12 @@ void commit_params(dt_iop_module_t *self,
     {
       piece->process_cl_ready = FALSE;
     }
+
+    // the diagnose and detection modes work on the whole image
+    if(run_profile || run_validation
+       || d->illuminant_type == DT_ILLUMINANT_DETECT_EDGES
+       || d->illuminant_type == DT_ILLUMINANT_DETECT_SURFACES)
+      piece->process_pointwise_ready = FALSE;
   }
 
   // if this module has some mask applied we assume it's safe so give no warning
@@ -116,6 +116,7 @@ typedef struct dt_iop_colorin_data_t
   dt_colorspaces_color_profile_type_t type_work;
   char filename[DT_IOP_COLOR_ICC_LEN];
   char filename_work[DT_IOP_COLOR_ICC_LEN];
+  dt_aligned_pixel_t corr; // late white balance correction, set up for process_pointwise()
 } dt_iop_colorin_data_t;
 
 
@@ -1199,6 +1200,26 @@ static void process_lcms2_proper(dt_iop_module_t *self,
   dt_free_align(scratchlines);
 }
 
+static gboolean _late_correction(dt_iop_module_t *self,
+                                 dt_dev_pixelpipe_iop_t *piece,
+                                 dt_aligned_pixel_t coeffs)
+{
+  const dt_dev_chroma_t *chr = &self->dev->chroma;
+  const gboolean corrected = dt_dev_is_D65_chroma(self->dev) && chr->late_correction;
+  for_four_channels(k)
+    coeffs[k] = corrected ? chr->D65coeffs[k] / chr->as_shot[k] : 1.0f;
+
+  if(corrected)
+  {
+    for_four_channels(k)
+    {
+      piece->pipe->dsc.temperature.coeffs[k] *= coeffs[k];
+      piece->pipe->dsc.processed_maximum[k] *= coeffs[k];
+    }
+  }
+  return corrected;
+}
+
 void process(dt_iop_module_t *self,
              dt_dev_pixelpipe_iop_t *piece,
              const void *const ivoid,
@@ -1211,20 +1232,8 @@ void process(dt_iop_module_t *self,
                                         ivoid, ovoid, roi_in, roi_out))
     return;
 
-  const dt_dev_chroma_t *chr = &self->dev->chroma;
-  const gboolean corrected = dt_dev_is_D65_chroma(self->dev) && chr->late_correction;
-  const dt_aligned_pixel_t coeffs = { corrected ? chr->D65coeffs[0] / chr->as_shot[0] : 1.0f,
-                                      corrected ? chr->D65coeffs[1] / chr->as_shot[1] : 1.0f,
-                                      corrected ? chr->D65coeffs[2] / chr->as_shot[2] : 1.0f,
-                                      corrected ? chr->D65coeffs[3] / chr->as_shot[3] : 1.0f };
-  if(corrected)
-  {
-    for_four_channels(k)
-    {
-      piece->pipe->dsc.temperature.coeffs[k] *= coeffs[k];
-      piece->pipe->dsc.processed_maximum[k] *= coeffs[k];
-    }
-  }
+  dt_aligned_pixel_t coeffs;
+  const gboolean corrected = _late_correction(self, piece, coeffs);
 
   const dt_iop_colorin_data_t *const d = piece->data;
   const gboolean blue_mapping =
@@ -1270,6 +1279,51 @@ void process(dt_iop_module_t *self,
   }
 }
 
+void process_pointwise_setup(dt_iop_module_t *self,
+                             dt_dev_pixelpipe_iop_t *piece)
+{
+  dt_iop_colorin_data_t *const d = piece->data;
+  _late_correction(self, piece, d->corr);
+}
+
+// the matrix paths of process_cmatrix() except for the legacy blue mapping
+void process_pointwise(dt_iop_module_t *self,
+                       dt_dev_pixelpipe_iop_t *piece,
+                       const float *const in,
+                       float *const out,
+                       const size_t npixels)
+{
+  const dt_iop_colorin_data_t *const d = piece->data;
+  const gboolean clipping = (d->nrgb != NULL);
+  const dt_colormatrix_t *const matrix = clipping ? &d->nmatrix : &d->cmatrix;
+
+  const dt_aligned_pixel_t matrix_row0 = { (*matrix)[0][0], (*matrix)[1][0], (*matrix)[2][0], 0.0f };
+  const dt_aligned_pixel_t matrix_row1 = { (*matrix)[0][1], (*matrix)[1][1], (*matrix)[2][1], 0.0f };
+  const dt_aligned_pixel_t matrix_row2 = { (*matrix)[0][2], (*matrix)[1][2], (*matrix)[2][2], 0.0f };
+  const dt_aligned_pixel_t lmatrix_row0 = { d->lmatrix[0][0], d->lmatrix[1][0], d->lmatrix[2][0], 0.0f };
+  const dt_aligned_pixel_t lmatrix_row1 = { d->lmatrix[0][1], d->lmatrix[1][1], d->lmatrix[2][1], 0.0f };
+  const dt_aligned_pixel_t lmatrix_row2 = { d->lmatrix[0][2], d->lmatrix[1][2], d->lmatrix[2][2], 0.0f };
+
+  for(size_t k = 0; k < npixels; k++)
+  {
+    dt_aligned_pixel_t cam = { in[4*k] * d->corr[0], in[4*k+1] * d->corr[1], in[4*k+2] * d->corr[2], 1.0f };
+    if(d->nonlinearlut)
+      _apply_tone_curves(cam, d);
+
+    dt_aligned_pixel_t res;
+    if(clipping)
+    {
+      dt_aligned_pixel_t nRGB;
+      dt_apply_color_matrix_by_row(cam, matrix_row0, matrix_row1, matrix_row2, nRGB);
+      dt_vector_clip(nRGB);
+      dt_RGB_to_Lab(nRGB, lmatrix_row0, lmatrix_row1, lmatrix_row2, res);
+    }
+    else
+      dt_RGB_to_Lab(cam, matrix_row0, matrix_row1, matrix_row2, res);
+    copy_pixel(out + 4*k, res);
+  }
+}
+
 void commit_params(dt_iop_module_t *self,
                    dt_iop_params_t *p1,
                    dt_dev_pixelpipe_t *pipe,
@@ -1583,6 +1637,11 @@ void commit_params(dt_iop_module_t *self,
       d->unbounded_coeffs[k][0] = -1.0f;
   }
 
+  // the lcms2 and legacy blue mapping paths need process()
+  piece->process_pointwise_ready =
+    dt_is_valid_colormatrix(d->cmatrix[0][0])
+    && !(d->blue_mapping && dt_image_is_matrix_correction_supported(&pipe->image));
+
   // commit color profiles to pipeline
   dt_ioppr_set_pipe_work_profile_info(self->dev, piece->pipe, d->type_work,
                                       d->filename_work, DT_INTENT_PERCEPTUAL);
@@ -550,6 +550,47 @@ void process(dt_iop_module_t *self, dt_dev_pixelpipe_iop_t *piece, const void *c
   }
 }
 
+// the matrix path of process(), lcms2 transforms need process()
+void process_pointwise(dt_iop_module_t *self,
+                       dt_dev_pixelpipe_iop_t *piece,
+                       const float *const in,
+                       float *const out,
+                       const size_t npixels)
+{
+  const dt_iop_colorout_data_t *const d = piece->data;
+
+  if(d->type == DT_COLORSPACE_LAB)
+  {
+    if(in != out)
+      memcpy(out, in, sizeof(float) * 4 * npixels);
+    return;
+  }
+
+  dt_colormatrix_t cmatrix;
+  transpose_3xSSE(d->cmatrix, cmatrix);
+  dt_aligned_pixel_t cmatrix_0, cmatrix_1, cmatrix_2;
+  copy_pixel(cmatrix_0,cmatrix[0]);
+  copy_pixel(cmatrix_1,cmatrix[1]);
+  copy_pixel(cmatrix_2,cmatrix[2]);
+  const gboolean lut[3] = { d->lut[0][0] >= 0.0f, d->lut[1][0] >= 0.0f, d->lut[2][0] >= 0.0f };
+
+  for(size_t k = 0; k < npixels; k++)
+  {
+    dt_aligned_pixel_t XYZ;
+    dt_Lab_to_XYZ(in + 4*k, XYZ);
+    dt_aligned_pixel_t rgb;
+    for_each_channel(r)
+      rgb[r] = cmatrix_0[r] * XYZ[0] + cmatrix_1[r] * XYZ[1] + cmatrix_2[r] * XYZ[2];
+    for(int c = 0; c < 3; c++)
+    {
+      if(lut[c])
+        rgb[c] = (rgb[c] < 1.0f) ? _lerp_lut(d->lut[c], rgb[c])
+                                 : dt_iop_eval_exp(d->unbounded_coeffs[c], rgb[c]);
+    }
+    copy_pixel(out + 4*k, rgb);
+  }
+}
+
 void commit_params(dt_iop_module_t *self, dt_iop_params_t *p1, dt_dev_pixelpipe_t *pipe,
                    dt_dev_pixelpipe_iop_t *piece)
 {
@@ -759,6 +800,8 @@ void commit_params(dt_iop_module_t *self, dt_iop_params_t *p1, dt_dev_pixelpipe_
   // softproof is never the original but always a copy that went through dt_colorspaces_make_temporary_profile()
   dt_colorspaces_cleanup_profile(softproof);
 
+  piece->process_pointwise_ready = dt_is_valid_colormatrix(d->cmatrix[0][0]);
+
   dt_ioppr_set_pipe_output_profile_info(self->dev, piece->pipe, d->type, out_filename, p->intent);
 }
 
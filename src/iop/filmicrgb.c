@@ -314,6 +314,18 @@ typedef struct dt_iop_filmicrgb_data_t
   struct dt_iop_filmic_rgb_spline_t spline DT_ALIGNED_ARRAY;
   dt_noise_distribution_t noise_distribution;
   gboolean enable_highlight_reconstruction;
+  // conversions set up for process_pointwise()
+  const struct dt_iop_order_iccprofile_info_t *work_profile;
+  dt_colormatrix_t input_matrix_trans;
+  dt_colormatrix_t output_matrix;
+  dt_colormatrix_t output_matrix_trans;
+  dt_colormatrix_t export_input_matrix_trans;
+  dt_colormatrix_t export_output_matrix;
+  dt_colormatrix_t export_output_matrix_trans;
+  int use_output_profile;
+  float norm_min, norm_max;
+  float display_black, display_white;
+  gboolean show_mask;
 } dt_iop_filmicrgb_data_t;
 
 
@@ -1849,6 +1861,40 @@ static inline void RGB_tone_mapping_v4(const dt_aligned_pixel_t pix_in,
   dt_vector_pow1(mapped, data->output_power, pix_out);
 }
 
+static inline void filmic_chroma_v4_pixel(const float *const restrict pix_in,
+                                          dt_aligned_pixel_t pix_out,
+                                          const int variant,
+                                          const dt_iop_order_iccprofile_info_t *const work_profile,
+                                          const dt_iop_filmicrgb_data_t *const data,
+                                          const dt_iop_filmic_rgb_spline_t spline,
+                                          const float norm_min,
+                                          const float norm_max,
+                                          const float display_black,
+                                          const float display_white,
+                                          const dt_colormatrix_t input_matrix_trans,
+                                          const dt_colormatrix_t output_matrix,
+                                          const dt_colormatrix_t output_matrix_trans,
+                                          const dt_colormatrix_t export_input_matrix_trans,
+                                          const dt_colormatrix_t export_output_matrix,
+                                          const dt_colormatrix_t export_output_matrix_trans,
+                                          const int use_output_profile)
+{
+  norm_tone_mapping_v4(pix_in, pix_out, variant, work_profile, data, spline,
+                       norm_min, norm_max, display_black, display_white);
+
+  // Save Ych in Kirk/Filmlight Yrg
+  dt_aligned_pixel_t Ych_original = { 0.f };
+  RGB_to_Ych(pix_in, input_matrix_trans, Ych_original);
+
+  // Get final Ych in Kirk/Filmlight Yrg
+  dt_aligned_pixel_t Ych_final = { 0.f };
+  RGB_to_Ych(pix_out, input_matrix_trans, Ych_final);
+
+  gamut_mapping(Ych_final, Ych_original, pix_out, input_matrix_trans, output_matrix, output_matrix_trans,
+                export_input_matrix_trans, export_output_matrix, export_output_matrix_trans,
+                display_black, display_white, data->saturation, use_output_profile);
+}
+
 static inline void filmic_chroma_v4(const float *const restrict in,
                                     float *const restrict out,
                                     const dt_iop_order_iccprofile_info_t *const work_profile,
@@ -1881,27 +1927,48 @@ static inline void filmic_chroma_v4(const float *const restrict in,
   DT_OMP_FOR()
   for(size_t k = 0; k < 4 * height * width; k += 4)
   {
-    const float *const restrict pix_in = in + k;
     dt_aligned_pixel_t pix_out;
-    norm_tone_mapping_v4(pix_in, pix_out, variant, work_profile, data, spline,
-                         norm_min, norm_max, display_black, display_white);
-
-    // Save Ych in Kirk/Filmlight Yrg
-    dt_aligned_pixel_t Ych_original = { 0.f };
-    RGB_to_Ych(pix_in, input_matrix_trans, Ych_original);
-
-    // Get final Ych in Kirk/Filmlight Yrg
-    dt_aligned_pixel_t Ych_final = { 0.f };
-    RGB_to_Ych(pix_out, input_matrix_trans, Ych_final);
-
-    gamut_mapping(Ych_final, Ych_original, pix_out, input_matrix_trans, output_matrix, output_matrix_trans,
-                  export_input_matrix_trans, export_output_matrix, export_output_matrix_trans,
-                  display_black, display_white, data->saturation, use_output_profile);
+    filmic_chroma_v4_pixel(in + k, pix_out, variant, work_profile, data, spline,
+                           norm_min, norm_max, display_black, display_white,
+                           input_matrix_trans, output_matrix, output_matrix_trans,
+                           export_input_matrix_trans, export_output_matrix, export_output_matrix_trans,
+                           use_output_profile);
     copy_pixel_nontemporal(out + k, pix_out);
   }
   dt_omploop_sfence();	// ensure that nontemporal writes complete before we attempt to read output
 }
 
+static inline void filmic_split_v4_pixel(const float *const restrict pix_in,
+                                         dt_aligned_pixel_t pix_out,
+                                         const dt_iop_filmicrgb_data_t *const data,
+                                         const dt_iop_filmic_rgb_spline_t spline,
+                                         const float display_black,
+                                         const float display_white,
+                                         const dt_colormatrix_t input_matrix_trans,
+                                         const dt_colormatrix_t output_matrix,
+                                         const dt_colormatrix_t output_matrix_trans,
+                                         const dt_colormatrix_t export_input_matrix_trans,
+                                         const dt_colormatrix_t export_output_matrix,
+                                         const dt_colormatrix_t export_output_matrix_trans,
+                                         const int use_output_profile)
+{
+  RGB_tone_mapping_v4(pix_in, pix_out, data, spline, display_black, display_white);
+
+  // Save Ych in Kirk/Filmlight Yrg
+  dt_aligned_pixel_t Ych_original = { 0.f };
+  RGB_to_Ych(pix_in, input_matrix_trans, Ych_original);
+
+  // Get final Ych in Kirk/Filmlight Yrg
+  dt_aligned_pixel_t Ych_final = { 0.f };
+  RGB_to_Ych(pix_out, input_matrix_trans, Ych_final);
+
+  Ych_final[1] = MIN(Ych_original[1], Ych_final[1]);
+
+  gamut_mapping(Ych_final, Ych_original, pix_out, input_matrix_trans, output_matrix, output_matrix_trans,
+                export_input_matrix_trans, export_output_matrix, export_output_matrix_trans,
+                display_black, display_white, data->saturation, use_output_profile);
+}
+
 static inline void filmic_split_v4(const float *const restrict in,
                                    float *const restrict out,
                                    const dt_iop_order_iccprofile_info_t *const work_profile,
@@ -1932,29 +1999,59 @@ static inline void filmic_split_v4(const float *const restrict in,
   DT_OMP_FOR()
   for(size_t k = 0; k < 4 * height * width; k += 4)
   {
-    const float *const restrict pix_in = in + k;
     dt_aligned_pixel_t pix_out;
+    filmic_split_v4_pixel(in + k, pix_out, data, spline, display_black, display_white,
+                          input_matrix_trans, output_matrix, output_matrix_trans,
+                          export_input_matrix_trans, export_output_matrix, export_output_matrix_trans,
+                          use_output_profile);
+    copy_pixel_nontemporal(out + k, pix_out);
+  }
+  dt_omploop_sfence();	// ensure that nontemporal writes complete before we attempt to read output
+}
 
-    RGB_tone_mapping_v4(pix_in, pix_out, data, spline, display_black, display_white);
 
-    // Save Ych in Kirk/Filmlight Yrg
-    dt_aligned_pixel_t Ych_original = { 0.f };
-    RGB_to_Ych(pix_in, input_matrix_trans, Ych_original);
+static inline void filmic_v5_pixel(const float *const restrict pix_in,
+                                   dt_aligned_pixel_t pix_out,
+                                   const dt_iop_order_iccprofile_info_t *const work_profile,
+                                   const dt_iop_filmicrgb_data_t *const data,
+                                   const dt_iop_filmic_rgb_spline_t spline,
+                                   const float norm_min,
+                                   const float norm_max,
+                                   const float display_black,
+                                   const float display_white,
+                                   const dt_colormatrix_t input_matrix_trans,
+                                   const dt_colormatrix_t output_matrix,
+                                   const dt_colormatrix_t output_matrix_trans,
+                                   const dt_colormatrix_t export_input_matrix_trans,
+                                   const dt_colormatrix_t export_output_matrix,
+                                   const dt_colormatrix_t export_output_matrix_trans,
+                                   const int use_output_profile)
+{
+  dt_aligned_pixel_t max_rgb = { 0.f };
+  dt_aligned_pixel_t naive_rgb = { 0.f };
 
-    // Get final Ych in Kirk/Filmlight Yrg
-    dt_aligned_pixel_t Ych_final = { 0.f };
-    RGB_to_Ych(pix_out, input_matrix_trans, Ych_final);
+  RGB_tone_mapping_v4(pix_in, naive_rgb, data, spline, display_black, display_white);
+  norm_tone_mapping_v4(pix_in, max_rgb, DT_FILMIC_METHOD_MAX_RGB, work_profile, data,
+                       spline, norm_min, norm_max, display_black, display_white);
 
-    Ych_final[1] = MIN(Ych_original[1], Ych_final[1]);
+  // Mix max RGB with naive RGB
+  for_each_channel(c, aligned(pix_out, max_rgb, naive_rgb))
+    pix_out[c] = (0.5f - data->saturation) * naive_rgb[c] + (0.5f + data->saturation) * max_rgb[c];
 
-    gamut_mapping(Ych_final, Ych_original, pix_out, input_matrix_trans, output_matrix, output_matrix_trans,
-                  export_input_matrix_trans, export_output_matrix, export_output_matrix_trans,
-                  display_black, display_white, data->saturation, use_output_profile);
-    copy_pixel_nontemporal(out + k, pix_out);
-  }
-  dt_omploop_sfence();	// ensure that nontemporal writes complete before we attempt to read output
-}
+  // Save Ych in Kirk/Filmlight Yrg
+  dt_aligned_pixel_t Ych_original = { 0.f };
+  RGB_to_Ych(pix_in, input_matrix_trans, Ych_original);
+
+  // Get final Ych in Kirk/Filmlight Yrg
+  dt_aligned_pixel_t Ych_final = { 0.f };
+  RGB_to_Ych(pix_out, input_matrix_trans, Ych_final);
 
+  Ych_final[1] = fminf(Ych_original[1], Ych_final[1]);
+
+  gamut_mapping(Ych_final, Ych_original, pix_out, input_matrix_trans, output_matrix, output_matrix_trans,
+                export_input_matrix_trans, export_output_matrix, export_output_matrix_trans,
+                display_black, display_white, 0.0f, use_output_profile);
+}
 
 static inline void filmic_v5(const float *const restrict in, float *const restrict out,
                                     const dt_iop_order_iccprofile_info_t *const work_profile,
@@ -1984,33 +2081,12 @@ static inline void filmic_v5(const float *const restrict in, float *const restri
   DT_OMP_FOR()
   for(size_t k = 0; k < height * width * 4; k += 4)
   {
-    const float *const restrict pix_in = in + k;
-
-    dt_aligned_pixel_t max_rgb = { 0.f };
-    dt_aligned_pixel_t naive_rgb = { 0.f };
-
-    RGB_tone_mapping_v4(pix_in, naive_rgb, data, spline, display_black, display_white);
-    norm_tone_mapping_v4(pix_in, max_rgb, DT_FILMIC_METHOD_MAX_RGB, work_profile, data,
-                         spline, norm_min, norm_max, display_black, display_white);
-
-    // Mix max RGB with naive RGB
     dt_aligned_pixel_t pix_out;
-    for_each_channel(c, aligned(pix_out, max_rgb, naive_rgb))
-      pix_out[c] = (0.5f - data->saturation) * naive_rgb[c] + (0.5f + data->saturation) * max_rgb[c];
-
-    // Save Ych in Kirk/Filmlight Yrg
-    dt_aligned_pixel_t Ych_original = { 0.f };
-    RGB_to_Ych(pix_in, input_matrix_trans, Ych_original);
-
-    // Get final Ych in Kirk/Filmlight Yrg
-    dt_aligned_pixel_t Ych_final = { 0.f };
-    RGB_to_Ych(pix_out, input_matrix_trans, Ych_final);
-
-    Ych_final[1] = fminf(Ych_original[1], Ych_final[1]);
-
-    gamut_mapping(Ych_final, Ych_original, pix_out, input_matrix_trans, output_matrix, output_matrix_trans,
-                  export_input_matrix_trans, export_output_matrix, export_output_matrix_trans,
-                  display_black, display_white, 0.0f, use_output_profile);
+    filmic_v5_pixel(in + k, pix_out, work_profile, data, spline,
+                    norm_min, norm_max, display_black, display_white,
+                    input_matrix_trans, output_matrix, output_matrix_trans,
+                    export_input_matrix_trans, export_output_matrix, export_output_matrix_trans,
+                    use_output_profile);
     copy_pixel_nontemporal(out + k, pix_out);
   }
   dt_omploop_sfence();	// ensure that nontemporal writes complete before we attempt to read output
@@ -2235,6 +2311,65 @@ void process(dt_iop_module_t *self,
   dt_free_align(reconstructed);
 }
 
+void process_pointwise_setup(dt_iop_module_t *self,
+                             dt_dev_pixelpipe_iop_t *piece)
+{
+  dt_iop_filmicrgb_data_t *d = piece->data;
+  const dt_iop_filmicrgb_gui_data_t *g = self->gui_data;
+
+  d->work_profile = dt_ioppr_get_pipe_work_profile_info(piece->pipe);
+  d->use_output_profile
+    = filmic_v4_prepare_matrices(d->input_matrix_trans, d->output_matrix, d->output_matrix_trans,
+                                 d->export_input_matrix_trans, d->export_output_matrix,
+                                 d->export_output_matrix_trans, d->work_profile,
+                                 dt_ioppr_get_pipe_output_profile_info(piece->pipe));
+  d->norm_min = exp_tonemapping_v2(0.f, d->grey_source, d->black_source, d->dynamic_range);
+  d->norm_max = exp_tonemapping_v2(1.f, d->grey_source, d->black_source, d->dynamic_range);
+  d->display_white = powf(d->spline.y[4], d->output_power);
+  d->display_black = powf(d->spline.y[0], d->output_power);
+  d->show_mask = self->dev->gui_attached && (piece->pipe->type & DT_DEV_PIXELPIPE_FULL) && g && g->show_mask;
+}
+
+void process_pointwise(dt_iop_module_t *self,
+                       dt_dev_pixelpipe_iop_t *piece,
+                       const float *const in,
+                       float *const out,
+                       const size_t npixels)
+{
+  const dt_iop_filmicrgb_data_t *const d = piece->data;
+
+  for(size_t k = 0; k < 4 * npixels; k += 4)
+  {
+    dt_aligned_pixel_t pix_out;
+    if(d->show_mask)
+    {
+      // same weight as mask_clipped_pixels()
+      const float pix_max = sqrtf(sqf(in[k]) + sqf(in[k + 1]) + sqf(in[k + 2]));
+      const float weight = clamp_simd(1.0f / (1.0f + exp2f(-pix_max * d->normalize + d->reconstruct_feather)));
+      for_four_channels(c)
+        pix_out[c] = weight;
+    }
+    else if(d->version == DT_FILMIC_COLORSCIENCE_V5)
+      filmic_v5_pixel(in + k, pix_out, d->work_profile, d, d->spline,
+                      d->norm_min, d->norm_max, d->display_black, d->display_white,
+                      d->input_matrix_trans, d->output_matrix, d->output_matrix_trans,
+                      d->export_input_matrix_trans, d->export_output_matrix, d->export_output_matrix_trans,
+                      d->use_output_profile);
+    else if(d->preserve_color == DT_FILMIC_METHOD_NONE)
+      filmic_split_v4_pixel(in + k, pix_out, d, d->spline, d->display_black, d->display_white,
+                            d->input_matrix_trans, d->output_matrix, d->output_matrix_trans,
+                            d->export_input_matrix_trans, d->export_output_matrix, d->export_output_matrix_trans,
+                            d->use_output_profile);
+    else
+      filmic_chroma_v4_pixel(in + k, pix_out, d->preserve_color, d->work_profile, d, d->spline,
+                             d->norm_min, d->norm_max, d->display_black, d->display_white,
+                             d->input_matrix_trans, d->output_matrix, d->output_matrix_trans,
+                             d->export_input_matrix_trans, d->export_output_matrix, d->export_output_matrix_trans,
+                             d->use_output_profile);
+    copy_pixel(out + k, pix_out);
+  }
+}
+
 #ifdef HAVE_OPENCL
 static inline cl_int reconstruct_highlights_cl(cl_mem in, cl_mem mask, cl_mem reconstructed,
                                           const dt_iop_filmicrgb_reconstruction_type_t variant, dt_iop_filmicrgb_global_data_t *const gd,
@@ -3120,6 +3255,11 @@ void commit_params(dt_iop_module_t *self, dt_iop_params_t *p1, dt_dev_pixelpipe_
   d->reconstruct_grey_vs_color = (p->reconstruct_grey_vs_color / 100.0f + 1.f) / 2.f;
 
   d->enable_highlight_reconstruction = p->enable_highlight_reconstruction;
+
+  // the highlight reconstruction works on neighbourhoods, the fast pipe skips it anyway.
+  // Only the current colour sciences have a per-pixel path.
+  piece->process_pointwise_ready = p->version >= DT_FILMIC_COLORSCIENCE_V4
+    && (!p->enable_highlight_reconstruction || (pipe->type & DT_DEV_PIXELPIPE_FAST));
 }
 
 void gui_focus(dt_iop_module_t *self, gboolean in)
@@ -283,6 +283,42 @@ gboolean distort_backtransform(dt_iop_module_t *self,
   return TRUE;
 }
 
+gboolean distort_warp(dt_iop_module_t *self,
+                      dt_dev_pixelpipe_iop_t *piece,
+                      const dt_iop_roi_t *const roi_in,
+                      const dt_iop_roi_t *const roi_out,
+                      float *const points,
+                      const size_t points_count)
+{
+  const dt_iop_flip_data_t *d = piece->data;
+
+  if(d->orientation == 0) return TRUE;
+
+  // the pixel positions used by dt_imageio_flip_buffers() in process()
+  DT_OMP_FOR(if(points_count > 500))
+  for(size_t i = 0; i < points_count * 2; i += 2)
+  {
+    float x, y;
+    if(d->orientation & ORIENTATION_SWAP_XY)
+    {
+      y = points[i];
+      x = points[i + 1];
+    }
+    else
+    {
+      x = points[i];
+      y = points[i + 1];
+    }
+    if(d->orientation & ORIENTATION_FLIP_X) x = roi_in->width - 1 - x;
+    if(d->orientation & ORIENTATION_FLIP_Y) y = roi_in->height - 1 - y;
+
+    points[i] = x;
+    points[i + 1] = y;
+  }
+
+  return TRUE;
+}
+
 void distort_mask(dt_iop_module_t *self,
                   dt_dev_pixelpipe_iop_t *piece,
                   const float *const in,
@@ -21,7 +21,7 @@
 
    Morphological closing operation supporting radius up to 8, tuned for performance
 
-   The segmentation algorithm uses a modified floodfill, while floddfilling it
+   The segmentation algorithm is a connected component labelling done in parallel, it
    - also takes keeps track of the surrounding rectangle of every segment and
    - marks the segment border locations.
 
@@ -30,16 +30,20 @@
 
 #define DT_SEG_ID_MASK 0x40000
 
-typedef struct dt_pos_t
+// minimum number of rows per stripe processed by a thread while segmentizing
+#define DT_SEG_STRIPE_ROWS 16
+
+typedef struct dt_seg_run_t
 {
-  int xpos;
-  int ypos;
-} dt_pos_t;
+  uint32_t first; // location of the leftmost pixel in a horizontal run
+  uint32_t len;
+  uint32_t root;  // location of the segment root
+} dt_seg_run_t;
 
 typedef struct dt_iop_segmentation_t
 {
   uint32_t *data; // holding segment id's for every location
-  uint32_t *tmp;  // pointer to temporary buffer used for morphological operations
+  uint32_t *tmp;  // pointer to temporary buffer used for morphological operations and segmentizing
   int *size;      // size of each segment
   int *xmin;      // bounding rectangle for each segment
   int *xmax;
@@ -54,26 +58,6 @@ typedef struct dt_iop_segmentation_t
   int height;
 } dt_iop_segmentation_t;
 
-typedef struct dt_ff_stack_t
-{
-  int pos;
-  int size;
-  dt_pos_t *el;
-} dt_ff_stack_t;
-
-static inline void _push_stack(int xpos, int ypos, dt_ff_stack_t *stack)
-{
-  const int i = stack->pos;
-  if(i >= stack->size - 1)
-  {
-    dt_print(DT_DEBUG_ALWAYS, "[segmentation stack overflow] %i", stack->size);
-    return;
-  }
-  stack->el[i].xpos = xpos;
-  stack->el[i].ypos = ypos;
-  stack->pos++;
-}
-
 static inline void _clear_segment_slot(dt_iop_segmentation_t *seg, uint32_t id)
 {
   if(id > seg->slots-1)
@@ -83,15 +67,6 @@ static inline void _clear_segment_slot(dt_iop_segmentation_t *seg, uint32_t id)
   seg->val1[id] = seg->val2[id] = 0.0f;
 }
 
-static inline dt_pos_t * _pop_stack(dt_ff_stack_t *stack)
-{
-  if(stack->pos > 0)
-    stack->pos--;
-  else
-    dt_print(DT_DEBUG_ALWAYS, "[segmentation stack underflow]");
-  return &stack->el[stack->pos];
-}
-
 static inline uint32_t _get_segment_id(dt_iop_segmentation_t *seg, const size_t loc)
 {
   if(loc >= (size_t)(seg->width * (seg->height-seg->border)))
@@ -101,200 +76,156 @@ static inline uint32_t _get_segment_id(dt_iop_segmentation_t *seg, const size_t
   return ((id < seg->nr) && (id > 1)) ? id : 0;
 }
 
-static inline int _test_dilate(const uint32_t *img, const size_t i, const size_t w1, const int radius)
+/* The structuring elements for dilating and eroding are described by the horizontal
+   extent of every row, index is [radius-1][dy+radius]. Eroding uses the same shapes up to radius 5.
+   This allows to process complete rows per shifted source row and lets the compiler vectorize.
+*/
+static const int8_t _morph_shape[8][17][2] =
 {
-  int retval = 0;
-  retval = img[i-w1-1] | img[i-w1] | img[i-w1+1] |
-           img[i-1]    | img[i]    | img[i+1] |
-           img[i+w1-1] | img[i+w1] | img[i+w1+1];
-  if(retval || (radius < 2)) return retval;
-
-  const size_t w2 = 2*w1;
-  retval = img[i-w2-1] | img[i-w2]   | img[i-w2+1] |
-           img[i-w1-2] | img[i-w1+2] |
-           img[i-2]    | img[i+2] |
-           img[i+w1-2] | img[i+w1+2] |
-           img[i+w2-1] | img[i+w2]   | img[i+w2+1];
-  if(retval || (radius < 3)) return retval;
-
-  const size_t w3 = 3*w1;
-  retval = img[i-w3-2] | img[i-w3-1] | img[i-w3] | img[i-w3+1] | img[i-w3+2] |
-           img[i-w2-3] | img[i-w2-2] | img[i-w2+2] | img[i-w2+3] |
-           img[i-w1-3] | img[i-w1+3] |
-           img[i-3]    | img[i+3]    |
-           img[i+w1-3] | img[i+w1+3] |
-           img[i+w2-3] | img[i+w2-2] | img[i+w2+2] | img[i+w2+3] |
-           img[i+w3-2] | img[i+w3-1] | img[i+w3] | img[i+w3+1] | img[i+w3+2];
-  if(retval || (radius < 4)) return retval;
-
-  const size_t w4 = 4*w1;
-  retval = img[i-w4-2] | img[i-w4-1] | img[i-w4] | img[i-w4+1] | img[i-w4+2] |
-           img[i-w3-3] | img[i-w3+3] |
-           img[i-w2-4] | img[i-w2+4] |
-           img[i-w1-4] | img[i-w1+4] |
-           img[i-4]    | img[i+4] |
-           img[i+w1-4] | img[i+w1+4] |
-           img[i+w2-4] | img[i+w2+4] |
-           img[i+w3-3] | img[i+w3+3] |
-           img[i+w4-2] | img[i+w4-1] | img[i+w4] | img[i+w4+1] | img[i+w4+2];
-  if(retval || (radius < 5)) return retval;
-
-  const size_t w5 = 5*w1;
-  retval = img[i-w5-2] | img[i-w5-1] | img[i-w5] | img[i-w5+1] | img[i-w5+2] |
-           img[i-w4-4] | img[i-w4-3] | img[i-w4+3] | img[i-w4+4] |
-           img[i-w3-4] | img[i-w3+4] |
-           img[i-w2-5] | img[i-w2+5] |
-           img[i-w1-5] | img[i-w1+5] |
-           img[i-5]    | img[i+5] |
-           img[i+w1-5] | img[i+w1+5] |
-           img[i+w2-5] | img[i+w2+5] |
-           img[i+w3-4] | img[i+w3+4] |
-           img[i+w4-4] | img[i+w4-3] | img[i+w4+3] | img[i+w4+4] |
-           img[i+w5-2] | img[i+w5-1] | img[i+w5] | img[i+w5+1] | img[i+w5+2];
-  if(retval || (radius < 6)) return retval;
-
-  const size_t w6 = 6*w1;
-  retval = img[i-w6-2] | img[i-w6-1] | img[i-w6] | img[i-w6+1] | img[i-w6+2] |
-           img[i-w5-4] | img[i-w5-3] | img[i-w5+3] | img[i-w5+4] |
-           img[i-w4-5] | img[i-w4+5] |
-           img[i-w3-5] | img[i-w3+5] |
-           img[i-w2-6] | img[i-w2+6] |
-           img[i-w1-6] | img[i-w1+6] |
-           img[i-6]    | img[i+6] |
-           img[i+w1-6] | img[i+w1+6] |
-           img[i+w2-6] | img[i+w2+6] |
-           img[i+w3-5] | img[i+w3+5] |
-           img[i+w4-5] | img[i+w4+5] |
-           img[i+w5-4] | img[i+w5-3] | img[i+w5+3] | img[i+w5+4] |
-           img[i+w6-2] | img[i+w6-1] | img[i+w6] | img[i+w6+1] | img[i+w6+2] ;
-  if(retval || (radius < 7)) return retval;
-
-  const size_t w7 = 7*w1;
-  retval = img[i-w7-3] | img[i-w7-2] | img[i-w7-1] | img[i-w7] | img[i-w7+1] | img[i-w7+2] | img[i-w7+3] |
-           img[i-w6-4] | img[i-w6-3] | img[i-w6+3] | img[i-w6+4] |
-           img[i-w5-6] | img[i-w5-5] | img[i-w5+5] | img[i-w5+6] |
-           img[i-w4-6] | img[i-w4+6] |
-           img[i-w3-7] | img[i-w3-6] | img[i-w3+6] | img[i-w3+7] |
-           img[i-w2-7] | img[i-w2+7] |
-           img[i-w1-7] | img[i-w1+7] |
-           img[i-7]    | img[i+7] |
-           img[i+w1-7] | img[i+w1+7] |
-           img[i+w2-7] | img[i+w2+7] |
-           img[i+w3-7] | img[i+w3-6] | img[i+w3+6] | img[i+w3+7] |
-           img[i+w4-6] | img[i+w4+6] |
-           img[i+w5-6] | img[i+w5-5] | img[i+w5+5] | img[i+w5+6] |
-           img[i+w6-4] | img[i+w6-3] | img[i+w6+3] | img[i+w6+4] |
-           img[i+w7-3] | img[i+w7-2] | img[i+w7-1] | img[i+w7] | img[i+w7+1] | img[i+w7+2] | img[i+w7+3];
-  if(retval || (radius < 8)) return retval;
-
-  const size_t w8 = 8*w1;
-  retval = img[i-w8-4] | img[i-w8-3] | img[i-w8-2] | img[i-w8-1] | img[i-w8] | img[i-w8+1] | img[i-w8+2] | img[i-w8+3] | img[i-w8+4] |
-           img[i-w7-6] | img[i-w7-5] | img[i-w7-4] | img[i-w7+4] | img[i-w7+5] | img[i-w7+6] |
-           img[i-w6-6] | img[i-w6-5] | img[i-w6+5] | img[i-w6+6] |
-           img[i-w5-7] | img[i-w5+6] |
-           img[i-w4-8] | img[i-w4-7] | img[i-w4+7] | img[i-w4+8] |
-           img[i-w3-8] | img[i-w3-7] | img[i-w3+7] | img[i-w3+8] |
-           img[i-w2-8] | img[i-w2+8] |
-           img[i-w1-8] | img[i-w1+8] |
-           img[i-8]    | img[i+8] |
-           img[i+w1-8] | img[i+w1+8] |
-           img[i+w2-8] | img[i+w2+8] |
-           img[i+w3-8] | img[i+w3-7] | img[i+w3+7] | img[i+w3+8] |
-           img[i+w4-8] | img[i+w4-7] | img[i+w4+7] | img[i+w4+8] |
-           img[i+w5-7] | img[i+w5+7] |
-           img[i+w6-6] | img[i+w6-5] | img[i+w6+5] | img[i+w6+6] |
-           img[i+w7-6] | img[i+w7-5] | img[i+w7-4] | img[i+w7+4] | img[i+w7+5] | img[i-w7+6] |
-           img[i+w8-4] | img[i+w8-3] | img[i+w8-2] | img[i+w8-1] | img[i+w8] | img[i+w8+1] | img[i+w8+2] | img[i+w8+3] | img[i+w8+4];
-  return retval;
+  { {-1,1}, {-1,1}, {-1,1} },
+  { {-1,1}, {-2,2}, {-2,2}, {-2,2}, {-1,1} },
+  { {-2,2}, {-3,3}, {-3,3}, {-3,3}, {-3,3}, {-3,3}, {-2,2} },
+  { {-2,2}, {-3,3}, {-4,4}, {-4,4}, {-4,4}, {-4,4}, {-4,4}, {-3,3}, {-2,2} },
+  { {-2,2}, {-4,4}, {-4,4}, {-5,5}, {-5,5}, {-5,5}, {-5,5}, {-5,5}, {-4,4}, {-4,4}, {-2,2} },
+  { {-2,2}, {-4,4}, {-5,5}, {-5,5}, {-6,6}, {-6,6}, {-6,6}, {-6,6}, {-6,6}, {-5,5}, {-5,5}, {-4,4},
+    {-2,2} },
+  { {-3,3}, {-4,4}, {-6,6}, {-6,6}, {-7,7}, {-7,7}, {-7,7}, {-7,7}, {-7,7}, {-7,7}, {-7,7}, {-6,6},
+    {-6,6}, {-4,4}, {-3,3} },
+  { {-4,4}, {-6,6}, {-6,6}, {-7,6}, {-8,8}, {-8,8}, {-8,8}, {-8,8}, {-8,8}, {-8,8}, {-8,8}, {-8,8},
+    {-8,8}, {-7,7}, {-6,6}, {-6,5}, {-4,4} }
+};
+
+// rows sharing the horizontal extent of an earlier row have already been processed
+static inline gboolean _morph_row_done(const int8_t (*const shape)[2], const int rad, const int dy)
+{
+  for(int y = -rad; y < dy; y++)
+    if(shape[y+rad][0] == shape[dy+rad][0] && shape[y+rad][1] == shape[dy+rad][1])
+      return TRUE;
+  return FALSE;
 }
 
-static inline void _dilating(const uint32_t *img,
-                             uint32_t *o,
+/* Both morphological operations first combine all source rows sharing the same horizontal
+   extent into a per-thread line buffer and shift that along the row afterwards.
+   All loops work on complete rows so the compiler can vectorize them.
+*/
+static inline void _dilating(const uint32_t *const restrict img,
+                             uint32_t *const restrict o,
                              const int w1,
                              const int height,
                              const int border,
                              const int radius)
 {
-  DT_OMP_FOR(collapse(2))
+  const int rad = CLAMP(radius, 1, 8);
+  const int8_t (*const shape)[2] = _morph_shape[rad-1];
+  size_t padded;
+  uint32_t *lines = dt_alloc_perthread(w1, sizeof(uint32_t), &padded);
+  if(!lines)
+  {
+    dt_print(DT_DEBUG_ALWAYS, "[segmentation dilating] can't allocate line buffers");
+    return;
+  }
+
+  DT_OMP_FOR()
   for(int row = border; row < height - border; row++)
   {
+    uint32_t *const restrict line = dt_get_perthread(lines, padded);
+    uint32_t *const restrict orow = o + (size_t)row * w1;
     for(int col = border; col < w1 - border; col++)
+      orow[col] = 0;
+
+    for(int dy = -rad; dy <= rad; dy++)
     {
-      const size_t i = (size_t)row*w1 + col;
-      o[i] = _test_dilate(img, i, w1, radius) ? 1 : 0;
+      if(_morph_row_done(shape, rad, dy))
+        continue;
+
+      const int lo = shape[dy+rad][0];
+      const int hi = shape[dy+rad][1];
+      for(int col = border + lo; col < w1 - border + hi; col++)
+        line[col] = 0;
+
+      for(int y = dy; y <= rad; y++)
+      {
+        if(shape[y+rad][0] != lo || shape[y+rad][1] != hi)
+          continue;
+        const uint32_t *const restrict irow = img + (size_t)(row + y) * w1;
+        DT_OMP_SIMD()
+        for(int col = border + lo; col < w1 - border + hi; col++)
+          line[col] |= irow[col];
+      }
+
+      for(int dx = lo; dx <= hi; dx++)
+      {
+        DT_OMP_SIMD()
+        for(int col = border; col < w1 - border; col++)
+          orow[col] |= line[col + dx];
+      }
     }
-  }
-}
 
-static inline int _test_erode(const uint32_t *img, const size_t i, const size_t w1, const int radius)
-{
-  int retval = 1;
-  retval =     img[i-w1-1] & img[i-w1] & img[i-w1+1] &
-               img[i-1]    & img[i]    & img[i+1] &
-               img[i+w1-1] & img[i+w1] & img[i+w1+1];
-  if((retval == 0) || (radius < 2)) return retval;
-
-  const size_t w2 = 2*w1;
-  retval = img[i-w2-1] & img[i-w2]   & img[i-w2+1] &
-           img[i-w1-2] & img[i-w1+2] &
-           img[i-2]    & img[i+2] &
-           img[i+w1-2] & img[i+w1+2] &
-           img[i+w2-1] & img[i+w2]   & img[i+w2+1];
-  if((retval == 0) || (radius < 3)) return retval;
-
-  const size_t w3 = 3*w1;
-  retval = img[i-w3-2] & img[i-w3-1] & img[i-w3] & img[i-w3+1] & img[i-w3+2] &
-           img[i-w2-3] & img[i-w2-2] & img[i-w2+2] & img[i-w2+3] &
-           img[i-w1-3] & img[i-w1+3] &
-           img[i-3]    & img[i+3]    &
-           img[i+w1-3] & img[i+w1+3] &
-           img[i+w2-3] & img[i+w2-2] & img[i+w2+2] & img[i+w2+3] &
-           img[i+w3-2] & img[i+w3-1] & img[i+w3] & img[i+w3+1] & img[i+w3+2];
-  if((retval == 0) || (radius < 4)) return retval;
-
-  const size_t w4 = 4*w1;
-  retval = img[i-w4-2] & img[i-w4-1] & img[i-w4] & img[i-w4+1] & img[i-w4+2] &
-           img[i-w3-3] & img[i-w3+3] &
-           img[i-w2-4] & img[i-w2+4] &
-           img[i-w1-4] & img[i-w1+4] &
-           img[i-4]    & img[i+4] &
-           img[i+w1-4] & img[i+w1+4] &
-           img[i+w2-4] & img[i+w2+4] &
-           img[i+w3-3] & img[i+w3+3] &
-           img[i+w4-2] & img[i+w4-1] & img[i+w4] & img[i+w4+1] & img[i+w4+2];
-  if((retval == 0) || (radius < 5)) return retval;
-
-  const size_t w5 = 5*w1;
-  retval = img[i-w5-2] & img[i-w5-1] & img[i-w5] & img[i-w5+1] & img[i-w5+2] &
-           img[i-w4-4] & img[i-w4-3] & img[i-w4+3] & img[i-w4+4] &
-           img[i-w3-4] & img[i-w3+4] &
-           img[i-w2-5] & img[i-w2+5] &
-           img[i-w1-5] & img[i-w1+5] &
-           img[i-5]    & img[i+5] &
-           img[i+w1-5] & img[i+w1+5] &
-           img[i+w2-5] & img[i+w2+5] &
-           img[i+w3-4] & img[i+w3+4] &
-           img[i+w4-4] & img[i+w4-3] & img[i+w4+3] & img[i+w4+4] &
-           img[i+w5-2] & img[i+w5-1] & img[i+w5] & img[i+w5+1] & img[i+w5+2];
-  return retval;
+    DT_OMP_SIMD()
+    for(int col = border; col < w1 - border; col++)
+      orow[col] = orow[col] ? 1 : 0;
+  }
+  dt_free_align(lines);
 }
 
-static inline void _eroding(const uint32_t *img,
-                            uint32_t *o,
+static inline void _eroding(const uint32_t *const restrict img,
+                            uint32_t *const restrict o,
                             const int w1,
                             const int height,
                             const int border,
                             const int radius)
 {
-  DT_OMP_FOR(collapse(2))
+  const int rad = CLAMP(radius, 1, 5);
+  const int8_t (*const shape)[2] = _morph_shape[rad-1];
+  size_t padded;
+  uint32_t *lines = dt_alloc_perthread(w1, sizeof(uint32_t), &padded);
+  if(!lines)
+  {
+    dt_print(DT_DEBUG_ALWAYS, "[segmentation eroding] can't allocate line buffers");
+    return;
+  }
+
+  DT_OMP_FOR()
   for(int row = border; row < height - border; row++)
   {
+    uint32_t *const restrict line = dt_get_perthread(lines, padded);
+    uint32_t *const restrict orow = o + (size_t)row * w1;
     for(int col = border; col < w1 - border; col++)
+      orow[col] = 1;
+
+    for(int dy = -rad; dy <= rad; dy++)
     {
-      const size_t i = (size_t)row*w1 + col;
-      o[i] = _test_erode(img, i, w1, radius) ? 1 : 0;
+      if(_morph_row_done(shape, rad, dy))
+        continue;
+
+      const int lo = shape[dy+rad][0];
+      const int hi = shape[dy+rad][1];
+      for(int col = border + lo; col < w1 - border + hi; col++)
+        line[col] = 1;
+
+      for(int y = dy; y <= rad; y++)
+      {
+        if(shape[y+rad][0] != lo || shape[y+rad][1] != hi)
+          continue;
+        const uint32_t *const restrict irow = img + (size_t)(row + y) * w1;
+        DT_OMP_SIMD()
+        for(int col = border + lo; col < w1 - border + hi; col++)
+          line[col] &= irow[col];
+      }
+
+      for(int dx = lo; dx <= hi; dx++)
+      {
+        DT_OMP_SIMD()
+        for(int col = border; col < w1 - border; col++)
+          orow[col] &= line[col + dx];
+      }
     }
+
+    DT_OMP_SIMD()
+    for(int col = border; col < w1 - border; col++)
+      orow[col] = orow[col] ? 1 : 0;
   }
+  dt_free_align(lines);
 }
 
 static inline void _intimage_borderfill(uint32_t *d,
@@ -316,270 +247,284 @@ static inline void _intimage_borderfill(uint32_t *d,
   }
 }
 
-static gboolean _floodfill_segmentize(int yin,
-                                      int xin,
-                                      dt_iop_segmentation_t *seg,
-                                      const int w,
-                                      const int h,
-                                      const int id,
-                                      dt_ff_stack_t *stack)
+/* Connected component labelling via union-find.
+   Every location is linked to a location with a lower index, so the root of each segment
+   is it's first location found while scanning the plane row by row. While labelling, the
+   data of a root location holds the size of the segment.
+*/
+static inline uint32_t _ccl_root(const uint32_t *parent, uint32_t loc)
+{
+  while(parent[loc] != loc)
+    loc = parent[loc];
+  return loc;
+}
+
+// path halving, only safe if no other thread works on the same locations
+static inline uint32_t _ccl_root_halving(uint32_t *parent, uint32_t loc)
+{
+  while(parent[loc] != loc)
+  {
+    parent[loc] = parent[parent[loc]];
+    loc = parent[loc];
+  }
+  return loc;
+}
+
+static inline void _ccl_link(uint32_t *parent, uint32_t *size, const uint32_t ra, const uint32_t rb)
+{
+  if(ra == rb)
+    return;
+
+  const uint32_t root = MIN(ra, rb);
+  const uint32_t other = MAX(ra, rb);
+  parent[other] = root;
+  size[root] += size[other];
+  size[other] = 1;
+}
+
+static inline int _stripe_row(const int stripe,
+                              const int stripes,
+                              const int rows,
+                              const int border)
+{
+  return border + (int)(((size_t)stripe * rows) / stripes);
+}
+
+static inline uint32_t _lower_id(const uint32_t id, const uint32_t candidate)
 {
-  if(id >= seg->slots - 2) return FALSE;
+  const gboolean segment = candidate > 1 && candidate < DT_SEG_ID_MASK;
+  return (segment && (id == 0 || candidate < id)) ? candidate : id;
+}
 
+// User interface
+/* Segments are labelled in horizontal stripes processed in parallel and merged afterwards.
+   The id's are handed out in scan order of the segment roots, this is the order the segments
+   have been found by the former sequential floodfill so we get the same id's independent of
+   the number of threads. As before
+   - only segments with a minimum size of 4 are used
+   - unused locations next to a segment are marked by DT_SEG_ID_MASK and the lowest id nearby
+   - the bounding rectangle of a segment includes it's first location and the marked borders
+   Two things differ from the floodfill, see src/tests/unittests/iop/test_segmentation.c
+   - the floodfill tested the column instead of the row before marking the location above
+     every location it started a horizontal run from, so depending on the fill order it
+     marked locations in the top margin and missed some in the two columns next to the
+     left margin. All marks use the row test now, so they only differ in the top margin,
+     the two rows below it and the two columns next to the left margin.
+   - a segment too small to be kept was reverted inside the rectangle of its marks only,
+     locations of it could keep their id which was then handed to the next segment.
+*/
+void dt_segmentize_plane(dt_iop_segmentation_t *seg)
+{
+  const double start = dt_get_debug_wtime();
+  const int width = seg->width;
+  const int height = seg->height;
   const int border = seg->border;
   uint32_t *d = seg->data;
-  int xp = 0;
-  int yp = 0;
-  size_t rp = 0;
-  int min_x = xin;
-  int max_x = xin;
-  int min_y = yin;
-  int max_y = yin;
-  int cnt = 0;
-  stack->pos = 0;
-  _clear_segment_slot(seg, id);
-
-  _push_stack(xin, yin, stack);
-  while(stack->pos)
+  uint32_t *parent = seg->tmp;
+
+  const int rows = height - 2 * border;
+  const int stripes = CLAMP(rows / DT_SEG_STRIPE_ROWS, 1, (int)dt_get_num_threads());
+  GArray **runs = g_new0(GArray *, stripes);
+  GArray **segments = g_new0(GArray *, stripes);
+  for(int s = 0; s < stripes; s++)
   {
-    dt_pos_t *coord = _pop_stack(stack);
-    const int x = coord->xpos;
-    const int y = coord->ypos;
-    if(d[y*w+x] == 1)
-    {
-      int yUp = y - 1, yDown = y + 1;
-      gboolean lastXUp = FALSE, lastXDown = FALSE, firstXUp = FALSE, firstXDown = FALSE;
-      d[y*w+x] = id;
-      cnt++;
-      if(yUp >= border && d[yUp*w+x] == 1)
-      {
-        _push_stack(x, yUp, stack); firstXUp = lastXUp = TRUE;
-      }
-      else
-      {
-        xp = x;
-        yp = yUp;
-        rp = yp*w + xp;
-        if(xp > border+1 && d[rp] == 0)
-        {
-          min_x = MIN(min_x, xp);
-          max_x = MAX(max_x, xp);
-          min_y = MIN(min_y, yp);
-          max_y = MAX(max_y, yp);
-          d[rp] = DT_SEG_ID_MASK | id;
-        }
-      }
+    runs[s] = g_array_new(FALSE, FALSE, sizeof(dt_seg_run_t));
+    segments[s] = g_array_new(FALSE, FALSE, sizeof(uint32_t));
+  }
 
-      if(yDown < h-border && d[yDown*w+x] == 1)
-      {
-        _push_stack(x, yDown, stack); firstXDown = lastXDown = TRUE;
-      }
-      else
-      {
-        xp = x;
-        yp = yDown;
-        rp = yp*w + xp;
-        if(yp < h-border-2 && d[rp] == 0)
-        {
-          min_x = MIN(min_x, xp);
-          max_x = MAX(max_x, xp);
-          min_y = MIN(min_y, yp);
-          max_y = MAX(max_y, yp);
-          d[rp] = DT_SEG_ID_MASK | id;
-        }
-      }
+  size_t padded;
+  int *bbox = dt_alloc_perthread(4 * seg->slots, sizeof(int), &padded);
+  if(!bbox)
+  {
+    dt_print(DT_DEBUG_ALWAYS, "[segmentize_plane] can't allocate segment boxes");
+    goto finish;
+  }
 
-      int xr = x + 1;
-      while(xr < w-border && d[y*w+xr] == 1)
+  /* Label all stripes independently. We work on horizontal runs of segment locations,
+     all of them get the first location as parent and are linked to the segments above.
+  */
+  DT_OMP_FOR()
+  for(int s = 0; s < stripes; s++)
+  {
+    const int r0 = _stripe_row(s, stripes, rows, border);
+    const int r1 = _stripe_row(s + 1, stripes, rows, border);
+    for(int row = r0; row < r1; row++)
+    {
+      const size_t rowloc = (size_t)row * width;
+      int col = border;
+      while(col < width - border)
       {
-        d[y*w+xr] = id;
-        cnt++;
-        if(yUp >= border && d[yUp*w + xr] == 1)
+        if(!d[rowloc + col])
         {
-          if(!lastXUp) { _push_stack(xr, yUp, stack); lastXUp = TRUE; }
+          col++;
+          continue;
         }
-        else
-        {
-          xp = xr;
-          yp = yUp;
-          rp = yp*w + xp;
-          if(yp > border+1 && d[rp] == 0)
-          {
-            min_x = MIN(min_x, xp);
-            max_x = MAX(max_x, xp);
-            min_y = MIN(min_y, yp);
-            max_y = MAX(max_y, yp);
-            d[rp] = DT_SEG_ID_MASK | id;
-          }
-          lastXUp = FALSE;
-        }
-
-        if(yDown < h-border && d[yDown*w+xr] == 1)
-        {
-          if(!lastXDown) { _push_stack(xr, yDown, stack); lastXDown = TRUE; }
-        }
-        else
-        {
-          xp = xr;
-          yp = yDown;
-          rp = yp*w + xp;
-          if(yp < h-border-2 && d[rp] == 0)
-          {
-            min_x = MIN(min_x, xp);
-            max_x = MAX(max_x, xp);
-            min_y = MIN(min_y, yp);
-            max_y = MAX(max_y, yp);
-            d[rp] = DT_SEG_ID_MASK | id;
-          }
-          lastXDown = FALSE;
-        }
-        xr++;
-      }
 
-      xp = xr;
-      yp = y;
-      rp = yp*w + xp;
-      if(xp < w-border-2 && d[rp] == 0)
-      {
-        min_x = MIN(min_x, xp);
-        max_x = MAX(max_x, xp);
-        min_y = MIN(min_y, yp);
-        max_y = MAX(max_y, yp);
-        d[rp] = DT_SEG_ID_MASK | id;
-      }
+        const uint32_t first = rowloc + col;
+        uint32_t run = 0;
+        for(; col < width - border && d[rowloc + col]; col++, run++)
+          parent[rowloc + col] = first;
+        d[first] = run;
+        const dt_seg_run_t newrun = { first, run, first };
+        g_array_append_val(runs[s], newrun);
 
-      int xl = x - 1;
-      lastXUp = firstXUp;
-      lastXDown = firstXDown;
-      while(xl >= border && d[y*w+xl] == 1)
-      {
-        d[y*w+xl] = id;
-        cnt++;
-        if(yUp >= border && d[yUp*w+xl] == 1)
-        {
-          if(!lastXUp) { _push_stack(xl, yUp, stack); lastXUp = TRUE; }
-        }
-        else
-        {
-          xp = xl;
-          yp = yUp;
-          rp = yp*w + xp;
-          if(yp > border+1 && d[rp] == 0)
-          {
-            min_x = MIN(min_x, xp);
-            max_x = MAX(max_x, xp);
-            min_y = MIN(min_y, yp);
-            max_y = MAX(max_y, yp);
-            d[rp] = DT_SEG_ID_MASK | id;
-          }
-          lastXUp = FALSE;
-        }
+        if(row == r0)
+          continue;
 
-        if(yDown < h-border && d[yDown*w+xl] == 1)
+        for(uint32_t loc = first; loc < first + run; loc++)
         {
-          if(!lastXDown) { _push_stack(xl, yDown, stack); lastXDown = TRUE; }
+          // a run of upper locations only needs to be linked once
+          if(d[loc-width] && (loc == first || !d[loc-width-1]))
+            _ccl_link(parent, d, _ccl_root_halving(parent, loc-width), _ccl_root_halving(parent, first));
         }
-        else
-        {
-          xp = xl;
-          yp = yDown;
-          rp = yp*w + xp;
-          if(yp < h-border-2 && d[rp] == 0)
-          {
-            min_x = MIN(min_x, xp);
-            max_x = MAX(max_x, xp);
-            min_y = MIN(min_y, yp);
-            max_y = MAX(max_y, yp);
-            d[rp] = DT_SEG_ID_MASK | id;
-          }
-          lastXDown = FALSE;
-        }
-        xl--;
       }
+    }
+  }
 
-      d[y*w+x] = id;
+  // merge segments crossing the stripe borders
+  for(int s = 1; s < stripes; s++)
+  {
+    const size_t rowloc = (size_t)_stripe_row(s, stripes, rows, border) * width;
+    for(int col = border; col < width - border; col++)
+    {
+      const uint32_t loc = rowloc + col;
+      if(d[loc] && d[loc-width])
+        _ccl_link(parent, d, _ccl_root(parent, loc-width), _ccl_root(parent, loc));
+    }
+  }
 
-      xp = xl;
-      yp = y;
-      rp = yp*w + xp;
-      if(xp > border+1 && d[rp] == 0)
-      {
-        min_x = MIN(min_x, xp);
-        max_x = MAX(max_x, xp);
-        min_y = MIN(min_y, yp);
-        max_y = MAX(max_y, yp);
-        d[rp] = DT_SEG_ID_MASK | id;
-      }
+  // keep the roots of segments with a minimum size of 4 to avoid oversegmentizing
+  DT_OMP_FOR()
+  for(int s = 0; s < stripes; s++)
+  {
+    dt_seg_run_t *run = (dt_seg_run_t *)runs[s]->data;
+    for(guint i = 0; i < runs[s]->len; i++)
+    {
+      run[i].root = _ccl_root(parent, run[i].first);
+      if(run[i].root != run[i].first)
+        continue;
+      if(d[run[i].first] > 3)
+        g_array_append_val(segments[s], run[i].first);
+      else
+        d[run[i].first] = 1;
     }
   }
 
-  const gboolean success = cnt > 3;
-  if(!success) // To avoid oversegmentizing we only use segments with a minimum size of 4
+  int id = 2;
+  int found = 0;
+  for(int s = 0; s < stripes; s++)
   {
-    // data in too In any case we want to revert border markings too
-    for(int row = min_y; row <= max_y; row++)
+    for(guint i = 0; i < segments[s]->len; i++)
     {
-      for(int col = min_x; col <= max_x; col++)
+      const uint32_t loc = g_array_index(segments[s], uint32_t, i);
+      found++;
+      if(id >= seg->slots - 2)
       {
-        size_t loc = (size_t)w*row + col;
-        if(d[loc] == id)
-          d[loc] = 1;
-        else if(d[loc] == (id | DT_SEG_ID_MASK))
-          d[loc] = 0;
+        d[loc] = 1;
+        continue;
       }
+      _clear_segment_slot(seg, id);
+      seg->size[id] = d[loc];
+      seg->xmin[id] = seg->xmax[id] = loc % width;
+      seg->ymin[id] = seg->ymax[id] = loc / width;
+      d[loc] = id++;
     }
   }
-  else
+  const int nr = id;
+
+  for(size_t t = 0; t < dt_get_num_threads(); t++)
   {
-    seg->size[id] = cnt;
-    seg->xmin[id] = min_x;
-    seg->xmax[id] = max_x;
-    seg->ymin[id] = min_y;
-    seg->ymax[id] = max_y;
-
-    seg->nr += 1;
-    _clear_segment_slot(seg, id+1);
+    int *box = dt_get_bythread(bbox, padded, t);
+    for(int i = 0; i < nr; i++)
+    {
+      box[4*i]   = box[4*i+2] = INT_MAX;
+      box[4*i+1] = box[4*i+3] = INT_MIN;
+    }
   }
 
-  return success;
-}
-
-// User interface
-void dt_segmentize_plane(dt_iop_segmentation_t *seg)
-{
-  dt_ff_stack_t stack;
-  const int width = seg->width;
-  const int height = seg->height;
-  stack.size = (size_t)width * height / 32;
-  stack.el = dt_alloc_align_type(dt_pos_t, stack.size);
-  if(!stack.el)
+  // label all locations with the id of their root, only the roots are read here and never written
+  DT_OMP_FOR()
+  for(int s = 0; s < stripes; s++)
   {
-    dt_print(DT_DEBUG_ALWAYS, "[segmentize_plane] can't allocate segmentation stack");
-    return;
+    const dt_seg_run_t *run = (dt_seg_run_t *)runs[s]->data;
+    for(guint i = 0; i < runs[s]->len; i++)
+    {
+      const uint32_t id = d[run[i].root];
+      const uint32_t first = run[i].first == run[i].root ? run[i].first + 1 : run[i].first;
+      for(uint32_t loc = first; loc < run[i].first + run[i].len; loc++)
+        d[loc] = id;
+    }
   }
-  const int border = seg->border;
-  int id = 2;
-  for(int row = border; row < height - border; row++)
+
+  /* Mark the segment borders. Even and odd rows are done in separate loops so we don't read
+     data of neighbour rows while another thread writes them.
+  */
+  DT_OMP_PRAGMA(parallel default(firstprivate))
   {
-    for(int col = border; col < width - border; col++)
+    int *box = dt_get_perthread(bbox, padded);
+
+    for(int odd = 0; odd < 2; odd++)
     {
-      if(id >= (seg->slots - 2))
-        goto finish;
-      if(seg->data[(size_t)width * row + col] == 1)
+      DT_OMP_PRAGMA(for schedule(static))
+      for(int row = border + odd; row < height - border; row += 2)
       {
-        if(_floodfill_segmentize(row, col, seg, width, height, id, &stack))
-          id++;
+        for(int col = border; col < width - border; col++)
+        {
+          const size_t loc = (size_t)row * width + col;
+          if(d[loc] || !(d[loc+width] | d[loc-width] | d[loc+1] | d[loc-1]))
+            continue;
+
+          uint32_t sid = 0;
+          if(row > border + 1)          sid = _lower_id(sid, d[loc+width]);
+          if(row < height - border - 2) sid = _lower_id(sid, d[loc-width]);
+          if(col > border + 1)          sid = _lower_id(sid, d[loc+1]);
+          if(col < width - border - 2)  sid = _lower_id(sid, d[loc-1]);
+
+          if(sid)
+          {
+            d[loc] = DT_SEG_ID_MASK | sid;
+            box[4*sid]   = MIN(box[4*sid], col);
+            box[4*sid+1] = MAX(box[4*sid+1], col);
+            box[4*sid+2] = MIN(box[4*sid+2], row);
+            box[4*sid+3] = MAX(box[4*sid+3], row);
+          }
+        }
       }
     }
   }
 
-  finish:
+  for(size_t t = 0; t < dt_get_num_threads(); t++)
+  {
+    const int *box = dt_get_bythread(bbox, padded, t);
+    for(int i = 2; i < nr; i++)
+    {
+      seg->xmin[i] = MIN(seg->xmin[i], box[4*i]);
+      seg->xmax[i] = MAX(seg->xmax[i], box[4*i+1]);
+      seg->ymin[i] = MIN(seg->ymin[i], box[4*i+2]);
+      seg->ymax[i] = MAX(seg->ymax[i], box[4*i+3]);
+    }
+  }
+
+  seg->nr = nr;
+  _clear_segment_slot(seg, nr);
 
-  if(id >= (seg->slots - 2))
+  if(found > nr - 2)
     dt_print(DT_DEBUG_ALWAYS, "[segmentize_plane] %ix%i number of segments exceeds maximum=%i",
              (int)width, (int)height, seg->slots);
 
-  dt_free_align(stack.el);
+  dt_print(DT_DEBUG_PERF, "[segmentize_plane] %ix%i, %i segments, %i stripes: %.3fs",
+           width, height, nr - 2, stripes, dt_get_debug_wtime() - start);
+
+  finish:
+
+  for(int s = 0; s < stripes; s++)
+  {
+    g_array_free(runs[s], TRUE);
+    g_array_free(segments[s], TRUE);
+  }
+  g_free(runs);
+  g_free(segments);
+  dt_free_align(bbox);
 }
 
 void dt_segments_combine(dt_iop_segmentation_t *seg, const int radius)
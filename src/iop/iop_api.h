@@ -264,6 +264,19 @@ REQUIRED(void, process, struct dt_iop_module_t *self,
                         void *const o,
                         const struct dt_iop_roi_t *const roi_in,
                         const struct dt_iop_roi_t *const roi_out);
+/** optional per-pixel variant of process() for modules where every output pixel only depends
+  * on the same input pixel, with unchanged roi and 4 channel float data. Neighbouring modules
+  * providing it are processed as a chain in one pass over the image. in and out may be the
+  * same buffer and it is called in parallel for parts of the image, so no OpenMP in here.
+  * commit_params() can clear piece->process_pointwise_ready for params needing process(). */
+OPTIONAL(void, process_pointwise, struct dt_iop_module_t *self,
+                                  struct dt_dev_pixelpipe_iop_t *piece,
+                                  const float *const in,
+                                  float *const out,
+                                  const size_t npixels);
+/** prepares the piece for process_pointwise(), called once per pipe run in pipe order. */
+OPTIONAL(void, process_pointwise_setup, struct dt_iop_module_t *self,
+                                        struct dt_dev_pixelpipe_iop_t *piece);
 /** a tiling variant of process(). */
 DEFAULT(void, process_tiling, struct dt_iop_module_t *self,
                               struct dt_dev_pixelpipe_iop_t *piece,
@@ -314,6 +327,17 @@ OPTIONAL(void, distort_mask, struct dt_iop_module_t *self,
                              float *const out,
                              const struct dt_iop_roi_t *const roi_in,
                              const struct dt_iop_roi_t *const roi_out);
+/** optional coordinate mapping of a module whose process() only resamples its input. points
+  * given relative to the roi_out origin are replaced by the positions relative to the roi_in
+  * origin process() would sample them from. Neighbouring modules providing it are composed
+  * into one warp and their input is resampled once. Returns FALSE if process() currently does
+  * more than that, called with no points to check it before the pipe is run. */
+OPTIONAL(gboolean, distort_warp, struct dt_iop_module_t *self,
+                                 struct dt_dev_pixelpipe_iop_t *piece,
+                                 const struct dt_iop_roi_t *const roi_in,
+                                 const struct dt_iop_roi_t *const roi_out,
+                                 float *const points,
+                                 const size_t points_count);
 
 // introspection related callbacks, will be auto-implemented if
 // DT_MODULE_INTROSPECTION() is used,
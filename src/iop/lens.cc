@@ -55,9 +55,16 @@
 #include <string.h>
 #include <lensfun.h>
 
+#include "lens/grid.c"
+
 #define MAXKNOTS 16
 #define VIGSPLINES 512
 
+// memory for the distortion grids kept in the cache, a grid of a 50MP
+// image takes about 5MB with the coarsest step and 75MB with the finest.
+// the most recently used grid is always kept.
+#define DT_IOP_LENS_GRID_BYTES ((size_t)96 << 20)
+
 extern "C" {
 
 #if LF_VERSION < ((0 << 24) | (2 << 16) | (9 << 8) | 0)
@@ -207,6 +214,9 @@ typedef struct dt_iop_lens_global_data_t
   int kernel_md_vignette;
   int kernel_md_correct;
   lfDatabase *db;
+  // distortion grids shared by all pipes, most recently used first
+  dt_pthread_mutex_t grid_lock;
+  GList *grids;
 } dt_iop_lens_global_data_t;
 
 typedef struct dt_iop_lens_data_t
@@ -226,6 +236,8 @@ typedef struct dt_iop_lens_data_t
   gboolean do_nan_checks;
   gboolean tca_override;
   lfLensCalibTCA custom_tca;
+  // identifies the Lensfun corrections for the distortion grids
+  dt_hash_t grid_hash;
 
   /* embedded metadata data */
   float cor_dist_ft;
@@ -1044,6 +1056,136 @@ static float _get_autoscale_lf(dt_iop_module_t *self,
   return scale;
 }
 
+// the distortion of the grids, data is the lfModifier
+static void _grid_distort(const void *data,
+                          const float x,
+                          const float y,
+                          float res[6])
+{
+  ((const lfModifier *)data)->ApplySubpixelGeometryDistortion(x, y, 1, 1, res);
+}
+
+static size_t _grid_bytes(const dt_iop_lens_grid_t *g)
+{
+  // rejected grids are only remembered by their hash
+  return sizeof(dt_iop_lens_grid_t)
+    + (g->map ? sizeof(float) * 6 * g->nx * g->ny : 0);
+}
+
+static void _grid_release(dt_iop_module_t *self,
+                          dt_iop_lens_grid_t *g)
+{
+  if(!g) return;
+
+  dt_iop_lens_global_data_t *gd = (dt_iop_lens_global_data_t *)self->global_data;
+  dt_pthread_mutex_lock(&gd->grid_lock);
+  // evicted grids are freed by their last user
+  const gboolean unused = --g->refs == 0 && !g_list_find(gd->grids, g);
+  dt_pthread_mutex_unlock(&gd->grid_lock);
+  if(unused) _grid_free(g);
+}
+
+// get the distortion grid of modifier for an image of size w x h,
+// building and caching it on first use. returns NULL if the exact
+// coordinates have to be used, otherwise the grid must be released
+// with _grid_release().
+static dt_iop_lens_grid_t *_grid_get(dt_iop_module_t *self,
+                                     const dt_iop_lens_data_t *d,
+                                     const lfModifier *modifier,
+                                     const int modflags,
+                                     const int w,
+                                     const int h)
+{
+  // the coordinates are not continuous where Lensfun gives NaNs
+  if(d->do_nan_checks
+     || !(modflags & (LF_MODIFY_TCA
+                      | LF_MODIFY_DISTORTION
+                      | LF_MODIFY_GEOMETRY
+                      | LF_MODIFY_SCALE)))
+    return NULL;
+
+  dt_iop_lens_global_data_t *gd = (dt_iop_lens_global_data_t *)self->global_data;
+  dt_hash_t hash = d->grid_hash;
+  hash = dt_hash(hash, &modflags, sizeof(modflags));
+  hash = dt_hash(hash, &w, sizeof(w));
+  hash = dt_hash(hash, &h, sizeof(h));
+
+  dt_iop_lens_grid_t *grid = NULL;
+  gboolean found = FALSE;
+  dt_pthread_mutex_lock(&gd->grid_lock);
+  for(GList *l = gd->grids; l; l = g_list_next(l))
+  {
+    dt_iop_lens_grid_t *g = (dt_iop_lens_grid_t *)l->data;
+    if(g->hash == hash)
+    {
+      gd->grids = g_list_remove_link(gd->grids, l);
+      gd->grids = g_list_concat(l, gd->grids);
+      found = TRUE;
+      if(g->map)
+      {
+        g->refs++;
+        grid = g;
+      }
+      break;
+    }
+  }
+  dt_pthread_mutex_unlock(&gd->grid_lock);
+  if(found) return grid;
+
+  const double start = dt_get_debug_wtime();
+  dt_iop_lens_grid_t *built =
+    (dt_iop_lens_grid_t *)calloc(1, sizeof(dt_iop_lens_grid_t));
+  built->hash = hash;
+  const float error = _grid_make(built, _grid_distort, modifier, w, h);
+
+  dt_print(DT_DEBUG_PERF,
+           "[lens] distortion grid for %dx%d %s: %dx%d nodes, step %d, max error %.4f px, %.3fs",
+           w, h, built->map ? "built" : "rejected",
+           built->nx, built->ny, built->step, error,
+           dt_get_debug_wtime() - start);
+
+  dt_pthread_mutex_lock(&gd->grid_lock);
+  // another pipe might have been faster
+  for(GList *l = gd->grids; l; l = g_list_next(l))
+  {
+    dt_iop_lens_grid_t *g = (dt_iop_lens_grid_t *)l->data;
+    if(g->hash == hash)
+    {
+      grid = g;
+      break;
+    }
+  }
+  if(grid)
+    _grid_free(built);
+  else
+  {
+    grid = built;
+    gd->grids = g_list_prepend(gd->grids, grid);
+    // evict the least recently used grids beyond the memory budget
+    size_t bytes = 0;
+    GList *l = gd->grids;
+    while(l)
+    {
+      GList *next = g_list_next(l);
+      dt_iop_lens_grid_t *g = (dt_iop_lens_grid_t *)l->data;
+      bytes += _grid_bytes(g);
+      if(l != gd->grids && bytes > DT_IOP_LENS_GRID_BYTES)
+      {
+        gd->grids = g_list_delete_link(gd->grids, l);
+        if(g->refs == 0) _grid_free(g);
+      }
+      l = next;
+    }
+  }
+  if(grid->map)
+    grid->refs++;
+  else
+    grid = NULL;
+  dt_pthread_mutex_unlock(&gd->grid_lock);
+
+  return grid;
+}
+
 static void _process_lf(dt_iop_module_t *self,
                         dt_dev_pixelpipe_iop_t *piece,
                         const void *const ivoid,
@@ -1085,6 +1227,8 @@ static void _process_lf(dt_iop_module_t *self,
 
   dt_pthread_mutex_unlock(&darktable.plugin_threadsafe);
 
+  dt_iop_lens_grid_t *grid = _grid_get(self, d, modifier, modflags, orig_w, orig_h);
+
   const struct dt_interpolation *const interpolation =
     dt_interpolation_new(DT_INTERPOLATION_USERPREF_WARP);
 
@@ -1106,8 +1250,11 @@ static void _process_lf(dt_iop_module_t *self,
       for(int y = 0; y < roi_out->height; y++)
       {
         float *bufptr = (float*)dt_get_perthread(buf, padded_bufsize);
-        modifier->ApplySubpixelGeometryDistortion(roi_out->x, roi_out->y + y,
-                                                  roi_out->width, 1, bufptr);
+        if(grid)
+          _grid_apply(grid, roi_out->x, roi_out->y + y, roi_out->width, bufptr);
+        else
+          modifier->ApplySubpixelGeometryDistortion(roi_out->x, roi_out->y + y,
+                                                    roi_out->width, 1, bufptr);
 
         // reverse transform the global coords from lf to our buffer
         float *out = ((float *)ovoid) + (size_t)y * roi_out->width * ch;
@@ -1216,10 +1363,13 @@ static void _process_lf(dt_iop_module_t *self,
       for(int y = 0; y < roi_out->height; y++)
       {
         float *buf2ptr = (float*)dt_get_perthread(buf2, padded_buf2size);
-        modifier->ApplySubpixelGeometryDistortion(roi_out->x,
-                                                  roi_out->y + y,
-                                                  roi_out->width,
-                                                  1, buf2ptr);
+        if(grid)
+          _grid_apply(grid, roi_out->x, roi_out->y + y, roi_out->width, buf2ptr);
+        else
+          modifier->ApplySubpixelGeometryDistortion(roi_out->x,
+                                                    roi_out->y + y,
+                                                    roi_out->width,
+                                                    1, buf2ptr);
         // reverse transform the global coords from lf to our buffer
         float *out = ((float *)ovoid) + (size_t)y * roi_out->width * ch;
         for(int x = 0; x < roi_out->width; x++, buf2ptr += 6, out += ch)
@@ -1279,6 +1429,7 @@ static void _process_lf(dt_iop_module_t *self,
     }
     dt_free_align(buf);
   }
+  _grid_release(self, grid);
   delete modifier;
 }
 
@@ -1304,6 +1455,7 @@ static int _process_cl_lf(dt_iop_module_t *self,
 
   float *tmpbuf = NULL;
   lfModifier *modifier = NULL;
+  dt_iop_lens_grid_t *grid = NULL;
 
   const int devid = piece->pipe->devid;
   const int iwidth = roi_in->width;
@@ -1374,6 +1526,8 @@ static int _process_cl_lf(dt_iop_module_t *self,
   modifier = _get_modifier(&modflags, orig_w, orig_h, d, used_lf_mask, FALSE);
   dt_pthread_mutex_unlock(&darktable.plugin_threadsafe);
 
+  grid = _grid_get(self, d, modifier, modflags, orig_w, orig_h);
+
   if(d->inverse)
   {
     // reverse direction (useful for renderings)
@@ -1386,9 +1540,12 @@ static int _process_cl_lf(dt_iop_module_t *self,
       for(int y = 0; y < roi_out->height; y++)
       {
         float *pi = tmpbuf + (size_t)y * tmpbufwidth;
-        modifier->ApplySubpixelGeometryDistortion(roi_out->x,
-                                                  roi_out->y + y,
-                                                  roi_out->width, 1, pi);
+        if(grid)
+          _grid_apply(grid, roi_out->x, roi_out->y + y, roi_out->width, pi);
+        else
+          modifier->ApplySubpixelGeometryDistortion(roi_out->x,
+                                                    roi_out->y + y,
+                                                    roi_out->width, 1, pi);
       }
 
       err = dt_opencl_write_buffer_to_device(devid, tmpbuf,
@@ -1499,9 +1656,12 @@ static int _process_cl_lf(dt_iop_module_t *self,
       for(int y = 0; y < roi_out->height; y++)
       {
         float *pi = tmpbuf + (size_t)y * tmpbufwidth;
-        modifier->ApplySubpixelGeometryDistortion(roi_out->x,
-                                                  roi_out->y + y,
-                                                  roi_out->width, 1, pi);
+        if(grid)
+          _grid_apply(grid, roi_out->x, roi_out->y + y, roi_out->width, pi);
+        else
+          modifier->ApplySubpixelGeometryDistortion(roi_out->x,
+                                                    roi_out->y + y,
+                                                    roi_out->width, 1, pi);
       }
 
       err = dt_opencl_write_buffer_to_device(devid, tmpbuf,
@@ -1528,6 +1688,7 @@ error:
   dt_opencl_release_mem_object(dev_tmp);
   dt_opencl_release_mem_object(dev_tmpbuf);
   dt_free_align(tmpbuf);
+  _grid_release(self, grid);
   if(modifier != NULL) delete modifier;
   return err;
 }
@@ -1630,6 +1791,76 @@ static gboolean _distort_backtransform_lf(dt_iop_module_t *self,
   return TRUE;
 }
 
+static gboolean _distort_warp_lf(dt_iop_module_t *self,
+                                 dt_dev_pixelpipe_iop_t *piece,
+                                 const dt_iop_roi_t *const roi_in,
+                                 const dt_iop_roi_t *const roi_out,
+                                 float *const points,
+                                 const size_t points_count)
+{
+  const dt_iop_lens_data_t *const d = (dt_iop_lens_data_t *)piece->data;
+
+  if(!d->lens || !d->lens->Maker || d->crop <= 0.0f)
+    return FALSE;
+
+  const gboolean raw_monochrome =
+    dt_image_is_monochrome(&self->dev->image_storage);
+  const int used_lf_mask = (raw_monochrome)
+    ? LF_MODIFY_ALL & ~LF_MODIFY_TCA
+    : LF_MODIFY_ALL;
+
+  const float orig_w = roi_in->scale * piece->buf_in.width;
+  const float orig_h = roi_in->scale * piece->buf_in.height;
+
+  dt_pthread_mutex_lock(&darktable.plugin_threadsafe);
+  int modflags;
+  const lfModifier *modifier =
+    _get_modifier(&modflags, orig_w, orig_h, d, used_lf_mask, FALSE);
+  dt_pthread_mutex_unlock(&darktable.plugin_threadsafe);
+
+  // a coordinate per channel and vignetting need the full process()
+  if(modflags & (LF_MODIFY_TCA | LF_MODIFY_VIGNETTING))
+  {
+    delete modifier;
+    return FALSE;
+  }
+
+  if(points_count == 0
+     || !(modflags & (LF_MODIFY_DISTORTION | LF_MODIFY_GEOMETRY | LF_MODIFY_SCALE)))
+  {
+    delete modifier;
+    return TRUE;
+  }
+
+  dt_iop_lens_grid_t *grid = _grid_get(self, d, modifier, modflags, orig_w, orig_h);
+
+  DT_OMP_FOR(if(points_count > 100))
+  for(size_t i = 0; i < points_count * 2; i += 2)
+  {
+    float res[6];
+    const float x = roi_out->x + points[i];
+    const float y = roi_out->y + points[i + 1];
+    if(grid)
+      _grid_apply(grid, x, y, 1, res);
+    else
+      modifier->ApplySubpixelGeometryDistortion(x, y, 1, 1, res);
+
+    // as in _process_lf(), invalid coordinates give black and the
+    // others are clamped to the input
+    if(d->do_nan_checks && (!isfinite(res[2]) || !isfinite(res[3])))
+    {
+      points[i] = points[i + 1] = NAN;
+      continue;
+    }
+    points[i] = fmaxf(fminf(res[2] - roi_in->x, roi_in->width - 1.0f), 0.0f);
+    points[i + 1] = fmaxf(fminf(res[3] - roi_in->y, roi_in->height - 1.0f), 0.0f);
+  }
+
+  _grid_release(self, grid);
+  delete modifier;
+  return TRUE;
+}
+
 // TODO: Shall we keep LF_MODIFY_TCA in the modifiers?
 static void _distort_mask_lf(dt_iop_module_t *self,
                              dt_dev_pixelpipe_iop_t *piece,
@@ -1667,6 +1898,8 @@ static void _distort_mask_lf(dt_iop_module_t *self,
     return;
   }
 
+  dt_iop_lens_grid_t *grid = _grid_get(self, d, modifier, modflags, orig_w, orig_h);
+
   const struct dt_interpolation *const interpolation =
     dt_interpolation_new(DT_INTERPOLATION_USERPREF_WARP);
 
@@ -1679,8 +1912,11 @@ static void _distort_mask_lf(dt_iop_module_t *self,
   for(int y = 0; y < roi_out->height; y++)
   {
     float *bufptr = (float*)dt_get_perthread(buf, padded_bufsize);
-    modifier->ApplySubpixelGeometryDistortion(roi_out->x, roi_out->y + y,
-                                              roi_out->width, 1, bufptr);
+    if(grid)
+      _grid_apply(grid, roi_out->x, roi_out->y + y, roi_out->width, bufptr);
+    else
+      modifier->ApplySubpixelGeometryDistortion(roi_out->x, roi_out->y + y,
+                                                roi_out->width, 1, bufptr);
 
     // reverse transform the global coords from lf to our buffer
     float *_out = out + (size_t)y * roi_out->width;
@@ -1701,6 +1937,7 @@ static void _distort_mask_lf(dt_iop_module_t *self,
     }
   }
   dt_free_align(buf);
+  _grid_release(self, grid);
   delete modifier;
 }
 
@@ -1909,6 +2146,19 @@ static void _commit_params_lf(dt_iop_module_t *self,
     d->do_nan_checks = FALSE;
   }
 
+  dt_hash_t hash = dt_hash(DT_INITHASH, p->camera, sizeof(p->camera));
+  hash = dt_hash(hash, p->lens, sizeof(p->lens));
+  hash = dt_hash(hash, &p->tca_override, sizeof(p->tca_override));
+  hash = dt_hash(hash, &p->tca_r, sizeof(p->tca_r));
+  hash = dt_hash(hash, &p->tca_b, sizeof(p->tca_b));
+  hash = dt_hash(hash, &d->crop, sizeof(d->crop));
+  hash = dt_hash(hash, &d->inverse, sizeof(d->inverse));
+  hash = dt_hash(hash, &d->scale, sizeof(d->scale));
+  hash = dt_hash(hash, &d->focal, sizeof(d->focal));
+  hash = dt_hash(hash, &d->aperture, sizeof(d->aperture));
+  hash = dt_hash(hash, &d->distance, sizeof(d->distance));
+  d->grid_hash = dt_hash(hash, &d->target_geom, sizeof(d->target_geom));
+
   /* calculate which corrections will be applied by Lensfun */
   if(self->dev->gui_attached
      && g
@@ -3218,6 +3468,25 @@ gboolean distort_backtransform(dt_iop_module_t *self,
   return FALSE;
 }
 
+gboolean distort_warp(dt_iop_module_t *self,
+                      dt_dev_pixelpipe_iop_t *piece,
+                      const dt_iop_roi_t *const roi_in,
+                      const dt_iop_roi_t *const roi_out,
+                      float *const points,
+                      const size_t points_count)
+{
+  const dt_iop_lens_data_t *const d = (dt_iop_lens_data_t *)piece->data;
+  const dt_iop_lens_gui_data_t *const g = (dt_iop_lens_gui_data_t *)self->gui_data;
+
+  // the manual vignette is applied to the input
+  if(d->method != DT_IOP_LENS_METHOD_LENSFUN
+     || d->v_strength > 0.0f
+     || (g && g->vig_masking))
+    return FALSE;
+
+  return _distort_warp_lf(self, piece, roi_in, roi_out, points, points_count);
+}
+
 void distort_mask(dt_iop_module_t *self,
                   dt_dev_pixelpipe_iop_t *piece,
                   const float *const in,
@@ -3372,6 +3641,7 @@ void init_global(dt_iop_module_so_t *self)
 
   lfDatabase *dt_iop_lensfun_db = new lfDatabase;
   gd->db = (lfDatabase *)dt_iop_lensfun_db;
+  dt_pthread_mutex_init(&gd->grid_lock, NULL);
 
 #if defined(__MACH__) || defined(__APPLE__)
 #else
@@ -3610,6 +3880,9 @@ void cleanup_global(dt_iop_module_so_t *self)
   lfDatabase *dt_iop_lensfun_db = (lfDatabase *)gd->db;
   delete dt_iop_lensfun_db;
 
+  g_list_free_full(gd->grids, (GDestroyNotify)_grid_free);
+  dt_pthread_mutex_destroy(&gd->grid_lock);
+
   dt_opencl_free_kernel(gd->kernel_lens_distort_bilinear);
   dt_opencl_free_kernel(gd->kernel_lens_distort_bicubic);
   dt_opencl_free_kernel(gd->kernel_lens_distort_lanczos2);
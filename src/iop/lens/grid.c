@@ -0,0 +1,227 @@
+/*
+    This file is part of darktable,
+    Copyright (C) 2025 darktable developers.
+
+    darktable is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    darktable is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with darktable.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Distortion grids of the lens module.
+
+   The distorted coordinates of the three channels change smoothly over the image, so
+   instead of evaluating the distortion for every pixel it is evaluated on the nodes of a
+   regular grid and bicubically interpolated. A grid is only used if the interpolated
+   coordinates are within DT_IOP_LENS_GRID_TOLERANCE pixels of the exact ones.
+
+   This file is included by lens.cc and the unit tests, the distortion is given by a
+   callback so it doesn't depend on Lensfun.
+*/
+
+// spacing in pixels of the grid nodes, halved down to DT_IOP_LENS_GRID_MIN_STEP
+// until the interpolated coordinates are within DT_IOP_LENS_GRID_TOLERANCE
+// pixels of the exact ones.
+#define DT_IOP_LENS_GRID_STEP 16
+#define DT_IOP_LENS_GRID_MIN_STEP 4
+#define DT_IOP_LENS_GRID_TOLERANCE 0.01f
+
+// the coordinates given by the distortion for the nodes of a regular grid
+// covering the whole image, node (i, j) being at ((i - 1) * step, (j - 1) * step).
+typedef struct dt_iop_lens_grid_t
+{
+  dt_hash_t hash;
+  int refs;
+  int step, nx, ny;
+  float *map; // 6 floats per node, NULL if the grid is not accurate enough
+} dt_iop_lens_grid_t;
+
+// the distorted x and y coordinates of the red, green and blue channels at (x, y)
+typedef void(dt_iop_lens_grid_distort_t)(const void *data,
+                                         const float x,
+                                         const float y,
+                                         float res[6]);
+
+static inline void _catmull_rom_weights(const float t, float w[4])
+{
+  w[0] = ((-0.5f * t + 1.0f) * t - 0.5f) * t;
+  w[1] = (1.5f * t - 2.5f) * t * t + 1.0f;
+  w[2] = ((-1.5f * t + 2.0f) * t + 0.5f) * t;
+  w[3] = (0.5f * t - 0.5f) * t * t;
+}
+
+// the distorted coordinates of width pixels starting at (xu, yu),
+// bicubically interpolated from the grid
+static void _grid_apply(const dt_iop_lens_grid_t *g,
+                        const float xu,
+                        const float yu,
+                        const int width,
+                        float *res)
+{
+  const float inv = 1.0f / g->step;
+  const size_t rowstride = (size_t)g->nx * 6;
+
+  const int j = CLAMP((int)floorf(yu * inv) + 1, 1, g->ny - 3);
+  float wy[4];
+  _catmull_rom_weights(CLAMP((yu - (j - 1) * g->step) * inv, 0.0f, 1.0f), wy);
+  const float *row = g->map + (size_t)(j - 1) * rowstride;
+
+  int x = 0;
+  while(x < width)
+  {
+    const int i = CLAMP((int)floorf((xu + x) * inv) + 1, 1, g->nx - 3);
+    const float x0 = (i - 1) * g->step;
+    // the pixels within this grid cell, all the remaining ones on the last
+    const int end = i == g->nx - 3
+      ? width
+      : MAX(x + 1, MIN(width, (int)ceilf(x0 + g->step - xu)));
+
+    // vertically interpolated columns around the cell
+    float col[4][6];
+    for(int k = 0; k < 4; k++)
+    {
+      const float *node = row + (size_t)(i - 1 + k) * 6;
+      for(int c = 0; c < 6; c++)
+        col[k][c] = wy[0] * node[c]
+                    + wy[1] * node[rowstride + c]
+                    + wy[2] * node[2 * rowstride + c]
+                    + wy[3] * node[3 * rowstride + c];
+    }
+
+    for(; x < end; x++)
+    {
+      float wx[4];
+      _catmull_rom_weights(CLAMP((xu + x - x0) * inv, 0.0f, 1.0f), wx);
+      float *out = res + (size_t)x * 6;
+      for(int c = 0; c < 6; c++)
+        out[c] = wx[0] * col[0][c] + wx[1] * col[1][c]
+                 + wx[2] * col[2][c] + wx[3] * col[3][c];
+    }
+  }
+}
+
+// the positions checked along an image side of size pixels: the first and last
+// pixel, the two cells at both ends, where the distortion is the strongest, and
+// every third cell between them. the error of the interpolation vanishes at the
+// nodes and the cell centers, so the cells are checked at a quarter and three
+// quarters of their width. pos has to hold 2 * size / step + 6 positions,
+// returns their number.
+static int _grid_samples(float *pos, const int size, const int step)
+{
+  const int cells = (size + step - 1) / step;
+  int n = 0;
+  pos[n++] = 0.0f;
+  for(int k = 0; k < cells; k++)
+  {
+    if(k < 2 || k >= cells - 2 || k % 3 == 0)
+    {
+      pos[n++] = MIN(k * step + step / 4, size - 1);
+      pos[n++] = MIN(k * step + 3 * step / 4, size - 1);
+    }
+  }
+  pos[n++] = size - 1;
+  return n;
+}
+
+// evaluate the distortion on a grid of the given step, and check it against
+// the exact coordinates at the sample positions. returns the maximum error in
+// pixels, or INFINITY if the distortion gave non-finite coordinates.
+static float _grid_build(dt_iop_lens_grid_t *g,
+                         dt_iop_lens_grid_distort_t *distort,
+                         const void *data,
+                         const int w,
+                         const int h,
+                         const int step)
+{
+  g->step = step;
+  g->nx = (w + step - 1) / step + 4;
+  g->ny = (h + step - 1) / step + 4;
+  g->map = dt_alloc_align_float((size_t)g->nx * g->ny * 6);
+  if(!g->map) return INFINITY;
+
+  const int nx = g->nx;
+  const int ny = g->ny;
+  float *const map = g->map;
+  int finite = TRUE;
+  DT_OMP_FOR(reduction(&&: finite))
+  for(int j = 0; j < ny; j++)
+  {
+    for(int i = 0; i < nx; i++)
+    {
+      float *node = map + ((size_t)j * nx + i) * 6;
+      distort(data, (i - 1) * step, (j - 1) * step, node);
+      for(int c = 0; c < 6; c++)
+        finite = finite && isfinite(node[c]);
+    }
+  }
+  if(!finite) return INFINITY;
+
+  float *sx = dt_alloc_align_float(2 * w / step + 6);
+  float *sy = dt_alloc_align_float(2 * h / step + 6);
+  if(!sx || !sy)
+  {
+    dt_free_align(sx);
+    dt_free_align(sy);
+    return INFINITY;
+  }
+  const int cx = _grid_samples(sx, w, step);
+  const int cy = _grid_samples(sy, h, step);
+  float error = 0.0f;
+  DT_OMP_FOR(reduction(max: error))
+  for(int m = 0; m < cy; m++)
+  {
+    for(int k = 0; k < cx; k++)
+    {
+      float exact[6], approx[6];
+      distort(data, sx[k], sy[m], exact);
+      _grid_apply(g, sx[k], sy[m], 1, approx);
+      for(int c = 0; c < 6; c++)
+        error = fmaxf(error, fabsf(exact[c] - approx[c]));
+    }
+  }
+  dt_free_align(sx);
+  dt_free_align(sy);
+  return error;
+}
+
+// build the coarsest grid of the distortion within the tolerance for an image of
+// w x h pixels. returns the error of the last grid tried, g->map is NULL if none
+// of them was accurate enough.
+static float _grid_make(dt_iop_lens_grid_t *g,
+                        dt_iop_lens_grid_distort_t *distort,
+                        const void *data,
+                        const int w,
+                        const int h)
+{
+  float error = INFINITY;
+  for(int step = DT_IOP_LENS_GRID_STEP; step >= DT_IOP_LENS_GRID_MIN_STEP; step /= 2)
+  {
+    error = _grid_build(g, distort, data, w, h, step);
+    if(error <= DT_IOP_LENS_GRID_TOLERANCE) break;
+    dt_free_align(g->map);
+    g->map = NULL;
+    // no finer grid will help
+    if(!isfinite(error)) break;
+  }
+  return error;
+}
+
+static void _grid_free(dt_iop_lens_grid_t *g)
+{
+  dt_free_align(g->map);
+  free(g);
+}
+
+// clang-format off
+// modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
+// vim: shiftwidth=2 expandtab tabstop=2 cindent
+// kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
+// clang-format on
@@ -34,7 +34,9 @@
 #include "imageio/imageio_png.h"
 #include "iop/iop_api.h"
 
+#include <glib/gstdio.h>
 #include <gtk/gtk.h>
+#include <inttypes.h>
 #include <libgen.h>
 #include <png.h>
 #include <stdio.h>
@@ -227,154 +229,142 @@ int legacy_params(dt_iop_module_t *self,
 
   return 1;
 }
+// number of pixels interpolated together, the lattice lookups of a block are gathered
+#define DT_IOP_LUT3D_BLOCK 8
+
+// find the lattice cell and the position inside the cell for a block of pixels
+static inline void _lut3d_locate(const float *const restrict in,
+                                 const size_t npix,
+                                 const uint16_t level,
+                                 int *const restrict idx,
+                                 float *const restrict dr,
+                                 float *const restrict dg,
+                                 float *const restrict db)
+{
+  const int level2 = level * level;
+  DT_OMP_SIMD()
+  for(size_t p = 0; p < npix; p++)
+  {
+    const float r = CLIP(in[4*p]) * (float)(level - 1);
+    const float g = CLIP(in[4*p+1]) * (float)(level - 1);
+    const float b = CLIP(in[4*p+2]) * (float)(level - 1);
+    const int ri = CLAMP((int)r, 0, level - 2);
+    const int gi = CLAMP((int)g, 0, level - 2);
+    const int bi = CLAMP((int)b, 0, level - 2);
+    idx[p] = (ri + gi * level + bi * level2) * 3; // index of P000 in clut
+    dr[p] = r - ri; // delta red
+    dg[p] = g - gi; // delta green
+    db[p] = b - bi; // delta blue
+  }
+}
+
 // From `HaldCLUT_correct.c' by Eskil Steenberg (http://www.quelsolaar.com) (BSD licensed)
+__DT_CLONE_TARGETS__
 void correct_pixel_trilinear(const float *const in, float *const out,
                              const size_t pixel_nb, const float *const restrict clut, const uint16_t level)
 {
-  const int level2 = level * level;
+  // offsets of P100, P010 and P001 relative to P000
+  const int o100 = 3;
+  const int o010 = level * 3;
+  const int o001 = level * level * 3;
 
   DT_OMP_FOR()
-  for(size_t k = 0; k < (size_t)(pixel_nb * 4); k+=4)
+  for(size_t k = 0; k < pixel_nb; k += DT_IOP_LUT3D_BLOCK)
   {
-    const float *const input = in + k;
-    float *const output = ((float *const)out) + k;
-
-    int rgbi[3], i, j;
-    float tmp[6];
-    dt_aligned_pixel_t rgbd;
-
-    for_each_channel(c)
-      rgbd[c] = CLIP(input[c]) * (float)(level - 1);
-
-    rgbi[0] = CLAMP((int)rgbd[0], 0, level - 2);
-    rgbi[1] = CLAMP((int)rgbd[1], 0, level - 2);
-    rgbi[2] = CLAMP((int)rgbd[2], 0, level - 2);
-
-    rgbd[0] = rgbd[0] - rgbi[0]; // delta red
-    rgbd[1] = rgbd[1] - rgbi[1]; // delta green
-    rgbd[2] = rgbd[2] - rgbi[2]; // delta blue
-
-  // indexes of P000 to P111 in clut
-    const int color = rgbi[0] + rgbi[1] * level + rgbi[2] * level * level;
-    i = color * 3;  // P000
-    j = (color + 1) * 3;  // P100
-
-    tmp[0] = clut[i] * (1 - rgbd[0]) + clut[j] * rgbd[0];
-    tmp[1] = clut[i+1] * (1 - rgbd[0]) + clut[j+1] * rgbd[0];
-    tmp[2] = clut[i+2] * (1 - rgbd[0]) + clut[j+2] * rgbd[0];
-
-    i = (color + level) * 3;  // P010
-    j = (color + level + 1) * 3;  //P110
-
-    tmp[3] = clut[i] * (1 - rgbd[0]) + clut[j] * rgbd[0];
-    tmp[4] = clut[i+1] * (1 - rgbd[0]) + clut[j+1] * rgbd[0];
-    tmp[5] = clut[i+2] * (1 - rgbd[0]) + clut[j+2] * rgbd[0];
-
-    output[0] = tmp[0] * (1 - rgbd[1]) + tmp[3] * rgbd[1];
-    output[1] = tmp[1] * (1 - rgbd[1]) + tmp[4] * rgbd[1];
-    output[2] = tmp[2] * (1 - rgbd[1]) + tmp[5] * rgbd[1];
-
-    i = (color + level2) * 3;  // P001
-    j = (color + level2 + 1) * 3;  // P101
-
-    tmp[0] = clut[i] * (1 - rgbd[0]) + clut[j] * rgbd[0];
-    tmp[1] = clut[i+1] * (1 - rgbd[0]) + clut[j+1] * rgbd[0];
-    tmp[2] = clut[i+2] * (1 - rgbd[0]) + clut[j+2] * rgbd[0];
-
-    i = (color + level + level2) * 3;  // P011
-    j = (color + level + level2 + 1) * 3;  // P111
-
-    tmp[3] = clut[i] * (1 - rgbd[0]) + clut[j] * rgbd[0];
-    tmp[4] = clut[i+1] * (1 - rgbd[0]) + clut[j+1] * rgbd[0];
-    tmp[5] = clut[i+2] * (1 - rgbd[0]) + clut[j+2] * rgbd[0];
-
-    tmp[0] = tmp[0] * (1 - rgbd[1]) + tmp[3] * rgbd[1];
-    tmp[1] = tmp[1] * (1 - rgbd[1]) + tmp[4] * rgbd[1];
-    tmp[2] = tmp[2] * (1 - rgbd[1]) + tmp[5] * rgbd[1];
-
-    output[0] = output[0] * (1 - rgbd[2]) + tmp[0] * rgbd[2];
-    output[1] = output[1] * (1 - rgbd[2]) + tmp[1] * rgbd[2];
-    output[2] = output[2] * (1 - rgbd[2]) + tmp[2] * rgbd[2];
- }
+    const size_t npix = MIN(DT_IOP_LUT3D_BLOCK, pixel_nb - k);
+    int DT_ALIGNED_ARRAY idx[DT_IOP_LUT3D_BLOCK];
+    float DT_ALIGNED_ARRAY dr[DT_IOP_LUT3D_BLOCK];
+    float DT_ALIGNED_ARRAY dg[DT_IOP_LUT3D_BLOCK];
+    float DT_ALIGNED_ARRAY db[DT_IOP_LUT3D_BLOCK];
+    _lut3d_locate(in + 4 * k, npix, level, idx, dr, dg, db);
+
+    float *const output = out + 4 * k;
+    for(int c = 0; c < 3; c++)
+    {
+      const float *const restrict lut = clut + c;
+      DT_OMP_SIMD()
+      for(size_t p = 0; p < npix; p++)
+      {
+        const int i = idx[p];
+        const float x = dr[p];
+        const float y = dg[p];
+        const float z = db[p];
+        const float c00 = lut[i] * (1 - x) + lut[i + o100] * x;
+        const float c10 = lut[i + o010] * (1 - x) + lut[i + o010 + o100] * x;
+        const float c01 = lut[i + o001] * (1 - x) + lut[i + o001 + o100] * x;
+        const float c11 = lut[i + o001 + o010] * (1 - x) + lut[i + o001 + o010 + o100] * x;
+        const float c0 = c00 * (1 - y) + c10 * y;
+        const float c1 = c01 * (1 - y) + c11 * y;
+        output[4*p + c] = c0 * (1 - z) + c1 * z;
+      }
+    }
+  }
 }
 
 // from OpenColorIO
 // https://github.com/imageworks/OpenColorIO/blob/master/src/OpenColorIO/ops/Lut3D/Lut3DOp.cpp
+__DT_CLONE_TARGETS__
 void correct_pixel_tetrahedral(const float *const in, float *const out,
                                const size_t pixel_nb, const float *const restrict clut, const uint16_t level)
 {
-  const int level2 = level * level;
+  const int o100 = 3;
+  const int o010 = level * 3;
+  const int o001 = level * level * 3;
+  const int o111 = o100 + o010 + o001;
 
   DT_OMP_FOR()
-  for(size_t k = 0; k < (size_t)(pixel_nb * 4); k+=4)
+  for(size_t k = 0; k < pixel_nb; k += DT_IOP_LUT3D_BLOCK)
   {
-    const float *const input = in + k;
-    float *const output = ((float *const)out) + k;
-
-    int rgbi[3];
-    dt_aligned_pixel_t rgbd;
-    for_each_channel(c)
-      rgbd[c] = CLIP(input[c]) * (float)(level - 1);
-
-    rgbi[0] = CLAMP((int)rgbd[0], 0, level - 2);
-    rgbi[1] = CLAMP((int)rgbd[1], 0, level - 2);
-    rgbi[2] = CLAMP((int)rgbd[2], 0, level - 2);
-
-    rgbd[0] = rgbd[0] - rgbi[0]; // delta red
-    rgbd[1] = rgbd[1] - rgbi[1]; // delta green
-    rgbd[2] = rgbd[2] - rgbi[2]; // delta blue
-
-  // indexes of P000 to P111 in clut
-    const int color = rgbi[0] + rgbi[1] * level + rgbi[2] * level * level;
-    const int i000 = color * 3;                     // P000
-    const int i100 = i000 + 3;                      // P100
-    const int i010 = (color + level) * 3;           // P010
-    const int i110 = i010 + 3;                      // P110
-    const int i001 = (color + level2) * 3;          // P001
-    const int i101 = i001 + 3;                      // P101
-    const int i011 = (color + level + level2) * 3;  // P011
-    const int i111 = i011 + 3;                      // P111
-
-    if(rgbd[0] > rgbd[1])
+    const size_t npix = MIN(DT_IOP_LUT3D_BLOCK, pixel_nb - k);
+    int DT_ALIGNED_ARRAY idx[DT_IOP_LUT3D_BLOCK];
+    float DT_ALIGNED_ARRAY dr[DT_IOP_LUT3D_BLOCK];
+    float DT_ALIGNED_ARRAY dg[DT_IOP_LUT3D_BLOCK];
+    float DT_ALIGNED_ARRAY db[DT_IOP_LUT3D_BLOCK];
+    _lut3d_locate(in + 4 * k, npix, level, idx, dr, dg, db);
+
+    /* The tetrahedron is selected by sorting the deltas, the path from P000 to P111
+       goes along the axis with the largest delta first. Selecting the two inner
+       vertices instead of branching keeps the block vectorised.
+    */
+    int DT_ALIGNED_ARRAY v1[DT_IOP_LUT3D_BLOCK];
+    int DT_ALIGNED_ARRAY v2[DT_IOP_LUT3D_BLOCK];
+    float DT_ALIGNED_ARRAY w0[DT_IOP_LUT3D_BLOCK];
+    float DT_ALIGNED_ARRAY w1[DT_IOP_LUT3D_BLOCK];
+    float DT_ALIGNED_ARRAY w2[DT_IOP_LUT3D_BLOCK];
+    float DT_ALIGNED_ARRAY w3[DT_IOP_LUT3D_BLOCK];
+    DT_OMP_SIMD()
+    for(size_t p = 0; p < npix; p++)
     {
-      if(rgbd[1] > rgbd[2])
-      {
-        output[0] = (1-rgbd[0])*clut[i000] + (rgbd[0]-rgbd[1])*clut[i100] + (rgbd[1]-rgbd[2])*clut[i110] + rgbd[2]*clut[i111];
-        output[1] = (1-rgbd[0])*clut[i000+1] + (rgbd[0]-rgbd[1])*clut[i100+1] + (rgbd[1]-rgbd[2])*clut[i110+1] + rgbd[2]*clut[i111+1];
-        output[2] = (1-rgbd[0])*clut[i000+2] + (rgbd[0]-rgbd[1])*clut[i100+2] + (rgbd[1]-rgbd[2])*clut[i110+2] + rgbd[2]*clut[i111+2];
-      }
-      else if(rgbd[0] > rgbd[2])
-      {
-        output[0] = (1-rgbd[0])*clut[i000] + (rgbd[0]-rgbd[2])*clut[i100] + (rgbd[2]-rgbd[1])*clut[i101] + rgbd[1]*clut[i111];
-        output[1] = (1-rgbd[0])*clut[i000+1] + (rgbd[0]-rgbd[2])*clut[i100+1] + (rgbd[2]-rgbd[1])*clut[i101+1] + rgbd[1]*clut[i111+1];
-        output[2] = (1-rgbd[0])*clut[i000+2] + (rgbd[0]-rgbd[2])*clut[i100+2] + (rgbd[2]-rgbd[1])*clut[i101+2] + rgbd[1]*clut[i111+2];
-      }
-      else
-      {
-        output[0] = (1-rgbd[2])*clut[i000] + (rgbd[2]-rgbd[0])*clut[i001] + (rgbd[0]-rgbd[1])*clut[i101] + rgbd[1]*clut[i111];
-        output[1] = (1-rgbd[2])*clut[i000+1] + (rgbd[2]-rgbd[0])*clut[i001+1] + (rgbd[0]-rgbd[1])*clut[i101+1] + rgbd[1]*clut[i111+1];
-        output[2] = (1-rgbd[2])*clut[i000+2] + (rgbd[2]-rgbd[0])*clut[i001+2] + (rgbd[0]-rgbd[1])*clut[i101+2] + rgbd[1]*clut[i111+2];
-      }
+      const float r = dr[p];
+      const float g = dg[p];
+      const float b = db[p];
+      const gboolean rg = r > g;
+      const gboolean gb = g > b;
+      const gboolean rb = r > b;
+      const gboolean bg = b > g;
+      const gboolean br = b > r;
+      // largest, middle and smallest delta and the vertices after the first and second step
+      const float dmax = rg ? (gb || rb ? r : b) : (bg ? b : g);
+      const float dmid = rg ? (gb ? g : (rb ? b : r)) : (bg ? g : (br ? b : r));
+      const float dmin = rg ? (gb ? b : g) : (bg ? r : (br ? r : b));
+      v1[p] = rg ? (gb || rb ? o100 : o001) : (bg ? o001 : o010);
+      v2[p] = rg ? (gb ? o100 + o010 : o100 + o001) : (bg ? o010 + o001 : (br ? o010 + o001 : o100 + o010));
+      w0[p] = 1 - dmax;
+      w1[p] = dmax - dmid;
+      w2[p] = dmid - dmin;
+      w3[p] = dmin;
     }
-    else
+
+    float *const output = out + 4 * k;
+    for(int c = 0; c < 3; c++)
     {
-      if(rgbd[2] > rgbd[1])
+      const float *const restrict lut = clut + c;
+      DT_OMP_SIMD()
+      for(size_t p = 0; p < npix; p++)
       {
-        output[0] = (1-rgbd[2])*clut[i000] + (rgbd[2]-rgbd[1])*clut[i001] + (rgbd[1]-rgbd[0])*clut[i011] + rgbd[0]*clut[i111];
-        output[1] = (1-rgbd[2])*clut[i000+1] + (rgbd[2]-rgbd[1])*clut[i001+1] + (rgbd[1]-rgbd[0])*clut[i011+1] + rgbd[0]*clut[i111+1];
-        output[2] = (1-rgbd[2])*clut[i000+2] + (rgbd[2]-rgbd[1])*clut[i001+2] + (rgbd[1]-rgbd[0])*clut[i011+2] + rgbd[0]*clut[i111+2];
-      }
-      else if(rgbd[2] > rgbd[0])
-      {
-        output[0] = (1-rgbd[1])*clut[i000] + (rgbd[1]-rgbd[2])*clut[i010] + (rgbd[2]-rgbd[0])*clut[i011] + rgbd[0]*clut[i111];
-        output[1] = (1-rgbd[1])*clut[i000+1] + (rgbd[1]-rgbd[2])*clut[i010+1] + (rgbd[2]-rgbd[0])*clut[i011+1] + rgbd[0]*clut[i111+1];
-        output[2] = (1-rgbd[1])*clut[i000+2] + (rgbd[1]-rgbd[2])*clut[i010+2] + (rgbd[2]-rgbd[0])*clut[i011+2] + rgbd[0]*clut[i111+2];
-      }
-      else
-      {
-        output[0] = (1-rgbd[1])*clut[i000] + (rgbd[1]-rgbd[0])*clut[i010] + (rgbd[0]-rgbd[2])*clut[i110] + rgbd[2]*clut[i111];
-        output[1] = (1-rgbd[1])*clut[i000+1] + (rgbd[1]-rgbd[0])*clut[i010+1] + (rgbd[0]-rgbd[2])*clut[i110+1] + rgbd[2]*clut[i111+1];
-        output[2] = (1-rgbd[1])*clut[i000+2] + (rgbd[1]-rgbd[0])*clut[i010+2] + (rgbd[0]-rgbd[2])*clut[i110+2] + rgbd[2]*clut[i111+2];
+        const int i = idx[p];
+        output[4*p + c] = w0[p] * lut[i] + w1[p] * lut[i + v1[p]]
+                        + w2[p] * lut[i + v2[p]] + w3[p] * lut[i + o111];
       }
     }
   }
@@ -457,6 +447,175 @@ void get_cache_filename(const char *const lutname, char *const cache_filename)
   g_free(cache_file);
 }
 
+// compiled LUT cache, a header followed by the lattice as stored in dt_iop_lut3d_data_t
+#define DT_IOP_LUT3D_CACHE_MAGIC "DTLUT3D1"
+
+// the least recently used compiled LUTs are removed once the cache directory holds
+// more than this. a 65^3 LUT takes 3.3MB, a 256^3 one 200MB.
+#define DT_IOP_LUT3D_CACHE_BYTES ((int64_t)256 << 20)
+
+typedef struct dt_iop_lut3d_cache_header_t
+{
+  char magic[8];
+  uint32_t level;
+  uint32_t reserved;
+  int64_t mtime; // of the LUT file the cache was compiled from
+  int64_t size;
+  char padding[32]; // pad the header to 64 bytes
+} dt_iop_lut3d_cache_header_t;
+
+typedef struct dt_iop_lut3d_cache_entry_t
+{
+  gchar *filename;
+  int64_t size;
+  int64_t mtime;
+} dt_iop_lut3d_cache_entry_t;
+
+static void _get_compiled_cache_filename(const char *const filepath, char *const cache_filename)
+{
+  char cachedir[PATH_MAX] = { 0 };
+  dt_loc_get_user_cache_dir(cachedir, sizeof(cachedir));
+  const dt_hash_t hash = dt_hash(DT_INITHASH, filepath, strlen(filepath));
+  gchar *name = g_strdup_printf("%016" PRIx64 ".clut", hash);
+  gchar *cache_file = g_build_filename(cachedir, "lut3d", name, NULL);
+  g_strlcpy(cache_filename, cache_file, PATH_MAX);
+  g_free(name);
+  g_free(cache_file);
+}
+
+// a plain read of the compiled LUT into the lattice buffer, nothing is parsed
+static uint16_t _read_compiled_clut(const char *const filepath, float **clut)
+{
+  GStatBuf st;
+  if(g_stat(filepath, &st)) return 0;
+
+  char cache_filename[PATH_MAX];
+  _get_compiled_cache_filename(filepath, cache_filename);
+  FILE *f = g_fopen(cache_filename, "rb");
+  if(!f) return 0;
+
+  uint16_t level = 0;
+  dt_iop_lut3d_cache_header_t header;
+  if(fread(&header, sizeof(header), 1, f) == 1
+     && !memcmp(header.magic, DT_IOP_LUT3D_CACHE_MAGIC, sizeof(header.magic))
+     && header.mtime == (int64_t)st.st_mtime
+     && header.size == (int64_t)st.st_size
+     && header.level >= 2 && header.level <= 256)
+  {
+    const size_t buf_size = (size_t)header.level * header.level * header.level * 3;
+    float *lclut = dt_alloc_align_float(buf_size);
+    // the file has to end with the lattice
+    if(lclut
+       && fread(lclut, sizeof(float), buf_size, f) == buf_size
+       && fgetc(f) == EOF)
+    {
+      *clut = lclut;
+      level = header.level;
+    }
+    else
+      dt_free_align(lclut);
+  }
+  fclose(f);
+
+  // mark it as recently used for the pruning of the cache
+  if(level) g_utime(cache_filename, NULL);
+  return level;
+}
+
+static gint _cache_entry_newer(gconstpointer a, gconstpointer b)
+{
+  const dt_iop_lut3d_cache_entry_t *ea = a;
+  const dt_iop_lut3d_cache_entry_t *eb = b;
+  return ea->mtime > eb->mtime ? -1 : ea->mtime < eb->mtime ? 1 : 0;
+}
+
+static void _cache_entry_free(gpointer data)
+{
+  dt_iop_lut3d_cache_entry_t *e = data;
+  g_free(e->filename);
+  g_free(e);
+}
+
+// remove the least recently used compiled LUTs of the cache directory beyond
+// DT_IOP_LUT3D_CACHE_BYTES, the one just written is always kept
+static void _prune_compiled_cluts(const char *const cache_dir, const char *const keep)
+{
+  GDir *dir = g_dir_open(cache_dir, 0, NULL);
+  if(!dir) return;
+
+  GList *entries = NULL;
+  const gchar *name;
+  while((name = g_dir_read_name(dir)))
+  {
+    if(!g_str_has_suffix(name, ".clut")) continue;
+    gchar *filename = g_build_filename(cache_dir, name, NULL);
+    GStatBuf st;
+    if(g_stat(filename, &st))
+    {
+      g_free(filename);
+      continue;
+    }
+    dt_iop_lut3d_cache_entry_t *e = g_malloc(sizeof(dt_iop_lut3d_cache_entry_t));
+    e->filename = filename;
+    e->size = st.st_size;
+    e->mtime = st.st_mtime;
+    entries = g_list_prepend(entries, e);
+  }
+  g_dir_close(dir);
+
+  entries = g_list_sort(entries, _cache_entry_newer);
+  int64_t total = 0;
+  for(GList *l = entries; l; l = g_list_next(l))
+  {
+    const dt_iop_lut3d_cache_entry_t *e = l->data;
+    total += e->size;
+    if(total > DT_IOP_LUT3D_CACHE_BYTES && strcmp(e->filename, keep))
+    {
+      dt_print(DT_DEBUG_CACHE, "[lut3d] removing compiled LUT cache %s", e->filename);
+      g_unlink(e->filename);
+    }
+  }
+  g_list_free_full(entries, _cache_entry_free);
+}
+
+static void _write_compiled_clut(const char *const filepath, const float *const clut, const uint16_t level)
+{
+  GStatBuf st;
+  if(g_stat(filepath, &st)) return;
+
+  char cache_filename[PATH_MAX];
+  _get_compiled_cache_filename(filepath, cache_filename);
+  gchar *cache_dir = g_path_get_dirname(cache_filename);
+  const size_t buf_size = (size_t)level * level * level * 3 * sizeof(float);
+  const size_t length = sizeof(dt_iop_lut3d_cache_header_t) + buf_size;
+  char *data = g_mkdir_with_parents(cache_dir, 0700) ? NULL : g_try_malloc0(length);
+  if(!data)
+  {
+    g_free(cache_dir);
+    return;
+  }
+
+  dt_iop_lut3d_cache_header_t *header = (dt_iop_lut3d_cache_header_t *)data;
+  memcpy(header->magic, DT_IOP_LUT3D_CACHE_MAGIC, sizeof(header->magic));
+  header->level = level;
+  header->mtime = st.st_mtime;
+  header->size = st.st_size;
+  memcpy(header + 1, clut, buf_size);
+
+  // written to a temporary file and renamed, other pipes may read it concurrently
+  GError *error = NULL;
+  if(!g_file_set_contents(cache_filename, data, length, &error))
+  {
+    dt_print(DT_DEBUG_ALWAYS, "[lut3d] can't write compiled LUT cache %s: %s",
+             cache_filename, error->message);
+    g_error_free(error);
+  }
+  else
+    _prune_compiled_cluts(cache_dir, cache_filename);
+  g_free(data);
+  g_free(cache_dir);
+}
+
 #ifdef HAVE_GMIC
 uint8_t calculate_clut_compressed(dt_iop_lut3d_params_t *const p, const char *const filepath, float **clut)
 {
@@ -1161,7 +1320,14 @@ static int calculate_clut(dt_iop_lut3d_params_t *const p, float **clut)
     if(filepath[0] && lutfolder[0])
     {
       char *fullpath = g_build_filename(lutfolder, filepath, NULL);
-      if(g_str_has_suffix (filepath, ".png") || g_str_has_suffix (filepath, ".PNG"))
+      const double start = dt_get_debug_wtime();
+      gboolean compiled = FALSE;
+      level = _read_compiled_clut(fullpath, clut);
+      if(level)
+      {
+        compiled = TRUE;
+      }
+      else if(g_str_has_suffix (filepath, ".png") || g_str_has_suffix (filepath, ".PNG"))
       {
         level = calculate_clut_haldclut(p, fullpath, clut);
       }
@@ -1173,6 +1339,11 @@ static int calculate_clut(dt_iop_lut3d_params_t *const p, float **clut)
       {
         level = calculate_clut_3dl(fullpath, clut);
       }
+      if(level && !compiled)
+        _write_compiled_clut(fullpath, *clut, level);
+      dt_print(DT_DEBUG_PERF, "[lut3d] %s level %d loaded %s in %.3fs",
+               fullpath, level, compiled ? "from compiled cache" : "from file",
+               dt_get_debug_wtime() - start);
       g_free(fullpath);
     }
     g_free(lutfolder);
@@ -179,6 +179,32 @@ gboolean distort_backtransform(dt_iop_module_t *self,
   return TRUE;
 }
 
+gboolean distort_warp(dt_iop_module_t *self,
+                      dt_dev_pixelpipe_iop_t *piece,
+                      const dt_iop_roi_t *const roi_in,
+                      const dt_iop_roi_t *const roi_out,
+                      float *const points,
+                      const size_t points_count)
+{
+  const float scale = roi_in->scale / piece->iscale;
+
+  DT_OMP_FOR_SIMD(if(points_count > 100))
+  for(size_t i = 0; i < points_count * 2; i += 2)
+  {
+    float pi[2], po[2];
+
+    pi[0] = roi_out->x + points[i];
+    pi[1] = roi_out->y + points[i + 1];
+
+    backtransform(piece, scale, pi, po);
+
+    points[i] = po[0] - roi_in->x;
+    points[i + 1] = po[1] - roi_in->y;
+  }
+
+  return TRUE;
+}
+
 void distort_mask(dt_iop_module_t *self,
                   dt_dev_pixelpipe_iop_t *piece,
                   const float *const in,
@@ -149,6 +149,27 @@ gboolean distort_backtransform(dt_iop_module_t *self,
   return TRUE;
 }
 
+gboolean distort_warp(dt_iop_module_t *self,
+                      dt_dev_pixelpipe_iop_t *piece,
+                      const dt_iop_roi_t *const roi_in,
+                      const dt_iop_roi_t *const roi_out,
+                      float *const points,
+                      const size_t points_count)
+{
+  // same scale as set by modify_roi_in() for process()
+  const float x_scale = (roi_in->width * 1.0f) / (roi_out->width * 1.0f);
+  const float y_scale = (roi_in->height * 1.0f) / (roi_out->height * 1.0f);
+
+  DT_OMP_FOR()
+  for(size_t i = 0; i < points_count * 2; i += 2)
+  {
+    points[i] *= x_scale;
+    points[i+1] *= y_scale;
+  }
+
+  return TRUE;
+}
+
 void distort_mask(
         dt_iop_module_t *self,
         dt_dev_pixelpipe_iop_t *piece,
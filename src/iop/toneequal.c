@@ -234,6 +234,8 @@ typedef struct dt_iop_toneequalizer_gui_data_t
   // 6 uint64 to pack - contiguous-ish memory
   dt_hash_t ui_preview_hash;
   dt_hash_t thumb_preview_hash;
+  uint32_t mask_cache_hits;   // luminance mask cache statistics over all pipes
+  uint32_t mask_cache_misses;
   size_t full_preview_buf_width, full_preview_buf_height;
   size_t thumb_preview_buf_width, thumb_preview_buf_height;
 
@@ -622,6 +624,22 @@ static void hash_set_get(const dt_hash_t *hash_in,
 }
 
 
+static dt_hash_t _luminance_mask_hash(const dt_iop_toneequalizer_data_t *const d,
+                                      const dt_hash_t upstream)
+{
+  // Only the parameters used to compute the luminance mask are hashed,
+  // changing the curve nodes keeps the cached mask
+  dt_hash_t hash = dt_hash(upstream, &d->method, sizeof(d->method));
+  hash = dt_hash(hash, &d->details, sizeof(d->details));
+  hash = dt_hash(hash, &d->exposure_boost, sizeof(d->exposure_boost));
+  hash = dt_hash(hash, &d->contrast_boost, sizeof(d->contrast_boost));
+  hash = dt_hash(hash, &d->radius, sizeof(d->radius));
+  hash = dt_hash(hash, &d->feathering, sizeof(d->feathering));
+  hash = dt_hash(hash, &d->iterations, sizeof(d->iterations));
+  hash = dt_hash(hash, &d->scale, sizeof(d->scale));
+  return dt_hash(hash, &d->quantization, sizeof(d->quantization));
+}
+
 static void invalidate_luminance_cache(dt_iop_module_t *const self)
 {
   // Invalidate the private luminance cache and histogram when
@@ -991,6 +1009,25 @@ static inline void display_luminance_mask(const float *const restrict in,
 }
 
 
+static void _report_mask_cache(dt_iop_module_t *self,
+                              const dt_dev_pixelpipe_iop_t *piece,
+                              const gboolean hit)
+{
+  dt_iop_toneequalizer_gui_data_t *const g = self->gui_data;
+
+  dt_iop_gui_enter_critical_section(self);
+  if(hit)
+    g->mask_cache_hits++;
+  else
+    g->mask_cache_misses++;
+  const uint32_t hits = g->mask_cache_hits;
+  const uint32_t misses = g->mask_cache_misses;
+  dt_iop_gui_leave_critical_section(self);
+
+  dt_print(DT_DEBUG_PERF, "[toneequal] %s luminance mask cache %s, %u hits, %u misses",
+           dt_dev_pixelpipe_type_to_str(piece->pipe->type), hit ? "hit" : "miss", hits, misses);
+}
+
 __DT_CLONE_TARGETS__
 static
 void toneeq_process(dt_iop_module_t *self,
@@ -1011,10 +1048,12 @@ void toneeq_process(dt_iop_module_t *self,
   const size_t height = roi_in->height;
   const size_t num_elem = width * height;
 
-  // Get the hash of the upstream pipe to track changes
+  // Get the hash of the upstream pipe and the mask parameters to track changes.
+  // The upstream hash must not include this module so curve edits don't invalidate the mask.
   const int position = self->iop_order;
-  const dt_hash_t hash = dt_dev_pixelpipe_cache_hash(piece->pipe->image.id,
-                                                    roi_out, piece->pipe, position);
+  const dt_hash_t hash =
+    _luminance_mask_hash(d, dt_dev_pixelpipe_cache_hash(piece->pipe->image.id,
+                                                        roi_out, piece->pipe, position - 1));
 
   // Sanity checks
   if(width < 1 || height < 1) return;
@@ -1117,7 +1156,10 @@ void toneeq_process(dt_iop_module_t *self,
         /* compute only if upstream pipe state has changed */
         compute_luminance_mask(in, luminance, width, height, d);
         hash_set_get(&hash, &g->ui_preview_hash, &self->gui_lock);
+        _report_mask_cache(self, piece, FALSE);
       }
+      else
+        _report_mask_cache(self, piece, TRUE);
     }
     else if(piece->pipe->type & DT_DEV_PIXELPIPE_PREVIEW)
     {
@@ -1138,7 +1180,10 @@ void toneeq_process(dt_iop_module_t *self,
         g->luminance_valid = TRUE;
         dt_iop_gui_leave_critical_section(self);
         dt_dev_pixelpipe_cache_invalidate_later(piece->pipe, self->iop_order);
+        _report_mask_cache(self, piece, FALSE);
       }
+      else
+        _report_mask_cache(self, piece, TRUE);
     }
     else // make it dummy-proof
     {
@@ -1343,6 +1388,8 @@ static void gui_cache_init(dt_iop_module_t *self)
   dt_iop_gui_enter_critical_section(self);
   g->ui_preview_hash = 0;
   g->thumb_preview_hash = 0;
+  g->mask_cache_hits = 0;
+  g->mask_cache_misses = 0;
   g->max_histogram = 1;
   g->scale = 1.0f;
   g->sigma = sqrtf(2.0f);
@@ -1345,6 +1345,15 @@ static void _expand_select_tree_path(GtkTreePath *path1,
 
 static const char *UNCATEGORIZED_TAG = N_("uncategorized");
 
+// when no other rule restricts the collection the image counts per
+// film roll, tag, day, camera and lens are read from the
+// memory.collect_*_count tables maintained by the database instead of
+// being recomputed over all images.
+static gboolean _where_is_unrestricted(const gchar *where_ext)
+{
+  return !g_strcmp0(where_ext, "1=1");
+}
+
 static void _tree_view(dt_lib_collect_rule_t *dr)
 {
   // update related list
@@ -1398,20 +1407,33 @@ static void _tree_view(dt_lib_collect_rule_t *dr)
     /* query construction */
     gchar *where_ext = dt_collection_get_extended_where(darktable.collection, dr->num);
     gchar *query = NULL;
+    const gboolean counted = _where_is_unrestricted(where_ext);
     switch(property)
     {
       case DT_COLLECTION_PROP_FOLDERS:
-        // clang-format off
-        query = g_strdup_printf
-          ("SELECT folder, film_rolls_id, COUNT(*) AS count, status"
-           " FROM main.images AS mi"
-           " JOIN (SELECT fr.id AS film_rolls_id, folder, status"
-           "       FROM main.film_rolls AS fr"
-           "       JOIN memory.film_folder AS ff"
-           "       ON fr.id = ff.id)"
-           "   ON film_id = film_rolls_id "
-           " WHERE %s"
-           " GROUP BY folder, film_rolls_id", where_ext);
+        if(counted)
+          // clang-format off
+          query = g_strdup
+            ("SELECT folder, film_rolls_id, fc.count AS count, status"
+             " FROM memory.collect_film_count AS fc"
+             " JOIN (SELECT fr.id AS film_rolls_id, folder, status"
+             "       FROM main.film_rolls AS fr"
+             "       JOIN memory.film_folder AS ff"
+             "       ON fr.id = ff.id)"
+             "   ON fc.film_id = film_rolls_id");
+          // clang-format on
+        else
+          // clang-format off
+          query = g_strdup_printf
+            ("SELECT folder, film_rolls_id, COUNT(*) AS count, status"
+             " FROM main.images AS mi"
+             " JOIN (SELECT fr.id AS film_rolls_id, folder, status"
+             "       FROM main.film_rolls AS fr"
+             "       JOIN memory.film_folder AS ff"
+             "       ON fr.id = ff.id)"
+             "   ON film_id = film_rolls_id "
+             " WHERE %s"
+             " GROUP BY folder, film_rolls_id", where_ext);
           // clang-format on
         break;
 
@@ -1420,7 +1442,19 @@ static void _tree_view(dt_lib_collect_rule_t *dr)
         const gboolean is_insensitive =
           dt_conf_is_equal("plugins/lighttable/tagging/case_sensitivity", "insensitive");
 
-        if(is_insensitive)
+        if(counted)
+          // clang-format off
+          query = g_strdup_printf
+            ("SELECT name, %s AS tagid, SUM(count) AS count"
+             " FROM memory.collect_tag_count"
+             " JOIN (SELECT %s AS name, id AS tag_id FROM data.tags)"
+             "   ON tagid = tag_id"
+             "   GROUP BY %s",
+             is_insensitive ? "1" : "tagid",
+             is_insensitive ? "lower(name)" : "name",
+             is_insensitive ? "name" : "tagid");
+          // clang-format on
+        else if(is_insensitive)
           // clang-format off
           query = g_strdup_printf
             ("SELECT name, 1 AS tagid, SUM(count) AS count"
@@ -1489,15 +1523,18 @@ static void _tree_view(dt_lib_collect_rule_t *dr)
         break;
 
       case DT_COLLECTION_PROP_DAY:
-        // clang-format off
-        query = g_strdup_printf
-          ("SELECT (datetime_taken / 86400000000) * 86400000000 AS date, 1,"
-           "        COUNT(*) AS count"
-           " FROM main.images AS mi"
-           " WHERE datetime_taken IS NOT NULL AND datetime_taken <> 0"
-           " AND %s"
-           " GROUP BY date", where_ext);
-        // clang-format on
+        if(counted)
+          query = g_strdup("SELECT day AS date, 1, count FROM memory.collect_day_count");
+        else
+          // clang-format off
+          query = g_strdup_printf
+            ("SELECT (datetime_taken / 86400000000) * 86400000000 AS date, 1,"
+             "        COUNT(*) AS count"
+             " FROM main.images AS mi"
+             " WHERE datetime_taken IS NOT NULL AND datetime_taken <> 0"
+             " AND %s"
+             " GROUP BY date", where_ext);
+          // clang-format on
         break;
 
       case DT_COLLECTION_PROP_TIME:
@@ -1863,22 +1900,35 @@ static void _list_view(dt_lib_collect_rule_t *dr)
     gchar *where_ext = dt_collection_get_extended_where(darktable.collection, dr->num);
 
     char query[1024] = { 0 };
+    const gboolean counted = _where_is_unrestricted(where_ext);
 
     switch(property)
     {
       case DT_COLLECTION_PROP_CAMERA:; // camera
-        // clang-format off
-        g_snprintf(query, sizeof(query),
-                   "SELECT TRIM(cm.maker || ' ' || cm.model) AS camera,"
-                   "       1, COUNT(*) AS count"
-                   "  FROM main.images AS mi, main.cameras AS cm"
-                   "  WHERE mi.camera_id = cm.id"
-                   "    AND %s "
-                   "  GROUP BY LOWER(camera)"
-                   "  ORDER BY LOWER(camera) %s",
-                   where_ext,
-                   sort_descending ? "DESC" : "ASC");
-        // clang-format on
+        if(counted)
+          // clang-format off
+          g_snprintf(query, sizeof(query),
+                     "SELECT TRIM(cm.maker || ' ' || cm.model) AS camera,"
+                     "       1, SUM(cc.count) AS count"
+                     "  FROM memory.collect_camera_count AS cc, main.cameras AS cm"
+                     "  WHERE cc.camera_id = cm.id"
+                     "  GROUP BY LOWER(camera)"
+                     "  ORDER BY LOWER(camera) %s",
+                     sort_descending ? "DESC" : "ASC");
+          // clang-format on
+        else
+          // clang-format off
+          g_snprintf(query, sizeof(query),
+                     "SELECT TRIM(cm.maker || ' ' || cm.model) AS camera,"
+                     "       1, COUNT(*) AS count"
+                     "  FROM main.images AS mi, main.cameras AS cm"
+                     "  WHERE mi.camera_id = cm.id"
+                     "    AND %s "
+                     "  GROUP BY LOWER(camera)"
+                     "  ORDER BY LOWER(camera) %s",
+                     where_ext,
+                     sort_descending ? "DESC" : "ASC");
+          // clang-format on
         break;
 
       case DT_COLLECTION_PROP_HISTORY: // History
@@ -1969,19 +2019,33 @@ static void _list_view(dt_lib_collect_rule_t *dr)
         break;
 
       case DT_COLLECTION_PROP_LENS: // lens
-        // clang-format off
-        g_snprintf(query, sizeof(query),
-                   "SELECT CASE LOWER(TRIM(ln.name))"
-                   "         WHEN 'n/a' THEN ''"
-                   "         ELSE ln.name"
-                   "       END AS lens, 1, COUNT(*) AS count"
-                   "  FROM main.images AS mi, main.lens AS ln"
-                   "  WHERE mi.lens_id = ln.id"
-                   "    AND %s"
-                   "  GROUP BY LOWER(lens)"
-                   "  ORDER BY LOWER(lens) %s", where_ext,
-                   sort_descending ? "DESC" : "ASC");
-        // clang-format on
+        if(counted)
+          // clang-format off
+          g_snprintf(query, sizeof(query),
+                     "SELECT CASE LOWER(TRIM(ln.name))"
+                     "         WHEN 'n/a' THEN ''"
+                     "         ELSE ln.name"
+                     "       END AS lens, 1, SUM(lc.count) AS count"
+                     "  FROM memory.collect_lens_count AS lc, main.lens AS ln"
+                     "  WHERE lc.lens_id = ln.id"
+                     "  GROUP BY LOWER(lens)"
+                     "  ORDER BY LOWER(lens) %s",
+                     sort_descending ? "DESC" : "ASC");
+          // clang-format on
+        else
+          // clang-format off
+          g_snprintf(query, sizeof(query),
+                     "SELECT CASE LOWER(TRIM(ln.name))"
+                     "         WHEN 'n/a' THEN ''"
+                     "         ELSE ln.name"
+                     "       END AS lens, 1, COUNT(*) AS count"
+                     "  FROM main.images AS mi, main.lens AS ln"
+                     "  WHERE mi.lens_id = ln.id"
+                     "    AND %s"
+                     "  GROUP BY LOWER(lens)"
+                     "  ORDER BY LOWER(lens) %s", where_ext,
+                     sort_descending ? "DESC" : "ASC");
+          // clang-format on
         break;
 
       case DT_COLLECTION_PROP_WHITEBALANCE: // white balance
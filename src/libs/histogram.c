@@ -19,7 +19,6 @@
 #include <stdint.h>
 
 #include "bauhaus/bauhaus.h"
-#include "common/atomic.h"
 #include "common/color_harmony.h"
 #include "common/darktable.h"
 #include "common/debug.h"
@@ -56,6 +55,11 @@
 // visible consequence.
 #define VECTORSCOPE_HUES 48
 #define VECTORSCOPE_BASE_LOG 30
+// the waveform and vectorscope look at no more input pixels than
+// this, the size of the default preview pipe. Larger previews, as
+// with hidpi screens, are decimated, which makes no visible
+// difference for the scopes but keeps their per-update cost flat.
+#define SCOPE_MAX_PIXELS (1440 * 900)
 
 DT_MODULE(1)
 
@@ -169,6 +173,8 @@ typedef struct dt_lib_histogram_t
   int waveform_bins, waveform_tones, waveform_max_bins;
   // FIXME: make dt_lib_histogram_vectorscope_t for all this data?
   uint8_t *vectorscope_graph, *vectorscope_bkgd;
+  uint32_t *vectorscope_bins;         // per-thread counts, kept between updates
+  size_t vectorscope_bin_pad, vectorscope_bin_threads;
   float vectorscope_pt[2];            // point colorpicker position
   GSList *vectorscope_samples;        // live samples position
   int selected_sample;                // position of the selected live sample in the list
@@ -291,24 +297,34 @@ static void _lib_histogram_process_waveform(dt_lib_histogram_t *const d,
   d->waveform_bins = num_bins;
   const size_t num_tones = d->waveform_tones;
 
+  // Only decimate across the bins, that is skip rows for a horizontal
+  // waveform and columns for a vertical one, so that all bins still
+  // see the same number of samples.
+  const size_t step = MAX(1, (size_t)ceilf((float)sample_width * sample_height / SCOPE_MAX_PIXELS));
+  const size_t row_step = orient == DT_LIB_HISTOGRAM_ORIENT_HORI ? step : 1;
+  const size_t col_step = orient == DT_LIB_HISTOGRAM_ORIENT_HORI ? 1 : step;
+  const size_t rows = (sample_height + row_step - 1) / row_step;
+
   // Note that, with current constants, the input buffer is from the
-  // preview pixelpipe and should be <= 1440x900x4. The output buffer
-  // will be <= 360x160x3. Hence process works with a relatively small
-  // quantity of data.
+  // preview pixelpipe and is decimated to <= 1440x900x4. The output
+  // buffer will be <= 360x160x3. Hence process works with a
+  // relatively small quantity of data.
   size_t bin_pad;
   uint32_t *const restrict partial_binned =
     dt_calloc_perthread(3U * num_bins * num_tones, sizeof(uint32_t), &bin_pad);
 
   DT_OMP_FOR()
-  for(size_t y=0; y<sample_height; y++)
+  for(size_t row=0; row<rows; row++)
   {
+    const size_t y = row * row_step;
     const float *const restrict px = DT_IS_ALIGNED((const float *const restrict)input +
                                                    4U * ((y + roi->crop_y) * roi->width));
     uint32_t *const restrict binned = dt_get_perthread(partial_binned, bin_pad);
-    for(size_t x=0; x<sample_width; x++)
+    for(size_t x=0; x<sample_width; x+=col_step)
     {
       const size_t bin = (orient == DT_LIB_HISTOGRAM_ORIENT_HORI ? x : y) / samples_per_bin;
-      size_t tone[4] DT_ALIGNED_PIXEL;
+      // 32-bit tones so that the conversions vectorize
+      int tone[4] DT_ALIGNED_PIXEL;
       for_each_channel(ch, aligned(px,tone:16))
       {
         // 1.0 is at 8/9 of the height!
@@ -343,8 +359,9 @@ static void _lib_histogram_process_waveform(dt_lib_histogram_t *const d,
 
   const float brightness = num_tones / 40.0f;
   const float scale = brightness / ((orient == DT_LIB_HISTOGRAM_ORIENT_HORI
-                                     ? sample_height
-                                     : sample_width) * samples_per_bin);
+                                     ? rows
+                                     : (sample_width + col_step - 1) / col_step)
+                                    * samples_per_bin);
   size_t nthreads = dt_get_num_threads();
 
   DT_OMP_FOR(collapse(3))
@@ -762,8 +779,20 @@ static void _lib_histogram_process_vectorscope
   // locus -- or the reverse, adapt the spectral locus to the
   // histogram profile PCS (always D50)?
   //
-  // FIXME: pre-allocate? -- use the same buffer as for waveform?
-  dt_atomic_int *const restrict binned = (dt_atomic_int*)dt_calloc_align_int(diam_px * diam_px);
+  // each thread counts into its own bins, merged when making the
+  // graph, rather than contending on atomic adds. these are allocated
+  // once, only cleared for each update.
+  const size_t nthreads = dt_get_num_threads();
+  if(!d->vectorscope_bins || d->vectorscope_bin_threads != nthreads)
+  {
+    dt_free_align(d->vectorscope_bins);
+    d->vectorscope_bins = dt_alloc_perthread((size_t)diam_px * diam_px, sizeof(uint32_t),
+                                             &d->vectorscope_bin_pad);
+    d->vectorscope_bin_threads = nthreads;
+  }
+  const size_t bin_pad = d->vectorscope_bin_pad;
+  uint32_t *const restrict partial_binned = d->vectorscope_bins;
+  memset(partial_binned, 0, sizeof(uint32_t) * bin_pad * nthreads);
   // FIXME: move verbosed interleaved comments into a method note at
   // the start, as the code itself is succinct and clear
   //
@@ -776,8 +805,13 @@ static void _lib_histogram_process_vectorscope
   // FIXME: make 2x2 averaging be conditional on preprocessor define
   //
   // FIXME: average neighboring pixels on x but not y -- may be enough of an optimization
-  const int sample_max_x = sample_width - (sample_width % 2);
-  const int sample_max_y = sample_height - (sample_height % 2);
+  //
+  // 2x2 blocks are averaged, and taken every step pixels such that
+  // no more than SCOPE_MAX_PIXELS are read
+  const int step =
+    MAX(2, (int)ceilf(2.f * sqrtf((float)sample_width * sample_height / SCOPE_MAX_PIXELS)));
+  const size_t blocks_x = sample_width < 2 ? 0 : (sample_width - 2) / step + 1;
+  const size_t blocks_y = sample_height < 2 ? 0 : (sample_height - 2) / step + 1;
   // FIXME: if decimate/downsample, should blur before this
   //
   // FIXME: instead of scaling, if chromaticity really depends only on
@@ -788,9 +822,11 @@ static void _lib_histogram_process_vectorscope
   // would also find point sample pixel this way
 
   DT_OMP_FOR(collapse(2))
-  for(size_t y=0; y<sample_max_y; y+=2)
-    for(size_t x=0; x<sample_max_x; x+=2)
+  for(size_t by=0; by<blocks_y; by++)
+    for(size_t bx=0; bx<blocks_x; bx++)
     {
+      const size_t x = bx * step;
+      const size_t y = by * step;
       // FIXME: There are unnecessary color math hops. Right now the
       // data comes into dt_lib_histogram_process() in a known profile
       // (usually from pixelpipe). Then (usually) it gets converted to
@@ -832,7 +868,10 @@ static void _lib_histogram_process_vectorscope
 
       // clip any out-of-scale values, so there aren't light edges
       if(out_x >= 0 && out_x <= diam_px-1 && out_y >= 0 && out_y <= diam_px-1)
-        dt_atomic_add_int(binned + out_y * diam_px + out_x, 1);
+      {
+        uint32_t *const restrict binned = dt_get_perthread(partial_binned, bin_pad);
+        binned[out_y * diam_px + out_x]++;
+      }
     }
 
   dt_aligned_pixel_t RGB = {0.f}, chromaticity;
@@ -901,19 +940,23 @@ static void _lib_histogram_process_vectorscope
 
   // FIXME: should count the max bin size, and vary the scale such that it is always 1?
   const float gain = 1.f / 30.f;
-  const float scale = gain * (diam_px * diam_px) / (sample_width * sample_height);
+  // a 2x2 block is one count, every step x step pixels
+  const float scale = gain * (diam_px * diam_px) * (step * step / 4.f)
+    / (sample_width * sample_height);
 
-  // loop appears to be too small to benefit w/OpenMP
-  // FIXME: is this still true?
+  DT_OMP_FOR(collapse(2))
   for(size_t out_y = 0; out_y < diam_px; out_y++)
     for(size_t out_x = 0; out_x < diam_px; out_x++)
     {
-      const int count = binned[out_y * diam_px + out_x];
+      uint32_t count = 0;
+      for(size_t n = 0; n < nthreads; n++)
+      {
+        const uint32_t *const restrict binned = dt_get_bythread(partial_binned, bin_pad, n);
+        count += binned[out_y * diam_px + out_x];
+      }
       const float intensity = lut[(int)(MIN(1.f, scale * count) * lutmax)];
       graph[out_y * out_stride + out_x] = intensity * 255.0f;
     }
-
-  dt_free_align(binned);
 }
 
 static void dt_lib_histogram_process
@@ -2757,6 +2800,7 @@ void gui_cleanup(dt_lib_module_t *self)
     dt_free_align(d->waveform_img[ch]);
   dt_free_align(d->vectorscope_graph);
   dt_free_align(d->vectorscope_bkgd);
+  dt_free_align(d->vectorscope_bins);
   if(d->vectorscope_samples)
     g_slist_free_full((GSList *)d->vectorscope_samples, free);
   d->vectorscope_samples = NULL;
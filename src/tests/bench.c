@@ -0,0 +1,100 @@
+/*
+    This file is part of darktable,
+    Copyright (C) 2025 darktable developers.
+
+    darktable is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    darktable is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with darktable.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+void dt_bench_image_args(int argc, char *argv[], int *width, int *height, int *runs)
+{
+  // all options take a value
+  for(int k = 1; k < argc; k += 2)
+  {
+    // CLAMP() evaluates its argument more than once, read the value first
+    const int value = k + 1 < argc ? atoi(argv[k + 1]) : 0;
+    if(k + 1 < argc && !strcmp(argv[k], "--width"))
+      *width = CLAMP(value, 16, 100000);
+    else if(k + 1 < argc && !strcmp(argv[k], "--height"))
+      *height = CLAMP(value, 16, 100000);
+    else if(k + 1 < argc && !strcmp(argv[k], "--runs"))
+      *runs = CLAMP(value, 1, 1000);
+    else
+    {
+      fprintf(stderr, "usage: %s [--width W] [--height H] [--runs N]\n", argv[0]);
+      exit(1);
+    }
+  }
+}
+
+gboolean dt_bench_init(const char *name, const char *library, const char *configdir)
+{
+  char *argv_override[10];
+  int argc_override = 0;
+  argv_override[argc_override++] = (char *)name;
+  argv_override[argc_override++] = "--library";
+  argv_override[argc_override++] = library ? (char *)library : ":memory:";
+  argv_override[argc_override++] = "--conf";
+  argv_override[argc_override++] = "write_sidecar_files=never";
+  if(configdir)
+  {
+    argv_override[argc_override++] = "--configdir";
+    argv_override[argc_override++] = (char *)configdir;
+    argv_override[argc_override++] = "--cachedir";
+    argv_override[argc_override++] = (char *)configdir;
+  }
+  argv_override[argc_override] = NULL;
+
+  // init dt without gui and without data.db:
+  return dt_init(argc_override, argv_override, FALSE, FALSE, NULL) != 0;
+}
+
+void dt_bench_times_add(dt_bench_times_t *times, const double secs)
+{
+  if(times->runs++ == 0)
+  {
+    times->first = secs;
+    times->best = secs;
+  }
+  times->best = MIN(times->best, secs);
+  times->total += secs;
+}
+
+double dt_bench_times_mean(const dt_bench_times_t *times)
+{
+  return times->runs ? times->total / times->runs : 0.0;
+}
+
+dt_bench_times_t dt_bench_run(dt_bench_func_t *prepare, dt_bench_func_t *func, void *data, const int runs)
+{
+  dt_bench_times_t times = { 0 };
+  for(int k = 0; k < runs; k++)
+  {
+    if(prepare) prepare(data);
+    const double start = dt_get_wtime();
+    func(data);
+    dt_bench_times_add(&times, dt_get_wtime() - start);
+  }
+  return times;
+}
+
+// clang-format off
+// modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
+// vim: shiftwidth=2 expandtab tabstop=2 cindent
+// kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
+// clang-format on
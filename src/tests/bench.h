@@ -0,0 +1,58 @@
+/*
+    This file is part of darktable,
+    Copyright (C) 2025 darktable developers.
+
+    darktable is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    darktable is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with darktable.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "common/darktable.h"
+
+/* the setup and the timing shared by the darktable-bench-* tools */
+
+typedef struct dt_bench_times_t
+{
+  int runs;
+  double first; // the first run, with cold caches
+  double best;
+  double total;
+} dt_bench_times_t;
+
+typedef void(dt_bench_func_t)(void *data);
+
+/** parses the --width, --height and --runs options of the image benchmarks,
+    prints the usage and exits on anything else. */
+void dt_bench_image_args(int argc, char *argv[], int *width, int *height, int *runs);
+
+/** inits darktable without gui on the library (":memory:" if NULL) and keeps
+    the config and the caches in configdir if given. sidecar files are never
+    written. returns TRUE on error. */
+gboolean dt_bench_init(const char *name, const char *library, const char *configdir);
+
+/** adds a run of secs seconds to times, which starts zeroed. */
+void dt_bench_times_add(dt_bench_times_t *times, const double secs);
+
+/** mean of the runs in times. */
+double dt_bench_times_mean(const dt_bench_times_t *times);
+
+/** times runs calls of func(data). prepare, if not NULL, is called before each
+    of them and isn't timed. */
+dt_bench_times_t dt_bench_run(dt_bench_func_t *prepare, dt_bench_func_t *func, void *data, const int runs);
+
+// clang-format off
+// modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
+// vim: shiftwidth=2 expandtab tabstop=2 cindent
+// kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
+// clang-format on
@@ -0,0 +1,235 @@
+/*
+    This file is part of darktable,
+    Copyright (C) 2025 darktable developers.
+
+    darktable is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    darktable is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with darktable.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+  benchmark of the cpu blending.
+
+  darktable-bench-blend [--width W] [--height H] [--runs N]
+
+  runs every blend mode, normal and reversed, through the blend operators of
+  the raw, Lab, RGB (display) and RGB (scene) blending color spaces on a
+  synthetic image of W x H pixels and prints the best time of each. modes a
+  color space doesn't offer fall back to normal blending there, as in the
+  pipe. the parametric Lab mask is then timed with all six channels enabled
+  and an increasing number of them actually narrowed, the others selecting
+  their whole span.
+*/
+
+#include "bench.h"
+#include "develop/blend.h"
+#include "develop/pixelpipe_hb.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef void(_blend_func)(dt_dev_pixelpipe_iop_t *piece,
+                          const float *const restrict a,
+                          float *const restrict b,
+                          const dt_iop_roi_t *const roi_in,
+                          const dt_iop_roi_t *const roi_out,
+                          const float *const restrict mask,
+                          const dt_dev_pixelpipe_display_mask_t request_mask_display);
+
+typedef struct _blend_t
+{
+  _blend_func *blend;
+  dt_dev_pixelpipe_iop_t *piece;
+  const float *a;
+  const float *b;
+  float *out;
+  float *mask;
+  const dt_iop_roi_t *roi;
+} _blend_t;
+
+static void _blend_prepare(void *data)
+{
+  // the blend is done in place, start from the same module output every time
+  const _blend_t *t = data;
+  memcpy(t->out, t->b, sizeof(float) * t->piece->colors * t->roi->width * t->roi->height);
+}
+
+static void _blend(void *data)
+{
+  const _blend_t *t = data;
+  t->blend(t->piece, t->a, t->out, t->roi, t->roi, t->mask, DT_DEV_PIXELPIPE_DISPLAY_NONE);
+}
+
+static void _lab_mask_prepare(void *data)
+{
+  const _blend_t *t = data;
+  dt_iop_image_fill(t->mask, 1.0f, t->roi->width, t->roi->height, 1);
+}
+
+static void _lab_mask(void *data)
+{
+  const _blend_t *t = data;
+  dt_develop_blendif_lab_make_mask(t->piece, t->a, t->b, t->roi, t->roi, t->mask);
+}
+
+static void _bench_blend(const char *cst_name,
+                         _blend_func *blend,
+                         dt_dev_pixelpipe_iop_t *piece,
+                         const float *const a,
+                         const float *const b,
+                         float *const out,
+                         float *const mask,
+                         const dt_iop_roi_t *const roi,
+                         const int runs)
+{
+  dt_develop_blend_params_t *const d = piece->blendop_data;
+  const size_t npixels = (size_t)roi->width * roi->height;
+  _blend_t t = { blend, piece, a, b, out, mask, roi };
+
+  double total = 0.0;
+  for(const dt_introspection_type_enum_tuple_t *mode = dt_develop_blend_mode_names; mode->name; mode++)
+  {
+    for(int reverse = 0; reverse < 2; reverse++)
+    {
+      d->blend_mode = mode->value | (reverse ? DEVELOP_BLEND_REVERSE : 0);
+
+      const double best = dt_bench_run(_blend_prepare, _blend, &t, runs).best;
+      total += best;
+
+      printf("%-12s %-32s %-8s %8.2f ms  %8.1f MP/s\n", cst_name, mode->name, reverse ? "reverse" : "",
+             1e3 * best, 1e-6 * npixels / best);
+    }
+  }
+  printf("%-12s all modes %8.2f ms\n\n", cst_name, 1e3 * total);
+}
+
+static void _bench_lab_mask(dt_dev_pixelpipe_iop_t *piece,
+                            const float *const a,
+                            const float *const b,
+                            float *const mask,
+                            const dt_iop_roi_t *const roi,
+                            const int runs)
+{
+  dt_develop_blend_params_t *const d = piece->blendop_data;
+  const size_t npixels = (size_t)roi->width * roi->height;
+  _blend_t t = { NULL, piece, a, b, NULL, mask, roi };
+  static const int channels[] = { DEVELOP_BLENDIF_L_in, DEVELOP_BLENDIF_A_in, DEVELOP_BLENDIF_B_in,
+                                  DEVELOP_BLENDIF_L_out, DEVELOP_BLENDIF_A_out, DEVELOP_BLENDIF_B_out };
+
+  d->mask_mode = DEVELOP_MASK_ENABLED | DEVELOP_MASK_CONDITIONAL;
+  d->blend_mode = DEVELOP_BLEND_NORMAL2;
+  d->blendif = 0;
+  for(size_t c = 0; c < G_N_ELEMENTS(channels); c++) d->blendif |= 1 << channels[c];
+
+  for(size_t narrowed = 0; narrowed <= G_N_ELEMENTS(channels); narrowed++)
+  {
+    for(size_t c = 0; c < G_N_ELEMENTS(channels); c++)
+    {
+      float *const p = d->blendif_parameters + 4 * channels[c];
+      const gboolean narrow = c < narrowed;
+      p[0] = narrow ? 0.1f : 0.0f;
+      p[1] = narrow ? 0.2f : 0.0f;
+      p[2] = narrow ? 0.8f : 1.0f;
+      p[3] = narrow ? 0.9f : 1.0f;
+    }
+
+    const double best = dt_bench_run(_lab_mask_prepare, _lab_mask, &t, runs).best;
+
+    printf("Lab mask     %d of %d channels narrowed        %8.2f ms  %8.1f MP/s\n", (int)narrowed,
+           (int)G_N_ELEMENTS(channels), 1e3 * best, 1e-6 * npixels / best);
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  int width = 6000;
+  int height = 4000;
+  int runs = 5;
+
+  dt_bench_image_args(argc, argv, &width, &height, &runs);
+
+  if(dt_bench_init("darktable-bench-blend", NULL, NULL)) exit(1);
+
+  const size_t npixels = (size_t)width * height;
+  float *a = dt_alloc_align_float(4 * npixels);
+  float *b = dt_alloc_align_float(4 * npixels);
+  float *out = dt_alloc_align_float(4 * npixels);
+  float *mask = dt_alloc_align_float(npixels);
+  if(!a || !b || !out || !mask)
+  {
+    fprintf(stderr, "can't allocate the image buffers\n");
+    exit(1);
+  }
+
+  // module input and output: smooth gradients with some noise on top, the mask a soft ramp
+  GRand *rand = g_rand_new_with_seed(42);
+  for(int j = 0; j < height; j++)
+    for(int i = 0; i < width; i++)
+    {
+      const size_t k = (size_t)j * width + i;
+      for(int c = 0; c < 4; c++)
+      {
+        a[4 * k + c] = (float)i / width + 0.1f * g_rand_double(rand);
+        b[4 * k + c] = (float)j / height + 0.1f * g_rand_double(rand);
+      }
+      mask[k] = 0.5f + 0.5f * sinf(0.01f * i) * cosf(0.013f * j);
+    }
+  g_rand_free(rand);
+
+  printf("%d threads, %dx%d image, %d runs\n\n", (int)dt_get_num_threads(), width, height, runs);
+
+  const dt_iop_roi_t roi = { 0, 0, width, height, 1.0f };
+  dt_dev_pixelpipe_t pipe = { 0 };
+  dt_develop_blend_params_t params;
+  dt_dev_pixelpipe_iop_t piece = { 0 };
+  piece.pipe = &pipe;
+  piece.blendop_data = &params;
+
+  const struct
+  {
+    const char *name;
+    dt_develop_blend_colorspace_t cst;
+    int colors;
+    _blend_func *blend;
+  } csts[] = {
+    { "raw", DEVELOP_BLEND_CS_RAW, 1, dt_develop_blendif_raw_blend },
+    { "Lab", DEVELOP_BLEND_CS_LAB, 4, dt_develop_blendif_lab_blend },
+    { "RGB display", DEVELOP_BLEND_CS_RGB_DISPLAY, 4, dt_develop_blendif_rgb_hsl_blend },
+    { "RGB scene", DEVELOP_BLEND_CS_RGB_SCENE, 4, dt_develop_blendif_rgb_jzczhz_blend },
+  };
+
+  for(size_t c = 0; c < G_N_ELEMENTS(csts); c++)
+  {
+    dt_develop_blend_init_blend_parameters(&params, csts[c].cst);
+    piece.colors = csts[c].colors;
+    _bench_blend(csts[c].name, csts[c].blend, &piece, a, b, out, mask, &roi, runs);
+  }
+
+  dt_develop_blend_init_blend_parameters(&params, DEVELOP_BLEND_CS_LAB);
+  piece.colors = 4;
+  _bench_lab_mask(&piece, a, b, mask, &roi, runs);
+
+  dt_free_align(a);
+  dt_free_align(b);
+  dt_free_align(out);
+  dt_free_align(mask);
+
+  dt_cleanup();
+
+  return 0;
+}
+
+// clang-format off
+// modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
+// vim: shiftwidth=2 expandtab tabstop=2 cindent
+// kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
+// clang-format on
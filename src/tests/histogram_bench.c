@@ -0,0 +1,160 @@
+/*
+    This file is part of darktable,
+    Copyright (C) 2025 darktable developers.
+
+    darktable is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    darktable is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with darktable.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+  benchmark of the histogram collection.
+
+  darktable-bench-histogram [--width W] [--height H] [--runs N]
+
+  collects the histograms of a synthetic image of W x H pixels the way the
+  modules do: 16 bit raw into 65536 bins (exposure deflicker), RGB into 256
+  and 16384 bins (rgbcurve, levels), middle grey compensated RGB (rgbcurve),
+  Lab (tonecurve) and LCh (colorzones), and prints the best time of each.
+  the default size is the one of the preview pipe, which the global
+  histogram also works on; its waveform and vectorscope are part of the
+  histogram lib and are timed by the "[histogram]" lines of -d perf.
+*/
+
+#include "bench.h"
+#include "common/histogram.h"
+#include "common/iop_profile.h"
+#include "develop/develop.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct _histogram_t
+{
+  dt_dev_histogram_collection_params_t *params;
+  dt_dev_histogram_stats_t *stats;
+  dt_iop_colorspace_type_t cst;
+  dt_iop_colorspace_type_t cst_to;
+  const void *pixel;
+  uint32_t **histogram;
+  uint32_t *histogram_max;
+  const dt_iop_order_iccprofile_info_t *profile;
+} _histogram_t;
+
+static void _histogram(void *data)
+{
+  const _histogram_t *h = data;
+  dt_histogram_helper(h->params, h->stats, h->cst, h->cst_to, h->pixel, h->histogram,
+                      h->histogram_max, h->profile != NULL, h->profile);
+}
+
+static void _bench(const char *name,
+                   const void *const pixel,
+                   const int width,
+                   const int height,
+                   const uint32_t bins_count,
+                   const dt_iop_colorspace_type_t cst,
+                   const dt_iop_colorspace_type_t cst_to,
+                   const dt_iop_order_iccprofile_info_t *const profile,
+                   const int runs)
+{
+  const dt_histogram_roi_t roi = { .width = width, .height = height };
+  dt_dev_histogram_collection_params_t params = { .roi = &roi, .bins_count = bins_count };
+  dt_dev_histogram_stats_t stats = { 0 };
+  uint32_t *histogram = NULL;
+  uint32_t histogram_max[4] = { 0 };
+
+  _histogram_t h = { &params, &stats, cst, cst_to, pixel, &histogram,
+                     cst == IOP_CS_RAW ? NULL : histogram_max, profile };
+  const double best = dt_bench_run(NULL, _histogram, &h, runs).best;
+
+  // all pixels have to be in the histogram
+  uint64_t total = 0;
+  for(size_t k = 0; histogram && k < bins_count; k++)
+    total += histogram[cst == IOP_CS_RAW ? k : 4 * k];
+
+  printf("%-16s %6u bins  %8.2f ms  %8.1f MP/s%s\n", name, bins_count, 1e3 * best,
+         1e-6 * width * height / best, total == (uint64_t)width * height ? "" : "  WRONG COUNT");
+
+  dt_free_align(histogram);
+}
+
+int main(int argc, char *argv[])
+{
+  int width = 1440;
+  int height = 900;
+  int runs = 20;
+
+  dt_bench_image_args(argc, argv, &width, &height, &runs);
+
+  if(dt_bench_init("darktable-bench-histogram", NULL, NULL)) exit(1);
+
+  const size_t npixels = (size_t)width * height;
+  uint16_t *raw = dt_alloc_aligned(sizeof(uint16_t) * npixels);
+  float *rgb = dt_alloc_align_float(4 * npixels);
+  float *lab = dt_alloc_align_float(4 * npixels);
+  if(!raw || !rgb || !lab)
+  {
+    fprintf(stderr, "can't allocate the image buffers\n");
+    exit(1);
+  }
+
+  // smooth gradients with some noise on top, a few values out of range
+  GRand *rand = g_rand_new_with_seed(42);
+  for(int j = 0; j < height; j++)
+    for(int i = 0; i < width; i++)
+    {
+      const size_t k = (size_t)j * width + i;
+      const float x = (float)i / width;
+      const float y = (float)j / height;
+      raw[k] = 16000.0f * x * y + g_rand_int_range(rand, 0, 512);
+      rgb[4 * k + 0] = 1.1f * x - 0.05f + 0.05f * g_rand_double(rand);
+      rgb[4 * k + 1] = y + 0.05f * g_rand_double(rand);
+      rgb[4 * k + 2] = 0.5f * x * y + 0.05f * g_rand_double(rand);
+      rgb[4 * k + 3] = 0.0f;
+      lab[4 * k + 0] = 100.0f * x + g_rand_double(rand);
+      lab[4 * k + 1] = 120.0f * (y - 0.5f) + g_rand_double(rand);
+      lab[4 * k + 2] = 120.0f * (0.5f - x) * y + g_rand_double(rand);
+      lab[4 * k + 3] = 0.0f;
+    }
+  g_rand_free(rand);
+
+  dt_develop_t dev;
+  dt_dev_init(&dev, FALSE);
+  const dt_iop_order_iccprofile_info_t *const work_profile =
+    dt_ioppr_add_profile_info_to_list(&dev, DT_COLORSPACE_LIN_REC2020, "", DT_INTENT_PERCEPTUAL);
+
+  printf("%d threads, %dx%d image, %d runs\n\n", (int)dt_get_num_threads(), width, height, runs);
+
+  _bench("raw", raw, width, height, 65536, IOP_CS_RAW, IOP_CS_NONE, NULL, runs);
+  _bench("RGB", rgb, width, height, 256, IOP_CS_RGB, IOP_CS_NONE, NULL, runs);
+  _bench("RGB", rgb, width, height, 16384, IOP_CS_RGB, IOP_CS_NONE, NULL, runs);
+  _bench("RGB compensated", rgb, width, height, 256, IOP_CS_RGB, IOP_CS_NONE, work_profile, runs);
+  _bench("Lab", lab, width, height, 256, IOP_CS_LAB, IOP_CS_NONE, NULL, runs);
+  _bench("LCh", lab, width, height, 256, IOP_CS_LAB, IOP_CS_LCH, NULL, runs);
+
+  dt_dev_cleanup(&dev);
+
+  dt_free_align(raw);
+  dt_free_align(rgb);
+  dt_free_align(lab);
+
+  dt_cleanup();
+
+  return 0;
+}
+
+// clang-format off
+// modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
+// vim: shiftwidth=2 expandtab tabstop=2 cindent
+// kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
+// clang-format on
@@ -0,0 +1,640 @@
+/*
+    This file is part of darktable,
+    Copyright (C) 2025 darktable developers.
+
+    darktable is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    darktable is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with darktable.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+  benchmark of the library database queries.
+
+  darktable-bench-library [--images N] [--seed S] [--library FILE] [--report FILE]
+
+  fills the library with N synthetic images (film rolls, cameras, lenses, tags,
+  metadata, color labels, history and groups) using the real schema, then times
+  the collection query builders and the tag counting functions. the timings and
+  the query plans of the generated collection queries are written as json to the
+  report file, or stdout.
+
+  a library file which already contains images is used as is, so a copy of a
+  real library can be measured as well. the ratings changed to time the
+  collection updates are restored afterwards. the collection settings are kept in a
+  temporary config directory, the user's darktablerc is not touched.
+*/
+
+#include "bench.h"
+#include "common/collection.h"
+#include "common/darktable.h"
+#include "common/database.h"
+#include "common/debug.h"
+#include "common/metadata.h"
+#include "common/tags.h"
+#include "control/conf.h"
+
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_IMAGES_PER_ROLL 400
+#define BENCH_CAMERAS 12
+#define BENCH_LENSES 40
+#define BENCH_TAGS_L1 20
+#define BENCH_TAGS_L2 50
+#define BENCH_RUNS 3
+
+static const char *_operations[] =
+  { "rawprepare", "temperature", "highlights", "demosaic", "exposure", "colorin",
+    "channelmixerrgb", "sigmoid", "colorbalancergb", "crop", "denoiseprofile",
+    "lens", "colorout", "gamma" };
+
+typedef struct bench_t
+{
+  GString *json;
+  int count;
+} bench_t;
+
+static void _json_string(GString *s, const char *str)
+{
+  g_string_append_c(s, '"');
+  for(const char *c = str; c && *c; c++)
+  {
+    if(*c == '"' || *c == '\\')
+      g_string_append_printf(s, "\\%c", *c);
+    else if((unsigned char)*c < 0x20)
+      g_string_append_printf(s, "\\u%04x", *c);
+    else
+      g_string_append_c(s, *c);
+  }
+  g_string_append_c(s, '"');
+}
+
+static int _count(const char *table)
+{
+  sqlite3_stmt *stmt;
+  gchar *query = g_strdup_printf("SELECT COUNT(*) FROM %s", table);
+  int count = 0;
+  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db), query, -1, &stmt, NULL);
+  if(sqlite3_step(stmt) == SQLITE_ROW)
+    count = sqlite3_column_int(stmt, 0);
+  sqlite3_finalize(stmt);
+  g_free(query);
+  return count;
+}
+
+static void _prepare(const char *sql, sqlite3_stmt **stmt)
+{
+  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get(darktable.db), sql, -1, stmt, NULL);
+}
+
+static void _step(sqlite3_stmt *stmt)
+{
+  sqlite3_step(stmt);
+  sqlite3_reset(stmt);
+  sqlite3_clear_bindings(stmt);
+}
+
+static void _generate(const int images, const guint32 seed)
+{
+  sqlite3 *db = dt_database_get(darktable.db);
+  GRand *rand = g_rand_new_with_seed(seed);
+  sqlite3_stmt *stmt;
+
+  dt_database_start_transaction(darktable.db);
+
+  // cameras and lenses
+  _prepare("INSERT INTO main.makers (id, name) VALUES (?1, ?2)", &stmt);
+  for(int k = 1; k <= 4; k++)
+  {
+    gchar *name = g_strdup_printf("maker %d", k);
+    DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, k);
+    DT_DEBUG_SQLITE3_BIND_TEXT(stmt, 2, name, -1, SQLITE_TRANSIENT);
+    _step(stmt);
+    g_free(name);
+  }
+  sqlite3_finalize(stmt);
+
+  _prepare("INSERT INTO main.models (id, name) VALUES (?1, ?2)", &stmt);
+  for(int k = 1; k <= BENCH_CAMERAS; k++)
+  {
+    gchar *name = g_strdup_printf("model %d", k);
+    DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, k);
+    DT_DEBUG_SQLITE3_BIND_TEXT(stmt, 2, name, -1, SQLITE_TRANSIENT);
+    _step(stmt);
+    g_free(name);
+  }
+  sqlite3_finalize(stmt);
+
+  _prepare("INSERT INTO main.cameras (id, maker, model, alias) VALUES (?1, ?2, ?3, ?3)", &stmt);
+  for(int k = 1; k <= BENCH_CAMERAS; k++)
+  {
+    gchar *maker = g_strdup_printf("maker %d", 1 + k % 4);
+    gchar *model = g_strdup_printf("model %d", k);
+    DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, k);
+    DT_DEBUG_SQLITE3_BIND_TEXT(stmt, 2, maker, -1, SQLITE_TRANSIENT);
+    DT_DEBUG_SQLITE3_BIND_TEXT(stmt, 3, model, -1, SQLITE_TRANSIENT);
+    _step(stmt);
+    g_free(maker);
+    g_free(model);
+  }
+  sqlite3_finalize(stmt);
+
+  _prepare("INSERT INTO main.lens (id, name) VALUES (?1, ?2)", &stmt);
+  for(int k = 1; k <= BENCH_LENSES; k++)
+  {
+    gchar *name = g_strdup_printf("lens %d-%dmm", 10 + k, 20 + 5 * k);
+    DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, k);
+    DT_DEBUG_SQLITE3_BIND_TEXT(stmt, 2, name, -1, SQLITE_TRANSIENT);
+    _step(stmt);
+    g_free(name);
+  }
+  sqlite3_finalize(stmt);
+
+  // film rolls
+  const int rolls = (images + BENCH_IMAGES_PER_ROLL - 1) / BENCH_IMAGES_PER_ROLL;
+  _prepare("INSERT INTO main.film_rolls (id, access_timestamp, folder) VALUES (?1, ?2, ?3)", &stmt);
+  for(int k = 1; k <= rolls; k++)
+  {
+    gchar *folder = g_strdup_printf("/bench/%04d/roll_%05d", 2000 + k % 25, k);
+    DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, k);
+    DT_DEBUG_SQLITE3_BIND_INT64(stmt, 2, k);
+    DT_DEBUG_SQLITE3_BIND_TEXT(stmt, 3, folder, -1, SQLITE_TRANSIENT);
+    _step(stmt);
+    g_free(folder);
+  }
+  sqlite3_finalize(stmt);
+
+  // tags, a two level hierarchy
+  const int ntags = BENCH_TAGS_L1 * BENCH_TAGS_L2;
+  _prepare("INSERT INTO data.tags (id, name, synonyms, flags) VALUES (?1, ?2, '', 0)", &stmt);
+  for(int k = 0; k < ntags; k++)
+  {
+    gchar *name = g_strdup_printf("bench|topic %d|keyword %d", k / BENCH_TAGS_L2, k % BENCH_TAGS_L2);
+    DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, 1000 + k);
+    DT_DEBUG_SQLITE3_BIND_TEXT(stmt, 2, name, -1, SQLITE_TRANSIENT);
+    _step(stmt);
+    g_free(name);
+  }
+  sqlite3_finalize(stmt);
+
+  // images with their tags, metadata, labels and history
+  sqlite3_stmt *img_stmt, *tag_stmt, *meta_stmt, *label_stmt, *hist_stmt;
+  // clang-format off
+  _prepare("INSERT INTO main.images"
+           " (id, group_id, film_id, width, height, filename, maker_id, model_id, lens_id,"
+           "  camera_id, exposure, aperture, iso, focal_length, datetime_taken, flags,"
+           "  version, max_version, history_end, position, aspect_ratio, import_timestamp,"
+           "  change_timestamp, latitude, longitude)"
+           " VALUES (?1, ?2, ?3, 6000, 4000, ?4, ?5, ?6, ?7, ?6, ?8, ?9, ?10, ?11, ?12, ?13,"
+           "         0, 0, ?14, ?15, 1.5, ?12, ?16, ?17, ?18)",
+           &img_stmt);
+  // clang-format on
+  _prepare("INSERT INTO main.tagged_images (imgid, tagid, position) VALUES (?1, ?2, ?3)", &tag_stmt);
+  _prepare("INSERT INTO main.meta_data (id, key, value) VALUES (?1, ?2, ?3)", &meta_stmt);
+  _prepare("INSERT INTO main.color_labels (imgid, color) VALUES (?1, ?2)", &label_stmt);
+  _prepare("INSERT INTO main.history (imgid, num, module, operation, op_params, enabled,"
+           " blendop_params, blendop_version, multi_priority, multi_name, multi_name_hand_edited)"
+           " VALUES (?1, ?2, 1, ?3, ?4, 1, NULL, 14, 0, '', 0)",
+           &hist_stmt);
+
+  const GTimeSpan start_time = (GTimeSpan)63000000000 * G_TIME_SPAN_SECOND;
+  uint8_t params[64] = { 0 };
+  int group_id = 1;
+
+  for(int id = 1; id <= images; id++)
+  {
+    const int film = 1 + (id - 1) / BENCH_IMAGES_PER_ROLL;
+    // a fifth of the images come as raw+jpeg, grouped to the raw
+    const gboolean jpeg = g_rand_int_range(rand, 0, 5) == 0 && id > 1;
+    if(!jpeg) group_id = id;
+    const int camera = 1 + g_rand_int_range(rand, 0, BENCH_CAMERAS);
+    const int rating = g_rand_int_range(rand, 0, 6);
+    const int history = g_rand_int_range(rand, 0, 3) ? g_rand_int_range(rand, 3, 15) : 0;
+
+    gchar *filename = g_strdup_printf("IMG_%07d.%s", jpeg ? id - 1 : id, jpeg ? "JPG" : "CR2");
+    DT_DEBUG_SQLITE3_BIND_INT(img_stmt, 1, id);
+    DT_DEBUG_SQLITE3_BIND_INT(img_stmt, 2, group_id);
+    DT_DEBUG_SQLITE3_BIND_INT(img_stmt, 3, film);
+    DT_DEBUG_SQLITE3_BIND_TEXT(img_stmt, 4, filename, -1, SQLITE_TRANSIENT);
+    DT_DEBUG_SQLITE3_BIND_INT(img_stmt, 5, 1 + camera % 4);
+    DT_DEBUG_SQLITE3_BIND_INT(img_stmt, 6, camera);
+    DT_DEBUG_SQLITE3_BIND_INT(img_stmt, 7, 1 + g_rand_int_range(rand, 0, BENCH_LENSES));
+    sqlite3_bind_double(img_stmt, 8, 1.0 / (1 << g_rand_int_range(rand, 0, 12)));
+    sqlite3_bind_double(img_stmt, 9, 1.4 * (1 + g_rand_int_range(rand, 0, 8)));
+    sqlite3_bind_double(img_stmt, 10, 100 << g_rand_int_range(rand, 0, 7));
+    sqlite3_bind_double(img_stmt, 11, 14 + g_rand_int_range(rand, 0, 300));
+    DT_DEBUG_SQLITE3_BIND_INT64(img_stmt, 12, start_time + (GTimeSpan)id * 600 * G_TIME_SPAN_SECOND);
+    DT_DEBUG_SQLITE3_BIND_INT(img_stmt, 13, (rating == 5 ? DT_IMAGE_REJECTED : rating)
+                                            | DT_IMAGE_NO_LEGACY_PRESETS
+                                            | (jpeg ? DT_IMAGE_LDR : DT_IMAGE_RAW));
+    DT_DEBUG_SQLITE3_BIND_INT(img_stmt, 14, history);
+    DT_DEBUG_SQLITE3_BIND_INT64(img_stmt, 15, (int64_t)id << 32);
+    DT_DEBUG_SQLITE3_BIND_INT64(img_stmt, 16, history ? start_time + (GTimeSpan)id * G_TIME_SPAN_DAY : -1);
+    if(g_rand_int_range(rand, 0, 4) == 0)
+    {
+      sqlite3_bind_double(img_stmt, 17, g_rand_double_range(rand, -60.0, 60.0));
+      sqlite3_bind_double(img_stmt, 18, g_rand_double_range(rand, -180.0, 180.0));
+    }
+    _step(img_stmt);
+    g_free(filename);
+
+    const int nb_tags = g_rand_int_range(rand, 0, 9);
+    const int topic = g_rand_int_range(rand, 0, BENCH_TAGS_L1);
+    for(int t = 0; t < nb_tags; t++)
+    {
+      // tags are mostly from a few topics per image
+      const int l1 = t < 5 ? topic : g_rand_int_range(rand, 0, BENCH_TAGS_L1);
+      DT_DEBUG_SQLITE3_BIND_INT(tag_stmt, 1, id);
+      DT_DEBUG_SQLITE3_BIND_INT(tag_stmt, 2, 1000 + l1 * BENCH_TAGS_L2 + g_rand_int_range(rand, 0, BENCH_TAGS_L2));
+      DT_DEBUG_SQLITE3_BIND_INT64(tag_stmt, 3, (int64_t)id << 32);
+      sqlite3_step(tag_stmt); // duplicates are rejected by the unique index
+      sqlite3_reset(tag_stmt);
+    }
+
+    if(g_rand_int_range(rand, 0, 3) == 0)
+    {
+      gchar *title = g_strdup_printf("title %d", g_rand_int_range(rand, 0, 1000));
+      DT_DEBUG_SQLITE3_BIND_INT(meta_stmt, 1, id);
+      DT_DEBUG_SQLITE3_BIND_INT(meta_stmt, 2, DT_METADATA_XMP_DC_TITLE);
+      DT_DEBUG_SQLITE3_BIND_TEXT(meta_stmt, 3, title, -1, SQLITE_TRANSIENT);
+      _step(meta_stmt);
+      g_free(title);
+    }
+    if(g_rand_int_range(rand, 0, 5) == 0)
+    {
+      DT_DEBUG_SQLITE3_BIND_INT(meta_stmt, 1, id);
+      DT_DEBUG_SQLITE3_BIND_INT(meta_stmt, 2, DT_METADATA_XMP_DC_CREATOR);
+      DT_DEBUG_SQLITE3_BIND_TEXT(meta_stmt, 3, "bench creator", -1, SQLITE_STATIC);
+      _step(meta_stmt);
+    }
+
+    if(g_rand_int_range(rand, 0, 5) == 0)
+    {
+      DT_DEBUG_SQLITE3_BIND_INT(label_stmt, 1, id);
+      DT_DEBUG_SQLITE3_BIND_INT(label_stmt, 2, g_rand_int_range(rand, 0, 5));
+      _step(label_stmt);
+    }
+
+    for(int h = 0; h < history; h++)
+    {
+      const int op = h < 4 ? h : g_rand_int_range(rand, 4, G_N_ELEMENTS(_operations));
+      DT_DEBUG_SQLITE3_BIND_INT(hist_stmt, 1, id);
+      DT_DEBUG_SQLITE3_BIND_INT(hist_stmt, 2, h);
+      DT_DEBUG_SQLITE3_BIND_TEXT(hist_stmt, 3, _operations[op], -1, SQLITE_STATIC);
+      DT_DEBUG_SQLITE3_BIND_BLOB(hist_stmt, 4, params, sizeof(params), SQLITE_STATIC);
+      _step(hist_stmt);
+    }
+  }
+
+  sqlite3_finalize(img_stmt);
+  sqlite3_finalize(tag_stmt);
+  sqlite3_finalize(meta_stmt);
+  sqlite3_finalize(label_stmt);
+  sqlite3_finalize(hist_stmt);
+
+  dt_database_release_transaction(darktable.db);
+
+  // as done by the database maintenance
+  sqlite3_exec(db, "ANALYZE", NULL, NULL, NULL);
+
+  g_rand_free(rand);
+}
+
+static void _plan(GString *s, const char *query, const gboolean limit)
+{
+  sqlite3_stmt *stmt;
+  gchar *explain = g_strdup_printf("EXPLAIN QUERY PLAN %s", query);
+  g_string_append(s, ", \"plan\": [");
+  if(sqlite3_prepare_v2(dt_database_get(darktable.db), explain, -1, &stmt, NULL) == SQLITE_OK)
+  {
+    if(limit)
+    {
+      sqlite3_bind_int(stmt, 1, 0);
+      sqlite3_bind_int(stmt, 2, -1);
+    }
+    int rows = 0;
+    while(sqlite3_step(stmt) == SQLITE_ROW)
+    {
+      gchar *line = g_strdup_printf("%d|%d|%s", sqlite3_column_int(stmt, 0),
+                                    sqlite3_column_int(stmt, 1),
+                                    (const char *)sqlite3_column_text(stmt, 3));
+      if(rows++) g_string_append(s, ", ");
+      _json_string(s, line);
+      g_free(line);
+    }
+    sqlite3_finalize(stmt);
+  }
+  g_string_append(s, "]");
+  g_free(explain);
+}
+
+static void _report(bench_t *b,
+                    const char *name,
+                    const dt_bench_times_t *times,
+                    const int64_t rows,
+                    const char *query)
+{
+  fprintf(stderr, "  %-40s %10.4f secs (best of %d) %10" PRId64 " rows\n", name, times->best, times->runs,
+          rows);
+
+  if(b->count++) g_string_append(b->json, ",\n");
+  g_string_append(b->json, "    {\"name\": ");
+  _json_string(b->json, name);
+  g_string_append_printf(b->json, ", \"best\": %.6f, \"mean\": %.6f, \"rows\": %" PRId64,
+                         times->best, dt_bench_times_mean(times), rows);
+  if(query)
+  {
+    g_string_append(b->json, ", \"query\": ");
+    _json_string(b->json, query);
+    _plan(b->json, query, TRUE);
+  }
+  g_string_append(b->json, "}");
+}
+
+typedef struct bench_rule_t
+{
+  const char *name;
+  int property;
+  const char *text;
+  int filter;          // additional rating filter
+} bench_rule_t;
+
+static void _remove_dir(const char *path)
+{
+  GDir *dir = g_dir_open(path, 0, NULL);
+  if(dir)
+  {
+    const gchar *name;
+    while((name = g_dir_read_name(dir)))
+    {
+      gchar *file = g_build_filename(path, name, NULL);
+      if(g_file_test(file, G_FILE_TEST_IS_DIR))
+        _remove_dir(file);
+      else
+        g_unlink(file);
+      g_free(file);
+    }
+    g_dir_close(dir);
+  }
+  g_rmdir(path);
+}
+
+static void _set_rule(const bench_rule_t *rule)
+{
+  dt_conf_set_int("plugins/lighttable/collect/num_rules", 1);
+  dt_conf_set_int("plugins/lighttable/collect/item0", rule->property);
+  dt_conf_set_string("plugins/lighttable/collect/string0", rule->text);
+  dt_conf_set_int("plugins/lighttable/collect/mode0", 0);
+
+  dt_conf_set_int("plugins/lighttable/filtering/num_rules", rule->filter ? 1 : 0);
+  dt_conf_set_int("plugins/lighttable/filtering/item0", DT_COLLECTION_PROP_RATING_RANGE);
+  dt_conf_set_string("plugins/lighttable/filtering/string0", ">=2");
+  dt_conf_set_int("plugins/lighttable/filtering/mode0", 0);
+  dt_conf_set_int("plugins/lighttable/filtering/off0", 0);
+}
+
+static void _bench_collection(bench_t *b, const bench_rule_t *rule)
+{
+  _set_rule(rule);
+
+  dt_bench_times_t t_query = { 0 }, t_update = { 0 }, t_memory = { 0 }, t_count = { 0 };
+  uint32_t count = 0;
+  for(int k = 0; k < BENCH_RUNS; k++)
+  {
+    double start = dt_get_wtime();
+    dt_collection_update_query(darktable.collection, DT_COLLECTION_CHANGE_NEW_QUERY,
+                               DT_COLLECTION_PROP_UNDEF, NULL);
+    dt_bench_times_add(&t_query, dt_get_wtime() - start);
+
+    start = dt_get_wtime();
+    dt_collection_update(darktable.collection);
+    dt_bench_times_add(&t_update, dt_get_wtime() - start);
+
+    start = dt_get_wtime();
+    dt_collection_memory_update();
+    dt_bench_times_add(&t_memory, dt_get_wtime() - start);
+
+    start = dt_get_wtime();
+    ((dt_collection_t *)darktable.collection)->count = UINT32_MAX;
+    count = dt_collection_get_count(darktable.collection);
+    dt_bench_times_add(&t_count, dt_get_wtime() - start);
+  }
+
+  fprintf(stderr, "collection: %s\n", rule->name);
+  gchar *name = g_strdup_printf("%s: dt_collection_update_query", rule->name);
+  _report(b, name, &t_query, count, NULL);
+  g_free(name);
+  name = g_strdup_printf("%s: dt_collection_update", rule->name);
+  _report(b, name, &t_update, count, NULL);
+  g_free(name);
+  name = g_strdup_printf("%s: memory.collected_images", rule->name);
+  _report(b, name, &t_memory, count, dt_collection_get_query(darktable.collection));
+  g_free(name);
+  name = g_strdup_printf("%s: dt_collection_get_count", rule->name);
+  _report(b, name, &t_count, count, dt_collection_get_query_no_group(darktable.collection));
+  g_free(name);
+
+  // a rating change of a few collected images, their flags are restored afterwards
+  GList *imgs = dt_collection_get_all(darktable.collection, 20);
+  gchar *ids = dt_util_glist_to_str(",", imgs);
+  gchar *query = g_strdup_printf("CREATE TEMPORARY TABLE bench_flags AS"
+                                 " SELECT id, flags FROM main.images WHERE id IN (%s)",
+                                 ids ? ids : "-1");
+  DT_DEBUG_SQLITE3_EXEC(dt_database_get(darktable.db), query, NULL, NULL, NULL);
+  g_free(query);
+  dt_bench_times_t t_delta = { 0 };
+  for(int k = 0; k < BENCH_RUNS; k++)
+  {
+    query = g_strdup_printf("UPDATE main.images SET flags = (flags & ~7) | %d WHERE id IN (%s)",
+                            k % 2 ? 1 : 3, ids ? ids : "-1");
+    DT_DEBUG_SQLITE3_EXEC(dt_database_get(darktable.db), query, NULL, NULL, NULL);
+    g_free(query);
+
+    const double start = dt_get_wtime();
+    dt_collection_update_query(darktable.collection, DT_COLLECTION_CHANGE_RELOAD,
+                               DT_COLLECTION_PROP_RATING_RANGE, g_list_copy(imgs));
+    dt_bench_times_add(&t_delta, dt_get_wtime() - start);
+  }
+  g_free(ids);
+  DT_DEBUG_SQLITE3_EXEC(dt_database_get(darktable.db),
+                        "UPDATE main.images"
+                        " SET flags = (SELECT flags FROM bench_flags WHERE bench_flags.id = main.images.id)"
+                        " WHERE id IN (SELECT id FROM bench_flags)",
+                        NULL, NULL, NULL);
+  DT_DEBUG_SQLITE3_EXEC(dt_database_get(darktable.db), "DROP TABLE bench_flags", NULL, NULL, NULL);
+  name = g_strdup_printf("%s: rating change of %d images", rule->name, g_list_length(imgs));
+  _report(b, name, &t_delta, dt_collection_get_count(darktable.collection), NULL);
+  g_free(name);
+  g_list_free(imgs);
+}
+
+static void _bench_tags(bench_t *b)
+{
+  fprintf(stderr, "tags\n");
+  dt_bench_times_t t = { 0 };
+  int64_t rows = 0;
+
+  for(int k = 0; k < BENCH_RUNS; k++)
+  {
+    GList *tags = NULL;
+    const double start = dt_get_wtime();
+    rows = dt_tag_get_with_usage(&tags);
+    dt_bench_times_add(&t, dt_get_wtime() - start);
+    dt_tag_free_result(&tags);
+  }
+  _report(b, "dt_tag_get_with_usage", &t, rows, NULL);
+  t = (dt_bench_times_t){ 0 };
+
+  for(int k = 0; k < BENCH_RUNS; k++)
+  {
+    int tag_count = 0, img_count = 0;
+    const double start = dt_get_wtime();
+    dt_tag_count_tags_images("bench|topic 1", &tag_count, &img_count);
+    dt_bench_times_add(&t, dt_get_wtime() - start);
+    rows = img_count;
+  }
+  _report(b, "dt_tag_count_tags_images", &t, rows, NULL);
+  t = (dt_bench_times_t){ 0 };
+
+  const int images = _count("main.images");
+  for(int k = 0; k < BENCH_RUNS; k++)
+  {
+    rows = 0;
+    const double start = dt_get_wtime();
+    for(int id = 1; id <= images; id += MAX(1, images / 1000))
+    {
+      GList *tags = NULL;
+      rows += dt_tag_get_attached(id, &tags, TRUE);
+      dt_tag_free_result(&tags);
+    }
+    dt_bench_times_add(&t, dt_get_wtime() - start);
+  }
+  _report(b, "dt_tag_get_attached (1000 images)", &t, rows, NULL);
+  t = (dt_bench_times_t){ 0 };
+
+  for(int k = 0; k < BENCH_RUNS; k++)
+  {
+    GList *imgs = NULL;
+    const double start = dt_get_wtime();
+    imgs = dt_tag_get_images(1000 + k);
+    dt_bench_times_add(&t, dt_get_wtime() - start);
+    rows = g_list_length(imgs);
+    g_list_free(imgs);
+  }
+  _report(b, "dt_tag_get_images", &t, rows, NULL);
+}
+
+int main(int argc, char *argv[])
+{
+  int images = 10000;
+  guint32 seed = 42;
+  const char *library = ":memory:";
+  const char *report = NULL;
+
+  for(int k = 1; k < argc; k++)
+  {
+    if(!strcmp(argv[k], "--images") && k + 1 < argc)
+    {
+      // CLAMP() evaluates its argument more than once
+      const int value = atoi(argv[++k]);
+      images = CLAMP(value, 1, 10000000);
+    }
+    else if(!strcmp(argv[k], "--seed") && k + 1 < argc)
+      seed = atoi(argv[++k]);
+    else if(!strcmp(argv[k], "--library") && k + 1 < argc)
+      library = argv[++k];
+    else if(!strcmp(argv[k], "--report") && k + 1 < argc)
+      report = argv[++k];
+    else
+    {
+      fprintf(stderr, "usage: %s [--images N] [--seed S] [--library FILE] [--report FILE]\n", argv[0]);
+      exit(1);
+    }
+  }
+
+  // the collection rules are set through the config, keep them away from the user's one
+  gchar *configdir = g_dir_make_tmp("darktable-bench-library-XXXXXX", NULL);
+  if(!configdir)
+  {
+    fprintf(stderr, "can't create a temporary config directory\n");
+    exit(1);
+  }
+
+  if(dt_bench_init("darktable-bench-library", library, configdir))
+  {
+    _remove_dir(configdir);
+    exit(1);
+  }
+
+  double gen_time = 0.0;
+  if(_count("main.images") == 0)
+  {
+    fprintf(stderr, "generating %d images\n", images);
+    const double start = dt_get_wtime();
+    _generate(images, seed);
+    gen_time = dt_get_wtime() - start;
+  }
+  images = _count("main.images");
+
+  bench_t b = { g_string_new(NULL), 0 };
+  g_string_append_printf(b.json,
+                         "{\n  \"sqlite\": \"%s\",\n  \"images\": %d,\n  \"film_rolls\": %d,\n"
+                         "  \"tagged_images\": %d,\n  \"history\": %d,\n  \"generate\": %.3f,\n"
+                         "  \"queries\": [\n",
+                         sqlite3_libversion(), images, _count("main.film_rolls"),
+                         _count("main.tagged_images"), _count("main.history"), gen_time);
+
+  const bench_rule_t rules[] = {
+    { "all images", DT_COLLECTION_PROP_FOLDERS, "%", FALSE },
+    { "film roll", DT_COLLECTION_PROP_FILMROLL, "/bench/2001/roll_00001", FALSE },
+    { "folder tree rated", DT_COLLECTION_PROP_FOLDERS, "/bench/2001*", TRUE },
+    { "tag", DT_COLLECTION_PROP_TAG, "bench|topic 3|%", FALSE },
+    { "tag rated", DT_COLLECTION_PROP_TAG, "bench|topic 3|%", TRUE },
+    { "camera", DT_COLLECTION_PROP_CAMERA, "maker 2 model 5", FALSE },
+    { "lens rated", DT_COLLECTION_PROP_LENS, "lens 12%", TRUE },
+  };
+
+  for(size_t k = 0; k < G_N_ELEMENTS(rules); k++)
+    _bench_collection(&b, &rules[k]);
+
+  _bench_tags(&b);
+
+  g_string_append(b.json, "\n  ]\n}\n");
+
+  if(report)
+  {
+    GError *error = NULL;
+    if(!g_file_set_contents(report, b.json->str, b.json->len, &error))
+    {
+      fprintf(stderr, "can't write report `%s': %s\n", report, error->message);
+      g_error_free(error);
+    }
+  }
+  else
+    fputs(b.json->str, stdout);
+
+  g_string_free(b.json, TRUE);
+
+  dt_cleanup();
+
+  _remove_dir(configdir);
+  g_free(configdir);
+
+  return 0;
+}
+
+// clang-format off
+// modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
+// vim: shiftwidth=2 expandtab tabstop=2 cindent
+// kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
+// clang-format on
@@ -0,0 +1,131 @@
+/*
+    This file is part of darktable,
+    Copyright (C) 2025 darktable developers.
+
+    darktable is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    darktable is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with darktable.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+  benchmark of the cpu image resampling.
+
+  darktable-bench-resample [--width W] [--height H] [--runs N]
+
+  resamples a synthetic 4 channel image of W x H pixels with bicubic and
+  lanczos3 to a few typical scales (demosaic downscale, finalscale, thumbnail
+  export and an upscale) and prints the best time and the throughput in input
+  and output megapixels per second. the first run of each case builds the
+  resampling plans, the others find them in the cache.
+*/
+
+#include "bench.h"
+#include "common/interpolation.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct _resample_t
+{
+  const struct dt_interpolation *itor;
+  float *out;
+  const dt_iop_roi_t *roi_out;
+  const float *in;
+  const dt_iop_roi_t *roi_in;
+} _resample_t;
+
+static void _resample(void *data)
+{
+  const _resample_t *r = data;
+  dt_interpolation_resample(r->itor, r->out, r->roi_out, r->in, r->roi_in);
+}
+
+static void _bench(const struct dt_interpolation *itor,
+                   const float *const in,
+                   const int width,
+                   const int height,
+                   const float scale,
+                   const int runs)
+{
+  const dt_iop_roi_t roi_in = { 0, 0, width, height, 1.0f };
+  const dt_iop_roi_t roi_out = { 0, 0, (int)(width * scale), (int)(height * scale), scale };
+
+  float *out = dt_alloc_align_float((size_t)4 * roi_out.width * roi_out.height);
+  if(!out)
+  {
+    fprintf(stderr, "can't allocate the output buffer\n");
+    return;
+  }
+
+  _resample_t r = { itor, out, &roi_out, in, &roi_in };
+  const dt_bench_times_t t = dt_bench_run(NULL, _resample, &r, runs);
+
+  const double mp_in = 1e-6 * width * height;
+  const double mp_out = 1e-6 * roi_out.width * roi_out.height;
+  printf("%-9s %6.3f  %5dx%-5d  first %8.2f ms  best %8.2f ms  %8.1f MP/s in  %8.1f MP/s out\n",
+         itor->name, scale, roi_out.width, roi_out.height, 1e3 * t.first, 1e3 * t.best,
+         mp_in / t.best, mp_out / t.best);
+
+  dt_free_align(out);
+}
+
+int main(int argc, char *argv[])
+{
+  int width = 6000;
+  int height = 4000;
+  int runs = 5;
+
+  dt_bench_image_args(argc, argv, &width, &height, &runs);
+
+  if(dt_bench_init("darktable-bench-resample", NULL, NULL)) exit(1);
+
+  float *in = dt_alloc_align_float((size_t)4 * width * height);
+  if(!in)
+  {
+    fprintf(stderr, "can't allocate the input buffer\n");
+    exit(1);
+  }
+
+  // smooth gradients with some noise on top, values as in a linear pipe
+  GRand *rand = g_rand_new_with_seed(42);
+  for(int j = 0; j < height; j++)
+    for(int i = 0; i < width; i++)
+    {
+      float *px = in + (size_t)4 * (j * width + i);
+      px[0] = (float)i / width + 0.05f * g_rand_double(rand);
+      px[1] = (float)j / height + 0.05f * g_rand_double(rand);
+      px[2] = 0.5f + 0.05f * g_rand_double(rand);
+      px[3] = 0.0f;
+    }
+  g_rand_free(rand);
+
+  printf("%d threads, %dx%d input, %d runs\n", (int)dt_get_num_threads(), width, height, runs);
+
+  const enum dt_interpolation_type types[] = { DT_INTERPOLATION_BICUBIC, DT_INTERPOLATION_LANCZOS3 };
+  const float scales[] = { 0.5f, 0.3f, 0.12f, 1.5f };
+
+  for(size_t t = 0; t < G_N_ELEMENTS(types); t++)
+    for(size_t s = 0; s < G_N_ELEMENTS(scales); s++)
+      _bench(dt_interpolation_new(types[t]), in, width, height, scales[s], runs);
+
+  dt_free_align(in);
+
+  dt_cleanup();
+
+  return 0;
+}
+
+// clang-format off
+// modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
+// vim: shiftwidth=2 expandtab tabstop=2 cindent
+// kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
+// clang-format on
@@ -0,0 +1,146 @@
+/*
+    This file is part of darktable,
+    Copyright (C) 2025 darktable developers.
+
+    darktable is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    darktable is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with darktable.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+  benchmark of the segmentation used by the highlights reconstruction.
+
+  darktable-bench-segmentation [--width W] [--height H] [--runs N]
+
+  combines and segmentizes a synthetic plane of W x H locations holding
+  clipped blobs of all sizes, as the "segmentation based" highlights
+  reconstruction does for every color plane at a third of the sensor size.
+  this is done with 1, 2, 4 .. up to all threads and the best times are
+  printed with the speedup against a single thread.
+*/
+
+#include "bench.h"
+#include "iop/hlreconstruct/segmentation.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// as used by the highlights module with the default combine radius
+#define BENCH_BORDER 9
+#define BENCH_COMBINE 2
+
+typedef struct _segmentation_t
+{
+  dt_iop_segmentation_t seg;
+  const uint32_t *plane;
+} _segmentation_t;
+
+static void _restore(void *data)
+{
+  _segmentation_t *s = data;
+  memcpy(s->seg.data, s->plane, sizeof(uint32_t) * s->seg.width * s->seg.height);
+}
+
+static void _combine(void *data)
+{
+  _segmentation_t *s = data;
+  dt_segments_combine(&s->seg, BENCH_COMBINE);
+}
+
+static void _restore_combine(void *data)
+{
+  _restore(data);
+  _combine(data);
+}
+
+static void _segmentize(void *data)
+{
+  _segmentation_t *s = data;
+  dt_segmentize_plane(&s->seg);
+}
+
+static void _set_threads(const int threads)
+{
+  darktable.num_openmp_threads = threads;
+#ifdef _OPENMP
+  omp_set_num_threads(threads);
+#endif
+}
+
+int main(int argc, char *argv[])
+{
+  int width = 2016;
+  int height = 1352;
+  int runs = 10;
+
+  dt_bench_image_args(argc, argv, &width, &height, &runs);
+
+  if(dt_bench_init("darktable-bench-segmentation", NULL, NULL)) exit(1);
+
+  // 250 segments per megapixel of the sensor like the highlights module
+  _segmentation_t s = { 0 };
+  const size_t npixels = (size_t)width * height;
+  uint32_t *plane = dt_calloc_aligned(sizeof(uint32_t) * npixels);
+  if(!plane || dt_segmentation_init_struct(&s.seg, width, height, BENCH_BORDER, 9 * npixels / 4000))
+  {
+    fprintf(stderr, "can't allocate the segmentation buffers\n");
+    exit(1);
+  }
+  s.plane = plane;
+
+  // clipped blobs of all sizes and some single clipped locations
+  GRand *rand = g_rand_new_with_seed(42);
+  for(size_t k = 0; k < npixels / 2000; k++)
+  {
+    const int cx = g_rand_int_range(rand, 0, width);
+    const int cy = g_rand_int_range(rand, 0, height);
+    const int r = g_rand_int_range(rand, 1, 40);
+    for(int row = MAX(BENCH_BORDER, cy - r); row < MIN(height - BENCH_BORDER, cy + r); row++)
+      for(int col = MAX(BENCH_BORDER, cx - r); col < MIN(width - BENCH_BORDER, cx + r); col++)
+        if((row - cy) * (row - cy) + (col - cx) * (col - cx) < r * r)
+          plane[(size_t)row * width + col] = 1;
+  }
+  for(size_t k = 0; k < npixels / 200; k++)
+    plane[(size_t)g_rand_int_range(rand, BENCH_BORDER, height - BENCH_BORDER) * width
+          + g_rand_int_range(rand, BENCH_BORDER, width - BENCH_BORDER)] = 1;
+  g_rand_free(rand);
+
+  const int max_threads = dt_get_num_threads();
+  printf("%d threads, %dx%d plane, %d runs\n\n", max_threads, width, height, runs);
+
+  double single = 0.0;
+  for(int threads = 1;; threads = MIN(2 * threads, max_threads))
+  {
+    _set_threads(threads);
+    const double combine = dt_bench_run(_restore, _combine, &s, runs).best;
+    const double segmentize = dt_bench_run(_restore_combine, _segmentize, &s, runs).best;
+    if(threads == 1) single = segmentize;
+
+    printf("%3d threads  combine %8.2f ms  segmentize %8.2f ms  %6d segments  speedup %5.2f\n",
+           threads, 1e3 * combine, 1e3 * segmentize, s.seg.nr - 2, single / segmentize);
+
+    if(threads == max_threads) break;
+  }
+
+  dt_segmentation_free_struct(&s.seg);
+  dt_free_align(plane);
+
+  dt_cleanup();
+
+  return 0;
+}
+
+// clang-format off
+// modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
+// vim: shiftwidth=2 expandtab tabstop=2 cindent
+// kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
+// clang-format on
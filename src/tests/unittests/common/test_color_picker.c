@@ -0,0 +1,244 @@
+/*
+    This file is part of darktable,
+    Copyright (C) 2025 darktable developers.
+
+    darktable is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    darktable is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with darktable.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+ * cmocka unit tests for the color picker tables of common/color_picker.c
+ *
+ * The mean, min and max of boxes given by dt_color_picker_table_stats() are
+ * checked against the ones of scanning the boxes pixel by pixel.
+ *
+ * Please see README.md for more detailed documentation.
+ */
+#include <limits.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <cmocka.h>
+
+#include "../util/assert.h"
+#include "../util/tracing.h"
+
+#include "common/darktable.h"
+#include "common/color_picker.h"
+#include "develop/imageop.h"
+
+#ifdef _WIN32
+#include "win/main_wrapper.h"
+#endif
+
+/*
+ * DEFINITIONS
+ */
+
+// the sums are kept in double, what is left is the rounding of the mean to float
+#define E 1e-6f
+
+// not a multiple of the tiles of the table
+#define WIDTH 203
+#define HEIGHT 141
+#define NPIXELS ((size_t)WIDTH * HEIGHT)
+
+// side of the tiles of which the table keeps the min and max
+#define TILE 16
+
+#define BOXES 2000
+
+/*
+ * HELPERS
+ */
+
+static uint32_t rand_state = 1;
+
+static uint32_t rand_next(void)
+{
+  // xorshift32, the same boxes on every platform
+  rand_state ^= rand_state << 13;
+  rand_state ^= rand_state >> 17;
+  rand_state ^= rand_state << 5;
+  return rand_state;
+}
+
+static int rand_range(const int low, const int high)
+{
+  return low + (int)(rand_next() % (uint32_t)(high - low));
+}
+
+// a position on a tile boundary or next to it, within [low, high]
+static int rand_tile_edge(const int low, const int high)
+{
+  const int edge = TILE * rand_range(0, high / TILE + 1) + rand_range(-1, 2);
+  return CLAMP(edge, low, high);
+}
+
+static float *image_new(void)
+{
+  float *const img = dt_alloc_align_float(4 * NPIXELS);
+  for(size_t k = 0; k < 4 * NPIXELS; k++)
+    img[k] = (rand_next() % 30001) / 10000.0f - 1.0f;
+  return img;
+}
+
+static void check_box(const dt_color_picker_table_t *table,
+                      const float *const img,
+                      const int *const box)
+{
+  lib_colorpicker_stats pick;
+  dt_color_picker_table_stats(table, box, pick);
+
+  double sum[4] = { 0.0, 0.0, 0.0, 0.0 };
+  dt_aligned_pixel_t low = { FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX };
+  dt_aligned_pixel_t high = { -FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX };
+  for(int j = box[1]; j < box[3]; j++)
+    for(int i = box[0]; i < box[2]; i++)
+      for(int c = 0; c < 4; c++)
+      {
+        const float v = img[4 * ((size_t)WIDTH * j + i) + c];
+        sum[c] += v;
+        low[c] = fminf(low[c], v);
+        high[c] = fmaxf(high[c], v);
+      }
+
+  const double size = (double)(box[2] - box[0]) * (box[3] - box[1]);
+  for(int c = 0; c < 4; c++)
+  {
+    assert_float_equal(pick[DT_PICK_MEAN][c], sum[c] / size, E);
+    // the min and max are values of the image, not computed
+    assert_true(pick[DT_PICK_MIN][c] == low[c]);
+    assert_true(pick[DT_PICK_MAX][c] == high[c]);
+  }
+}
+
+/*
+ * TEST FUNCTIONS
+ */
+
+static void test_table_random_boxes(void **state)
+{
+  TR_STEP("verify that random boxes of all kinds match scanning them");
+  rand_state = 1;
+  float *const img = image_new();
+  const dt_iop_roi_t roi = { .width = WIDTH, .height = HEIGHT, .scale = 1.0f };
+  dt_color_picker_table_t *table = dt_color_picker_table_new(img, &roi, FALSE);
+  assert_non_null(table);
+
+  int single = 0, edges = 0;
+  for(int n = 0; n < BOXES; n++)
+  {
+    int box[4];
+    switch(n % 4)
+    {
+      case 0:
+        // a single pixel
+        box[0] = rand_range(0, WIDTH);
+        box[1] = rand_range(0, HEIGHT);
+        box[2] = box[0] + 1;
+        box[3] = box[1] + 1;
+        single++;
+        break;
+      case 1:
+        // on or next to the tile boundaries, so the box holds whole
+        // tiles with none, one or a few pixels around them
+        box[0] = rand_tile_edge(0, WIDTH - 1);
+        box[1] = rand_tile_edge(0, HEIGHT - 1);
+        box[2] = rand_tile_edge(box[0] + 1, WIDTH);
+        box[3] = rand_tile_edge(box[1] + 1, HEIGHT);
+        edges++;
+        break;
+      case 2:
+      {
+        // smaller than a tile or two
+        const int w = rand_range(1, 2 * TILE + 2);
+        const int h = rand_range(1, 2 * TILE + 2);
+        box[0] = rand_range(0, WIDTH);
+        box[1] = rand_range(0, HEIGHT);
+        box[2] = MIN(WIDTH, box[0] + w);
+        box[3] = MIN(HEIGHT, box[1] + h);
+        break;
+      }
+      default:
+        box[0] = rand_range(0, WIDTH);
+        box[1] = rand_range(0, HEIGHT);
+        box[2] = rand_range(box[0] + 1, WIDTH + 1);
+        box[3] = rand_range(box[1] + 1, HEIGHT + 1);
+        break;
+    }
+    check_box(table, img, box);
+  }
+  TR_DEBUG("%d boxes, %d single pixels, %d on tile boundaries", BOXES, single, edges);
+
+  dt_color_picker_table_free(table);
+  dt_free_align(img);
+}
+
+static void test_table_tile_corners(void **state)
+{
+  TR_STEP("verify that every pixel around a tile corner and the image corners match");
+  rand_state = 2;
+  float *const img = image_new();
+  const dt_iop_roi_t roi = { .width = WIDTH, .height = HEIGHT, .scale = 1.0f };
+  dt_color_picker_table_t *table = dt_color_picker_table_new(img, &roi, FALSE);
+  assert_non_null(table);
+
+  for(int y = TILE - 2; y <= TILE + 1; y++)
+    for(int x = TILE - 2; x <= TILE + 1; x++)
+    {
+      const int box[4] = { x, y, x + 1, y + 1 };
+      check_box(table, img, box);
+    }
+
+  const int corners[4][4] = { { 0, 0, 1, 1 },
+                              { WIDTH - 1, 0, WIDTH, 1 },
+                              { 0, HEIGHT - 1, 1, HEIGHT },
+                              { WIDTH - 1, HEIGHT - 1, WIDTH, HEIGHT } };
+  for(int k = 0; k < 4; k++)
+    check_box(table, img, corners[k]);
+
+  // exactly one tile, and the whole image with its partial last tiles
+  const int tile[4] = { TILE, TILE, 2 * TILE, 2 * TILE };
+  check_box(table, img, tile);
+  const int all[4] = { 0, 0, WIDTH, HEIGHT };
+  check_box(table, img, all);
+
+  dt_color_picker_table_free(table);
+  dt_free_align(img);
+}
+
+/*
+ * MAIN FUNCTION
+ */
+int main(int argc, char* argv[])
+{
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_table_random_boxes),
+    cmocka_unit_test(test_table_tile_corners)
+  };
+
+  TR_DEBUG("epsilon = %e", E);
+
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}
+// clang-format off
+// modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
+// vim: shiftwidth=2 expandtab tabstop=2 cindent
+// kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
+// clang-format on
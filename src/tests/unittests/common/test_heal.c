@@ -0,0 +1,253 @@
+/*
+    This file is part of darktable,
+    Copyright (C) 2025 darktable developers.
+
+    darktable is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    darktable is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with darktable.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+ * cmocka unit tests for common/heal.c
+ *
+ * The multigrid solver is checked against a plain Gauss-Seidel solution of
+ * the same problem, iterated until it doesn't change anymore.
+ *
+ * Please see README.md for more detailed documentation.
+ */
+#include <limits.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <cmocka.h>
+
+#include "../util/assert.h"
+#include "../util/tracing.h"
+
+#include "common/darktable.h"
+#include "common/heal.h"
+
+#ifdef _WIN32
+#include "win/main_wrapper.h"
+#endif
+
+/*
+ * DEFINITIONS
+ */
+
+// the solver aims at 0.1%
+#define E 1e-3f
+
+typedef struct heal_case_t
+{
+  int width;
+  int height;
+  float *src;
+  float *dest;
+  float *mask;
+} heal_case_t;
+
+typedef enum heal_shape_t
+{
+  HEAL_SHAPE_DISC,
+  HEAL_SHAPE_BORDER, // touches the left and top image borders
+  HEAL_SHAPE_CROSS,
+  HEAL_SHAPE_NONE
+} heal_shape_t;
+
+/*
+ * HELPERS
+ */
+
+static heal_case_t heal_case_new(const int width, const int height, const heal_shape_t shape)
+{
+  heal_case_t hc = { width, height };
+  hc.src = calloc((size_t)4 * width * height, sizeof(float));
+  hc.dest = calloc((size_t)4 * width * height, sizeof(float));
+  hc.mask = calloc((size_t)width * height, sizeof(float));
+
+  for(int y = 0; y < height; y++)
+    for(int x = 0; x < width; x++)
+    {
+      const size_t k = (size_t)y * width + x;
+      for(int c = 0; c < 4; c++)
+      {
+        hc.src[4 * k + c] = 0.3f + 0.2f * sinf(0.05f * x + c) + 0.1f * cosf(0.07f * y);
+        hc.dest[4 * k + c] = 0.5f + 0.3f * sinf(0.03f * y * (c + 1)) * cosf(0.02f * x)
+                             + 0.05f * ((7 * x + 13 * y) % 17) / 17.0f;
+      }
+      const float dx = x - 0.45f * width;
+      const float dy = y - 0.5f * height;
+      switch(shape)
+      {
+        case HEAL_SHAPE_DISC:
+          hc.mask[k] = dx * dx + dy * dy < 0.09f * height * height;
+          break;
+        case HEAL_SHAPE_BORDER:
+          hc.mask[k] = x < width / 3 && y < height / 2;
+          break;
+        case HEAL_SHAPE_CROSS:
+          hc.mask[k] = (fabsf(dx) < 0.4f * width && fabsf(dy) < 3.0f)
+                       || (fabsf(dy) < 0.4f * height && fabsf(dx) < 4.0f);
+          break;
+        case HEAL_SHAPE_NONE:
+          break;
+      }
+    }
+  return hc;
+}
+
+static void heal_case_free(heal_case_t *hc)
+{
+  free(hc->src);
+  free(hc->dest);
+  free(hc->mask);
+}
+
+// Reference solution: Gauss-Seidel with over-relaxation on dest - src, the masked pixels being set to the
+// average of their neighbours inside the image, until nothing changes anymore.
+static float *heal_reference(const heal_case_t *hc)
+{
+  const int width = hc->width;
+  const int height = hc->height;
+  float *u = malloc(sizeof(float) * 4 * width * height);
+  for(size_t k = 0; k < (size_t)4 * width * height; k++)
+    u[k] = hc->dest[k] - hc->src[k];
+
+  float change = 1.0f;
+  for(int iter = 0; iter < 100000 && change > 1e-9f; iter++)
+  {
+    change = 0.0f;
+    for(int y = 0; y < height; y++)
+      for(int x = 0; x < width; x++)
+      {
+        const size_t k = (size_t)y * width + x;
+        if(!hc->mask[k]) continue;
+        for(int c = 0; c < 4; c++)
+        {
+          float sum = 0.0f;
+          int n = 0;
+          if(x > 0)          { sum += u[4 * (k - 1) + c]; n++; }
+          if(x + 1 < width)  { sum += u[4 * (k + 1) + c]; n++; }
+          if(y > 0)          { sum += u[4 * (k - width) + c]; n++; }
+          if(y + 1 < height) { sum += u[4 * (k + width) + c]; n++; }
+          const float d = 1.8f * (sum / n - u[4 * k + c]);
+          u[4 * k + c] += d;
+          change = fmaxf(change, fabsf(d));
+        }
+      }
+  }
+
+  for(size_t k = 0; k < (size_t)4 * width * height; k++)
+    u[k] += hc->src[k];
+  return u;
+}
+
+static void check_heal(const int width, const int height, const heal_shape_t shape)
+{
+  heal_case_t hc = heal_case_new(width, height, shape);
+  float *expected = heal_reference(&hc);
+  float *orig = malloc(sizeof(float) * 4 * width * height);
+  memcpy(orig, hc.dest, sizeof(float) * 4 * width * height);
+
+  dt_heal(hc.src, hc.dest, hc.mask, width, height, 4, 2000);
+
+  float maxerr = 0.0f;
+  for(size_t k = 0; k < (size_t)width * height; k++)
+    for(int c = 0; c < 3; c++)
+    {
+      if(hc.mask[k])
+        maxerr = fmaxf(maxerr, fabsf(hc.dest[4 * k + c] - expected[4 * k + c]));
+      else
+        // pixels outside of the mask are left alone
+        assert_true(hc.dest[4 * k + c] == orig[4 * k + c]);
+    }
+  TR_DEBUG("%dx%d shape %d: max error %e", width, height, shape, maxerr);
+  assert_true(maxerr < E);
+
+  free(orig);
+  free(expected);
+  heal_case_free(&hc);
+}
+
+/*
+ * TEST FUNCTIONS
+ */
+
+static void test_heal_disc(void **state)
+{
+  TR_STEP("verify that a disc in the middle of the image matches the reference");
+  check_heal(160, 130, HEAL_SHAPE_DISC);
+  TR_STEP("verify that a stamp smaller than the coarsest multigrid level matches the reference");
+  check_heal(40, 30, HEAL_SHAPE_DISC);
+}
+
+static void test_heal_border(void **state)
+{
+  TR_STEP("verify that the image borders inside the mask match the reference");
+  check_heal(151, 121, HEAL_SHAPE_BORDER);
+}
+
+static void test_heal_cross(void **state)
+{
+  TR_STEP("verify that a thin mask, vanishing on coarse levels, matches the reference");
+  check_heal(171, 143, HEAL_SHAPE_CROSS);
+}
+
+static void test_heal_constant(void **state)
+{
+  TR_STEP("verify that a constant difference at the boundary is kept inside the mask");
+  heal_case_t hc = heal_case_new(128, 96, HEAL_SHAPE_DISC);
+  for(size_t k = 0; k < (size_t)128 * 96; k++)
+    for(int c = 0; c < 4; c++)
+      hc.dest[4 * k + c] = hc.mask[k] ? 0.0f : hc.src[4 * k + c] + 0.25f;
+
+  dt_heal(hc.src, hc.dest, hc.mask, 128, 96, 4, 2000);
+
+  for(size_t k = 0; k < (size_t)128 * 96; k++)
+    for(int c = 0; c < 3; c++)
+      assert_float_equal(hc.dest[4 * k + c], hc.src[4 * k + c] + 0.25f, E);
+  heal_case_free(&hc);
+}
+
+static void test_heal_empty(void **state)
+{
+  TR_STEP("verify that nothing changes without a mask");
+  check_heal(64, 48, HEAL_SHAPE_NONE);
+}
+
+/*
+ * MAIN FUNCTION
+ */
+int main(int argc, char* argv[])
+{
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_heal_disc),
+    cmocka_unit_test(test_heal_border),
+    cmocka_unit_test(test_heal_cross),
+    cmocka_unit_test(test_heal_constant),
+    cmocka_unit_test(test_heal_empty)
+  };
+
+  TR_DEBUG("epsilon = %e", E);
+
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}
+// clang-format off
+// modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
+// vim: shiftwidth=2 expandtab tabstop=2 cindent
+// kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
+// clang-format on
@@ -0,0 +1,298 @@
+/*
+    This file is part of darktable,
+    Copyright (C) 2025 darktable developers.
+
+    darktable is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    darktable is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with darktable.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+ * cmocka unit tests for the fused pointwise chains of develop/pixelpipe_hb.c
+ *
+ * Please see README.md for more detailed documentation.
+ */
+#include <limits.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <math.h>
+
+#include <cmocka.h>
+
+#include "../util/assert.h"
+#include "../util/tracing.h"
+
+#include "develop/pixelpipe_hb.c"
+
+#ifdef _WIN32
+#include "win/main_wrapper.h"
+#endif
+
+/*
+ * DEFINITIONS
+ */
+
+// epsilon for floating point comparison, the chain converts between RGB and Lab
+// the same way as the unfused pipe but on smaller parts of the image
+#define E 1e-4f
+
+// more than one chunk and a partial last one
+#define WIDTH 1000
+#define HEIGHT 3
+#define NPIXELS ((size_t)WIDTH * HEIGHT)
+
+#define NMOD 3
+
+static dt_iop_order_iccprofile_info_t work_profile;
+static dt_iop_module_t modules[NMOD];
+static dt_dev_pixelpipe_iop_t pieces[NMOD];
+static dt_develop_t test_dev;
+static dt_dev_pixelpipe_t test_pipe;
+
+/*
+ * MODULE STUBS
+ *
+ * An exposure like RGB module, a Lab module and another RGB module, the same
+ * colorspace layout as exposure -> colorin -> channelmixerrgb.
+ */
+
+static dt_iop_colorspace_type_t _cst_rgb(dt_iop_module_t *self,
+                                         dt_dev_pixelpipe_t *p,
+                                         dt_dev_pixelpipe_iop_t *piece)
+{
+  return IOP_CS_RGB;
+}
+
+static dt_iop_colorspace_type_t _cst_lab(dt_iop_module_t *self,
+                                         dt_dev_pixelpipe_t *p,
+                                         dt_dev_pixelpipe_iop_t *piece)
+{
+  return IOP_CS_LAB;
+}
+
+static void _modify_roi_in(dt_iop_module_t *self,
+                           dt_dev_pixelpipe_iop_t *piece,
+                           const dt_iop_roi_t *roi_out,
+                           dt_iop_roi_t *roi_in)
+{
+  *roi_in = *roi_out;
+}
+
+static void _gain(dt_iop_module_t *self,
+                  dt_dev_pixelpipe_iop_t *piece,
+                  const float *const in,
+                  float *const out,
+                  const size_t npixels)
+{
+  for(size_t k = 0; k < 4 * npixels; k += 4)
+  {
+    for(int c = 0; c < 3; c++) out[k + c] = 2.0f * in[k + c];
+    out[k + 3] = in[k + 3];
+  }
+}
+
+static void _lab_shift(dt_iop_module_t *self,
+                       dt_dev_pixelpipe_iop_t *piece,
+                       const float *const in,
+                       float *const out,
+                       const size_t npixels)
+{
+  for(size_t k = 0; k < 4 * npixels; k += 4)
+  {
+    out[k + 0] = in[k + 0] + 5.0f;
+    out[k + 1] = 0.5f * in[k + 1];
+    out[k + 2] = in[k + 2] - 3.0f;
+    out[k + 3] = in[k + 3];
+  }
+}
+
+static void _offset(dt_iop_module_t *self,
+                    dt_dev_pixelpipe_iop_t *piece,
+                    const float *const in,
+                    float *const out,
+                    const size_t npixels)
+{
+  for(size_t k = 0; k < 4 * npixels; k += 4)
+  {
+    for(int c = 0; c < 3; c++) out[k + c] = in[k + c] + 0.01f;
+    out[k + 3] = in[k + 3];
+  }
+}
+
+/*
+ * SETUP
+ */
+
+static int setup(void **state)
+{
+  // linear sRGB primaries, D50
+  const dt_colormatrix_t rgb_to_xyz = { { 0.4360747f, 0.3850649f, 0.1430804f, 0.0f },
+                                        { 0.2225045f, 0.7168786f, 0.0606169f, 0.0f },
+                                        { 0.0139322f, 0.0971045f, 0.7141733f, 0.0f } };
+  const dt_colormatrix_t xyz_to_rgb = { {  3.1338561f, -1.6168667f, -0.4906146f, 0.0f },
+                                        { -0.9787684f,  1.9161415f,  0.0334540f, 0.0f },
+                                        {  0.0719453f, -0.2289914f,  1.4052427f, 0.0f } };
+  memset(&work_profile, 0, sizeof(work_profile));
+  work_profile.type = DT_COLORSPACE_LIN_REC709;
+  memcpy(work_profile.matrix_in, rgb_to_xyz, sizeof(dt_colormatrix_t));
+  memcpy(work_profile.matrix_out, xyz_to_rgb, sizeof(dt_colormatrix_t));
+  dt_colormatrix_transpose(work_profile.matrix_in_transposed, work_profile.matrix_in);
+  dt_colormatrix_transpose(work_profile.matrix_out_transposed, work_profile.matrix_out);
+
+  memset(&test_dev, 0, sizeof(test_dev));
+  memset(&test_pipe, 0, sizeof(test_pipe));
+  memset(modules, 0, sizeof(modules));
+  memset(pieces, 0, sizeof(pieces));
+
+  const dt_iop_colorspace_type_t cst[NMOD] = { IOP_CS_RGB, IOP_CS_LAB, IOP_CS_RGB };
+  void (*kernels[NMOD])(dt_iop_module_t *, dt_dev_pixelpipe_iop_t *, const float *const, float *const,
+                        const size_t) = { _gain, _lab_shift, _offset };
+  for(int i = 0; i < NMOD; i++)
+  {
+    modules[i].dev = &test_dev;
+    modules[i].iop_order = i + 1;
+    modules[i].input_colorspace = modules[i].output_colorspace = cst[i] == IOP_CS_LAB ? _cst_lab : _cst_rgb;
+    modules[i].modify_roi_in = _modify_roi_in;
+    modules[i].process_pointwise = kernels[i];
+    pieces[i].module = &modules[i];
+    pieces[i].pipe = &test_pipe;
+    pieces[i].enabled = TRUE;
+    pieces[i].process_pointwise_ready = TRUE;
+    pieces[i].dsc_in.channels = 4;
+    pieces[i].dsc_in.datatype = TYPE_FLOAT;
+  }
+
+  return 0;
+}
+
+/*
+ * TEST FUNCTIONS
+ */
+
+static int _collect(GList **chain)
+{
+  GList *mlist = NULL;
+  GList *plist = NULL;
+  for(int i = 0; i < NMOD; i++)
+  {
+    mlist = g_list_append(mlist, &modules[i]);
+    plist = g_list_append(plist, &pieces[i]);
+  }
+
+  const dt_iop_roi_t roi = { .width = WIDTH, .height = HEIGHT, .scale = 1.0f };
+  GList *first_module = NULL;
+  GList *first_piece = NULL;
+  int first_pos = NMOD;
+  const int nmod = _pointwise_chain_collect(&test_pipe, &test_dev, &roi,
+                                            g_list_last(mlist), g_list_last(plist), NMOD, &work_profile,
+                                            chain, &first_module, &first_piece, &first_pos);
+  g_list_free(mlist);
+  g_list_free(plist);
+  return nmod;
+}
+
+static void test_chain_collect(void **state)
+{
+  GList *chain = NULL;
+
+  // RGB -> Lab -> RGB modules form one chain with conversions in between
+  assert_int_equal(_collect(&chain), NMOD);
+  assert_ptr_equal(chain->data, &pieces[0]);
+  assert_ptr_equal(g_list_last(chain)->data, &pieces[NMOD - 1]);
+  g_list_free(chain);
+
+  // a module needing process() ends the chain
+  pieces[1].process_pointwise_ready = FALSE;
+  assert_int_equal(_collect(&chain), 1);
+  g_list_free(chain);
+  pieces[1].process_pointwise_ready = TRUE;
+
+  // without a matrix work profile we can't convert inside the chain
+  work_profile.nonlinearlut = 1;
+  assert_int_equal(_collect(&chain), 1);
+  g_list_free(chain);
+  work_profile.nonlinearlut = 0;
+}
+
+static void test_chain_matches_sequential(void **state)
+{
+  float *const in = dt_alloc_align_float(4 * NPIXELS);
+  float *const fused = dt_alloc_align_float(4 * NPIXELS);
+  float *const sequential = dt_alloc_align_float(4 * NPIXELS);
+
+  for(size_t k = 0; k < NPIXELS; k++)
+  {
+    in[4 * k + 0] = 0.05f + 0.9f * (float)(k % 97) / 97.0f;
+    in[4 * k + 1] = 0.05f + 0.9f * (float)(k % 31) / 31.0f;
+    in[4 * k + 2] = 0.05f + 0.9f * (float)(k % 13) / 13.0f;
+    in[4 * k + 3] = 1.0f;
+  }
+
+  // fused: the chain as set up by _dev_pixelpipe_process_fused()
+  GList *chain = NULL;
+  assert_int_equal(_collect(&chain), NMOD);
+  g_list_free(chain);
+  dt_dev_pixelpipe_iop_t *members[NMOD] = { &pieces[0], &pieces[1], &pieces[2] };
+  const dt_iop_colorspace_type_t cst_from[NMOD] = { IOP_CS_RGB, IOP_CS_RGB, IOP_CS_LAB };
+  const dt_iop_colorspace_type_t cst_to[NMOD] = { IOP_CS_RGB, IOP_CS_LAB, IOP_CS_RGB };
+  _pointwise_chain_run(members, NMOD, cst_from, cst_to, &work_profile, in, fused, NPIXELS);
+
+  // sequential: each module over the whole image, colorspace conversions in between
+  // like dt_ioppr_transform_image_colorspace() does
+  _gain(&modules[0], &pieces[0], in, sequential, NPIXELS);
+  for(size_t k = 0; k < 4 * NPIXELS; k += 4)
+  {
+    dt_aligned_pixel_t lab;
+    dt_ioppr_rgb_matrix_to_lab(sequential + k, lab, work_profile.matrix_in_transposed, work_profile.lut_in,
+                               work_profile.unbounded_coeffs_in, work_profile.lutsize,
+                               work_profile.nonlinearlut);
+    for(int c = 0; c < 3; c++) sequential[k + c] = lab[c];
+  }
+  _lab_shift(&modules[1], &pieces[1], sequential, sequential, NPIXELS);
+  for(size_t k = 0; k < 4 * NPIXELS; k += 4)
+  {
+    dt_aligned_pixel_t rgb;
+    dt_ioppr_lab_to_rgb_matrix(sequential + k, rgb, work_profile.matrix_out_transposed, work_profile.lut_out,
+                               work_profile.unbounded_coeffs_out, work_profile.lutsize,
+                               work_profile.nonlinearlut);
+    for(int c = 0; c < 3; c++) sequential[k + c] = rgb[c];
+  }
+  _offset(&modules[2], &pieces[2], sequential, sequential, NPIXELS);
+
+  for(size_t k = 0; k < 4 * NPIXELS; k++)
+  {
+    assert_float_equal(fused[k], sequential[k], E);
+  }
+
+  dt_free_align(in);
+  dt_free_align(fused);
+  dt_free_align(sequential);
+}
+
+/*
+ * MAIN FUNCTION
+ */
+int main(int argc, char* argv[])
+{
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test_setup(test_chain_collect, setup),
+    cmocka_unit_test_setup(test_chain_matches_sequential, setup)
+  };
+
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}
+// clang-format off
+// modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
+// vim: shiftwidth=2 expandtab tabstop=2 cindent
+// kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
+// clang-format on
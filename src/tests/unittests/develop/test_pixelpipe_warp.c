@@ -0,0 +1,223 @@
+/*
+    This file is part of darktable,
+    Copyright (C) 2025 darktable developers.
+
+    darktable is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    darktable is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with darktable.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+ * cmocka unit tests for the composed warps of develop/pixelpipe_hb.c
+ *
+ * Please see README.md for more detailed documentation.
+ */
+#include <limits.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <math.h>
+
+#include <cmocka.h>
+
+#include "../util/assert.h"
+#include "../util/tracing.h"
+
+#include "develop/pixelpipe_hb.c"
+
+#ifdef _WIN32
+#include "win/main_wrapper.h"
+#endif
+
+/*
+ * DEFINITIONS
+ */
+
+// epsilon for floating point comparison. bilinear interpolation is exact on the
+// linear input, what is left is the error of resampling the warped intermediate
+// images in the sequential run.
+#define E 1e-4f
+
+// more than one strip of rows and a partial last one
+#define SIZE 80
+#define NPIXELS ((size_t)SIZE * SIZE)
+
+#define NMOD 3
+
+static dt_iop_module_t modules[NMOD];
+static dt_dev_pixelpipe_iop_t pieces[NMOD];
+static dt_dev_pixelpipe_t test_pipe;
+
+/*
+ * MODULE STUBS
+ *
+ * Warps shaped like the ones of lens (radial distortion), ashift (rotation and
+ * perspective) and flip (rotation by 90 degrees), in the pipe order of these
+ * modules. All of them scale the image up so the samples stay inside.
+ */
+
+static gboolean _lens_warp(dt_iop_module_t *self,
+                           dt_dev_pixelpipe_iop_t *piece,
+                           const dt_iop_roi_t *const roi_in,
+                           const dt_iop_roi_t *const roi_out,
+                           float *const points,
+                           const size_t points_count)
+{
+  const float c = 0.5f * (SIZE - 1);
+  const float r2max = 2.0f * c * c;
+  for(size_t i = 0; i < points_count * 2; i += 2)
+  {
+    const float u = points[i] - c;
+    const float v = points[i + 1] - c;
+    const float s = 0.8f * (1.0f + 0.05f * (u * u + v * v) / r2max);
+    // clamped to the input like lens does
+    points[i] = fmaxf(fminf(c + s * u, roi_in->width - 1.0f), 0.0f);
+    points[i + 1] = fmaxf(fminf(c + s * v, roi_in->height - 1.0f), 0.0f);
+  }
+  return TRUE;
+}
+
+static gboolean _ashift_warp(dt_iop_module_t *self,
+                             dt_dev_pixelpipe_iop_t *piece,
+                             const dt_iop_roi_t *const roi_in,
+                             const dt_iop_roi_t *const roi_out,
+                             float *const points,
+                             const size_t points_count)
+{
+  const float c = 0.5f * (SIZE - 1);
+  const float cosa = cosf(3.0f * M_PI_F / 180.0f);
+  const float sina = sinf(3.0f * M_PI_F / 180.0f);
+  for(size_t i = 0; i < points_count * 2; i += 2)
+  {
+    const float u = points[i] - c;
+    const float v = points[i + 1] - c;
+    const float w = 1.0f + 0.0005f * u;
+    points[i] = c + 0.8f * (cosa * u - sina * v) / w;
+    points[i + 1] = c + 0.8f * (sina * u + cosa * v) / w;
+  }
+  return TRUE;
+}
+
+static gboolean _flip_warp(dt_iop_module_t *self,
+                           dt_dev_pixelpipe_iop_t *piece,
+                           const dt_iop_roi_t *const roi_in,
+                           const dt_iop_roi_t *const roi_out,
+                           float *const points,
+                           const size_t points_count)
+{
+  // ORIENTATION_SWAP_XY | ORIENTATION_FLIP_X
+  for(size_t i = 0; i < points_count * 2; i += 2)
+  {
+    const float x = points[i + 1];
+    const float y = points[i];
+    points[i] = roi_in->width - 1 - x;
+    points[i + 1] = y;
+  }
+  return TRUE;
+}
+
+/*
+ * SETUP
+ */
+
+static int setup(void **state)
+{
+  memset(&test_pipe, 0, sizeof(test_pipe));
+  memset(modules, 0, sizeof(modules));
+  memset(pieces, 0, sizeof(pieces));
+
+  gboolean (*warps[NMOD])(dt_iop_module_t *, dt_dev_pixelpipe_iop_t *, const dt_iop_roi_t *const,
+                          const dt_iop_roi_t *const, float *const, const size_t) =
+    { _lens_warp, _ashift_warp, _flip_warp };
+  const dt_iop_roi_t roi = { .width = SIZE, .height = SIZE, .scale = 1.0f };
+  for(int i = 0; i < NMOD; i++)
+  {
+    modules[i].iop_order = i + 1;
+    modules[i].distort_warp = warps[i];
+    pieces[i].module = &modules[i];
+    pieces[i].pipe = &test_pipe;
+    pieces[i].enabled = TRUE;
+    pieces[i].processed_roi_in = pieces[i].processed_roi_out = roi;
+  }
+
+  return 0;
+}
+
+/*
+ * TEST FUNCTIONS
+ */
+
+static void test_warp_matches_sequential(void **state)
+{
+  const dt_iop_roi_t roi = { .width = SIZE, .height = SIZE, .scale = 1.0f };
+  float *const in = dt_alloc_align_float(4 * NPIXELS);
+  float *const composed = dt_alloc_align_float(4 * NPIXELS);
+  float *const sequential = dt_alloc_align_float(4 * NPIXELS);
+  float *const tmp = dt_alloc_align_float(4 * NPIXELS);
+  float *const points = dt_alloc_align_float(2 * (size_t)SIZE * DT_PIPE_WARP_ROWS);
+  uint8_t *const valid = dt_alloc_aligned((size_t)SIZE * DT_PIPE_WARP_ROWS);
+
+  for(size_t k = 0; k < NPIXELS; k++)
+  {
+    const float x = k % SIZE;
+    const float y = k / SIZE;
+    in[4 * k + 0] = x / SIZE;
+    in[4 * k + 1] = y / SIZE;
+    in[4 * k + 2] = 0.5f * (x + y) / SIZE;
+    in[4 * k + 3] = 1.0f;
+  }
+
+  const struct dt_interpolation *const interpolation = dt_interpolation_new(DT_INTERPOLATION_BILINEAR);
+
+  // composed: lens, ashift and flip mapped at once and resampled once
+  dt_dev_pixelpipe_iop_t *members[NMOD] = { &pieces[0], &pieces[1], &pieces[2] };
+  _warp_chain_run(members, NMOD, interpolation, in, &roi, composed, &roi, points, valid);
+
+  // sequential: each module resamples the output of the previous one
+  _warp_chain_run(&members[0], 1, interpolation, in, &roi, sequential, &roi, points, valid);
+  _warp_chain_run(&members[1], 1, interpolation, sequential, &roi, tmp, &roi, points, valid);
+  _warp_chain_run(&members[2], 1, interpolation, tmp, &roi, sequential, &roi, points, valid);
+
+  for(size_t k = 0; k < 4 * NPIXELS; k++)
+  {
+    assert_float_equal(composed[k], sequential[k], E);
+  }
+
+  // the flip really is a rotation: the top left pixel comes from the top right
+  // of the ashift output, which is bright in red and dark in green
+  assert_true(composed[0] > 0.5f);
+  assert_true(composed[1] < 0.5f);
+
+  dt_free_align(in);
+  dt_free_align(composed);
+  dt_free_align(sequential);
+  dt_free_align(tmp);
+  dt_free_align(points);
+  dt_free_align(valid);
+}
+
+/*
+ * MAIN FUNCTION
+ */
+int main(int argc, char* argv[])
+{
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test_setup(test_warp_matches_sequential, setup)
+  };
+
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}
+// clang-format off
+// modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
+// vim: shiftwidth=2 expandtab tabstop=2 cindent
+// kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
+// clang-format on
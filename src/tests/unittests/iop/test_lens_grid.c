@@ -0,0 +1,234 @@
+/*
+    This file is part of darktable,
+    Copyright (C) 2025 darktable developers.
+
+    darktable is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    darktable is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with darktable.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+ * cmocka unit tests for the distortion grids of iop/lens/grid.c
+ *
+ * A grid accepted by _grid_make() has to be within the tolerance for every
+ * pixel of the image, the borders included, not only at the positions it
+ * checks. Distortions a grid can't follow have to be rejected.
+ *
+ * Please see README.md for more detailed documentation.
+ */
+#include <limits.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <cmocka.h>
+
+#include "../util/assert.h"
+#include "../util/tracing.h"
+
+#include "common/darktable.h"
+#include "iop/lens/grid.c"
+
+#ifdef _WIN32
+#include "win/main_wrapper.h"
+#endif
+
+/*
+ * DEFINITIONS
+ */
+
+// not a multiple of any grid step
+#define WIDTH 601
+#define HEIGHT 401
+
+// a radial distortion with a term only strong in the corners and some
+// lateral chromatic aberration
+typedef struct radial_t
+{
+  float cx, cy;
+  float norm;
+  float k1;  // coefficient of r^2
+  float k6;  // coefficient of r^12
+  float tca[3];
+  gboolean nan; // gives NaNs in the right half
+} radial_t;
+
+static radial_t radial_new(const float k1, const float k6)
+{
+  const radial_t r = { 0.5f * (WIDTH - 1), 0.5f * (HEIGHT - 1),
+                       1.0f / sqrtf(0.25f * WIDTH * WIDTH + 0.25f * HEIGHT * HEIGHT),
+                       k1, k6, { 1.0005f, 1.0f, 0.9995f }, FALSE };
+  return r;
+}
+
+static void radial_distort(const void *data, const float x, const float y, float res[6])
+{
+  const radial_t *r = (const radial_t *)data;
+  const float u = (x - r->cx) * r->norm;
+  const float v = (y - r->cy) * r->norm;
+  const float r2 = u * u + v * v;
+  const float r6 = r2 * r2 * r2;
+  const float f = 1.0f + r->k1 * r2 + r->k6 * r6 * r6;
+  for(int c = 0; c < 3; c++)
+  {
+    res[2 * c] = r->cx + u * f * r->tca[c] / r->norm;
+    res[2 * c + 1] = r->cy + v * f * r->tca[c] / r->norm;
+  }
+  if(r->nan && x > r->cx)
+    res[0] = NAN;
+}
+
+/*
+ * HELPERS
+ */
+
+// the largest error of the grid over all pixels of the image
+static float dense_error(const dt_iop_lens_grid_t *g, const radial_t *r)
+{
+  float *approx = dt_alloc_align_float((size_t)6 * WIDTH);
+  float error = 0.0f;
+  for(int y = 0; y < HEIGHT; y++)
+  {
+    _grid_apply(g, 0.0f, y, WIDTH, approx);
+    for(int x = 0; x < WIDTH; x++)
+    {
+      float exact[6];
+      radial_distort(r, x, y, exact);
+      for(int c = 0; c < 6; c++)
+        error = fmaxf(error, fabsf(exact[c] - approx[6 * x + c]));
+    }
+  }
+  dt_free_align(approx);
+  return error;
+}
+
+/*
+ * TEST FUNCTIONS
+ */
+
+static void test_grid_samples(void **state)
+{
+  for(int step = DT_IOP_LENS_GRID_MIN_STEP; step <= DT_IOP_LENS_GRID_STEP; step *= 2)
+  {
+    for(int size = 1; size < 200; size++)
+    {
+      float pos[2 * 200 / DT_IOP_LENS_GRID_MIN_STEP + 6];
+      const int n = _grid_samples(pos, size, step);
+      assert_true(n <= 2 * size / step + 6);
+
+      // the first and last pixel
+      assert_float_equal(pos[0], 0.0f, 0.0f);
+      assert_float_equal(pos[n - 1], size - 1, 0.0f);
+
+      int first = 0, last = 0;
+      for(int k = 0; k < n; k++)
+      {
+        assert_true(pos[k] >= 0.0f && pos[k] <= size - 1);
+        if(k) assert_true(pos[k] >= pos[k - 1]);
+        // no more than three cells between the checked ones
+        if(k) assert_true(pos[k] - pos[k - 1] <= 3 * step);
+        if(pos[k] > 0.0f && pos[k] < step) first++;
+        if(pos[k] > size - 1 - step && pos[k] < size - 1) last++;
+      }
+      // the cells at the borders within the cell, not only at the nodes
+      if(size > step)
+      {
+        assert_true(first >= 2);
+        assert_true(last >= 1);
+      }
+    }
+  }
+}
+
+static void test_grid_coarse(void **state)
+{
+  // a moderate barrel distortion only needs the coarsest grid
+  const radial_t r = radial_new(-0.05f, 0.0f);
+  dt_iop_lens_grid_t g = { 0 };
+  const float error = _grid_make(&g, radial_distort, &r, WIDTH, HEIGHT);
+  TR_DEBUG("step %d, error %e", g.step, error);
+
+  assert_non_null(g.map);
+  assert_int_equal(g.step, DT_IOP_LENS_GRID_STEP);
+  assert_true(error <= DT_IOP_LENS_GRID_TOLERANCE);
+  assert_true(dense_error(&g, &r) <= DT_IOP_LENS_GRID_TOLERANCE);
+
+  dt_free_align(g.map);
+}
+
+static void test_grid_corners(void **state)
+{
+  // strong in the corners only, a finer grid is needed there
+  const radial_t r = radial_new(-0.2f, 0.5f);
+  dt_iop_lens_grid_t g = { 0 };
+  const float error = _grid_make(&g, radial_distort, &r, WIDTH, HEIGHT);
+  const float dense = g.map ? dense_error(&g, &r) : INFINITY;
+  TR_DEBUG("step %d, error %e, dense error %e", g.step, error, dense);
+
+  assert_non_null(g.map);
+  assert_true(g.step < DT_IOP_LENS_GRID_STEP);
+  assert_true(error <= DT_IOP_LENS_GRID_TOLERANCE);
+  assert_true(dense <= DT_IOP_LENS_GRID_TOLERANCE);
+
+  dt_free_align(g.map);
+}
+
+static void test_grid_rejected(void **state)
+{
+  // no grid is accurate enough in the corners, the exact coordinates have to be used
+  const radial_t r = radial_new(-0.2f, 5.0f);
+  dt_iop_lens_grid_t g = { 0 };
+  const float error = _grid_make(&g, radial_distort, &r, WIDTH, HEIGHT);
+  TR_DEBUG("step %d, error %e", g.step, error);
+
+  assert_null(g.map);
+  assert_int_equal(g.step, DT_IOP_LENS_GRID_MIN_STEP);
+  assert_true(error > DT_IOP_LENS_GRID_TOLERANCE);
+}
+
+static void test_grid_nan(void **state)
+{
+  // the coordinates are not continuous, there is no point in trying finer grids
+  radial_t r = radial_new(-0.05f, 0.0f);
+  r.nan = TRUE;
+  dt_iop_lens_grid_t g = { 0 };
+  const float error = _grid_make(&g, radial_distort, &r, WIDTH, HEIGHT);
+
+  assert_null(g.map);
+  assert_int_equal(g.step, DT_IOP_LENS_GRID_STEP);
+  assert_false(isfinite(error));
+}
+
+/*
+ * MAIN FUNCTION
+ */
+int main(int argc, char* argv[])
+{
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_grid_samples),
+    cmocka_unit_test(test_grid_coarse),
+    cmocka_unit_test(test_grid_corners),
+    cmocka_unit_test(test_grid_rejected),
+    cmocka_unit_test(test_grid_nan)
+  };
+
+  TR_DEBUG("tolerance = %e", DT_IOP_LENS_GRID_TOLERANCE);
+
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}
+// clang-format off
+// modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
+// vim: shiftwidth=2 expandtab tabstop=2 cindent
+// kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
+// clang-format on
@@ -0,0 +1,438 @@
+/*
+    This file is part of darktable,
+    Copyright (C) 2025 darktable developers.
+
+    darktable is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    darktable is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with darktable.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+ * cmocka unit tests for iop/hlreconstruct/segmentation.c
+ *
+ * The parallel labelling is checked against the sequential floodfill it
+ * replaced, which is kept here as the reference. Both must find the same
+ * segments with the same id's and sizes. The marked segment borders differ
+ * next to the top and left margins only, see dt_segmentize_plane().
+ *
+ * Please see README.md for more detailed documentation.
+ */
+#include <limits.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "../util/assert.h"
+#include "../util/tracing.h"
+
+#include "common/darktable.h"
+#include "iop/hlreconstruct/segmentation.c"
+
+#ifdef _WIN32
+#include "win/main_wrapper.h"
+#endif
+
+/*
+ * DEFINITIONS
+ */
+
+// the border used by the segmentation based highlights reconstruction
+#define BORDER 9
+
+// enough rows for several stripes, not a multiple of the stripe rows
+#define WIDTH 211
+#define HEIGHT 157
+
+#define SLOTS 0x4000
+
+/*
+ * REFERENCE
+ *
+ * The sequential floodfill as it was before the labelling was parallelized.
+ */
+
+typedef struct ref_pos_t
+{
+  int xpos;
+  int ypos;
+} ref_pos_t;
+
+typedef struct ref_stack_t
+{
+  int pos;
+  int size;
+  ref_pos_t *el;
+} ref_stack_t;
+
+static void ref_push(const int xpos, const int ypos, ref_stack_t *stack)
+{
+  assert_true(stack->pos < stack->size - 1);
+  stack->el[stack->pos].xpos = xpos;
+  stack->el[stack->pos].ypos = ypos;
+  stack->pos++;
+}
+
+static void ref_mark(dt_iop_segmentation_t *seg,
+                     const int x,
+                     const int y,
+                     const int id,
+                     int *box)
+{
+  uint32_t *d = seg->data + (size_t)y * seg->width + x;
+  if(*d)
+    return;
+  *d = DT_SEG_ID_MASK | id;
+  box[0] = MIN(box[0], x);
+  box[1] = MAX(box[1], x);
+  box[2] = MIN(box[2], y);
+  box[3] = MAX(box[3], y);
+}
+
+static gboolean ref_floodfill(const int yin,
+                              const int xin,
+                              dt_iop_segmentation_t *seg,
+                              const int id,
+                              ref_stack_t *stack)
+{
+  const int w = seg->width;
+  const int h = seg->height;
+  const int border = seg->border;
+  uint32_t *d = seg->data;
+  int box[4] = { xin, xin, yin, yin };
+  int cnt = 0;
+  stack->pos = 0;
+  _clear_segment_slot(seg, id);
+
+  ref_push(xin, yin, stack);
+  while(stack->pos)
+  {
+    stack->pos--;
+    const int x = stack->el[stack->pos].xpos;
+    const int y = stack->el[stack->pos].ypos;
+    if(d[y*w+x] != 1)
+      continue;
+
+    const int yUp = y - 1, yDown = y + 1;
+    gboolean lastXUp = FALSE, lastXDown = FALSE, firstXUp = FALSE, firstXDown = FALSE;
+    d[y*w+x] = id;
+    cnt++;
+    if(yUp >= border && d[yUp*w+x] == 1)
+    {
+      ref_push(x, yUp, stack); firstXUp = lastXUp = TRUE;
+    }
+    else if(x > border+1) // the column test the parallel labelling doesn't reproduce
+      ref_mark(seg, x, yUp, id, box);
+
+    if(yDown < h-border && d[yDown*w+x] == 1)
+    {
+      ref_push(x, yDown, stack); firstXDown = lastXDown = TRUE;
+    }
+    else if(yDown < h-border-2)
+      ref_mark(seg, x, yDown, id, box);
+
+    int xr = x + 1;
+    while(xr < w-border && d[y*w+xr] == 1)
+    {
+      d[y*w+xr] = id;
+      cnt++;
+      if(yUp >= border && d[yUp*w+xr] == 1)
+      {
+        if(!lastXUp) { ref_push(xr, yUp, stack); lastXUp = TRUE; }
+      }
+      else
+      {
+        if(yUp > border+1) ref_mark(seg, xr, yUp, id, box);
+        lastXUp = FALSE;
+      }
+
+      if(yDown < h-border && d[yDown*w+xr] == 1)
+      {
+        if(!lastXDown) { ref_push(xr, yDown, stack); lastXDown = TRUE; }
+      }
+      else
+      {
+        if(yDown < h-border-2) ref_mark(seg, xr, yDown, id, box);
+        lastXDown = FALSE;
+      }
+      xr++;
+    }
+    if(xr < w-border-2) ref_mark(seg, xr, y, id, box);
+
+    int xl = x - 1;
+    lastXUp = firstXUp;
+    lastXDown = firstXDown;
+    while(xl >= border && d[y*w+xl] == 1)
+    {
+      d[y*w+xl] = id;
+      cnt++;
+      if(yUp >= border && d[yUp*w+xl] == 1)
+      {
+        if(!lastXUp) { ref_push(xl, yUp, stack); lastXUp = TRUE; }
+      }
+      else
+      {
+        if(yUp > border+1) ref_mark(seg, xl, yUp, id, box);
+        lastXUp = FALSE;
+      }
+
+      if(yDown < h-border && d[yDown*w+xl] == 1)
+      {
+        if(!lastXDown) { ref_push(xl, yDown, stack); lastXDown = TRUE; }
+      }
+      else
+      {
+        if(yDown < h-border-2) ref_mark(seg, xl, yDown, id, box);
+        lastXDown = FALSE;
+      }
+      xl--;
+    }
+    if(xl > border+1) ref_mark(seg, xl, y, id, box);
+  }
+
+  if(cnt < 4)
+  {
+    /* revert the segment and its border marks. The floodfill only looked at the box of the
+       marks, that could miss locations of the segment if the marks next to them had been
+       taken by other segments. Their stale id's then were reused by the next segment, here
+       they are reverted too. All of them are within 2 of the first location.
+    */
+    for(int row = MIN(box[2], yin - 2); row <= MAX(box[3], yin + 2); row++)
+      for(int col = MIN(box[0], xin - 2); col <= MAX(box[1], xin + 2); col++)
+      {
+        const size_t loc = (size_t)w*row + col;
+        if(d[loc] == id)
+          d[loc] = 1;
+        else if(d[loc] == (id | DT_SEG_ID_MASK))
+          d[loc] = 0;
+      }
+    return FALSE;
+  }
+
+  seg->size[id] = cnt;
+  seg->xmin[id] = box[0];
+  seg->xmax[id] = box[1];
+  seg->ymin[id] = box[2];
+  seg->ymax[id] = box[3];
+  seg->nr += 1;
+  _clear_segment_slot(seg, id+1);
+  return TRUE;
+}
+
+static void ref_segmentize(dt_iop_segmentation_t *seg)
+{
+  ref_stack_t stack = { 0, seg->width * seg->height, NULL };
+  stack.el = malloc(sizeof(ref_pos_t) * stack.size);
+  assert_non_null(stack.el);
+
+  int id = 2;
+  for(int row = seg->border; row < seg->height - seg->border; row++)
+    for(int col = seg->border; col < seg->width - seg->border; col++)
+      if(seg->data[(size_t)seg->width * row + col] == 1 && ref_floodfill(row, col, seg, id, &stack))
+        id++;
+
+  free(stack.el);
+}
+
+/*
+ * HELPERS
+ */
+
+static uint32_t rand_state = 1;
+
+// xorshift, so the planes are the same on all platforms
+static uint32_t next_rand(void)
+{
+  rand_state ^= rand_state << 13;
+  rand_state ^= rand_state >> 17;
+  rand_state ^= rand_state << 5;
+  return rand_state;
+}
+
+static void set_threads(const int threads)
+{
+  // as dt_init() does, never more than the processors
+  darktable.num_openmp_threads = threads;
+#ifdef _OPENMP
+  omp_set_num_threads(dt_get_num_threads());
+#endif
+}
+
+// discs and rectangles of all sizes on sparse noise, also touching the margins
+static void fill_plane(dt_iop_segmentation_t *seg, const uint32_t seed)
+{
+  const int border = seg->border;
+  rand_state = seed;
+  memset(seg->data, 0, sizeof(uint32_t) * seg->width * seg->height);
+
+  for(int row = border; row < seg->height - border; row++)
+    for(int col = border; col < seg->width - border; col++)
+      if(next_rand() % 100 < 25)
+        seg->data[(size_t)row * seg->width + col] = 1;
+
+  for(int k = 0; k < 60; k++)
+  {
+    const int cx = next_rand() % seg->width;
+    const int cy = next_rand() % seg->height;
+    const int r = 1 + next_rand() % 12;
+    const gboolean disc = next_rand() % 2;
+    for(int row = MAX(border, cy - r); row <= MIN(seg->height - border - 1, cy + r); row++)
+      for(int col = MAX(border, cx - r); col <= MIN(seg->width - border - 1, cx + r); col++)
+        if(!disc || (row - cy) * (row - cy) + (col - cx) * (col - cx) <= r * r)
+          seg->data[(size_t)row * seg->width + col] = next_rand() % 8 ? 1 : 0;
+  }
+}
+
+static dt_iop_segmentation_t new_segmentation(void)
+{
+  dt_iop_segmentation_t seg;
+  assert_false(dt_segmentation_init_struct(&seg, WIDTH, HEIGHT, BORDER, SLOTS));
+  return seg;
+}
+
+// the locations next to the top and left margins, the only ones where the marks may differ
+static gboolean in_margin(const int row, const int col)
+{
+  return row <= BORDER + 1 || col <= BORDER + 1;
+}
+
+static uint32_t unmarked(const uint32_t v)
+{
+  return (v & DT_SEG_ID_MASK) ? 0 : v;
+}
+
+static gboolean next_to_segment(const dt_iop_segmentation_t *seg, const size_t loc, const uint32_t id)
+{
+  const uint32_t *d = seg->data;
+  return d[loc - 1] == id || d[loc + 1] == id || d[loc - seg->width] == id || d[loc + seg->width] == id;
+}
+
+/*
+ * TEST FUNCTIONS
+ */
+
+static void test_segmentize_matches_floodfill(void **state)
+{
+  for(uint32_t seed = 1; seed <= 20; seed++)
+  {
+    dt_iop_segmentation_t seg = new_segmentation();
+    dt_iop_segmentation_t ref = new_segmentation();
+    fill_plane(&seg, seed);
+    memcpy(ref.data, seg.data, sizeof(uint32_t) * WIDTH * HEIGHT);
+
+    dt_segmentize_plane(&seg);
+    ref_segmentize(&ref);
+
+    TR_DEBUG("seed %u: %d segments", seed, seg.nr - 2);
+    assert_true(seg.nr > 10);
+    assert_int_equal(seg.nr, ref.nr);
+
+    int *top = malloc(sizeof(int) * seg.nr);
+    int *left = malloc(sizeof(int) * seg.nr);
+    for(int id = 0; id < seg.nr; id++)
+      top[id] = left[id] = INT_MAX;
+
+    for(int row = 0; row < HEIGHT; row++)
+      for(int col = 0; col < WIDTH; col++)
+      {
+        const size_t loc = (size_t)row * WIDTH + col;
+        const uint32_t v = seg.data[loc];
+        const uint32_t r = ref.data[loc];
+
+        // the same segments everywhere, the same marks away from the top and left margins
+        assert_int_equal(unmarked(v), unmarked(r));
+        if(!in_margin(row, col))
+          assert_int_equal(v, r);
+
+        // where they differ both only mark locations next to their segment
+        if(v & DT_SEG_ID_MASK)
+          assert_true(next_to_segment(&seg, loc, v & (DT_SEG_ID_MASK - 1)));
+        if(r & DT_SEG_ID_MASK)
+          assert_true(next_to_segment(&ref, loc, r & (DT_SEG_ID_MASK - 1)));
+
+        if(v > 1 && v < DT_SEG_ID_MASK)
+        {
+          top[v] = MIN(top[v], row);
+          left[v] = MIN(left[v], col);
+        }
+      }
+
+    for(int id = 2; id < seg.nr; id++)
+    {
+      assert_int_equal(seg.size[id], ref.size[id]);
+      // the boxes include the marks, they are the same if none of them is next to the margins
+      if(top[id] > BORDER + 2 && left[id] > BORDER + 2)
+      {
+        assert_int_equal(seg.xmin[id], ref.xmin[id]);
+        assert_int_equal(seg.xmax[id], ref.xmax[id]);
+        assert_int_equal(seg.ymin[id], ref.ymin[id]);
+        assert_int_equal(seg.ymax[id], ref.ymax[id]);
+      }
+    }
+
+    free(top);
+    free(left);
+    dt_segmentation_free_struct(&seg);
+    dt_segmentation_free_struct(&ref);
+  }
+}
+
+static void test_segmentize_thread_independent(void **state)
+{
+  dt_iop_segmentation_t single = new_segmentation();
+  fill_plane(&single, 42);
+  set_threads(1);
+  dt_segmentize_plane(&single);
+
+  for(int threads = 2; threads <= 8; threads++)
+  {
+    dt_iop_segmentation_t seg = new_segmentation();
+    fill_plane(&seg, 42);
+    set_threads(threads);
+    dt_segmentize_plane(&seg);
+
+    assert_int_equal(seg.nr, single.nr);
+    assert_memory_equal(seg.data, single.data, sizeof(uint32_t) * WIDTH * HEIGHT);
+    assert_memory_equal(seg.size + 2, single.size + 2, sizeof(int) * (single.nr - 2));
+    assert_memory_equal(seg.xmin + 2, single.xmin + 2, sizeof(int) * (single.nr - 2));
+    assert_memory_equal(seg.xmax + 2, single.xmax + 2, sizeof(int) * (single.nr - 2));
+    assert_memory_equal(seg.ymin + 2, single.ymin + 2, sizeof(int) * (single.nr - 2));
+    assert_memory_equal(seg.ymax + 2, single.ymax + 2, sizeof(int) * (single.nr - 2));
+    dt_segmentation_free_struct(&seg);
+  }
+
+  dt_segmentation_free_struct(&single);
+}
+
+/*
+ * MAIN FUNCTION
+ */
+int main(int argc, char* argv[])
+{
+  // there is no dt_init(), use up to 4 threads so the plane is cut into stripes
+  set_threads(4);
+
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_segmentize_matches_floodfill),
+    cmocka_unit_test(test_segmentize_thread_independent)
+  };
+
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}
+// clang-format off
+// modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
+// vim: shiftwidth=2 expandtab tabstop=2 cindent
+// kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
+// clang-format on
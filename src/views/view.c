@@ -754,6 +754,7 @@ dt_view_surface_value_t dt_view_image_get_surface(const dt_imgid_t imgid,
 
   // we transfer cached image on a cairo_surface (with colorspace transform if needed)
   cairo_surface_t *tmp_surface = NULL;
+  gboolean focus_peaking_pending = FALSE;
   uint8_t *rgbbuf = calloc((size_t)buf_wd * buf_ht * 4, sizeof(uint8_t));
   if(rgbbuf)
   {
@@ -855,17 +856,22 @@ dt_view_surface_value_t dt_view_image_get_surface(const dt_imgid_t imgid,
                                : darktable.gui->filter_image);
 
     cairo_paint(cr);
-    /* from focus_peaking.h
-       static inline void dt_focuspeaking(cairo_t *cr, int width, int height,
-                                       uint8_t *const restrict image,
-                                       const int buf_width, const int buf_height)
-
-       The current implementation assumes the data at image is
-       organized as a rectangle without a stride, So we pass the raw
-       data to be processed, this is more data but correct.
-    */
+    // the overlay is computed in the background from the unscaled
+    // thumbnail, which has no stride. until it is there the surface is
+    // reported as not complete so that the thumbnail asks again.
     if(darktable.gui->show_focus_peaking && mip == buf.size)
-      dt_focuspeaking(cr, buf_wd, buf_ht, rgbbuf);
+    {
+      gboolean ready = FALSE;
+      cairo_surface_t *overlay =
+        dt_focuspeaking_get_overlay(imgid, mip, 0, buf_wd, buf_ht, rgbbuf, &ready);
+      if(overlay)
+      {
+        dt_focuspeaking_paint(cr, overlay);
+        cairo_surface_destroy(overlay);
+      }
+      if(!ready)
+        focus_peaking_pending = TRUE;
+    }
 
     cairo_surface_destroy(tmp_surface);
     cairo_destroy(cr);
@@ -874,7 +880,7 @@ dt_view_surface_value_t dt_view_image_get_surface(const dt_imgid_t imgid,
   // we consider skull/error as ok as the image hasn't to be reload
   if(buf_wd <= 30 && buf_ht <= 30)
     ret = DT_VIEW_SURFACE_OK;
-  else if(mip != buf.size)
+  else if(mip != buf.size || focus_peaking_pending)
     ret = DT_VIEW_SURFACE_SMALLER;
   else
     ret = DT_VIEW_SURFACE_OK;
@@ -1803,8 +1809,21 @@ void dt_view_paint_surface(cairo_t *cr,
     if(darktable.gui->show_focus_peaking
       && window != DT_WINDOW_SLIDESHOW)
     {
-      dt_focuspeaking(cr, buf_width, buf_height,
-                      cairo_image_surface_get_data(surface));
+      // the backbuf of the pipe comes with its hash, snapshots and
+      // duplicate previews have to be looked at
+      const dt_hash_t hash = buf == port->pipe->backbuf
+        ? port->pipe->backbuf_hash
+        : dt_hash(DT_INITHASH, buf, sizeof(uint8_t) * 4 * buf_width * buf_height);
+      // the previous one until it is there, we are redrawn then
+      gboolean ready = FALSE;
+      cairo_surface_t *overlay =
+        dt_focuspeaking_get_overlay(dev->image_storage.id, DT_MIPMAP_NONE, hash,
+                                    buf_width, buf_height, buf, &ready);
+      if(overlay)
+      {
+        dt_focuspeaking_paint(cr, overlay);
+        cairo_surface_destroy(overlay);
+      }
     }
     cairo_surface_destroy(surface);
   }